@@ -0,0 +1,90 @@
+#include <iostream>
+#include <string_view>
+
+#define NOMINMAX
+
+#include "Core/Logging.h"
+#include "Engine/BoundingVolumeHierarchy.h"
+#include "Importers/PMesh.h"
+#include "Math/VectorMath.h"
+#include "Renderer/Sampler.h"
+#include "Renderer/Pipeline/Rasterizer.h"
+
+/**
+ * A benchmark of the engine, which compares each of its implementations on the same work and logs how long they take.
+ **/
+struct Benchmark
+{
+	std::string_view name;
+	void (*run)();
+};
+
+static constexpr Benchmark g_benchmarks[] = {
+	{ "rasterizer", [] { Rasterizer::benchmark(); } },
+	{ "bvh", [] { BoundingVolumeHierarchy::benchmark(); } },
+	{ "sampler", [] { Sampler::benchmark(); } },
+	{ "vector", [] { VectorMath::benchmark(); } },
+	{ "pmesh", [] { PMesh::benchmark(); } },
+};
+
+static void printUsage()
+{
+	std::cout << "Usage: PBenchmark [name...]\nRuns the named benchmarks, or all of them if none are named:\n";
+	for (const Benchmark& benchmark : g_benchmarks)
+	{
+		std::cout << "  " << benchmark.name << '\n';
+	}
+}
+
+static void runBenchmark(const Benchmark& benchmark)
+{
+	LOG_INFO("Running the {} benchmark.", benchmark.name)
+	benchmark.run();
+
+#if _WIN32
+	// The log only goes to the debugger on Windows, so echo the results to the console
+	Logging::Logger* logger = Logging::Logger::get();
+	for (const Logging::ELogLevel level : { Logging::ELogLevel::Info, Logging::ELogLevel::Warning, Logging::ELogLevel::Error })
+	{
+		for (const std::string& message : logger->getMessages(level))
+		{
+			std::cout << message;
+		}
+	}
+	logger->clear();
+#endif
+}
+
+int main(int argc, char* argv[])
+{
+	if (argc == 1)
+	{
+		for (const Benchmark& benchmark : g_benchmarks)
+		{
+			runBenchmark(benchmark);
+		}
+		return 0;
+	}
+
+	for (int32 index = 1; index < argc; index++)
+	{
+		const std::string_view name = argv[index];
+		const Benchmark*	   found = nullptr;
+		for (const Benchmark& benchmark : g_benchmarks)
+		{
+			if (benchmark.name == name)
+			{
+				found = &benchmark;
+			}
+		}
+		if (found == nullptr)
+		{
+			std::cout << "Unknown benchmark '" << name << "'.\n";
+			printUsage();
+			return 1;
+		}
+		runBenchmark(*found);
+	}
+
+	return 0;
+}
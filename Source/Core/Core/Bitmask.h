@@ -25,15 +25,15 @@
     inline Enum& operator|=(Enum& Lhs, Enum Rhs) {                  \
         return Lhs = static_cast<Enum>(                             \
                    static_cast<std::underlying_type_t<Enum>>(Lhs) | \
-                   static_cast<std::underlying_type_t<Enum>>(Lhs)); \
+                   static_cast<std::underlying_type_t<Enum>>(Rhs)); \
     }                                                               \
     inline Enum& operator&=(Enum& Lhs, Enum Rhs) {                  \
         return Lhs = static_cast<Enum>(                             \
                    static_cast<std::underlying_type_t<Enum>>(Lhs) & \
-                   static_cast<std::underlying_type_t<Enum>>(Lhs)); \
+                   static_cast<std::underlying_type_t<Enum>>(Rhs)); \
     }                                                               \
     inline Enum& operator^=(Enum& Lhs, Enum Rhs) {                  \
         return Lhs = static_cast<Enum>(                             \
                    static_cast<std::underlying_type_t<Enum>>(Lhs) ^ \
-                   static_cast<std::underlying_type_t<Enum>>(Lhs)); \
+                   static_cast<std::underlying_type_t<Enum>>(Rhs)); \
     }
@@ -19,4 +19,22 @@
 
 #if defined(_WIN32) || defined(_WIN64)
 	#define WINDOWS_PLATFORM
-#endif
\ No newline at end of file
+#endif
+// Defined on x86 and x64, the only architectures with the SSE and AVX instruction sets. Code using their intrinsics
+// must be guarded by this, with a scalar path for every other architecture.
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+	#define PENG_X86
+#endif
+// Allows a single function to use AVX2 instructions regardless of the architecture the rest of the
+// project is compiled for. Callers must check the CPU supports AVX2 before calling these functions.
+#if defined(_MSC_VER)
+	#define TARGET_AVX2
+#else
+	#define TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+// As TARGET_AVX2, for SSE4.1. Callers must check the CPU supports SSE4.1 before calling these functions.
+#if defined(_MSC_VER)
+	#define TARGET_SSE41
+#else
+	#define TARGET_SSE41 __attribute__((target("sse4.1")))
+#endif
@@ -0,0 +1,154 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "Core/Types.h"
+
+/**
+ * @brief Fixed-size pool of worker threads which execute indexed jobs in parallel.
+ *
+ * The calling thread always takes part in the work, so a pool constructed with N threads runs N - 1 workers
+ * alongside the caller. Thread index 0 is always the calling thread.
+ */
+class ThreadPool
+{
+	using JobFunction = std::function<void(int32 index, int32 threadIndex)>;
+
+	std::vector<std::thread> m_threads;
+
+	std::mutex				m_mutex;
+	std::condition_variable m_startCondition;
+	std::condition_variable m_doneCondition;
+
+	/** The job currently being executed. **/
+	const JobFunction* m_job = nullptr;
+	/** Total number of indexes in the current job. **/
+	int32 m_jobCount = 0;
+	/** Next index to be picked up by any thread. **/
+	std::atomic<int32> m_nextIndex = 0;
+	/** Number of workers which have not yet finished the current job. **/
+	int32 m_activeWorkers = 0;
+	/** Incremented each time a new job is started so workers can tell jobs apart. **/
+	uint64 m_generation = 0;
+	bool   m_stopping = false;
+
+	void runJob(const int32 threadIndex)
+	{
+		int32 index;
+		while ((index = m_nextIndex.fetch_add(1)) < m_jobCount)
+		{
+			(*m_job)(index, threadIndex);
+		}
+	}
+
+	void workerLoop(const int32 threadIndex)
+	{
+		uint64 lastGeneration = 0;
+		while (true)
+		{
+			{
+				std::unique_lock lock(m_mutex);
+				m_startCondition.wait(lock, [&] { return m_stopping || m_generation != lastGeneration; });
+				if (m_stopping)
+				{
+					return;
+				}
+				lastGeneration = m_generation;
+			}
+
+			runJob(threadIndex);
+
+			{
+				std::unique_lock lock(m_mutex);
+				if (--m_activeWorkers == 0)
+				{
+					m_doneCondition.notify_one();
+				}
+			}
+		}
+	}
+
+public:
+	/**
+	 * @brief Constructs a new thread pool.
+	 * @param threadCount The total number of threads, including the calling thread. If 0, the hardware concurrency is used.
+	 */
+	explicit ThreadPool(int32 threadCount = 0)
+	{
+		if (threadCount <= 0)
+		{
+			threadCount = std::max(1, (int32)std::thread::hardware_concurrency());
+		}
+		for (int32 threadIndex = 1; threadIndex < threadCount; threadIndex++)
+		{
+			m_threads.emplace_back(&ThreadPool::workerLoop, this, threadIndex);
+		}
+	}
+
+	~ThreadPool()
+	{
+		{
+			std::unique_lock lock(m_mutex);
+			m_stopping = true;
+		}
+		m_startCondition.notify_all();
+		for (std::thread& thread : m_threads)
+		{
+			thread.join();
+		}
+	}
+
+	ThreadPool(const ThreadPool& other) = delete;
+	ThreadPool& operator=(const ThreadPool& other) = delete;
+
+	/**
+	 * @brief Returns the total number of threads in this pool, including the calling thread.
+	 */
+	[[nodiscard]] int32 getThreadCount() const { return (int32)m_threads.size() + 1; }
+
+	/**
+	 * @brief Calls `job(index, threadIndex)` for every index in [0, count) and blocks until all calls have returned.
+	 * @param count The number of indexes to process.
+	 * @param job The function to call for each index. `threadIndex` is in [0, getThreadCount()).
+	 */
+	void parallelFor(const int32 count, const JobFunction& job)
+	{
+		if (count <= 0)
+		{
+			return;
+		}
+
+		// Not worth waking the workers for a single job
+		if (count == 1 || m_threads.empty())
+		{
+			for (int32 index = 0; index < count; index++)
+			{
+				job(index, 0);
+			}
+			return;
+		}
+
+		{
+			std::unique_lock lock(m_mutex);
+			m_job = &job;
+			m_jobCount = count;
+			m_nextIndex = 0;
+			m_activeWorkers = (int32)m_threads.size();
+			m_generation++;
+		}
+		m_startCondition.notify_all();
+
+		// The calling thread works on the job as well
+		runJob(0);
+
+		std::unique_lock lock(m_mutex);
+		m_doneCondition.wait(lock, [&] { return m_activeWorkers == 0; });
+		m_job = nullptr;
+	}
+};
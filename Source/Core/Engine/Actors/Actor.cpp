@@ -1,10 +1,47 @@
 #include "Actor.h"
 
+#include <algorithm>
+
+#include "Core/Logging.h"
 #include "Math/Spherical.h"
+#include "Math/VectorMath.h"
+
+namespace
+{
+	/** Scratch space for Actor::updateTransforms, kept between calls to avoid reallocating. **/
+	std::vector<Actor*> g_transformLevel;
+	std::vector<Actor*> g_nextTransformLevel;
+	std::vector<Actor*> g_transformBatch;
+	std::vector<mat4f>	g_localMatrices;
+	std::vector<mat4f>	g_parentMatrices;
+	std::vector<mat4f>	g_worldMatrices;
+} // namespace
 
 Actor::Actor()
 {
 	setSignature(ESignature::Tickable);
+
+	// Every actor starts out dirty, so its matrices are computed before it is first drawn
+	m_transformFlags |= ETransformFlags::Queued;
+	g_objectManager.getChangedActors().push_back(this);
+}
+
+Actor::~Actor()
+{
+	// Children are left where they are in their own space, which is now world space
+	for (Actor* child : m_children)
+	{
+		child->m_parent = nullptr;
+		child->onWorldTransformChanged();
+	}
+	if (m_parent != nullptr)
+	{
+		std::erase(m_parent->m_children, this);
+	}
+	if (hasTransformFlag(ETransformFlags::Queued))
+	{
+		std::erase(g_objectManager.getChangedActors(), this);
+	}
 }
 
 void Actor::computeBasisVectors()
@@ -18,6 +55,166 @@ void Actor::computeBasisVectors()
 	m_upVector    = m_forwardVector.cross(m_rightVector).normalized();
 }
 
+void Actor::onTransformChanged()
+{
+	m_transformFlags |= ETransformFlags::LocalDirty;
+	onWorldTransformChanged();
+}
+
+void Actor::onWorldTransformChanged()
+{
+	invalidateWorldMatrix();
+
+	// The bounds of this actor and its descendants in the scene are updated with their world matrices
+	if (!hasTransformFlag(ETransformFlags::Queued))
+	{
+		m_transformFlags |= ETransformFlags::Queued;
+		g_objectManager.getChangedActors().push_back(this);
+	}
+}
+
+void Actor::invalidateWorldMatrix()
+{
+	// The descendants of an actor whose world matrix is out of date are always out of date too
+	if (hasTransformFlag(ETransformFlags::WorldDirty))
+	{
+		return;
+	}
+	m_transformFlags |= ETransformFlags::WorldDirty;
+	for (Actor* child : m_children)
+	{
+		child->invalidateWorldMatrix();
+	}
+}
+
+void Actor::setParent(Actor* parent)
+{
+	if (parent == m_parent)
+	{
+		return;
+	}
+	for (const Actor* ancestor = parent; ancestor != nullptr; ancestor = ancestor->m_parent)
+	{
+		if (ancestor == this)
+		{
+			LOG_ERROR("Cannot parent an actor to itself or one of its descendants.")
+			return;
+		}
+	}
+
+	if (m_parent != nullptr)
+	{
+		std::erase(m_parent->m_children, this);
+	}
+	m_parent = parent;
+	if (m_parent != nullptr)
+	{
+		m_parent->m_children.push_back(this);
+	}
+	onWorldTransformChanged();
+}
+
+Actor* Actor::getParent() const
+{
+	return m_parent;
+}
+
+const std::vector<Actor*>& Actor::getChildren() const
+{
+	return m_children;
+}
+
+const mat4f& Actor::getLocalMatrix()
+{
+	if (hasTransformFlag(ETransformFlags::LocalDirty))
+	{
+		m_localMatrix = m_transform.toMatrix();
+		m_transformFlags &= ~ETransformFlags::LocalDirty;
+	}
+	return m_localMatrix;
+}
+
+const mat4f& Actor::getWorldMatrix()
+{
+	if (hasTransformFlag(ETransformFlags::WorldDirty))
+	{
+		// Row vectors are transformed by the local matrix first, then by each ancestor's
+		m_worldMatrix = m_parent != nullptr ? getLocalMatrix() * m_parent->getWorldMatrix() : getLocalMatrix();
+		m_transformFlags &= ~ETransformFlags::WorldDirty;
+	}
+	return m_worldMatrix;
+}
+
+void Actor::updateTransforms()
+{
+	std::vector<Actor*>& changedActors = g_objectManager.getChangedActors();
+	if (changedActors.empty())
+	{
+		return;
+	}
+
+	// Changed actors below another changed actor are covered by the walk of its subtree
+	g_transformLevel.clear();
+	for (Actor* actor : changedActors)
+	{
+		const Actor* ancestor = actor->m_parent;
+		while (ancestor != nullptr && !ancestor->hasTransformFlag(ETransformFlags::Queued))
+		{
+			ancestor = ancestor->m_parent;
+		}
+		if (ancestor == nullptr)
+		{
+			g_transformLevel.push_back(actor);
+		}
+	}
+	for (Actor* actor : changedActors)
+	{
+		actor->m_transformFlags &= ~ETransformFlags::Queued;
+	}
+	changedActors.clear();
+
+	// Walk the changed subtrees one depth at a time, so every parent's world matrix is final before its children
+	// read it
+	while (!g_transformLevel.empty())
+	{
+		// Actors without a parent are already in world space. The rest of the depth is multiplied in one batch.
+		g_transformBatch.clear();
+		g_localMatrices.clear();
+		g_parentMatrices.clear();
+		for (Actor* actor : g_transformLevel)
+		{
+			if (actor->m_parent == nullptr)
+			{
+				actor->m_worldMatrix = actor->getLocalMatrix();
+				continue;
+			}
+			g_transformBatch.push_back(actor);
+			g_localMatrices.push_back(actor->getLocalMatrix());
+			g_parentMatrices.push_back(actor->m_parent->getWorldMatrix());
+		}
+		g_worldMatrices.resize(g_transformBatch.size());
+		VectorMath::multiply(g_localMatrices.data(), g_parentMatrices.data(), (int32)g_transformBatch.size(), g_worldMatrices.data());
+		for (size_t i = 0; i < g_transformBatch.size(); i++)
+		{
+			g_transformBatch[i]->m_worldMatrix = g_worldMatrices[i];
+		}
+
+		g_nextTransformLevel.clear();
+		for (Actor* actor : g_transformLevel)
+		{
+			actor->m_transformFlags &= ~ETransformFlags::WorldDirty;
+
+			// Keep the bounds of this actor in the scene up to date
+			if (actor->hasSignature(ESignature::Renderable))
+			{
+				g_objectManager.updateRenderable(dynamic_cast<IRenderable*>(actor));
+			}
+			g_nextTransformLevel.insert(g_nextTransformLevel.end(), actor->m_children.begin(), actor->m_children.end());
+		}
+		std::swap(g_transformLevel, g_nextTransformLevel);
+	}
+}
+
 transf Actor::getTransform() const
 {
 	return m_transform;
@@ -41,22 +238,26 @@ vec3f Actor::getScale() const
 void Actor::setTranslation(const vec3f& newTranslation)
 {
 	m_transform.translation = newTranslation;
+	onTransformChanged();
 }
 
 void Actor::setRotation(const rotf& newRotation)
 {
 	m_transform.rotation = newRotation;
 	computeBasisVectors();
+	onTransformChanged();
 }
 
 void Actor::setScale(const vec3f& newScale)
 {
 	m_transform.scale = newScale;
+	onTransformChanged();
 }
 
 void Actor::translate(const vec3f& delta)
 {
 	m_transform.translation += delta;
+	onTransformChanged();
 }
 
 void Actor::rotate(const float pitch, const float yaw, const float roll)
@@ -64,6 +265,7 @@ void Actor::rotate(const float pitch, const float yaw, const float roll)
 	m_transform.rotation += rotf(pitch, yaw, roll);
 	m_transform.rotation.normalize();
 	computeBasisVectors();
+	onTransformChanged();
 }
 
 vec3f Actor::getForwardVector() const
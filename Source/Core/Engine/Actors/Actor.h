@@ -6,7 +6,24 @@
 #include "Engine/ObjectManager.h"
 #include "Math/MathCommon.h"
 
-/** Represents an object in the scene which can tick and has a transform. **/
+/** State of the matrices an actor caches from its transform. **/
+enum class ETransformFlags : uint8
+{
+	None = 0,
+	/** The transform has changed since the local matrix was computed. **/
+	LocalDirty = 1,
+	/** The local matrix of this actor or one of its ancestors has changed since the world matrix was computed. **/
+	WorldDirty = 2,
+	/** The actor is waiting for the next call to Actor::updateTransforms. **/
+	Queued = 4,
+};
+
+DEFINE_BITMASK_OPERATORS(ETransformFlags)
+
+/**
+ * Represents an object in the scene which can tick and has a transform. An actor's transform is relative to its
+ * parent, if it has one.
+ */
 class Actor : public Object, public ITickable
 {
 	GENERATE_SUPER(Object)
@@ -16,18 +33,70 @@ protected:
 
 	transf m_transform;
 
+	/** Hierarchy **/
+
+	Actor*				m_parent = nullptr;
+	std::vector<Actor*> m_children;
+
+	/** Cached matrices, only recomputed once the flags say they are out of date. **/
+
+	mat4f			m_localMatrix;
+	mat4f			m_worldMatrix;
+	ETransformFlags m_transformFlags = ETransformFlags::LocalDirty | ETransformFlags::WorldDirty;
+
 	// Basis vectors
 	vec3f m_forwardVector;
 	vec3f m_rightVector;
 	vec3f m_upVector;
 
+	/** Called whenever the transform of this actor changes. **/
+	void onTransformChanged();
+	/** Called whenever the world matrix of this actor changes without its own transform changing. **/
+	void onWorldTransformChanged();
+	/** Marks the world matrix of this actor and all of its descendants as out of date. **/
+	void invalidateWorldMatrix();
+
+	[[nodiscard]] bool hasTransformFlag(const ETransformFlags flag) const
+	{
+		return (m_transformFlags & flag) == flag;
+	}
+
 public:
 	Actor();
 
-	~Actor() override = default;
+	~Actor() override;
 	void update(float deltaTime) override = 0;
 	void computeBasisVectors();
 
+	/** Hierarchy **/
+
+	/**
+	 * @brief Attaches this actor to `parent`, or detaches it if `parent` is nullptr. The transform of this actor is
+	 * kept, so it becomes relative to the new parent. Parenting an actor to one of its own descendants is ignored.
+	 */
+	void setParent(Actor* parent);
+	[[nodiscard]] Actor* getParent() const;
+	[[nodiscard]] const std::vector<Actor*>& getChildren() const;
+
+	/** Matrices **/
+
+	/**
+	 * @brief Returns the matrix which transforms from this actor's space into its parent's.
+	 */
+	[[nodiscard]] const mat4f& getLocalMatrix();
+	/**
+	 * @brief Returns the matrix which transforms from this actor's space into world space. Computed on demand if it
+	 * is out of date, though Actor::updateTransforms updates every changed actor in one pass.
+	 */
+	[[nodiscard]] const mat4f& getWorldMatrix();
+
+	/**
+	 * @brief Updates the world matrices of every actor whose transform, or whose ancestor's transform, has changed
+	 * since the last call, along with their bounds in the scene. Unchanged subtrees are never visited, so a scene
+	 * which has settled costs nothing. Each depth of the changed subtrees is multiplied as one batch with VectorMath.
+	 */
+	static void updateTransforms();
+
 	/** Getters **/
 
 	[[nodiscard]] transf getTransform() const;
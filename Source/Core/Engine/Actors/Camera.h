@@ -134,8 +134,32 @@ namespace Math
 		return false;
 	}
 
-	static bool deprojectScreenToWorld(const vec2f& screenPosition, const ViewData& viewData)
+	/**
+	 * @brief Converts a position on the screen into a world-space ray, the inverse of projectWorldToScreen.
+	 * @param screenPosition Position on the screen, in the same space projectWorldToScreen outputs.
+	 * @param worldPosition Receives the world position on the near plane under the screen position.
+	 * @param worldDirection Receives the normalized direction of the ray through the screen position.
+	 */
+	static bool deprojectScreenToWorld(const vec2f& screenPosition, const ViewData& viewData, vec3f& worldPosition,
+		vec3f& worldDirection)
 	{
+		// Normalized device coordinates
+		const float x = (screenPosition.x / static_cast<float>(viewData.width) - 0.5f) * 2.0f;
+		const float y = (screenPosition.y / static_cast<float>(viewData.height) - 0.5f) * 2.0f;
+
+		// Unproject the points under the screen position on the near and far planes
+		mat4f		inverseViewProjection = viewData.viewProjectionMatrix;
+		inverseViewProjection = inverseViewProjection.getInverse();
+		const vec4f nearPosition = inverseViewProjection * vec4f(x, y, 0.0f, 1.0f);
+		const vec4f farPosition = inverseViewProjection * vec4f(x, y, 1.0f, 1.0f);
+		if (nearPosition.w == 0.0f || farPosition.w == 0.0f)
+		{
+			return false;
+		}
+
+		worldPosition = vec3f(nearPosition.x / nearPosition.w, nearPosition.y / nearPosition.w, nearPosition.z / nearPosition.w);
+		const vec3f farWorldPosition(farPosition.x / farPosition.w, farPosition.y / farPosition.w, farPosition.z / farPosition.w);
+		worldDirection = (farWorldPosition - worldPosition).normalized();
 		return true;
 	}
 }
@@ -27,18 +27,25 @@ public:
 		return m_staticMeshComponent->getMesh();
 	}
 
-	void setMesh(Mesh* mesh) const
+	void setMesh(Mesh* mesh)
 	{
 		assert(m_staticMeshComponent != nullptr);
 		m_staticMeshComponent->setMesh(mesh);
+		g_objectManager.updateRenderable(this);
 	}
 
 	void update(float deltaTime) override
 	{
 	}
 
-	transf* getTransform() override
+	/** Change the transform through the setters of Actor, which mark the world matrix and bounds as out of date. **/
+	const transf* getTransform() override
 	{
 		return &m_transform;
 	}
+
+	mat4f getWorldMatrix() override
+	{
+		return Actor::getWorldMatrix();
+	}
 };
@@ -0,0 +1,661 @@
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <random>
+
+#include "BoundingVolumeHierarchy.h"
+
+#include "Core/Logging.h"
+#include "Engine/Timer.h"
+
+namespace
+{
+	/** Number of bins centroids are sorted into when evaluating the surface area heuristic. **/
+	constexpr int32 g_binCount = 12;
+
+	/**
+	 * @brief Slab test between a ray and a box.
+	 * @return Whether the ray enters the box before `maxDistance`.
+	 */
+	bool intersectsRay(const boxf& box, const vec3f& origin, const vec3f& inverseDirection, const float maxDistance)
+	{
+		float nearest = 0.0f;
+		float farthest = maxDistance;
+		for (int32 axis = 0; axis < 3; axis++)
+		{
+			float t0 = (box.min.xyz[axis] - origin.xyz[axis]) * inverseDirection.xyz[axis];
+			float t1 = (box.max.xyz[axis] - origin.xyz[axis]) * inverseDirection.xyz[axis];
+			if (t0 > t1)
+			{
+				std::swap(t0, t1);
+			}
+			nearest = std::max(nearest, t0);
+			farthest = std::min(farthest, t1);
+			if (nearest > farthest)
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+
+	/**
+	 * @brief Moller-Trumbore intersection between a ray and a triangle.
+	 * @return The distance along the ray of the hit, or a negative number if the triangle was missed.
+	 */
+	float intersectsTriangle(const vec3f& origin, const vec3f& direction, const vec3f& v0, const vec3f& v1, const vec3f& v2)
+	{
+		const vec3f edge1 = v1 - v0;
+		const vec3f edge2 = v2 - v0;
+		const vec3f p = direction.cross(edge2);
+		const float determinant = edge1.dot(p);
+		if (std::abs(determinant) < std::numeric_limits<float>::epsilon())
+		{
+			return -1.0f;
+		}
+
+		const float inverseDeterminant = 1.0f / determinant;
+		const vec3f s = origin - v0;
+		const float u = s.dot(p) * inverseDeterminant;
+		if (u < 0.0f || u > 1.0f)
+		{
+			return -1.0f;
+		}
+
+		const vec3f q = s.cross(edge1);
+		const float v = direction.dot(q) * inverseDeterminant;
+		if (v < 0.0f || u + v > 1.0f)
+		{
+			return -1.0f;
+		}
+
+		return edge2.dot(q) * inverseDeterminant;
+	}
+
+	/**
+	 * @brief Tests every triangle of `renderable` with the ray, moved into object space so distances along the ray
+	 * stay the same as in world space.
+	 * @return Whether a triangle was hit closer than `closest`, which then receives the distance of the hit.
+	 */
+	bool intersectsRenderable(IRenderable* renderable, const vec3f& origin, const vec3f& direction, float& closest)
+	{
+		Mesh* mesh = renderable->getMesh();
+		if (!mesh)
+		{
+			return false;
+		}
+		mat4f		inverseModel = renderable->getWorldMatrix().getInverse();
+		const vec4f localOrigin = inverseModel * vec4f(origin, 1.0f);
+		const vec4f localDirection = inverseModel * vec4f(direction, 0.0f);
+		const vec3f rayOrigin(localOrigin.x, localOrigin.y, localOrigin.z);
+		const vec3f rayDirection(localDirection.x, localDirection.y, localDirection.z);
+
+		const Vertex3*				  vertices = (const Vertex3*)mesh->getVertexData().data();
+		const std::span<const uint32> indexes = mesh->getIndexData();
+		bool						hit = false;
+		for (size_t index = 0; index + 2 < indexes.size(); index += 3)
+		{
+			const float distance = intersectsTriangle(rayOrigin, rayDirection, vertices[indexes[index]].position,
+				vertices[indexes[index + 1]].position, vertices[indexes[index + 2]].position);
+			if (distance > 0.0f && distance < closest)
+			{
+				closest = distance;
+				hit = true;
+			}
+		}
+		return hit;
+	}
+
+	/** A renderable with its own transform, so the benchmark doesn't need to spawn actors. **/
+	struct BenchmarkRenderable : IRenderable
+	{
+		Mesh*  mesh = nullptr;
+		transf transform;
+
+		Mesh*		  getMesh() override { return mesh; }
+		const transf* getTransform() override { return &transform; }
+	};
+
+	/** Returns every renderable whose bounds intersect `frustum`, sorted so results can be compared. **/
+	std::vector<IRenderable*> queryBruteForce(const frustumf& frustum, const std::vector<IRenderable*>& renderables)
+	{
+		std::vector<IRenderable*> out;
+		for (IRenderable* renderable : renderables)
+		{
+			if (frustum.intersects(BoundingVolumeHierarchy::getWorldBounds(renderable)))
+			{
+				out.emplace_back(renderable);
+			}
+		}
+		std::ranges::sort(out);
+		return out;
+	}
+} // namespace
+
+boxf BoundingVolumeHierarchy::getWorldBounds(IRenderable* renderable)
+{
+	const mat4f model = renderable->getWorldMatrix();
+	const Mesh* mesh = renderable->getMesh();
+
+	// Renderables without geometry are just a point at their origin
+	const boxf localBounds = mesh && mesh->getBounds().isValid() ? mesh->getBounds() : boxf(vec3f(0.0f), vec3f(0.0f));
+
+	// Transform each corner of the local bounds into world space
+	boxf worldBounds;
+	for (int32 corner = 0; corner < 8; corner++)
+	{
+		const vec4f localCorner((corner & 1) ? localBounds.max.x : localBounds.min.x, (corner & 2) ? localBounds.max.y : localBounds.min.y,
+			(corner & 4) ? localBounds.max.z : localBounds.min.z, 1.0f);
+		const vec4f worldCorner = model * localCorner;
+		worldBounds.expand(vec3f(worldCorner.x, worldCorner.y, worldCorner.z));
+	}
+	return worldBounds;
+}
+
+int32 BoundingVolumeHierarchy::allocateNode()
+{
+	if (!m_freeNodes.empty())
+	{
+		const int32 index = m_freeNodes.back();
+		m_freeNodes.pop_back();
+		m_nodes[index] = BVHNode();
+		return index;
+	}
+	m_nodes.emplace_back();
+	return (int32)m_nodes.size() - 1;
+}
+
+void BoundingVolumeHierarchy::freeNode(const int32 index)
+{
+	m_nodes[index] = BVHNode();
+	m_freeNodes.push_back(index);
+}
+
+void BoundingVolumeHierarchy::insertLeaf(const int32 leaf)
+{
+	if (m_root == -1)
+	{
+		m_root = leaf;
+		m_nodes[leaf].parent = -1;
+		return;
+	}
+
+	// Walk down the tree towards the sibling which least increases the total surface area
+	const boxf leafBounds = m_nodes[leaf].bounds;
+	int32	   index = m_root;
+	while (!m_nodes[index].isLeaf())
+	{
+		const BVHNode& node = m_nodes[index];
+		const float	   area = node.bounds.surfaceArea();
+		const float	   combinedArea = boxf::combine(node.bounds, leafBounds).surfaceArea();
+
+		// Cost of making a new parent for this node and the leaf
+		const float cost = 2.0f * combinedArea;
+		// Minimum cost of pushing the leaf further down the tree
+		const float inheritanceCost = 2.0f * (combinedArea - area);
+
+		float childCosts[2];
+		for (int32 i = 0; i < 2; i++)
+		{
+			const BVHNode& child = m_nodes[node.children[i]];
+			const float	   childArea = boxf::combine(child.bounds, leafBounds).surfaceArea();
+			childCosts[i] = (child.isLeaf() ? childArea : childArea - child.bounds.surfaceArea()) + inheritanceCost;
+		}
+
+		if (cost < childCosts[0] && cost < childCosts[1])
+		{
+			break;
+		}
+		index = childCosts[0] < childCosts[1] ? node.children[0] : node.children[1];
+	}
+
+	// Replace the sibling with a new parent of both the sibling and the leaf
+	const int32 sibling = index;
+	const int32 oldParent = m_nodes[sibling].parent;
+	const int32 newParent = allocateNode();
+	m_nodes[newParent].parent = oldParent;
+	m_nodes[newParent].bounds = boxf::combine(m_nodes[sibling].bounds, leafBounds);
+	m_nodes[newParent].children[0] = sibling;
+	m_nodes[newParent].children[1] = leaf;
+	m_nodes[sibling].parent = newParent;
+	m_nodes[leaf].parent = newParent;
+
+	if (oldParent == -1)
+	{
+		m_root = newParent;
+	}
+	else
+	{
+		BVHNode& parent = m_nodes[oldParent];
+		parent.children[parent.children[0] == sibling ? 0 : 1] = newParent;
+		refit(oldParent);
+	}
+}
+
+void BoundingVolumeHierarchy::removeLeaf(const int32 leaf)
+{
+	if (leaf == m_root)
+	{
+		m_root = -1;
+		return;
+	}
+
+	// Replace the leaf's parent with the leaf's sibling
+	const int32 parent = m_nodes[leaf].parent;
+	const int32 grandParent = m_nodes[parent].parent;
+	const int32 sibling = m_nodes[parent].children[m_nodes[parent].children[0] == leaf ? 1 : 0];
+	freeNode(parent);
+	m_nodes[sibling].parent = grandParent;
+	m_nodes[leaf].parent = -1;
+
+	if (grandParent == -1)
+	{
+		m_root = sibling;
+	}
+	else
+	{
+		BVHNode& node = m_nodes[grandParent];
+		node.children[node.children[0] == parent ? 0 : 1] = sibling;
+		refit(grandParent);
+	}
+}
+
+void BoundingVolumeHierarchy::refit(int32 index)
+{
+	while (index != -1)
+	{
+		BVHNode& node = m_nodes[index];
+		node.bounds = boxf::combine(m_nodes[node.children[0]].bounds, m_nodes[node.children[1]].bounds);
+		index = node.parent;
+	}
+}
+
+int32 BoundingVolumeHierarchy::buildRecursive(std::vector<int32>& leaves, const int32 start, const int32 end)
+{
+	if (end - start == 1)
+	{
+		return leaves[start];
+	}
+
+	// Split along the longest axis of the leaf centroids
+	boxf centroidBounds;
+	for (int32 i = start; i < end; i++)
+	{
+		centroidBounds.expand(m_nodes[leaves[i]].bounds.center());
+	}
+	const vec3f extents = centroidBounds.max - centroidBounds.min;
+	const int32 axis = extents.x > extents.y && extents.x > extents.z ? 0 : (extents.y > extents.z ? 1 : 2);
+	const float axisMin = centroidBounds.min.xyz[axis];
+	const float axisExtent = extents.xyz[axis];
+
+	int32 middle = start + (end - start) / 2;
+	if (axisExtent > 0.0f)
+	{
+		// Sort the leaves into bins, then pick the split between bins with the lowest surface area heuristic cost
+		const auto getBin = [&](const int32 leaf)
+		{
+			const float offset = (m_nodes[leaf].bounds.center().xyz[axis] - axisMin) / axisExtent;
+			return std::min((int32)(offset * g_binCount), g_binCount - 1);
+		};
+
+		boxf  binBounds[g_binCount];
+		int32 binCounts[g_binCount] = {};
+		for (int32 i = start; i < end; i++)
+		{
+			const int32 bin = getBin(leaves[i]);
+			binBounds[bin].expand(m_nodes[leaves[i]].bounds);
+			binCounts[bin]++;
+		}
+
+		// Accumulate the area and count of every bin on the right of each split
+		float rightAreas[g_binCount];
+		int32 rightCounts[g_binCount];
+		boxf  rightBounds;
+		int32 rightCount = 0;
+		for (int32 bin = g_binCount - 1; bin > 0; bin--)
+		{
+			rightBounds.expand(binBounds[bin]);
+			rightCount += binCounts[bin];
+			rightAreas[bin] = rightBounds.isValid() ? rightBounds.surfaceArea() : 0.0f;
+			rightCounts[bin] = rightCount;
+		}
+
+		float bestCost = std::numeric_limits<float>::max();
+		int32 bestSplit = -1;
+		boxf  leftBounds;
+		int32 leftCount = 0;
+		for (int32 split = 1; split < g_binCount; split++)
+		{
+			leftBounds.expand(binBounds[split - 1]);
+			leftCount += binCounts[split - 1];
+			if (leftCount == 0 || rightCounts[split] == 0)
+			{
+				continue;
+			}
+			const float cost = leftCount * leftBounds.surfaceArea() + rightCounts[split] * rightAreas[split];
+			if (cost < bestCost)
+			{
+				bestCost = cost;
+				bestSplit = split;
+			}
+		}
+
+		if (bestSplit != -1)
+		{
+			middle = (int32)(std::partition(leaves.begin() + start, leaves.begin() + end,
+								 [&](const int32 leaf) { return getBin(leaf) < bestSplit; })
+				- leaves.begin());
+		}
+	}
+
+	const int32 node = allocateNode();
+	const int32 left = buildRecursive(leaves, start, middle);
+	const int32 right = buildRecursive(leaves, middle, end);
+	m_nodes[node].children[0] = left;
+	m_nodes[node].children[1] = right;
+	m_nodes[node].bounds = boxf::combine(m_nodes[left].bounds, m_nodes[right].bounds);
+	m_nodes[left].parent = node;
+	m_nodes[right].parent = node;
+	return node;
+}
+
+void BoundingVolumeHierarchy::build(const std::vector<IRenderable*>& renderables)
+{
+	clear();
+	if (renderables.empty())
+	{
+		return;
+	}
+
+	std::vector<int32> leaves;
+	leaves.reserve(renderables.size());
+	m_nodes.reserve(renderables.size() * 2);
+	for (IRenderable* renderable : renderables)
+	{
+		const int32 leaf = allocateNode();
+		m_nodes[leaf].renderable = renderable;
+		m_nodes[leaf].bounds = getWorldBounds(renderable);
+		m_leaves[renderable] = leaf;
+		leaves.push_back(leaf);
+	}
+
+	m_root = buildRecursive(leaves, 0, (int32)leaves.size());
+	m_nodes[m_root].parent = -1;
+}
+
+void BoundingVolumeHierarchy::insert(IRenderable* renderable)
+{
+	if (contains(renderable))
+	{
+		update(renderable);
+		return;
+	}
+
+	const int32 leaf = allocateNode();
+	m_nodes[leaf].renderable = renderable;
+	m_nodes[leaf].bounds = getWorldBounds(renderable);
+	m_leaves[renderable] = leaf;
+	insertLeaf(leaf);
+}
+
+void BoundingVolumeHierarchy::remove(IRenderable* renderable)
+{
+	const auto it = m_leaves.find(renderable);
+	if (it == m_leaves.end())
+	{
+		return;
+	}
+
+	removeLeaf(it->second);
+	freeNode(it->second);
+	m_leaves.erase(it);
+}
+
+void BoundingVolumeHierarchy::update(IRenderable* renderable)
+{
+	const auto it = m_leaves.find(renderable);
+	if (it == m_leaves.end())
+	{
+		return;
+	}
+
+	const int32 leaf = it->second;
+	const boxf	bounds = getWorldBounds(renderable);
+	const int32 parent = m_nodes[leaf].parent;
+	m_nodes[leaf].bounds = bounds;
+
+	// Small movements within the parent's bounds only need the ancestors refit. Anything larger is reinserted so
+	// the tree doesn't degrade as renderables move around.
+	if (parent == -1)
+	{
+		return;
+	}
+	if (m_nodes[parent].bounds.contains(bounds))
+	{
+		refit(parent);
+	}
+	else
+	{
+		removeLeaf(leaf);
+		insertLeaf(leaf);
+	}
+}
+
+void BoundingVolumeHierarchy::clear()
+{
+	m_nodes.clear();
+	m_freeNodes.clear();
+	m_leaves.clear();
+	m_root = -1;
+}
+
+void BoundingVolumeHierarchy::queryFrustum(const frustumf& frustum, std::vector<IRenderable*>& out) const
+{
+	if (m_root == -1)
+	{
+		return;
+	}
+
+	std::vector<int32> stack = { m_root };
+	while (!stack.empty())
+	{
+		const BVHNode& node = m_nodes[stack.back()];
+		stack.pop_back();
+		if (!frustum.intersects(node.bounds))
+		{
+			continue;
+		}
+
+		if (node.isLeaf())
+		{
+			out.emplace_back(node.renderable);
+		}
+		else
+		{
+			stack.push_back(node.children[0]);
+			stack.push_back(node.children[1]);
+		}
+	}
+}
+
+bool BoundingVolumeHierarchy::raycast(const vec3f& origin, const vec3f& direction, RaycastHit& hit) const
+{
+	hit = RaycastHit();
+	if (m_root == -1)
+	{
+		return false;
+	}
+
+	const vec3f inverseDirection(1.0f / direction.x, 1.0f / direction.y, 1.0f / direction.z);
+	float		closest = std::numeric_limits<float>::max();
+
+	std::vector<int32> stack = { m_root };
+	while (!stack.empty())
+	{
+		const BVHNode& node = m_nodes[stack.back()];
+		stack.pop_back();
+		if (!intersectsRay(node.bounds, origin, inverseDirection, closest))
+		{
+			continue;
+		}
+
+		if (!node.isLeaf())
+		{
+			stack.push_back(node.children[0]);
+			stack.push_back(node.children[1]);
+			continue;
+		}
+
+		if (intersectsRenderable(node.renderable, origin, direction, closest))
+		{
+			hit.renderable = node.renderable;
+			hit.distance = closest;
+		}
+	}
+
+	if (!hit.renderable)
+	{
+		return false;
+	}
+	hit.position = origin + direction * hit.distance;
+	return true;
+}
+
+void BoundingVolumeHierarchy::benchmark(const int32 renderableCount)
+{
+	// Unit cube shared by every renderable
+	const std::vector<vec3f> positions = {
+		{ -1, -1, -1 }, { 1, -1, -1 }, { 1, 1, -1 }, { -1, 1, -1 }, { -1, -1, 1 }, { 1, -1, 1 }, { 1, 1, 1 }, { -1, 1, 1 }
+	};
+	const int32 faces[12][3] = { { 0, 2, 1 }, { 0, 3, 2 }, { 4, 5, 6 }, { 4, 6, 7 }, { 0, 1, 5 }, { 0, 5, 4 },
+		{ 3, 6, 2 }, { 3, 7, 6 }, { 0, 4, 7 }, { 0, 7, 3 }, { 1, 2, 6 }, { 1, 6, 5 } };
+	std::vector<Triangle3> triangles;
+	for (const auto& face : faces)
+	{
+		triangles.emplace_back(std::vector<int32>{ face[0], face[1], face[2] }, std::vector<int32>{}, std::vector<int32>{});
+	}
+	Mesh cube(triangles, positions);
+
+	// Scatter the cubes over a wide, flat area, like actors placed in a level
+	std::mt19937						  generator(1337);
+	std::uniform_real_distribution<float> spread(-500.0f, 500.0f);
+	std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+
+	std::vector<BenchmarkRenderable> storage(renderableCount);
+	std::vector<IRenderable*>		 renderables;
+	for (BenchmarkRenderable& renderable : storage)
+	{
+		renderable.mesh = &cube;
+		renderable.transform.translation = vec3f(spread(generator), spread(generator) * 0.1f, spread(generator));
+		renderables.emplace_back(&renderable);
+	}
+
+	// Views looking across the scene from around its edge
+	constexpr int32	   viewCount = 64;
+	std::vector<mat4f> views;
+	std::vector<vec3f> eyes;
+	for (int32 index = 0; index < viewCount; index++)
+	{
+		const vec3f eye(spread(generator), 50.0f, spread(generator));
+		const vec3f target(spread(generator), 0.0f, spread(generator));
+		eyes.emplace_back(eye);
+		views.emplace_back(lookAtLH(eye, target, vec3f::upVector()) * perspectiveFovLH(90.0f * DEG_TO_RAD, 16.0f / 9.0f, 1.0f, 1000.0f));
+	}
+
+	BoundingVolumeHierarchy	  tree;
+	std::vector<IRenderable*> results;
+
+	// Compares every view's frustum query against testing each renderable, and times both
+	auto compareFrustums = [&](const char* stage)
+	{
+		int32 mismatches = 0;
+		float treeTime = 0.0f;
+		float bruteForceTime = 0.0f;
+		for (const mat4f& view : views)
+		{
+			const frustumf frustum(view);
+
+			TimePoint start = PTimer::now();
+			results.clear();
+			tree.queryFrustum(frustum, results);
+			treeTime += DurationMs(PTimer::now() - start).count();
+
+			start = PTimer::now();
+			const std::vector<IRenderable*> expected = queryBruteForce(frustum, renderables);
+			bruteForceTime += DurationMs(PTimer::now() - start).count();
+
+			std::ranges::sort(results);
+			mismatches += results != expected;
+		}
+
+		if (mismatches > 0)
+		{
+			LOG_WARNING("Frustum {}: {} of {} queries differ from brute force.", stage, mismatches, viewCount)
+		}
+		LOG_INFO("Frustum {}: {:.3f} ms per query, brute force {:.3f} ms", stage, treeTime / viewCount,
+			bruteForceTime / viewCount)
+	};
+
+	for (IRenderable* renderable : renderables)
+	{
+		tree.insert(renderable);
+	}
+	compareFrustums("after inserting");
+
+	tree.build(renderables);
+	compareFrustums("after building");
+
+	// Move a third of the renderables, both within and out of their parent's bounds
+	for (int32 index = 0; index < renderableCount / 3; index++)
+	{
+		storage[index].transform.translation += vec3f(unit(generator), 0.0f, unit(generator) * 50.0f);
+		tree.update(&storage[index]);
+	}
+	compareFrustums("after moving");
+
+	// Rays from each eye towards random renderables, some of which are missed or hidden behind others, compared
+	// against testing every triangle of every renderable
+	std::uniform_int_distribution<int32> randomRenderable(0, renderableCount - 1);
+	constexpr int32 raysPerView = 16;
+	int32			mismatches = 0;
+	int32			hitCount = 0;
+	float			treeTime = 0.0f;
+	float			bruteForceTime = 0.0f;
+	for (const vec3f& eye : eyes)
+	{
+		for (int32 index = 0; index < raysPerView; index++)
+		{
+			const vec3f target = storage[randomRenderable(generator)].transform.translation +
+				vec3f(unit(generator), unit(generator), unit(generator)) * 2.0f;
+			const vec3f direction = (target - eye).normalized();
+
+			TimePoint  start = PTimer::now();
+			RaycastHit hit;
+			tree.raycast(eye, direction, hit);
+			treeTime += DurationMs(PTimer::now() - start).count();
+
+			start = PTimer::now();
+			IRenderable* expected = nullptr;
+			float		 closest = std::numeric_limits<float>::max();
+			for (IRenderable* renderable : renderables)
+			{
+				if (intersectsRenderable(renderable, eye, direction, closest))
+				{
+					expected = renderable;
+				}
+			}
+			bruteForceTime += DurationMs(PTimer::now() - start).count();
+
+			hitCount += expected != nullptr;
+			mismatches += hit.renderable != expected;
+		}
+	}
+
+	const int32 rayCount = viewCount * raysPerView;
+	if (mismatches > 0)
+	{
+		LOG_WARNING("Raycast: {} of {} rays hit a different renderable than brute force.", mismatches, rayCount)
+	}
+	LOG_INFO("Raycast: {} of {} rays hit, {:.3f} ms per ray, brute force {:.3f} ms", hitCount, rayCount,
+		treeTime / rayCount, bruteForceTime / rayCount)
+}
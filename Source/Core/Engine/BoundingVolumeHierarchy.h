@@ -0,0 +1,109 @@
+#pragma once
+
+#include <unordered_map>
+#include <vector>
+
+#include "Object.h"
+
+#include "Math/Box.h"
+#include "Math/Frustum.h"
+
+/** Result of a ray query against the scene. **/
+struct RaycastHit
+{
+	/** The closest renderable hit by the ray. **/
+	IRenderable* renderable = nullptr;
+	/** Distance along the ray, in multiples of the ray direction. **/
+	float distance = 0.0f;
+	/** World-space position of the hit. **/
+	vec3f position;
+};
+
+/** A single node of a BoundingVolumeHierarchy. Leaves reference exactly one renderable. **/
+struct BVHNode
+{
+	/** World-space bounds of everything below this node. **/
+	boxf bounds;
+	int32 parent = -1;
+	int32 children[2] = { -1, -1 };
+	IRenderable* renderable = nullptr;
+
+	[[nodiscard]] bool isLeaf() const { return children[0] == -1; }
+};
+
+/**
+ * @brief Dynamic bounding volume hierarchy over renderables, used to cull and pick them without visiting every
+ * renderable in the scene.
+ *
+ * Renderables can be inserted, removed and updated individually. Small movements only refit the bounds of the
+ * renderable's ancestors, while renderables which move out of their parent's bounds are reinserted. Calling
+ * `build` rebuilds the whole tree top-down using the surface area heuristic, which gives the best tree for a
+ * static scene.
+ */
+class BoundingVolumeHierarchy
+{
+	std::vector<BVHNode> m_nodes;
+	/** Indexes of unused nodes in m_nodes. **/
+	std::vector<int32> m_freeNodes;
+	/** Leaf node of each renderable in the tree. **/
+	std::unordered_map<IRenderable*, int32> m_leaves;
+	int32 m_root = -1;
+
+	int32 allocateNode();
+	void freeNode(int32 index);
+
+	/** Inserts an existing leaf node into the tree, next to the sibling which least increases the tree's surface area. **/
+	void insertLeaf(int32 leaf);
+	/** Detaches a leaf node from the tree without freeing it. **/
+	void removeLeaf(int32 leaf);
+	/** Recomputes the bounds of `index` and every ancestor above it. **/
+	void refit(int32 index);
+
+	int32 buildRecursive(std::vector<int32>& leaves, int32 start, int32 end);
+
+public:
+	/**
+	 * @brief Returns the world-space bounds of `renderable`, from its mesh bounds and transform.
+	 */
+	static boxf getWorldBounds(IRenderable* renderable);
+
+	/**
+	 * @brief Rebuilds the tree from scratch over `renderables` using the surface area heuristic.
+	 */
+	void build(const std::vector<IRenderable*>& renderables);
+
+	void insert(IRenderable* renderable);
+	void remove(IRenderable* renderable);
+
+	/**
+	 * @brief Updates the bounds of `renderable` after its transform or mesh has changed.
+	 */
+	void update(IRenderable* renderable);
+
+	void clear();
+
+	[[nodiscard]] bool contains(IRenderable* renderable) const { return m_leaves.contains(renderable); }
+	[[nodiscard]] int32 size() const { return (int32)m_leaves.size(); }
+
+	/**
+	 * @brief Appends every renderable whose bounds intersect `frustum` to `out`.
+	 */
+	void queryFrustum(const frustumf& frustum, std::vector<IRenderable*>& out) const;
+
+	/**
+	 * @brief Finds the closest triangle of any renderable hit by the ray.
+	 * @param origin World-space origin of the ray.
+	 * @param direction World-space direction of the ray.
+	 * @param hit Receives the closest hit, if any.
+	 * @return Whether anything was hit.
+	 */
+	bool raycast(const vec3f& origin, const vec3f& direction, RaycastHit& hit) const;
+
+	/**
+	 * @brief Scatters cubes over a level and compares frustum queries and raycasts against testing every cube,
+	 * after inserting the cubes, after building the tree and after moving some of them. Logs how long both take
+	 * and warns if any result differs.
+	 * @param renderableCount The number of cubes in the level.
+	 */
+	static void benchmark(int32 renderableCount = 3000);
+};
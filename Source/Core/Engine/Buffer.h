@@ -1,5 +1,6 @@
 #pragma once
 
+#include <span>
 #include <vector>
 
 #include "Core/Types.h"
@@ -21,6 +22,7 @@ public:
 	GenericBuffer(const std::vector<float>& vertexData)
 		: m_data(vertexData) {}
 
-	virtual void createVertexBuffer(std::vector<float>& data){}
+	virtual void createVertexBuffer(std::span<const float> data){}
+	virtual void createIndexBuffer(std::span<const uint32> data) {}
 	virtual void createConstantBuffer(int32 byteSize) {}
 };
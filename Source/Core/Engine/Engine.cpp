@@ -13,9 +13,11 @@ bool Engine::shutdown()
 
 void Engine::tick(float deltaTime) {}
 
+void Engine::onViewportCreated(Viewport* viewport) {}
+
 void Engine::onKeyPressed(const EKey keyCode) const {}
 
-void Engine::onLeftMouseDown(MouseData& mouse) const {}
+void Engine::onLeftMouseDown(MouseData& mouse) {}
 
 void Engine::onLeftMouseUp(MouseData& mouse) const {}
 
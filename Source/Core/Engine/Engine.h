@@ -6,6 +6,8 @@
 
 extern inline Engine* g_engine = nullptr;
 
+class Viewport;
+
 class Engine
 {
 protected:
@@ -16,8 +18,14 @@ public:
 	virtual bool   shutdown();
 	virtual void   tick(float deltaTime);
 
+	/**
+	 * @brief Called once the application has created the viewport the scene is drawn in, so the engine can add its
+	 * scene to it. The viewport outlives the scene, which is released in shutdown.
+	 */
+	virtual void onViewportCreated(Viewport* viewport);
+
 	void onMouseMiddleScrolled(MouseData& mouse) const;
-	void onLeftMouseDown(MouseData& mouse) const;
+	virtual void onLeftMouseDown(MouseData& mouse);
 	void onLeftMouseUp(MouseData& mouse) const;
 	void onMiddleMouseUp(MouseData& mouse) const;
 	void onMouseMoved(MouseData& mouse) const;
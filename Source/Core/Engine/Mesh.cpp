@@ -1,4 +1,9 @@
-﻿#include "Engine/Mesh.h"
+﻿#include <algorithm>
+#include <unordered_map>
+
+#include "Engine/Mesh.h"
+#include "Engine/MeshSimplifier.h"
+#include "Platforms/Generic/MappedFile.h"
 
 void Mesh::processTriangles()
 {
@@ -23,52 +28,138 @@ void Mesh::processTriangles()
 			triangle.v2.texCoord = m_texCoords[triangle.texCoordIndexes[2]];
 		}
 	}
-	m_vertexBuffer = toVertexData();
+	toVertexData(m_vertexBuffer, m_indexBuffer);
+	computeBounds();
+	m_mappedFile.reset();
+	m_mappedVertices = {};
+	m_mappedIndexes = {};
+
+	// Levels of detail were built from the previous triangles
+	m_lods.clear();
+	m_version++;
+}
+
+void Mesh::setMappedData(std::shared_ptr<const MappedFile> file, const std::span<const float> vertices,
+	const std::span<const uint32> indexes, std::vector<MeshLod>&& lods, const boxf& bounds, const spheref& boundingSphere)
+{
+	// Only the render data is loaded, so there are no triangles to rebuild it from
+	m_triangles.clear();
+	m_positions.clear();
+	m_normals.clear();
+	m_texCoords.clear();
+	m_vertexBuffer.clear();
+	m_indexBuffer.clear();
+
+	m_mappedFile = std::move(file);
+	m_mappedVertices = vertices;
+	m_mappedIndexes = indexes;
+	m_lods = std::move(lods);
+	m_bounds = bounds;
+	m_boundingSphere = boundingSphere;
+	m_version++;
 }
 
-std::vector<float> Mesh::toVertexData()
+void Mesh::generateLods()
 {
-	int32			   vertexSize = (int32)sizeof(Vertex3);
-	auto			   size = m_triangles.size() * 3 * vertexSize;
-	std::vector<float> data(size);
-	size_t			   offset = 0;
-
-	float* dataPtr = data.data();
-	// Triangle
-	for (Triangle3& tri : m_triangles)
+	m_lods.clear();
+
+	const std::span<const float>  vertexData = getVertexData();
+	const std::span<const uint32> indexData = getIndexData();
+	std::vector<size_t>			  targetTriangleCounts;
+	for (size_t target = indexData.size() / 6; target >= g_minLodTriangleCount && targetTriangleCounts.size() + 1 < g_maxLodCount;
+		target /= 2)
+	{
+		targetTriangleCounts.push_back(target);
+	}
+	if (targetTriangleCounts.empty())
 	{
-		// Vertex3 0
-		data[offset++] = tri.v0.position.x;
-		data[offset++] = tri.v0.position.y;
-		data[offset++] = tri.v0.position.z;
-		data[offset++] = tri.v0.normal.x;
-		data[offset++] = tri.v0.normal.y;
-		data[offset++] = tri.v0.normal.z;
-		data[offset++] = tri.v0.texCoord.x;
-		data[offset++] = tri.v0.texCoord.y;
-
-		// Vertex3 1
-		data[offset++] = tri.v1.position.x;
-		data[offset++] = tri.v1.position.y;
-		data[offset++] = tri.v1.position.z;
-		data[offset++] = tri.v1.normal.x;
-		data[offset++] = tri.v1.normal.y;
-		data[offset++] = tri.v1.normal.z;
-		data[offset++] = tri.v1.texCoord.x;
-		data[offset++] = tri.v1.texCoord.y;
-
-		// Vertex3 2
-		data[offset++] = tri.v2.position.x;
-		data[offset++] = tri.v2.position.y;
-		data[offset++] = tri.v2.position.z;
-		data[offset++] = tri.v2.normal.x;
-		data[offset++] = tri.v2.normal.y;
-		data[offset++] = tri.v2.normal.z;
-		data[offset++] = tri.v2.texCoord.x;
-		data[offset++] = tri.v2.texCoord.y;
+		return;
 	}
 
-	return data;
+	constexpr size_t floatsPerVertex = sizeof(Vertex3) / sizeof(float);
+	const Vertex3* vertices = (const Vertex3*)vertexData.data();
+	std::vector<SimplifiedMesh> levels;
+	MeshSimplifier::simplify(vertices, vertexData.size() / floatsPerVertex, indexData, targetTriangleCounts, levels);
+
+	// Copy the vertexes each level still uses into its own buffer, so coarse levels only transform what they need
+	std::vector<uint32> remap(vertexData.size() / floatsPerVertex);
+	for (const SimplifiedMesh& level : levels)
+	{
+		MeshLod& lod = m_lods.emplace_back();
+		lod.error = level.error;
+		lod.indexBuffer.reserve(level.indexes.size());
+
+		std::ranges::fill(remap, UINT32_MAX);
+		for (const uint32 index : level.indexes)
+		{
+			if (remap[index] == UINT32_MAX)
+			{
+				remap[index] = (uint32)(lod.vertexBuffer.size() / floatsPerVertex);
+				const float* vertex = vertexData.data() + index * floatsPerVertex;
+				lod.vertexBuffer.insert(lod.vertexBuffer.end(), vertex, vertex + floatsPerVertex);
+			}
+			lod.indexBuffer.push_back(remap[index]);
+		}
+	}
+}
+
+void Mesh::computeBounds()
+{
+	m_bounds = boxf::makeBoundingBox(m_positions);
+	m_boundingSphere = spheref::makeBoundingSphere(m_positions, m_bounds);
+}
+
+namespace
+{
+	/** Hashes every attribute of a vertex, so identical vertexes can be merged into one. **/
+	struct VertexHash
+	{
+		size_t operator()(const Vertex3& vertex) const
+		{
+			const float values[] = { vertex.position.x, vertex.position.y, vertex.position.z, vertex.normal.x, vertex.normal.y,
+				vertex.normal.z, vertex.texCoord.x, vertex.texCoord.y };
+			size_t hash = 0;
+			for (const float value : values)
+			{
+				hash ^= std::hash<float>{}(value) + 0x9e3779b9 + (hash << 6) + (hash >> 2);
+			}
+			return hash;
+		}
+	};
+
+	struct VertexEqual
+	{
+		bool operator()(const Vertex3& a, const Vertex3& b) const
+		{
+			return a.position == b.position && a.normal == b.normal && a.texCoord.x == b.texCoord.x && a.texCoord.y == b.texCoord.y;
+		}
+	};
+} // namespace
+
+void Mesh::toVertexData(std::vector<float>& vertexData, std::vector<uint32>& indexData) const
+{
+	constexpr size_t floatsPerVertex = sizeof(Vertex3) / sizeof(float);
+
+	vertexData.clear();
+	indexData.clear();
+	indexData.reserve(m_triangles.size() * 3);
+
+	std::unordered_map<Vertex3, uint32, VertexHash, VertexEqual> vertexIndexes;
+	vertexIndexes.reserve(m_triangles.size() * 3);
+	for (const Triangle3& tri : m_triangles)
+	{
+		for (const Vertex3* vertex : { &tri.v0, &tri.v1, &tri.v2 })
+		{
+			// Reuse the index of an identical vertex if there is one, otherwise append this vertex
+			auto [it, inserted] = vertexIndexes.try_emplace(*vertex, (uint32)(vertexData.size() / floatsPerVertex));
+			if (inserted)
+			{
+				vertexData.insert(vertexData.end(), { vertex->position.x, vertex->position.y, vertex->position.z, vertex->normal.x,
+														vertex->normal.y, vertex->normal.z, vertex->texCoord.x, vertex->texCoord.y });
+			}
+			indexData.push_back(it->second);
+		}
+	}
 }
 
 bool Triangulation::isTriangleFlipped(int32 orientation, const vec2i& a, const vec2i& b, const vec2i& c)
@@ -1,14 +1,19 @@
 ﻿#pragma once
 
 #include <memory>
+#include <span>
 #include <vector>
 #include <cassert>
 
 #include "Core/LinkedList.h"
+#include "Math/Box.h"
+#include "Math/Sphere.h"
 #include "Math/Vector.h"
 #include "Math/Transform.h"
 
 class Mesh;
+class IRenderable;
+class MappedFile;
 
 struct Index2;
 struct Index3;
@@ -195,6 +200,35 @@ struct Triangle3
 	}
 };
 
+/** A simplified version of a mesh, with its own vertex and index buffers. **/
+struct MeshLod
+{
+	/** Interleaved data of each vertex used by this level, as Vertex3. **/
+	std::vector<float> vertexBuffer;
+	/** Three indexes into vertexBuffer per triangle. **/
+	std::vector<uint32> indexBuffer;
+	/** The same data in the mapped file of a mesh loaded from one, in which case the buffers above are empty. **/
+	std::span<const float>	mappedVertices;
+	std::span<const uint32> mappedIndexes;
+	/** Estimated object-space distance between this level's surface and the full detail surface. **/
+	float error = 0.0f;
+
+	[[nodiscard]] std::span<const float> getVertexData() const
+	{
+		return mappedVertices.empty() ? std::span<const float>(vertexBuffer) : mappedVertices;
+	}
+
+	[[nodiscard]] std::span<const uint32> getIndexData() const
+	{
+		return mappedIndexes.empty() ? std::span<const uint32>(indexBuffer) : mappedIndexes;
+	}
+};
+
+/** Each level of detail targets half the triangles of the level before it. **/
+inline constexpr int32 g_maxLodCount = 6;
+/** Meshes are not simplified below this many triangles. **/
+inline constexpr size_t g_minLodTriangleCount = 64;
+
 class Mesh
 {
 	// Properties
@@ -203,7 +237,27 @@ class Mesh
 	std::vector<vec3f>	   m_normals;
 	std::vector<vec2f>	   m_texCoords;
 
+	/** Interleaved data of each unique vertex, as Vertex3. **/
 	std::vector<float> m_vertexBuffer;
+	/** Three indexes into m_vertexBuffer per triangle. **/
+	std::vector<uint32> m_indexBuffer;
+	/** Incremented every time the vertex and index buffers are rebuilt. **/
+	uint32 m_version = 0;
+
+	/** Simplified levels of detail, from finest to coarsest. Level 0 is the mesh itself and is not stored here. **/
+	std::vector<MeshLod> m_lods;
+
+	/** Object-space bounds of every position, updated with the vertex and index buffers. **/
+	boxf	m_bounds;
+	spheref m_boundingSphere;
+
+	/**
+	 * File the vertex and index data of a mesh loaded from a .pmesh file live in, shared by every copy of the mesh.
+	 * The buffers above are left empty for those meshes.
+	 **/
+	std::shared_ptr<const MappedFile> m_mappedFile;
+	std::span<const float>			  m_mappedVertices;
+	std::span<const uint32>			  m_mappedIndexes;
 
 public:
 	Mesh() = default;
@@ -218,9 +272,39 @@ public:
 
 	[[nodiscard]] bool hasTexCoords() const { return !m_texCoords.empty(); }
 
+	/**
+	 * @brief Builds the vertex and index buffers and bounds from this mesh's triangles, replacing any data it was
+	 * loaded with.
+	 */
 	void processTriangles();
 
-	std::vector<float> toVertexData();
+	/**
+	 * @brief Makes this mesh render straight from data in `file` rather than from its own buffers. Used by PMesh to
+	 * load meshes without copying them, so `file` is kept open for as long as any copy of the mesh references it.
+	 * @param file The mapped file the data lives in.
+	 * @param vertices Interleaved data of each vertex, as Vertex3.
+	 * @param indexes Three indexes into `vertices` per triangle.
+	 * @param lods Simplified levels of detail, from finest to coarsest, whose data may also live in `file`.
+	 */
+	void setMappedData(std::shared_ptr<const MappedFile> file, std::span<const float> vertices, std::span<const uint32> indexes,
+		std::vector<MeshLod>&& lods, const boxf& bounds, const spheref& boundingSphere);
+
+	/** Recomputes the bounding box and bounding sphere from the current positions. **/
+	void computeBounds();
+
+	/**
+	 * @brief Generates simplified levels of detail from the current vertex and index buffers, each with half the
+	 * triangles of the level before it. Meshes which are already small are left with a single level.
+	 */
+	void generateLods();
+
+	/**
+	 * @brief Builds an indexed vertex buffer from this mesh's triangles. Vertexes which are identical in every
+	 * attribute are only stored once.
+	 * @param vertexData Receives the interleaved data of each unique vertex.
+	 * @param indexData Receives three indexes into `vertexData` per triangle.
+	 */
+	void toVertexData(std::vector<float>& vertexData, std::vector<uint32>& indexData) const;
 
 	std::vector<Triangle3>* getTriangles() { return &m_triangles; }
 
@@ -232,22 +316,65 @@ public:
 
 	void setTriangles(const std::vector<Triangle3>& triangles) { m_triangles = triangles; }
 
+	void setTriangles(std::vector<Triangle3>&& triangles) { m_triangles = std::move(triangles); }
+
 	void setPositions(const std::vector<vec3f>& positions) { m_positions = positions; }
 
+	void setPositions(std::vector<vec3f>&& positions) { m_positions = std::move(positions); }
+
 	void setNormals(const std::vector<vec3f>& normals) { m_normals = normals; }
 
+	void setNormals(std::vector<vec3f>&& normals) { m_normals = std::move(normals); }
+
 	void setTexCoords(const std::vector<vec2f>& texCoords) { m_texCoords = texCoords; }
 
-	std::vector<float>* getVertexData() { return &m_vertexBuffer; }
+	void setTexCoords(std::vector<vec2f>&& texCoords) { m_texCoords = std::move(texCoords); }
+
+	/** Returns the interleaved data of each unique vertex, as Vertex3. **/
+	[[nodiscard]] std::span<const float> getVertexData() const
+	{
+		return m_mappedFile ? m_mappedVertices : std::span<const float>(m_vertexBuffer);
+	}
+
+	/** Returns three indexes into the vertex data per triangle. **/
+	[[nodiscard]] std::span<const uint32> getIndexData() const
+	{
+		return m_mappedFile ? m_mappedIndexes : std::span<const uint32>(m_indexBuffer);
+	}
+
+	[[nodiscard]] const boxf& getBounds() const { return m_bounds; }
+
+	[[nodiscard]] const spheref& getBoundingSphere() const { return m_boundingSphere; }
+
+	/** Returns the number of levels of detail, including the full detail mesh. **/
+	[[nodiscard]] int32 getLodCount() const { return (int32)m_lods.size() + 1; }
+
+	/** Returns the simplified level of detail `level`, which must be between 1 and getLodCount() - 1. **/
+	[[nodiscard]] const MeshLod& getLod(const int32 level) const { return m_lods[level - 1]; }
+
+	/** Returns the current version of the vertex and index buffers. Pointers into them are invalidated whenever this changes. **/
+	[[nodiscard]] uint32 getVersion() const { return m_version; }
 
 	/** Returns the size of this mesh's geometry in bytes. **/
-	[[nodiscard]] size_t memorySize() const { return m_vertexBuffer.size() * sizeof(float); }
+	[[nodiscard]] size_t memorySize() const
+	{
+		size_t size = getVertexData().size_bytes() + getIndexData().size_bytes();
+		for (const MeshLod& lod : m_lods)
+		{
+			size += lod.getVertexData().size_bytes() + lod.getIndexData().size_bytes();
+		}
+		return size;
+	}
 };
 
 struct MeshDescription
 {
-	/** Pointer to the transform of this mesh. **/
-	transf* transform = nullptr;
+	/** Pointer to the mesh which owns the vertex and index data. **/
+	Mesh* mesh = nullptr;
+	/** Version of the mesh the data pointers were taken from. **/
+	uint32 version = 0;
+	/** Renderable which places this mesh in the world. **/
+	IRenderable* renderable = nullptr;
 	/** Byte size of the mesh. **/
 	uint32 byteSize = 0;
 	/** Vertex3 count. **/
@@ -257,7 +384,9 @@ struct MeshDescription
 	/** Stride **/
 	uint32 stride = 0;
 	/** Vertex3 data pointer **/
-	float* data = nullptr;
+	const float* data = nullptr;
+	/** Index data pointer, three indexes per triangle. **/
+	const uint32* indexes = nullptr;
 };
 
 // https://github.com/SebLague/Shape-Editor-Tool/blob/master/Shape%20Editor%20E04/Assets/Geometry/Triangulator.cs
@@ -0,0 +1,514 @@
+#include <algorithm>
+#include <cmath>
+#include <queue>
+#include <unordered_map>
+
+#include "Engine/MeshSimplifier.h"
+
+namespace
+{
+	/** Double precision point, so quadrics of large meshes don't lose precision when accumulated. **/
+	struct Point
+	{
+		double x = 0.0;
+		double y = 0.0;
+		double z = 0.0;
+
+		Point operator-(const Point& other) const { return { x - other.x, y - other.y, z - other.z }; }
+
+		[[nodiscard]] double dot(const Point& other) const { return x * other.x + y * other.y + z * other.z; }
+
+		[[nodiscard]] Point cross(const Point& other) const
+		{
+			return { y * other.z - z * other.y, z * other.x - x * other.z, x * other.y - y * other.x };
+		}
+
+		[[nodiscard]] double length() const { return std::sqrt(dot(*this)); }
+	};
+
+	/**
+	 * Symmetric 4x4 matrix which evaluates the weighted sum of squared distances from a point to a set of planes.
+	 * The weight is summed alongside, so the sum can be turned back into an average distance.
+	 */
+	struct Quadric
+	{
+		double a2 = 0.0, ab = 0.0, ac = 0.0, ad = 0.0;
+		double b2 = 0.0, bc = 0.0, bd = 0.0;
+		double c2 = 0.0, cd = 0.0;
+		double d2 = 0.0;
+		double weight = 0.0;
+
+		/** Adds the plane through `point` with unit `normal`. **/
+		void addPlane(const Point& normal, const Point& point, const double planeWeight)
+		{
+			const double a = normal.x;
+			const double b = normal.y;
+			const double c = normal.z;
+			const double d = -normal.dot(point);
+			a2 += planeWeight * a * a;
+			ab += planeWeight * a * b;
+			ac += planeWeight * a * c;
+			ad += planeWeight * a * d;
+			b2 += planeWeight * b * b;
+			bc += planeWeight * b * c;
+			bd += planeWeight * b * d;
+			c2 += planeWeight * c * c;
+			cd += planeWeight * c * d;
+			d2 += planeWeight * d * d;
+			weight += planeWeight;
+		}
+
+		void operator+=(const Quadric& other)
+		{
+			a2 += other.a2;
+			ab += other.ab;
+			ac += other.ac;
+			ad += other.ad;
+			b2 += other.b2;
+			bc += other.bc;
+			bd += other.bd;
+			c2 += other.c2;
+			cd += other.cd;
+			d2 += other.d2;
+			weight += other.weight;
+		}
+
+		[[nodiscard]] double evaluate(const Point& p) const
+		{
+			const double error = a2 * p.x * p.x + 2.0 * ab * p.x * p.y + 2.0 * ac * p.x * p.z + 2.0 * ad * p.x + b2 * p.y * p.y +
+				2.0 * bc * p.y * p.z + 2.0 * bd * p.y + c2 * p.z * p.z + 2.0 * cd * p.z + d2;
+			return std::max(error, 0.0);
+		}
+	};
+
+	/** A candidate collapse of the position `from` onto the position `to`. **/
+	struct Collapse
+	{
+		double cost;
+		uint32 from;
+		uint32 to;
+		/** Versions of both positions when the cost was computed. The collapse is stale if either has changed. **/
+		uint32 fromVersion;
+		uint32 toVersion;
+
+		bool operator>(const Collapse& other) const { return cost > other.cost; }
+	};
+
+	struct PositionHash
+	{
+		size_t operator()(const vec3f& position) const
+		{
+			size_t hash = 0;
+			for (const float value : { position.x, position.y, position.z })
+			{
+				hash ^= std::hash<float>{}(value) + 0x9e3779b9 + (hash << 6) + (hash >> 2);
+			}
+			return hash;
+		}
+	};
+
+	struct PositionEqual
+	{
+		bool operator()(const vec3f& a, const vec3f& b) const { return a.x == b.x && a.y == b.y && a.z == b.z; }
+	};
+
+	uint64 makeEdgeKey(uint32 a, uint32 b)
+	{
+		if (a > b)
+		{
+			std::swap(a, b);
+		}
+		return ((uint64)a << 32) | b;
+	}
+
+	class Simplifier
+	{
+		/** Welded position of each source vertex. **/
+		std::vector<uint32> m_vertexPositions;
+		std::vector<Point>	m_positions;
+		std::vector<Quadric> m_quadrics;
+		std::vector<uint32> m_versions;
+		std::vector<bool>	m_removedPositions;
+		/** Triangles around each position. Removed triangles are pruned lazily. **/
+		std::vector<std::vector<uint32>> m_positionTriangles;
+
+		/** Three source vertex indexes per triangle. **/
+		std::vector<uint32> m_indexes;
+		std::vector<bool>	m_removedTriangles;
+		size_t				m_triangleCount = 0;
+
+		std::priority_queue<Collapse, std::vector<Collapse>, std::greater<>> m_collapses;
+		double m_maxError = 0.0;
+
+		/** Scratch storage for the neighbours of the two positions of a collapse. **/
+		std::vector<uint32> m_fromNeighbours;
+		std::vector<uint32> m_toNeighbours;
+		/** Scratch storage for the positions opposite the collapsed edge. **/
+		std::vector<uint32> m_oppositePositions;
+		/** Scratch storage for the vertex each vertex of the collapsed position is replaced with. **/
+		std::vector<std::pair<uint32, uint32>> m_vertexRemap;
+
+		[[nodiscard]] uint32 positionOf(const uint32 triangle, const int32 corner) const
+		{
+			return m_vertexPositions[m_indexes[triangle * 3 + corner]];
+		}
+
+		[[nodiscard]] bool triangleHasPosition(const uint32 triangle, const uint32 position) const
+		{
+			return positionOf(triangle, 0) == position || positionOf(triangle, 1) == position || positionOf(triangle, 2) == position;
+		}
+
+		[[nodiscard]] Point triangleNormal(const Point& p0, const Point& p1, const Point& p2) const
+		{
+			return (p1 - p0).cross(p2 - p0);
+		}
+
+		/** Removes dead triangles from the triangle list of `position`. **/
+		void pruneTriangles(const uint32 position)
+		{
+			std::vector<uint32>& triangles = m_positionTriangles[position];
+			std::erase_if(triangles, [this](const uint32 triangle) { return m_removedTriangles[triangle]; });
+		}
+
+		void gatherNeighbours(const uint32 position, std::vector<uint32>& neighbours) const
+		{
+			neighbours.clear();
+			for (const uint32 triangle : m_positionTriangles[position])
+			{
+				for (int32 corner = 0; corner < 3; corner++)
+				{
+					const uint32 neighbour = positionOf(triangle, corner);
+					if (neighbour != position && std::ranges::find(neighbours, neighbour) == neighbours.end())
+					{
+						neighbours.push_back(neighbour);
+					}
+				}
+			}
+		}
+
+		void pushCollapse(const uint32 from, const uint32 to)
+		{
+			Quadric quadric = m_quadrics[from];
+			quadric += m_quadrics[to];
+			m_collapses.push({ quadric.evaluate(m_positions[to]), from, to, m_versions[from], m_versions[to] });
+		}
+
+		/**
+		 * Checks whether moving `from` onto `to` keeps the surface a manifold (the link condition), and doesn't flip any
+		 * of the triangles which remain.
+		 */
+		bool canCollapse(const uint32 from, const uint32 to)
+		{
+			gatherNeighbours(from, m_fromNeighbours);
+			gatherNeighbours(to, m_toNeighbours);
+
+			// Collect the positions opposite the edge in the triangles on either side of it. Double-sided surfaces have
+			// more than one triangle per side, so these are not simply counted.
+			m_oppositePositions.clear();
+			for (const uint32 triangle : m_positionTriangles[from])
+			{
+				if (!triangleHasPosition(triangle, to))
+				{
+					continue;
+				}
+				for (int32 corner = 0; corner < 3; corner++)
+				{
+					const uint32 position = positionOf(triangle, corner);
+					if (position != from && position != to && std::ranges::find(m_oppositePositions, position) == m_oppositePositions.end())
+					{
+						m_oppositePositions.push_back(position);
+					}
+				}
+			}
+			if (m_oppositePositions.empty())
+			{
+				return false;
+			}
+
+			// The edge's endpoints may only share the neighbours opposite the edge, otherwise collapsing it would join
+			// two separate parts of the surface
+			size_t sharedNeighbours = 0;
+			for (const uint32 neighbour : m_fromNeighbours)
+			{
+				sharedNeighbours += std::ranges::find(m_toNeighbours, neighbour) != m_toNeighbours.end() ? 1 : 0;
+			}
+			if (sharedNeighbours != m_oppositePositions.size())
+			{
+				return false;
+			}
+
+			for (const uint32 triangle : m_positionTriangles[from])
+			{
+				if (triangleHasPosition(triangle, to))
+				{
+					continue;
+				}
+
+				Point points[3];
+				Point moved[3];
+				for (int32 corner = 0; corner < 3; corner++)
+				{
+					const uint32 position = positionOf(triangle, corner);
+					points[corner] = m_positions[position];
+					moved[corner] = position == from ? m_positions[to] : points[corner];
+				}
+
+				const Point before = triangleNormal(points[0], points[1], points[2]);
+				const Point after = triangleNormal(moved[0], moved[1], moved[2]);
+
+				// Reject collapses which flip a triangle, or squash it down to a sliver
+				const double afterLength = after.length();
+				if (before.dot(after) <= 0.0 || afterLength <= 1e-3 * before.length())
+				{
+					return false;
+				}
+			}
+
+			return true;
+		}
+
+		void collapse(const uint32 from, const uint32 to)
+		{
+			// Vertexes on the collapsed position take the attributes of the vertex they share an edge with on the
+			// target position. Vertexes on the other side of a seam fall back to the first shared edge.
+			m_vertexRemap.clear();
+			for (const uint32 triangle : m_positionTriangles[from])
+			{
+				if (!triangleHasPosition(triangle, to))
+				{
+					continue;
+				}
+
+				uint32 fromVertex = 0;
+				uint32 toVertex = 0;
+				for (int32 corner = 0; corner < 3; corner++)
+				{
+					const uint32 vertex = m_indexes[triangle * 3 + corner];
+					if (m_vertexPositions[vertex] == from)
+					{
+						fromVertex = vertex;
+					}
+					else if (m_vertexPositions[vertex] == to)
+					{
+						toVertex = vertex;
+					}
+				}
+				m_vertexRemap.emplace_back(fromVertex, toVertex);
+
+				m_removedTriangles[triangle] = true;
+				m_triangleCount--;
+			}
+
+			for (const uint32 triangle : m_positionTriangles[from])
+			{
+				if (m_removedTriangles[triangle])
+				{
+					continue;
+				}
+
+				for (int32 corner = 0; corner < 3; corner++)
+				{
+					uint32& vertex = m_indexes[triangle * 3 + corner];
+					if (m_vertexPositions[vertex] != from)
+					{
+						continue;
+					}
+
+					auto it = std::ranges::find_if(m_vertexRemap, [vertex](const auto& pair) { return pair.first == vertex; });
+					vertex = it != m_vertexRemap.end() ? it->second : m_vertexRemap.front().second;
+				}
+				m_positionTriangles[to].push_back(triangle);
+			}
+
+			m_quadrics[to] += m_quadrics[from];
+			m_removedPositions[from] = true;
+			m_positionTriangles[from].clear();
+			m_versions[to]++;
+			pruneTriangles(to);
+
+			// Every edge around the target position has a new cost
+			gatherNeighbours(to, m_toNeighbours);
+			for (const uint32 neighbour : m_toNeighbours)
+			{
+				pushCollapse(to, neighbour);
+				pushCollapse(neighbour, to);
+			}
+		}
+
+		void record(std::vector<SimplifiedMesh>& levels) const
+		{
+			SimplifiedMesh& level = levels.emplace_back();
+			level.indexes.reserve(m_triangleCount * 3);
+			for (size_t triangle = 0; triangle < m_removedTriangles.size(); triangle++)
+			{
+				if (!m_removedTriangles[triangle])
+				{
+					level.indexes.insert(level.indexes.end(), m_indexes.begin() + triangle * 3, m_indexes.begin() + triangle * 3 + 3);
+				}
+			}
+			level.error = (float)m_maxError;
+		}
+
+	public:
+		Simplifier(const Vertex3* vertices, const size_t vertexCount, const std::span<const uint32> indexes)
+			: m_indexes(indexes.begin(), indexes.end())
+		{
+			// Weld vertexes which only differ by their normal or texture coordinate
+			std::unordered_map<vec3f, uint32, PositionHash, PositionEqual> positionIndexes;
+			m_vertexPositions.resize(vertexCount);
+			for (size_t vertex = 0; vertex < vertexCount; vertex++)
+			{
+				const vec3f& position = vertices[vertex].position;
+				auto [it, inserted] = positionIndexes.try_emplace(position, (uint32)m_positions.size());
+				if (inserted)
+				{
+					m_positions.push_back({ position.x, position.y, position.z });
+				}
+				m_vertexPositions[vertex] = it->second;
+			}
+
+			const size_t positionCount = m_positions.size();
+			m_quadrics.resize(positionCount);
+			m_versions.resize(positionCount, 0);
+			m_removedPositions.resize(positionCount, false);
+			m_positionTriangles.resize(positionCount);
+
+			const size_t triangleCount = m_indexes.size() / 3;
+			m_indexes.resize(triangleCount * 3);
+			m_removedTriangles.resize(triangleCount, false);
+			m_triangleCount = triangleCount;
+
+			// Each position starts with the planes of the triangles around it, weighted by their area. Degenerate
+			// triangles add nothing and are dropped straight away.
+			std::unordered_map<uint64, uint32> edgeCounts;
+			for (uint32 triangle = 0; triangle < triangleCount; triangle++)
+			{
+				const uint32 p0 = positionOf(triangle, 0);
+				const uint32 p1 = positionOf(triangle, 1);
+				const uint32 p2 = positionOf(triangle, 2);
+				if (p0 == p1 || p1 == p2 || p2 == p0)
+				{
+					m_removedTriangles[triangle] = true;
+					m_triangleCount--;
+					continue;
+				}
+
+				const Point normal = triangleNormal(m_positions[p0], m_positions[p1], m_positions[p2]);
+				const double doubleArea = normal.length();
+				if (doubleArea > 0.0)
+				{
+					const Point unitNormal = { normal.x / doubleArea, normal.y / doubleArea, normal.z / doubleArea };
+					for (const uint32 position : { p0, p1, p2 })
+					{
+						m_quadrics[position].addPlane(unitNormal, m_positions[p0], doubleArea * 0.5);
+					}
+				}
+
+				for (const uint32 position : { p0, p1, p2 })
+				{
+					m_positionTriangles[position].push_back(triangle);
+				}
+				edgeCounts[makeEdgeKey(p0, p1)]++;
+				edgeCounts[makeEdgeKey(p1, p2)]++;
+				edgeCounts[makeEdgeKey(p2, p0)]++;
+			}
+
+			// Open borders only have triangles on one side, so they are held in place by a plane perpendicular to the
+			// triangle along each border edge
+			for (uint32 triangle = 0; triangle < triangleCount; triangle++)
+			{
+				if (m_removedTriangles[triangle])
+				{
+					continue;
+				}
+
+				const Point normal = triangleNormal(m_positions[positionOf(triangle, 0)], m_positions[positionOf(triangle, 1)],
+					m_positions[positionOf(triangle, 2)]);
+				for (int32 corner = 0; corner < 3; corner++)
+				{
+					const uint32 a = positionOf(triangle, corner);
+					const uint32 b = positionOf(triangle, (corner + 1) % 3);
+					if (edgeCounts[makeEdgeKey(a, b)] != 1)
+					{
+						continue;
+					}
+
+					const Point edge = m_positions[b] - m_positions[a];
+					const Point borderNormal = edge.cross(normal);
+					const double length = borderNormal.length();
+					if (length > 0.0)
+					{
+						const Point unitNormal = { borderNormal.x / length, borderNormal.y / length, borderNormal.z / length };
+						const double edgeWeight = edge.dot(edge);
+						m_quadrics[a].addPlane(unitNormal, m_positions[a], edgeWeight);
+						m_quadrics[b].addPlane(unitNormal, m_positions[a], edgeWeight);
+					}
+				}
+			}
+
+			for (const auto& [key, count] : edgeCounts)
+			{
+				const uint32 a = (uint32)(key >> 32);
+				const uint32 b = (uint32)(key & 0xFFFFFFFF);
+				pushCollapse(a, b);
+				pushCollapse(b, a);
+			}
+		}
+
+		void simplify(const std::vector<size_t>& targetTriangleCounts, std::vector<SimplifiedMesh>& levels)
+		{
+			size_t targetIndex = 0;
+			while (targetIndex < targetTriangleCounts.size() && !m_collapses.empty())
+			{
+				if (m_triangleCount <= targetTriangleCounts[targetIndex])
+				{
+					record(levels);
+					targetIndex++;
+					continue;
+				}
+
+				const Collapse candidate = m_collapses.top();
+				m_collapses.pop();
+
+				// Skip collapses whose positions have been removed or changed since they were queued
+				if (m_removedPositions[candidate.from] || m_removedPositions[candidate.to] ||
+					m_versions[candidate.from] != candidate.fromVersion || m_versions[candidate.to] != candidate.toVersion)
+				{
+					continue;
+				}
+
+				pruneTriangles(candidate.from);
+				pruneTriangles(candidate.to);
+				if (!canCollapse(candidate.from, candidate.to))
+				{
+					continue;
+				}
+
+				const double weight = m_quadrics[candidate.from].weight + m_quadrics[candidate.to].weight;
+				if (weight > 0.0)
+				{
+					m_maxError = std::max(m_maxError, std::sqrt(candidate.cost / weight));
+				}
+				collapse(candidate.from, candidate.to);
+			}
+
+			if (targetIndex < targetTriangleCounts.size() && m_triangleCount <= targetTriangleCounts[targetIndex])
+			{
+				record(levels);
+			}
+		}
+	};
+} // namespace
+
+void MeshSimplifier::simplify(const Vertex3* vertices, const size_t vertexCount, const std::span<const uint32> indexes,
+	const std::vector<size_t>& targetTriangleCounts, std::vector<SimplifiedMesh>& levels)
+{
+	levels.clear();
+	if (vertices == nullptr || vertexCount == 0 || indexes.size() < 3)
+	{
+		return;
+	}
+
+	Simplifier simplifier(vertices, vertexCount, indexes);
+	simplifier.simplify(targetTriangleCounts, levels);
+}
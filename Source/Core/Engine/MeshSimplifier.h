@@ -0,0 +1,36 @@
+#pragma once
+
+#include <span>
+#include <vector>
+
+#include "Engine/Mesh.h"
+
+/** A simplified index buffer produced by MeshSimplifier. **/
+struct SimplifiedMesh
+{
+	/** Three indexes into the source vertexes per remaining triangle. **/
+	std::vector<uint32> indexes;
+	/** Estimated object-space distance between the simplified surface and the source surface. **/
+	float error = 0.0f;
+};
+
+/**
+ * Mesh simplification by quadric error edge collapse (Garland & Heckbert, "Surface Simplification Using Quadric Error
+ * Metrics"). Vertexes which share a position are collapsed together, so seams in normals and texture coordinates don't
+ * tear the surface apart.
+ */
+namespace MeshSimplifier
+{
+	/**
+	 * @brief Repeatedly collapses the cheapest edge of a mesh, recording the remaining triangles each time the
+	 * triangle count reaches one of `targetTriangleCounts`.
+	 * @param vertices The source vertexes.
+	 * @param vertexCount The number of source vertexes.
+	 * @param indexes Three indexes into `vertices` per triangle.
+	 * @param targetTriangleCounts Triangle counts to record, in decreasing order.
+	 * @param levels Receives one simplified mesh per target which could be reached. Simplification stops early if no
+	 * edge can be collapsed without flipping or tearing the surface.
+	 */
+	void simplify(const Vertex3* vertices, size_t vertexCount, std::span<const uint32> indexes,
+		const std::vector<size_t>& targetTriangleCounts, std::vector<SimplifiedMesh>& levels);
+} // namespace MeshSimplifier
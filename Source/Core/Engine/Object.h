@@ -6,6 +6,7 @@
 #include "Mesh.h"
 
 #include "Core/Bitmask.h"
+#include "Math/Matrix.h"
 
 using ObjectId = uint32;
 
@@ -22,7 +23,14 @@ class IRenderable
 {
 public:
 	virtual Mesh* getMesh() = 0;
-	virtual transf* getTransform() = 0;
+	/** Read only, as writing the transform directly would leave the cached world matrix and scene bounds stale. **/
+	virtual const transf* getTransform() = 0;
+
+	/** Returns the matrix which transforms the mesh into world space. **/
+	virtual mat4f getWorldMatrix()
+	{
+		return getTransform()->toMatrix();
+	}
 };
 
 class ITickable
@@ -2,16 +2,23 @@
 
 #include <assert.h>
 
+#include "BoundingVolumeHierarchy.h"
 #include "Object.h"
 
 constexpr uint32 g_maxObjectCount = 10000;
 
+class Actor;
+
 // https://austinmorlan.com/posts/entity_component_system/
 class ObjectManager
 {
 	std::array<Object*, g_maxObjectCount> m_objects{};
 	std::queue<ObjectId> m_availableIds{};
 	int32 m_objectCount = 0;
+	/** Spatial hierarchy over every renderable object. **/
+	BoundingVolumeHierarchy m_renderableTree;
+	/** Actors whose world matrix has changed since the last call to Actor::updateTransforms. **/
+	std::vector<Actor*> m_changedActors;
 
 public:
 	ObjectManager()
@@ -44,6 +51,12 @@ public:
 		Object* newObject = m_objects[id];
 		newObject->setObjectId(id);
 
+		// Track renderables in the scene's bounding volume hierarchy
+		if (newObject->hasSignature(ESignature::Renderable))
+		{
+			m_renderableTree.insert(dynamic_cast<IRenderable*>(newObject));
+		}
+
 		// Bump object count
 		m_objectCount++;
 
@@ -58,6 +71,10 @@ public:
 
 		auto id       = object->getObjectId();
 		m_objects[id] = nullptr;
+		if (object->hasSignature(ESignature::Renderable))
+		{
+			m_renderableTree.remove(dynamic_cast<IRenderable*>(object));
+		}
 		object->~T();
 		m_availableIds.push(id);
 	}
@@ -101,6 +118,33 @@ public:
 		return out;
 	}
 
+	/**
+	 * @brief Rebuilds the bounding volume hierarchy over every renderable from scratch. Should be called once a
+	 * scene has been loaded, as it produces a better tree than inserting renderables one at a time.
+	 */
+	void rebuildRenderableTree()
+	{
+		m_renderableTree.build(getRenderables());
+	}
+
+	/**
+	 * @brief Updates the bounds of `renderable` in the bounding volume hierarchy after its transform or mesh has changed.
+	 */
+	void updateRenderable(IRenderable* renderable)
+	{
+		m_renderableTree.update(renderable);
+	}
+
+	[[nodiscard]] BoundingVolumeHierarchy* getRenderableTree()
+	{
+		return &m_renderableTree;
+	}
+
+	[[nodiscard]] std::vector<Actor*>& getChangedActors()
+	{
+		return m_changedActors;
+	}
+
 	[[nodiscard]] std::vector<ITickable*> getTickables() const
 	{
 		std::vector<ITickable*> out;
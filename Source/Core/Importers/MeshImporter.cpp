@@ -0,0 +1,435 @@
+#include <algorithm>
+#include <charconv>
+#include <cstring>
+#include <filesystem>
+#include <string_view>
+#include <thread>
+
+#include "Importers/MeshImporter.h"
+#include "Importers/PMesh.h"
+
+#include "Core/Logging.h"
+#include "Core/ThreadPool.h"
+#include "Platforms/Generic/MappedFile.h"
+
+namespace
+{
+	/** Files are only split into chunks of at least this many bytes, as smaller ones aren't worth a thread. **/
+	constexpr size_t g_minObjChunkSize = 1 << 20;
+	/** Chunks per thread, so threads which finish early can pick up more work. **/
+	constexpr int32 g_objChunksPerThread = 4;
+
+	/** Index of an attribute a face corner doesn't have. **/
+	constexpr int32 g_missingObjIndex = INT32_MIN;
+
+	/** Attributes of a face corner whose index counts back from the end of the chunk's own attributes. **/
+	constexpr uint8 g_relativePosition = 1;
+	constexpr uint8 g_relativeTexCoord = 2;
+	constexpr uint8 g_relativeNormal = 4;
+
+	/** Zero-based indexes of the attributes of one corner of a face. **/
+	struct ObjCorner
+	{
+		int32 position = g_missingObjIndex;
+		int32 texCoord = g_missingObjIndex;
+		int32 normal = g_missingObjIndex;
+		uint8 relative = 0;
+	};
+
+	/** Everything parsed from one line-aligned range of the file. **/
+	struct ObjChunk
+	{
+		std::string_view   text;
+		std::vector<vec3f> positions;
+		std::vector<vec3f> normals;
+		std::vector<vec2f> texCoords;
+		/** Three corners per triangle. **/
+		std::vector<ObjCorner> corners;
+		/** Number of statements which were skipped because they aren't supported. **/
+		int32 ignoredCount = 0;
+		/** Start of the first line which couldn't be parsed, if any. **/
+		const char* errorLine = nullptr;
+
+		/** Offsets of this chunk's attributes and triangles in the merged mesh. **/
+		int32 positionOffset = 0;
+		int32 texCoordOffset = 0;
+		int32 normalOffset = 0;
+		size_t triangleOffset = 0;
+		/** Whether a face references an attribute which doesn't exist. **/
+		bool hasInvalidIndex = false;
+	};
+
+	bool isSpace(const char c)
+	{
+		return c == ' ' || c == '\t' || c == '\r';
+	}
+
+	const char* skipSpaces(const char* p, const char* end)
+	{
+		while (p != end && isSpace(*p))
+		{
+			p++;
+		}
+		return p;
+	}
+
+	bool parseFloat(const char*& p, const char* end, float& value)
+	{
+		p = skipSpaces(p, end);
+
+		// std::from_chars doesn't accept an explicit plus sign
+		if (p != end && *p == '+')
+		{
+			p++;
+		}
+		const auto [next, error] = std::from_chars(p, end, value);
+		if (error != std::errc())
+		{
+			return false;
+		}
+		p = next;
+		return true;
+	}
+
+	/**
+	 * @brief Parses a one-based index of an attribute, of which `count` have been read so far. Negative indexes count
+	 * back from `count`, and are marked as relative with `relativeBit`.
+	 */
+	bool parseIndex(const char*& p, const char* end, const size_t count, const uint8 relativeBit, int32& index, uint8& relative)
+	{
+		int32 value = 0;
+		const auto [next, error] = std::from_chars(p, end, value);
+		if (error != std::errc() || value == 0)
+		{
+			return false;
+		}
+		p = next;
+
+		if (value > 0)
+		{
+			index = value - 1;
+		}
+		else
+		{
+			index = (int32)count + value;
+			relative |= relativeBit;
+		}
+		return true;
+	}
+
+	/**
+	 * @brief Parses the corners of a face, as `v`, `v/vt`, `v//vn` or `v/vt/vn`, and splits it into a fan of triangles.
+	 */
+	bool parseFace(const char* p, const char* end, ObjChunk& chunk)
+	{
+		ObjCorner first;
+		ObjCorner previous;
+		int32	  count = 0;
+		while ((p = skipSpaces(p, end)) != end)
+		{
+			ObjCorner corner;
+			if (!parseIndex(p, end, chunk.positions.size(), g_relativePosition, corner.position, corner.relative))
+			{
+				return false;
+			}
+			if (p != end && *p == '/')
+			{
+				p++;
+				if (p != end && *p != '/'
+					&& !parseIndex(p, end, chunk.texCoords.size(), g_relativeTexCoord, corner.texCoord, corner.relative))
+				{
+					return false;
+				}
+				if (p != end && *p == '/')
+				{
+					p++;
+					if (!parseIndex(p, end, chunk.normals.size(), g_relativeNormal, corner.normal, corner.relative))
+					{
+						return false;
+					}
+				}
+			}
+			if (p != end && !isSpace(*p))
+			{
+				return false;
+			}
+
+			if (count == 0)
+			{
+				first = corner;
+			}
+			else if (count >= 2)
+			{
+				chunk.corners.push_back(first);
+				chunk.corners.push_back(previous);
+				chunk.corners.push_back(corner);
+			}
+			previous = corner;
+			count++;
+		}
+		return count >= 3;
+	}
+
+	bool parseLine(const char* p, const char* end, ObjChunk& chunk)
+	{
+		p = skipSpaces(p, end);
+		const char* keyword = p;
+		while (p != end && !isSpace(*p))
+		{
+			p++;
+		}
+
+		const std::string_view token(keyword, p - keyword);
+		if (token.empty() || token[0] == '#')
+		{
+			return true;
+		}
+		if (token == "v")
+		{
+			vec3f& position = chunk.positions.emplace_back();
+			return parseFloat(p, end, position.x) && parseFloat(p, end, position.y) && parseFloat(p, end, position.z);
+		}
+		if (token == "vt")
+		{
+			vec2f& texCoord = chunk.texCoords.emplace_back();
+			return parseFloat(p, end, texCoord.x) && parseFloat(p, end, texCoord.y);
+		}
+		if (token == "vn")
+		{
+			vec3f& normal = chunk.normals.emplace_back();
+			return parseFloat(p, end, normal.x) && parseFloat(p, end, normal.y) && parseFloat(p, end, normal.z);
+		}
+		if (token == "f")
+		{
+			return parseFace(p, end, chunk);
+		}
+
+		// Objects, groups, smoothing groups and materials
+		chunk.ignoredCount++;
+		return true;
+	}
+
+	void parseChunk(ObjChunk& chunk)
+	{
+		const char* p = chunk.text.data();
+		const char* end = p + chunk.text.size();
+		while (p < end)
+		{
+			const char* lineEnd = (const char*)std::memchr(p, '\n', end - p);
+			if (lineEnd == nullptr)
+			{
+				lineEnd = end;
+			}
+			if (!parseLine(p, lineEnd, chunk))
+			{
+				chunk.errorLine = p;
+				return;
+			}
+			p = lineEnd + 1;
+		}
+	}
+
+	/**
+	 * @brief Resolves a corner's index of an attribute to an index into the merged attributes. Returns false if it
+	 * doesn't reference one of the `count` attributes.
+	 */
+	bool resolveIndex(int32& index, const bool relative, const int32 offset, const int32 count)
+	{
+		if (relative)
+		{
+			index += offset;
+		}
+		return index >= 0 && index < count;
+	}
+
+	/**
+	 * @brief Builds the triangles of `chunk` in `triangles`, with indexes into the merged attributes.
+	 */
+	void buildTriangles(ObjChunk& chunk, const int32 positionCount, const int32 texCoordCount, const int32 normalCount,
+		std::vector<Triangle3>& triangles)
+	{
+		for (size_t i = 0; i < chunk.corners.size(); i += 3)
+		{
+			ObjCorner* corners = &chunk.corners[i];
+			bool	   hasTexCoords = true;
+			bool	   hasNormals = true;
+			for (int32 j = 0; j < 3; j++)
+			{
+				ObjCorner& corner = corners[j];
+				if (!resolveIndex(corner.position, corner.relative & g_relativePosition, chunk.positionOffset, positionCount))
+				{
+					chunk.hasInvalidIndex = true;
+					return;
+				}
+				if (corner.texCoord != g_missingObjIndex
+					&& !resolveIndex(corner.texCoord, corner.relative & g_relativeTexCoord, chunk.texCoordOffset, texCoordCount))
+				{
+					chunk.hasInvalidIndex = true;
+					return;
+				}
+				if (corner.normal != g_missingObjIndex
+					&& !resolveIndex(corner.normal, corner.relative & g_relativeNormal, chunk.normalOffset, normalCount))
+				{
+					chunk.hasInvalidIndex = true;
+					return;
+				}
+				hasTexCoords &= corner.texCoord != g_missingObjIndex;
+				hasNormals &= corner.normal != g_missingObjIndex;
+			}
+
+			// Attributes are only used if every corner of the triangle has them
+			Triangle3& triangle = triangles[chunk.triangleOffset + i / 3];
+			triangle.positionIndexes = { corners[0].position, corners[1].position, corners[2].position };
+			if (hasTexCoords)
+			{
+				triangle.texCoordIndexes = { corners[0].texCoord, corners[1].texCoord, corners[2].texCoord };
+			}
+			if (hasNormals)
+			{
+				triangle.normalIndexes = { corners[0].normal, corners[1].normal, corners[2].normal };
+			}
+		}
+	}
+
+	template <typename T>
+	void appendAll(const std::vector<ObjChunk>& chunks, std::vector<T> ObjChunk::*attribute, std::vector<T>& out)
+	{
+		size_t count = 0;
+		for (const ObjChunk& chunk : chunks)
+		{
+			count += (chunk.*attribute).size();
+		}
+		out.reserve(count);
+		for (const ObjChunk& chunk : chunks)
+		{
+			out.insert(out.end(), (chunk.*attribute).begin(), (chunk.*attribute).end());
+		}
+	}
+} // namespace
+
+bool ObjImporter::import(const std::string& fileName, Mesh* mesh)
+{
+	MappedFile file;
+	if (!file.open(fileName))
+	{
+		LOG_ERROR("Unable to read file {}", fileName)
+		return false;
+	}
+	const std::string_view text = file.getView();
+
+	// Split the file into chunks which each start at the beginning of a line
+	const int32 threadCount = std::max(1, (int32)std::thread::hardware_concurrency());
+	const int32 chunkCount = (int32)std::clamp<size_t>(text.size() / g_minObjChunkSize, 1, (size_t)(threadCount * g_objChunksPerThread));
+	std::vector<ObjChunk> chunks(chunkCount);
+	size_t				  chunkStart = 0;
+	for (int32 i = 0; i < chunkCount; i++)
+	{
+		size_t chunkEnd = text.size();
+		if (i + 1 < chunkCount)
+		{
+			chunkEnd = text.find('\n', std::max(chunkStart, text.size() * (i + 1) / chunkCount));
+			chunkEnd = chunkEnd == std::string_view::npos ? text.size() : chunkEnd + 1;
+		}
+		chunks[i].text = text.substr(chunkStart, chunkEnd - chunkStart);
+		chunkStart = chunkEnd;
+	}
+
+	// Parse every chunk on its own, then report the first error in the file
+	ThreadPool pool(std::min(threadCount, chunkCount));
+	pool.parallelFor(chunkCount, [&](const int32 index, int32) { parseChunk(chunks[index]); });
+	for (const ObjChunk& chunk : chunks)
+	{
+		if (chunk.errorLine != nullptr)
+		{
+			const char*	   lineEnd = std::find(chunk.errorLine, text.data() + text.size(), '\n');
+			const int64	   lineNumber = std::count(text.data(), chunk.errorLine, '\n') + 1;
+			const std::string line(chunk.errorLine, lineEnd);
+			LOG_ERROR("Failed to parse line {} of {}: {}", lineNumber, fileName, line)
+			return false;
+		}
+	}
+
+	// Each chunk's attributes follow those of the chunks before it
+	int32  positionCount = 0;
+	int32  texCoordCount = 0;
+	int32  normalCount = 0;
+	size_t triangleCount = 0;
+	int32  ignoredCount = 0;
+	for (ObjChunk& chunk : chunks)
+	{
+		chunk.positionOffset = positionCount;
+		chunk.texCoordOffset = texCoordCount;
+		chunk.normalOffset = normalCount;
+		chunk.triangleOffset = triangleCount;
+		positionCount += (int32)chunk.positions.size();
+		texCoordCount += (int32)chunk.texCoords.size();
+		normalCount += (int32)chunk.normals.size();
+		triangleCount += chunk.corners.size() / 3;
+		ignoredCount += chunk.ignoredCount;
+	}
+	if (ignoredCount > 0)
+	{
+		LOG_WARNING("Ignored {} unsupported statements in {}", ignoredCount, fileName)
+	}
+
+	// Build the triangles of each chunk in place
+	std::vector<Triangle3> triangles(triangleCount);
+	pool.parallelFor(chunkCount, [&](const int32 index, int32)
+		{ buildTriangles(chunks[index], positionCount, texCoordCount, normalCount, triangles); });
+	if (std::ranges::any_of(chunks, [](const ObjChunk& chunk) { return chunk.hasInvalidIndex; }))
+	{
+		LOG_ERROR("A face in {} references a vertex attribute which doesn't exist", fileName)
+		return false;
+	}
+
+	std::vector<vec3f> positions;
+	std::vector<vec3f> normals;
+	std::vector<vec2f> texCoords;
+	appendAll(chunks, &ObjChunk::positions, positions);
+	appendAll(chunks, &ObjChunk::normals, normals);
+	appendAll(chunks, &ObjChunk::texCoords, texCoords);
+
+	mesh->setTriangles(std::move(triangles));
+	mesh->setPositions(std::move(positions));
+	if (!normals.empty())
+	{
+		mesh->setNormals(std::move(normals));
+	}
+	if (!texCoords.empty())
+	{
+		mesh->setTexCoords(std::move(texCoords));
+	}
+
+	// Build the render buffers, then the levels of detail from them
+	mesh->processTriangles();
+	mesh->generateLods();
+
+	return true;
+}
+
+bool ObjImporter::importCached(const std::string& fileName, Mesh* mesh)
+{
+	const std::string cacheFileName = std::filesystem::path(fileName).replace_extension(".pmesh").string();
+	const std::string latestFileName = PMesh::resolve(cacheFileName);
+
+	// Use the cache if it was written after the OBJ file last changed
+	std::error_code		  error;
+	const auto			  sourceTime = std::filesystem::last_write_time(fileName, error);
+	const std::error_code sourceError = error;
+	const auto			  cacheTime = std::filesystem::last_write_time(latestFileName, error);
+	if (!error && (sourceError || cacheTime > sourceTime) && PMesh::load(latestFileName, mesh))
+	{
+		return true;
+	}
+
+	if (!import(fileName, mesh))
+	{
+		return false;
+	}
+	if (!PMesh::write(*mesh, cacheFileName))
+	{
+		LOG_WARNING("Unable to cache {} as {}", fileName, cacheFileName)
+	}
+
+	return true;
+}
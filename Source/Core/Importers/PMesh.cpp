@@ -0,0 +1,364 @@
+#include <algorithm>
+#include <bit>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <limits>
+
+#include "Importers/PMesh.h"
+
+#include "Core/Logging.h"
+#include "Engine/Timer.h"
+#include "Importers/MeshImporter.h"
+#include "Importers/ResourceManager.h"
+#include "Platforms/Generic/MappedFile.h"
+
+// Files are stored in the byte order of the machine which wrote them
+static_assert(std::endian::native == std::endian::little, "PMesh files are little endian.");
+
+namespace
+{
+	constexpr char g_pmeshMagic[4] = { 'P', 'M', 'S', 'H' };
+	/** Alignment of every section of the file. A cache line, and a multiple of the alignment of every SIMD type. **/
+	constexpr uint64 g_pmeshAlignment = 64;
+	/** Floats per vertex, stored so files written with a different Vertex3 are rejected. **/
+	constexpr uint32 g_pmeshVertexStride = sizeof(Vertex3) / sizeof(float);
+
+	struct PMeshHeader
+	{
+		char   magic[4];
+		uint32 version;
+		/** Number of levels of detail, including the full detail mesh. **/
+		uint32 levelCount;
+		uint32 vertexStride;
+		float  boundsMin[3];
+		float  boundsMax[3];
+		float  sphereCenter[3];
+		float  sphereRadius;
+		uint64 fileSize;
+	};
+
+	struct PMeshLevel
+	{
+		uint64 vertexOffset;
+		/** Number of floats, not vertexes. **/
+		uint64 vertexCount;
+		uint64 indexOffset;
+		uint64 indexCount;
+		float  error;
+		uint32 padding;
+	};
+
+	static_assert(sizeof(PMeshHeader) == 64);
+	static_assert(sizeof(PMeshLevel) == 40);
+
+	uint64 alignOffset(const uint64 offset)
+	{
+		return (offset + g_pmeshAlignment - 1) & ~(g_pmeshAlignment - 1);
+	}
+
+	/** Whether `count` elements of `T` starting at `offset` are aligned and lie within a file of `fileSize` bytes. **/
+	template <typename T>
+	bool isValidSection(const uint64 offset, const uint64 count, const uint64 fileSize)
+	{
+		return offset % g_pmeshAlignment == 0 && offset <= fileSize && count <= (fileSize - offset) / sizeof(T);
+	}
+
+	/** Whether every index refers to one of `vertexCount` vertexes. **/
+	bool areValidIndexes(const std::span<const uint32> indexes, const uint64 vertexCount)
+	{
+		return std::ranges::all_of(indexes, [vertexCount](const uint32 index) { return index < vertexCount; });
+	}
+
+	/** Name a file is written to when the file it replaces can't be removed. **/
+	std::string getPendingFileName(const std::string& fileName)
+	{
+		return fileName + ".pending";
+	}
+
+	/** Whether `a` and `b` hold the same bytes. **/
+	template <typename T>
+	bool isEqual(const std::span<const T> a, const std::span<const T> b)
+	{
+		return a.size() == b.size() && std::memcmp(a.data(), b.data(), a.size_bytes()) == 0;
+	}
+} // namespace
+
+bool PMesh::write(const Mesh& mesh, const std::string& fileName)
+{
+	// Gather the data of every level, the full detail mesh first
+	const int32							 levelCount = mesh.getLodCount();
+	std::vector<std::span<const float>>	 vertexData(levelCount);
+	std::vector<std::span<const uint32>> indexData(levelCount);
+	std::vector<PMeshLevel>				 levels(levelCount);
+	vertexData[0] = mesh.getVertexData();
+	indexData[0] = mesh.getIndexData();
+	for (int32 level = 1; level < levelCount; level++)
+	{
+		const MeshLod& lod = mesh.getLod(level);
+		vertexData[level] = lod.getVertexData();
+		indexData[level] = lod.getIndexData();
+		levels[level].error = lod.error;
+	}
+
+	// Lay out the sections after the header and level table
+	uint64 offset = sizeof(PMeshHeader) + levelCount * sizeof(PMeshLevel);
+	for (int32 level = 0; level < levelCount; level++)
+	{
+		levels[level].vertexOffset = alignOffset(offset);
+		levels[level].vertexCount = vertexData[level].size();
+		offset = levels[level].vertexOffset + vertexData[level].size_bytes();
+		levels[level].indexOffset = alignOffset(offset);
+		levels[level].indexCount = indexData[level].size();
+		offset = levels[level].indexOffset + indexData[level].size_bytes();
+	}
+
+	const boxf&	   bounds = mesh.getBounds();
+	const spheref& sphere = mesh.getBoundingSphere();
+	PMeshHeader	   header{};
+	std::memcpy(header.magic, g_pmeshMagic, sizeof(header.magic));
+	header.version = version;
+	header.levelCount = levelCount;
+	header.vertexStride = g_pmeshVertexStride;
+	header.boundsMin[0] = bounds.min.x;
+	header.boundsMin[1] = bounds.min.y;
+	header.boundsMin[2] = bounds.min.z;
+	header.boundsMax[0] = bounds.max.x;
+	header.boundsMax[1] = bounds.max.y;
+	header.boundsMax[2] = bounds.max.z;
+	header.sphereCenter[0] = sphere.center.x;
+	header.sphereCenter[1] = sphere.center.y;
+	header.sphereCenter[2] = sphere.center.z;
+	header.sphereRadius = sphere.radius;
+	header.fileSize = offset;
+
+	// Write beside the destination, so the file is only replaced once it is complete
+	const std::string tempFileName = fileName + ".tmp";
+	{
+		std::ofstream stream(tempFileName, std::ios::binary | std::ios::trunc);
+		if (!stream)
+		{
+			LOG_ERROR("Unable to open file {} for writing.", tempFileName)
+			return false;
+		}
+
+		const auto writeAt = [&stream](const uint64 position, const void* data, const size_t size)
+		{
+			// Pad up to the start of the section
+			static constexpr char padding[g_pmeshAlignment] = {};
+			stream.write(padding, (std::streamsize)(position - (uint64)stream.tellp()));
+			stream.write((const char*)data, (std::streamsize)size);
+		};
+
+		writeAt(0, &header, sizeof(header));
+		writeAt(sizeof(header), levels.data(), levels.size() * sizeof(PMeshLevel));
+		for (int32 level = 0; level < levelCount; level++)
+		{
+			writeAt(levels[level].vertexOffset, vertexData[level].data(), vertexData[level].size_bytes());
+			writeAt(levels[level].indexOffset, indexData[level].data(), indexData[level].size_bytes());
+		}
+
+		stream.close();
+		if (!stream)
+		{
+			LOG_ERROR("Failed to write file {}.", tempFileName)
+			std::filesystem::remove(tempFileName);
+			return false;
+		}
+	}
+
+	std::error_code error;
+	std::filesystem::rename(tempFileName, fileName, error);
+	if (!error)
+	{
+		// Anything left pending by an earlier write is older than this one
+		std::filesystem::remove(getPendingFileName(fileName), error);
+		return true;
+	}
+
+	// Windows won't replace a file while a view of it is mapped, so leave the new file to be switched over to the
+	// next time the mesh is loaded
+	const std::string pendingFileName = getPendingFileName(fileName);
+	const std::string reason = error.message();
+	std::filesystem::rename(tempFileName, pendingFileName, error);
+	if (error)
+	{
+		LOG_ERROR("Unable to replace file {} ({}).", fileName, reason)
+		std::filesystem::remove(tempFileName, error);
+		return false;
+	}
+
+	LOG_WARNING("File {} is in use ({}), it will be replaced by {} when it is next loaded.", fileName, reason, pendingFileName)
+	return true;
+}
+
+std::string PMesh::resolve(const std::string& fileName)
+{
+	const std::string pendingFileName = getPendingFileName(fileName);
+
+	std::error_code error;
+	if (!std::filesystem::exists(pendingFileName, error))
+	{
+		return fileName;
+	}
+
+	std::filesystem::rename(pendingFileName, fileName, error);
+	if (!error)
+	{
+		return fileName;
+	}
+
+	// The old file is still mapped somewhere, so read the pending one in its place if it is newer
+	const auto pendingTime = std::filesystem::last_write_time(pendingFileName, error);
+	if (error)
+	{
+		return fileName;
+	}
+	const auto fileTime = std::filesystem::last_write_time(fileName, error);
+	return error || pendingTime > fileTime ? pendingFileName : fileName;
+}
+
+bool PMesh::load(const std::string& fileName, Mesh* mesh)
+{
+	auto file = std::make_shared<MappedFile>();
+	if (!file->open(resolve(fileName)))
+	{
+		return false;
+	}
+
+	const uint64 fileSize = file->getSize();
+	if (fileSize < sizeof(PMeshHeader))
+	{
+		LOG_ERROR("File {} is too small to be a mesh.", fileName)
+		return false;
+	}
+
+	// The mapping is page aligned, so the header can be read in place
+	const char*		   base = file->getData();
+	const PMeshHeader* header = (const PMeshHeader*)base;
+	if (std::memcmp(header->magic, g_pmeshMagic, sizeof(g_pmeshMagic)) != 0)
+	{
+		LOG_ERROR("File {} is not a mesh.", fileName)
+		return false;
+	}
+	if (header->version != version || header->vertexStride != g_pmeshVertexStride)
+	{
+		LOG_ERROR("Mesh {} was written with version {}, but version {} is required.", fileName, header->version, version)
+		return false;
+	}
+	if (header->levelCount == 0 || header->levelCount > g_maxLodCount || header->fileSize != fileSize
+		|| !isValidSection<PMeshLevel>(sizeof(PMeshHeader), header->levelCount, fileSize))
+	{
+		LOG_ERROR("Mesh {} is corrupt.", fileName)
+		return false;
+	}
+
+	// Point each level at its sections of the file
+	const PMeshLevel*	 levels = (const PMeshLevel*)(base + sizeof(PMeshHeader));
+	std::vector<MeshLod> lods(header->levelCount - 1);
+	for (uint32 index = 0; index < header->levelCount; index++)
+	{
+		const PMeshLevel& level = levels[index];
+		if (!isValidSection<float>(level.vertexOffset, level.vertexCount, fileSize)
+			|| !isValidSection<uint32>(level.indexOffset, level.indexCount, fileSize)
+			|| level.vertexCount % g_pmeshVertexStride != 0 || level.indexCount % 3 != 0)
+		{
+			LOG_ERROR("Level {} of mesh {} is corrupt.", index, fileName)
+			return false;
+		}
+
+		// The renderer reads vertexes by index without checking them, so a corrupt index must never reach it
+		const std::span<const uint32> indexes((const uint32*)(base + level.indexOffset), level.indexCount);
+		if (!areValidIndexes(indexes, level.vertexCount / g_pmeshVertexStride))
+		{
+			LOG_ERROR("Level {} of mesh {} has indexes out of range.", index, fileName)
+			return false;
+		}
+
+		if (index > 0)
+		{
+			MeshLod& lod = lods[index - 1];
+			lod.mappedVertices = { (const float*)(base + level.vertexOffset), level.vertexCount };
+			lod.mappedIndexes = indexes;
+			lod.error = level.error;
+		}
+	}
+
+	const boxf bounds({ header->boundsMin[0], header->boundsMin[1], header->boundsMin[2] },
+		{ header->boundsMax[0], header->boundsMax[1], header->boundsMax[2] });
+	const spheref sphere({ header->sphereCenter[0], header->sphereCenter[1], header->sphereCenter[2] }, header->sphereRadius);
+	const std::span<const float>  vertices((const float*)(base + levels[0].vertexOffset), levels[0].vertexCount);
+	const std::span<const uint32> indexes((const uint32*)(base + levels[0].indexOffset), levels[0].indexCount);
+	mesh->setMappedData(std::move(file), vertices, indexes, std::move(lods), bounds, sphere);
+
+	return true;
+}
+
+void PMesh::benchmark(const std::string& fileName)
+{
+	const std::string objFileName = ResourceManager::getResourceFileName(fileName);
+	const std::string pmeshFileName = (std::filesystem::temp_directory_path() / "PMeshBenchmark.pmesh").string();
+
+	Mesh			imported;
+	const TimePoint importStart = PTimer::now();
+	if (objFileName.empty() || !ObjImporter::import(objFileName, &imported))
+	{
+		LOG_ERROR("Unable to import {}.", fileName)
+		return;
+	}
+	const float importTime = DurationMs(PTimer::now() - importStart).count();
+
+	if (!write(imported, pmeshFileName))
+	{
+		return;
+	}
+
+	// Take the best of a few loads to reduce noise. Every load maps the file afresh.
+	Mesh  loaded;
+	float loadTime = std::numeric_limits<float>::max();
+	for (int32 run = 0; run < 5; run++)
+	{
+		loaded = Mesh();
+		const TimePoint loadStart = PTimer::now();
+		if (!load(pmeshFileName, &loaded))
+		{
+			LOG_ERROR("Unable to load {}.", pmeshFileName)
+			return;
+		}
+		loadTime = std::min(loadTime, DurationMs(PTimer::now() - loadStart).count());
+	}
+
+	int32 mismatches = 0;
+	if (loaded.getLodCount() != imported.getLodCount())
+	{
+		LOG_WARNING("Loaded mesh has {} levels of detail, but {} were written.", loaded.getLodCount(), imported.getLodCount())
+		mismatches++;
+	}
+	for (int32 level = 0; level < std::min(loaded.getLodCount(), imported.getLodCount()); level++)
+	{
+		const std::span<const float>  vertices = level == 0 ? imported.getVertexData() : imported.getLod(level).getVertexData();
+		const std::span<const uint32> indexes = level == 0 ? imported.getIndexData() : imported.getLod(level).getIndexData();
+		const std::span<const float>  loadedVertices = level == 0 ? loaded.getVertexData() : loaded.getLod(level).getVertexData();
+		const std::span<const uint32> loadedIndexes = level == 0 ? loaded.getIndexData() : loaded.getLod(level).getIndexData();
+		if (!isEqual(vertices, loadedVertices) || !isEqual(indexes, loadedIndexes)
+			|| (level > 0 && imported.getLod(level).error != loaded.getLod(level).error))
+		{
+			LOG_WARNING("Level {} of the loaded mesh differs from the one written.", level)
+			mismatches++;
+		}
+	}
+	if (loaded.getBounds().min != imported.getBounds().min || loaded.getBounds().max != imported.getBounds().max
+		|| loaded.getBoundingSphere().center != imported.getBoundingSphere().center
+		|| loaded.getBoundingSphere().radius != imported.getBoundingSphere().radius)
+	{
+		LOG_WARNING("Bounds of the loaded mesh differ from the ones written.")
+		mismatches++;
+	}
+
+	LOG_INFO("{}: {} levels of detail, {} bytes, {} mismatches.", fileName, imported.getLodCount(), imported.memorySize(), mismatches)
+	LOG_INFO("OBJ import {:.3f} ms, .pmesh load {:.3f} ms.", importTime, loadTime)
+
+	loaded = Mesh();
+	std::error_code error;
+	std::filesystem::remove(pmeshFileName, error);
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <string>
+
+#include "Engine/Mesh.h"
+
+/**
+ * Reads and writes .pmesh files, PenguinEngine's own binary mesh format. A file holds exactly what the renderer draws:
+ * the interleaved vertex and index buffers of every level of detail along with the mesh's bounds.
+ *
+ * Every section starts on a 64 byte boundary and is stored in the layout it has in memory, so a file is loaded by
+ * mapping it and pointing the mesh at its sections. Nothing is parsed or copied, vertex pages are only read from disk
+ * when the renderer first touches them, and every process which loads the same file shares a single copy of it in
+ * the page cache.
+ *
+ * Layout, with every offset counted from the start of the file:
+ *   PMeshHeader
+ *   PMeshLevel[levelCount], level 0 being the full detail mesh
+ *   Vertex and index data of each level
+ */
+class PMesh
+{
+public:
+	/** Incremented whenever the layout of the file changes. Files of any other version are rejected. **/
+	static constexpr uint32 version = 1;
+
+	/**
+	 * @brief Writes the render data of `mesh` to a .pmesh file. The file is written beside `fileName` first and then
+	 * moved over it, so a process which has the old file mapped never sees it half written. Where the old file can't
+	 * be replaced while it is mapped, as on Windows, the new file is left beside it and switched over to by `resolve`.
+	 *
+	 * @param mesh The mesh to write. Its vertex and index buffers must have been built.
+	 * @param fileName The path to the .pmesh file.
+	 * @return true if the file was written, false otherwise.
+	 */
+	static bool write(const Mesh& mesh, const std::string& fileName);
+
+	/**
+	 * @brief Finds the file holding the latest copy of `fileName`. A file left pending by `write` is moved over
+	 * `fileName` if it is no longer in use, and otherwise read in its place until it can be.
+	 *
+	 * @param fileName The path to the .pmesh file.
+	 * @return The path to read the mesh from.
+	 */
+	static std::string resolve(const std::string& fileName);
+
+	/**
+	 * @brief Loads a mesh from a .pmesh file without copying its data. The file stays mapped for as long as the mesh,
+	 * or any copy of it, exists. Only the render data is loaded, so the mesh has no triangles or attributes.
+	 *
+	 * The header, the extents of every section and every index are validated, so a corrupt file is rejected rather
+	 * than drawn. Checking the indexes reads the index sections, but the vertex sections are still only read when
+	 * they are drawn.
+	 *
+	 * @param fileName The path to the .pmesh file.
+	 * @param mesh The mesh object to fill.
+	 * @return true if the load is successful, false otherwise.
+	 */
+	static bool load(const std::string& fileName, Mesh* mesh);
+
+	/**
+	 * @brief Imports an OBJ file, writes it to a .pmesh file in the temporary directory and loads it back, checking
+	 * that every level of detail survives the round trip. Logs how long the OBJ import and the load take.
+	 * @param fileName The OBJ file to import, relative to the resource directory.
+	 */
+	static void benchmark(const std::string& fileName = "Examples/Teapot.obj");
+};
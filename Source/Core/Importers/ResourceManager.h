@@ -7,7 +7,7 @@
 
 namespace ResourceManager
 {
-	std::filesystem::path getRootPath()
+	inline std::filesystem::path getRootPath()
 	{
 		std::filesystem::path root = __FILE__;
 		root = root.parent_path(); // Engine
@@ -16,13 +16,13 @@ namespace ResourceManager
 		return root.parent_path(); // PenguinEngine
 	}
 
-	std::filesystem::path getResourceRootPath()
+	inline std::filesystem::path getResourceRootPath()
 	{
 		std::filesystem::path root = getRootPath();
 		return (root / "Resources");
 	}
 
-	std::string getResourceFileName(const std::string& fileName)
+	inline std::string getResourceFileName(const std::string& fileName)
 	{
 		auto resources = getResourceRootPath();
 		auto fullFileName = resources / fileName;
@@ -534,7 +534,7 @@ int32 TextureImporter::importPng(ByteReader* reader, Texture* texture, ETextureF
 	return result;
 }
 
-int32 TextureImporter::import(const std::string& fileName, Texture* texture, const ETextureFileFormat format)
+int32 TextureImporter::import(const std::string& fileName, Texture* texture, const ETextureFileFormat format, const ETextureLayout layout)
 {
 	if (!std::filesystem::exists(fileName))
 	{
@@ -582,5 +582,12 @@ int32 TextureImporter::import(const std::string& fileName, Texture* texture, con
 		}
 	}
 
+	// Build the mip chain up front, so sampling a minified texture never has to filter it
+	if (result == TextureImporterError::Ok)
+	{
+		texture->generateMips();
+		texture->setLayout(layout);
+	}
+
 	return result;
 }
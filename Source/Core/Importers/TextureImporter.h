@@ -193,6 +193,10 @@ class TextureImporter
 	static int32 addAlphaChannel(uint8* in, uint8* out, uint32 width, int32 channelCount);
 
 public:
+	/**
+	 * @brief Imports an image file into `texture` and builds its mip chain.
+	 * @param layout The order to store the pixels in. Textures uploaded to a hardware renderer must be linear.
+	 */
 	static int32 import(const std::string& fileName, Texture* texture,
-	                    ETextureFileFormat format = ETextureFileFormat::Rgba);
+	                    ETextureFileFormat format = ETextureFileFormat::Rgba, ETextureLayout layout = ETextureLayout::Linear);
 };
@@ -0,0 +1,78 @@
+﻿#pragma once
+
+#include <algorithm>
+#include <limits>
+#include <vector>
+
+#include "Vector.h"
+
+/** Axis-aligned bounding box. **/
+template <typename T>
+struct box_t
+{
+	vec3_t<T> min = vec3_t<T>(std::numeric_limits<T>::max());
+	vec3_t<T> max = vec3_t<T>(std::numeric_limits<T>::lowest());
+
+	box_t() = default;
+
+	box_t(const vec3_t<T>& inMin, const vec3_t<T>& inMax) : min(inMin), max(inMax) {}
+
+	/** Returns whether this box contains at least one point. **/
+	[[nodiscard]] bool isValid() const { return min.x <= max.x && min.y <= max.y && min.z <= max.z; }
+
+	[[nodiscard]] vec3_t<T> center() const { return vec3_t<T>((min.x + max.x) / T(2), (min.y + max.y) / T(2), (min.z + max.z) / T(2)); }
+
+	[[nodiscard]] vec3_t<T> extents() const { return vec3_t<T>((max.x - min.x) / T(2), (max.y - min.y) / T(2), (max.z - min.z) / T(2)); }
+
+	/** Returns the surface area of this box. **/
+	[[nodiscard]] T surfaceArea() const
+	{
+		const T dx = max.x - min.x;
+		const T dy = max.y - min.y;
+		const T dz = max.z - min.z;
+		return T(2) * (dx * dy + dy * dz + dz * dx);
+	}
+
+	/** Returns whether `other` is entirely inside this box. **/
+	[[nodiscard]] bool contains(const box_t& other) const
+	{
+		return min.x <= other.min.x && min.y <= other.min.y && min.z <= other.min.z && max.x >= other.max.x
+			&& max.y >= other.max.y && max.z >= other.max.z;
+	}
+
+	/** Grows this box to contain `point`. **/
+	void expand(const vec3_t<T>& point)
+	{
+		min = vec3_t<T>(std::min(min.x, point.x), std::min(min.y, point.y), std::min(min.z, point.z));
+		max = vec3_t<T>(std::max(max.x, point.x), std::max(max.y, point.y), std::max(max.z, point.z));
+	}
+
+	/** Grows this box to contain `other`. **/
+	void expand(const box_t& other)
+	{
+		if (!other.isValid())
+		{
+			return;
+		}
+		expand(other.min);
+		expand(other.max);
+	}
+
+	/** Returns the smallest box containing both `a` and `b`. **/
+	static box_t combine(const box_t& a, const box_t& b)
+	{
+		box_t out(a);
+		out.expand(b);
+		return out;
+	}
+
+	static box_t makeBoundingBox(const std::vector<vec3_t<T>>& points)
+	{
+		box_t box;
+		for (const vec3_t<T>& point : points)
+		{
+			box.expand(point);
+		}
+		return box;
+	}
+};
@@ -1,5 +1,8 @@
 #pragma once
 
+#include <bit>
+#include <utility>
+
 #include "Renderer/Grid.h"
 #include "MathFwd.h"
 #include "Vector.h"
@@ -85,6 +88,145 @@ namespace Clipping
 		return clipLine(&line->a, &line->b, size);
 	}
 
+	/** Scale of the guard band relative to the view frustum. Triangles which stay within it are left to the rasterizer to clip. **/
+	constexpr float g_guardBandScale = 8.0f;
+	/** Maximum number of vertexes a triangle can have after being clipped against every clip plane. **/
+	constexpr int32 g_maxClipVertices = 8;
+
+	/** Planes in homogeneous clip space. All but the near plane are scaled out to the guard band. **/
+	enum EClipPlane : int32
+	{
+		Near   = 1 << 0,
+		Left   = 1 << 1,
+		Right  = 1 << 2,
+		Bottom = 1 << 3,
+		Top    = 1 << 4,
+	};
+
+	/** A vertex of a clipped polygon. **/
+	struct ClipVertex
+	{
+		/** Position in homogeneous clip space. **/
+		vec4f position;
+		/** Weight of each vertex of the original triangle, used to interpolate its attributes. **/
+		vec3f weights;
+	};
+
+	/**
+	 * @brief Returns the signed distance of `position` from `plane`. Positions on the inside have a positive distance.
+	 */
+	inline float getPlaneDistance(const vec4f& position, const EClipPlane plane)
+	{
+		switch (plane)
+		{
+			case Near:
+				return position.z;
+			case Left:
+				return position.x + position.w * g_guardBandScale;
+			case Right:
+				return position.w * g_guardBandScale - position.x;
+			case Bottom:
+				return position.y + position.w * g_guardBandScale;
+			case Top:
+				return position.w * g_guardBandScale - position.y;
+			default:
+				return 0.0f;
+		}
+	}
+
+	/**
+	 * @brief Returns a mask of every plane `position` is outside of.
+	 */
+	inline int32 getOutCode(const vec4f& position)
+	{
+		int32 code = 0;
+		for (const EClipPlane plane : { Near, Left, Right, Bottom, Top })
+		{
+			if (getPlaneDistance(position, plane) < 0.0f)
+			{
+				code |= plane;
+			}
+		}
+		return code;
+	}
+
+	/**
+	 * @brief Returns a mask of every plane of the view frustum itself, without the guard band, `position` is outside of.
+	 */
+	inline int32 getFrustumOutCode(const vec4f& position)
+	{
+		return (position.z < 0.0f) * Near | (position.x < -position.w) * Left | (position.x > position.w) * Right
+			| (position.y < -position.w) * Bottom | (position.y > position.w) * Top;
+	}
+
+	/**
+	 * @brief Clips a triangle in homogeneous clip space against `planes` using the Sutherland-Hodgman algorithm.
+	 * @param positions The clip-space position of each vertex of the triangle.
+	 * @param planes Mask of the planes to clip against.
+	 * @param output Receives the vertexes of the clipped convex polygon, in the same winding order as the triangle.
+	 * @return The number of vertexes in the clipped polygon, or 0 if the triangle was entirely clipped.
+	 */
+	inline int32 clipTriangle(const vec4f* positions, const int32 planes, ClipVertex (&output)[g_maxClipVertices])
+	{
+		ClipVertex buffer[g_maxClipVertices];
+		ClipVertex* input = buffer;
+		ClipVertex* result = output;
+
+		// Each plane clips from one buffer into the other, so start in whichever buffer leaves the final polygon in
+		// `output`
+		if (std::popcount((uint32)planes) % 2 == 1)
+		{
+			std::swap(input, result);
+		}
+		result[0] = { positions[0], vec3f(1.0f, 0.0f, 0.0f) };
+		result[1] = { positions[1], vec3f(0.0f, 1.0f, 0.0f) };
+		result[2] = { positions[2], vec3f(0.0f, 0.0f, 1.0f) };
+		int32 count = 3;
+
+		for (const EClipPlane plane : { Near, Left, Right, Bottom, Top })
+		{
+			if (!(planes & plane))
+			{
+				continue;
+			}
+			std::swap(input, result);
+
+			const int32 inputCount = count;
+			count = 0;
+			for (int32 i = 0; i < inputCount; i++)
+			{
+				const ClipVertex& a = input[i];
+				const ClipVertex& b = input[(i + 1) % inputCount];
+				const float		  distanceA = getPlaneDistance(a.position, plane);
+				const float		  distanceB = getPlaneDistance(b.position, plane);
+
+				if (distanceA >= 0.0f)
+				{
+					result[count++] = a;
+				}
+
+				// The edge crosses the plane, so add the intersection
+				if ((distanceA >= 0.0f) != (distanceB >= 0.0f))
+				{
+					const float t = distanceA / (distanceA - distanceB);
+					result[count++] = {
+						vec4f(a.position.x + (b.position.x - a.position.x) * t, a.position.y + (b.position.y - a.position.y) * t,
+							a.position.z + (b.position.z - a.position.z) * t, a.position.w + (b.position.w - a.position.w) * t),
+						vec3f(a.weights.x + (b.weights.x - a.weights.x) * t, a.weights.y + (b.weights.y - a.weights.y) * t,
+							a.weights.z + (b.weights.z - a.weights.z) * t)
+					};
+				}
+			}
+
+			if (count < 3)
+			{
+				return 0;
+			}
+		}
+
+		return count;
+	}
+
 	inline vec3f clipVertex(const vec4f& input, const int32 width, const int32 height)
 	{
 		// Apply perspective correction
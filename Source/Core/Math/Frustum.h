@@ -0,0 +1,73 @@
+﻿#pragma once
+
+#include <cmath>
+
+#include "Box.h"
+#include "Matrix.h"
+#include "Plane.h"
+#include "Sphere.h"
+
+/**
+ * @brief The six planes of a view frustum, with normals facing inwards.
+ *
+ * Built from a (model) view projection matrix, so the planes are in whatever space the matrix transforms from.
+ * Passing a model view projection matrix lets bounds be tested in object space without transforming them.
+ */
+template <typename T>
+struct frustum_t
+{
+	plane_t<T> planes[6] = {
+		{ 0, 0, 0, 0 }, { 0, 0, 0, 0 }, { 0, 0, 0, 0 }, { 0, 0, 0, 0 }, { 0, 0, 0, 0 }, { 0, 0, 0, 0 }
+	};
+
+	frustum_t() = default;
+
+	explicit frustum_t(const mat4_t<T>& m)
+	{
+		// Gribb-Hartmann plane extraction. Vectors are transformed as rows, so each column of the matrix
+		// produces one component of the clip-space position. Clip-space depth is in [0, W].
+		for (int32 i = 0; i < 4; i++)
+		{
+			planes[0][i] = m.m[i][3] + m.m[i][0]; // Left
+			planes[1][i] = m.m[i][3] - m.m[i][0]; // Right
+			planes[2][i] = m.m[i][3] + m.m[i][1]; // Bottom
+			planes[3][i] = m.m[i][3] - m.m[i][1]; // Top
+			planes[4][i] = m.m[i][2];			  // Near
+			planes[5][i] = m.m[i][3] - m.m[i][2]; // Far
+		}
+
+		for (plane_t<T>& plane : planes)
+		{
+			plane.normalize();
+		}
+	}
+
+	/** Returns whether any part of `sphere` may be inside the frustum. **/
+	[[nodiscard]] bool intersects(const sphere_t<T>& sphere) const
+	{
+		for (const plane_t<T>& plane : planes)
+		{
+			if (plane.distance(sphere.center) < -sphere.radius)
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+
+	/** Returns whether any part of `box` may be inside the frustum. **/
+	[[nodiscard]] bool intersects(const box_t<T>& box) const
+	{
+		for (const plane_t<T>& plane : planes)
+		{
+			// Test the corner of the box furthest along the plane normal
+			const vec3_t<T> corner(plane.x >= T(0) ? box.max.x : box.min.x, plane.y >= T(0) ? box.max.y : box.min.y,
+				plane.z >= T(0) ? box.max.z : box.min.z);
+			if (plane.distance(corner) < T(0))
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+};
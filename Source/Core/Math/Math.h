@@ -3,7 +3,6 @@
 #include <bit>
 #include <cmath>
 #include <float.h>
-#include <intrin.h>
 #include <cassert>
 
 #include "MathFwd.h"
@@ -2,13 +2,20 @@
 
 #include <cstdint>
 #include <numbers>
-#include <intrin.h>
+
+#if defined(_MSC_VER)
+	#include <intrin.h>
+#elif defined(__x86_64__) || defined(__i386__)
+	#include <immintrin.h>
+#endif
 
 #include "Core/Types.h"
 
 /** SSE **/
 
-#if defined(_INCLUDED_MM2) || defined(_M_X64)
+// The SSE paths use SSE4.1, which MSVC allows on any x64 target. GCC and Clang only allow it when the whole project
+// is compiled for SSE4.1; otherwise only the runtime dispatched paths in VectorMath.h use SIMD.
+#if defined(_INCLUDED_MM2) || defined(_M_X64) || defined(__SSE4_1__)
 
 	#define PENG_SSE
 
@@ -130,6 +137,16 @@ using transd = trans_t<double>;
 template <typename T> struct plane_t;
 using planef = plane_t<float>;
 
+// Bounds
+template <typename T> struct box_t;
+using boxf = box_t<float>;
+
+template <typename T> struct sphere_t;
+using spheref = sphere_t<float>;
+
+template <typename T> struct frustum_t;
+using frustumf = frustum_t<float>;
+
 // Enums
 enum class EWindingOrder : uint8
 {
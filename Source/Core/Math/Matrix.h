@@ -1,11 +1,13 @@
 ﻿#pragma once
 
 #include <string>
+#include <type_traits>
 
 #include "Math.h"
 #include "Plane.h"
 #include "Rotator.h"
 #include "Vector.h"
+#include "VectorMath.h"
 #include "Core/Logging.h"
 
 template <typename T> mat4_t<T> perspectiveFovLH(T fov, T aspect, T minZ, T maxZ);
@@ -509,6 +511,19 @@ struct mat4_t
 
 	vec3_t<T> operator*(const vec3_t<T>& v) const
 	{
+#ifdef PENG_SSE
+		if constexpr (std::is_same_v<T, float>)
+		{
+			// Weight the rows by each component, summed in the same order as below so both round identically.
+			// Loading the rows reads the fourth column too, which is always within the matrix.
+			__m128 result = _mm_mul_ps(_mm_loadu_ps(m[0]), _mm_set1_ps(v.x));
+			result = _mm_add_ps(result, _mm_mul_ps(_mm_loadu_ps(m[1]), _mm_set1_ps(v.y)));
+			result = _mm_add_ps(result, _mm_mul_ps(_mm_loadu_ps(m[2]), _mm_set1_ps(v.z)));
+			float out[4];
+			_mm_storeu_ps(out, result);
+			return { out[0], out[1], out[2] };
+		}
+#endif
 		float x = m[0][0] * v.x + m[1][0] * v.y + m[2][0] * v.z;
 		float y = m[0][1] * v.x + m[1][1] * v.y + m[2][1] * v.z;
 		float z = m[0][2] * v.x + m[1][2] * v.y + m[2][2] * v.z;
@@ -518,22 +533,22 @@ struct mat4_t
 	vec4_t<T> operator*(const vec4_t<T>& v) const
 	{
 #ifdef PENG_SSE
+		if constexpr (std::is_same_v<T, float>)
+		{
+			__m128 result = _mm_mul_ps(_mm_loadu_ps(m[0]), _mm_set1_ps(v.x));
+			result = _mm_add_ps(result, _mm_mul_ps(_mm_loadu_ps(m[1]), _mm_set1_ps(v.y)));
+			result = _mm_add_ps(result, _mm_mul_ps(_mm_loadu_ps(m[2]), _mm_set1_ps(v.z)));
+			result = _mm_add_ps(result, _mm_mul_ps(_mm_loadu_ps(m[3]), _mm_set1_ps(v.w)));
+			vec4_t<T> out;
+			_mm_storeu_ps(out.xyzw, result);
+			return out;
+		}
+#endif
 		float x = m[0][0] * v.x + m[1][0] * v.y + m[2][0] * v.z + m[3][0] * v.w;
 		float y = m[0][1] * v.x + m[1][1] * v.y + m[2][1] * v.z + m[3][1] * v.w;
 		float z = m[0][2] * v.x + m[1][2] * v.y + m[2][2] * v.z + m[3][2] * v.w;
 		float w = m[0][3] * v.x + m[1][3] * v.y + m[2][3] * v.z + m[3][3] * v.w;
 		return { x, y, z, w };
-#else
-		XMVECTOR vResult = XM_PERMUTE_PS(V, _MM_SHUFFLE(3, 3, 3, 3)); // W
-		vResult = _mm_mul_ps(vResult, M.r[3]);
-		XMVECTOR vTemp = XM_PERMUTE_PS(V, _MM_SHUFFLE(2, 2, 2, 2)); // Z
-		vResult = XM_FMADD_PS(vTemp, M.r[2], vResult);
-		vTemp = XM_PERMUTE_PS(V, _MM_SHUFFLE(1, 1, 1, 1)); // Y
-		vResult = XM_FMADD_PS(vTemp, M.r[1], vResult);
-		vTemp = XM_PERMUTE_PS(V, _MM_SHUFFLE(0, 0, 0, 0)); // X
-		vResult = XM_FMADD_PS(vTemp, M.r[0], vResult);
-		return vResult;
-#endif
 	}
 
 	mat4_t& operator=(const mat4_t& Other) // NOLINT
@@ -593,6 +608,14 @@ template <typename T> constexpr mat4_t<T> operator*(const mat4_t<T>& m0, const m
 	return result;
 }
 
+/** Float matrices are multiplied with the best VectorMath backend for this CPU, which rounds exactly as above. **/
+inline mat4f operator*(const mat4f& m0, const mat4f& m1)
+{
+	mat4f result;
+	VectorMath::multiply(m0, m1, result);
+	return result;
+}
+
 template <typename T> mat4_t<T> perspectiveFovLH(T fov, T aspect, T minZ, T maxZ)
 {
 	float sinFov;
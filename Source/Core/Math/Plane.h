@@ -1,5 +1,9 @@
 ﻿#pragma once
 
+#include <cmath>
+
+#include "Vector.h"
+
 template <typename T>
 struct plane_t
 {
@@ -42,4 +46,20 @@ struct plane_t
 
 	T operator[](int32 index) const { return xyzw[index]; }
 	T& operator[](int32 index) { return xyzw[index]; }
+
+	/** Returns the signed distance of `point` from this plane. Only a true distance if this plane is normalized. **/
+	T distance(const vec3_t<T>& point) const { return x * point.x + y * point.y + z * point.z + w; }
+
+	/** Scales this plane so its normal has unit length. **/
+	void normalize()
+	{
+		const T length = std::sqrt(x * x + y * y + z * z);
+		if (length > T(0))
+		{
+			x /= length;
+			y /= length;
+			z /= length;
+			w /= length;
+		}
+	}
 };
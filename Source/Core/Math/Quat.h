@@ -1,5 +1,7 @@
 ﻿#pragma once
 
+#include <type_traits>
+
 template <typename T>
 struct quat_t
 {
@@ -134,10 +136,29 @@ struct quat_t
 
 	quat_t operator*(const quat_t& other) const
 	{
+#ifdef PENG_SSE
+		if constexpr (std::is_same_v<T, float>)
+		{
+			// Each component of this quaternion weights a permutation of the other's, with the signs of the Hamilton
+			// product. Terms are summed in the same order as below so both round identically.
+			const __m128 b = _mm_loadu_ps(other.xyzw);
+			const __m128 bWZYX = _mm_xor_ps(_mm_shuffle_ps(b, b, _MM_SHUFFLE(0, 1, 2, 3)), _mm_setr_ps(0.0f, -0.0f, 0.0f, -0.0f));
+			const __m128 bZWXY = _mm_xor_ps(_mm_shuffle_ps(b, b, _MM_SHUFFLE(1, 0, 3, 2)), _mm_setr_ps(0.0f, 0.0f, -0.0f, -0.0f));
+			const __m128 bYXWZ = _mm_xor_ps(_mm_shuffle_ps(b, b, _MM_SHUFFLE(2, 3, 0, 1)), _mm_setr_ps(-0.0f, 0.0f, 0.0f, -0.0f));
+
+			__m128 result = _mm_mul_ps(_mm_set1_ps(w), b);
+			result = _mm_add_ps(result, _mm_mul_ps(_mm_set1_ps(x), bWZYX));
+			result = _mm_add_ps(result, _mm_mul_ps(_mm_set1_ps(y), bZWXY));
+			result = _mm_add_ps(result, _mm_mul_ps(_mm_set1_ps(z), bYXWZ));
+			quat_t out;
+			_mm_storeu_ps(out.xyzw, result);
+			return out;
+		}
+#endif
 		T tempW = w * other.w - x * other.x - y * other.y - z * other.z;
 		T tempX = w * other.x + x * other.w + y * other.z - z * other.y;
-		T tempY = w * other.y - x * other.y + y * other.w + z * other.x;
-		T tempZ = w * other.z + x * other.z - y * other.x + z * other.w;
+		T tempY = w * other.y - x * other.z + y * other.w + z * other.x;
+		T tempZ = w * other.z + x * other.y - y * other.x + z * other.w;
 
 		return {tempX, tempY, tempZ, tempW};
 	}
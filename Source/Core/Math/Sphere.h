@@ -0,0 +1,33 @@
+﻿#pragma once
+
+#include <cmath>
+
+#include "Box.h"
+
+/** Bounding sphere. **/
+template <typename T>
+struct sphere_t
+{
+	vec3_t<T> center;
+	T		  radius = T(0);
+
+	sphere_t() = default;
+
+	sphere_t(const vec3_t<T>& inCenter, T inRadius) : center(inCenter), radius(inRadius) {}
+
+	/**
+	 * @brief Returns a sphere centered on the bounding box of `points` which contains every point.
+	 */
+	static sphere_t makeBoundingSphere(const std::vector<vec3_t<T>>& points, const box_t<T>& box)
+	{
+		sphere_t sphere(box.center(), T(0));
+		T		 radiusSquared = T(0);
+		for (const vec3_t<T>& point : points)
+		{
+			const vec3_t<T> offset = point - sphere.center;
+			radiusSquared = std::max(radiusSquared, offset.x * offset.x + offset.y * offset.y + offset.z * offset.z);
+		}
+		sphere.radius = std::sqrt(radiusSquared);
+		return sphere;
+	}
+};
@@ -3,14 +3,9 @@
 
 #include "Core/Macros.h"
 
-#ifdef WINDOWS_PLATFORM
-	#include <DirectXMath.h>
-#endif
-
 #include <algorithm>
 #include <cassert>
 #include <format>
-#include <intrin.h>
 
 #include "Core/Logging.h"
 #include "Math.h"
@@ -265,25 +260,25 @@ struct vec3_t
 	vec3_t cross(const vec3_t& v) const
 	{
 #ifndef PENG_SSE
-		return vec3_t{ y * v.z - z * v.y, x * v.z - z * v.x, x * v.y - y * v.x };
+		return vec3_t{ y * v.z - z * v.y, z * v.x - x * v.z, x * v.y - y * v.x };
 #else
 		__m128 V1 = toM128();
 		__m128 V2 = v.toM128();
 		// y1,z1,x1,w1
-		__m128 vTemp1 = XM_PERMUTE_PS(V1, _MM_SHUFFLE(3, 0, 2, 1));
+		__m128 vTemp1 = _mm_shuffle_ps(V1, V1, _MM_SHUFFLE(3, 0, 2, 1));
 		// z2,x2,y2,w2
-		__m128 vTemp2 = XM_PERMUTE_PS(V2, _MM_SHUFFLE(3, 1, 0, 2));
+		__m128 vTemp2 = _mm_shuffle_ps(V2, V2, _MM_SHUFFLE(3, 1, 0, 2));
 		// Perform the left operation
 		__m128 vResult = _mm_mul_ps(vTemp1, vTemp2);
 		// z1,x1,y1,w1
-		vTemp1 = XM_PERMUTE_PS(vTemp1, _MM_SHUFFLE(3, 0, 2, 1));
+		vTemp1 = _mm_shuffle_ps(vTemp1, vTemp1, _MM_SHUFFLE(3, 0, 2, 1));
 		// y2,z2,x2,w2
-		vTemp2 = XM_PERMUTE_PS(vTemp2, _MM_SHUFFLE(3, 1, 0, 2));
+		vTemp2 = _mm_shuffle_ps(vTemp2, vTemp2, _MM_SHUFFLE(3, 1, 0, 2));
 		// Perform the right operation
-		vResult = XM_FNMADD_PS(vTemp1, vTemp2, vResult);
+		vResult = _mm_sub_ps(vResult, _mm_mul_ps(vTemp1, vTemp2));
 		// Set w to zero
 		vec3_t out;
-		__m128 r = _mm_and_ps(vResult, DirectX::g_XMMask3);
+		__m128 r = _mm_and_ps(vResult, g_mask3.v);
 		_MM_EXTRACT_FLOAT(out.x, r, 0);
 		_MM_EXTRACT_FLOAT(out.y, r, 1);
 		_MM_EXTRACT_FLOAT(out.z, r, 2);
@@ -325,6 +320,7 @@ struct vec3_t
 
 	vec3_t swizzleXYZ() const { return { z, x, y }; }
 
+#ifdef PENG_SSE
 	__m128 toM128() const
 	{
 		// Convert to float array in reverse order as elements are loaded right to left
@@ -332,6 +328,7 @@ struct vec3_t
 		// Store the float array
 		return _mm_load_ps(_xyzw);
 	}
+#endif
 
 	std::string toString() const { return std::format("[{}, {}, {}]", x, y, z); }
 
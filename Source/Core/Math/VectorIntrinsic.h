@@ -1,10 +1,14 @@
 ﻿#pragma once
 
-#include <DirectXMath.h>
-#include <xmmintrin.h>
+#include <cstring>
 
+#include "Matrix.h"
 #include "Vector.h"
 
+// Wrappers of SSE registers for code which works on a few vectors at a time. Operations on many vectors at once
+// should use the runtime dispatched functions in VectorMath.h instead, which also run on CPUs without SSE4.1.
+#ifdef PENG_SSE
+
 // ReSharper disable once CppInconsistentNaming
 struct vecm
 {
@@ -22,48 +26,40 @@ struct vecm
 		: m(_mm_set_ps(v, v, v, v)) {}
 
 	vecm(const float x, const float y, const float z)
-		: m(_mm_set_ps(x, y, z, 0)) {}
+		: m(_mm_setr_ps(x, y, z, 0)) {}
 
 	vecm(const vec3f& v)
-		: m(_mm_set_ps(v.x, v.y, v.z, 0)) {}
+		: m(_mm_setr_ps(v.x, v.y, v.z, 0)) {}
 
 	vecm(const float x, const float y, const float z, const float w)
-		: m(_mm_set_ps(x, y, z, w)) {}
+		: m(_mm_setr_ps(x, y, z, w)) {}
 
 	vecm(const vec4f& v)
-		: m(_mm_set_ps(v.x, v.y, v.z, v.w)) {}
+		: m(_mm_loadu_ps(v.xyzw)) {}
 
 	vecm(const float* values)
-		: m(_mm_load_ps(values)) {}
+		: m(_mm_loadu_ps(values)) {}
 
 	/** General methods **/
 
 	[[nodiscard]] float x() const
 	{
-		float out;
-		_MM_EXTRACT_FLOAT(out, m, 0);
-		return out;
+		return _mm_cvtss_f32(m);
 	}
 
 	[[nodiscard]] float y() const
 	{
-		float out;
-		_MM_EXTRACT_FLOAT(out, m, 1);
-		return out;
+		return _mm_cvtss_f32(_mm_shuffle_ps(m, m, _MM_SHUFFLE(1, 1, 1, 1)));
 	}
 
 	[[nodiscard]] float z() const
 	{
-		float out;
-		_MM_EXTRACT_FLOAT(out, m, 2);
-		return out;
+		return _mm_cvtss_f32(_mm_shuffle_ps(m, m, _MM_SHUFFLE(2, 2, 2, 2)));
 	}
 
 	[[nodiscard]] float w() const
 	{
-		float out;
-		_MM_EXTRACT_FLOAT(out, m, 3);
-		return out;
+		return _mm_cvtss_f32(_mm_shuffle_ps(m, m, _MM_SHUFFLE(3, 3, 3, 3)));
 	}
 
 	/** 3D Vector **/
@@ -202,20 +198,15 @@ struct vecm
 
 	explicit operator vec3f() const
 	{
-		vec3f out;
-		_MM_EXTRACT_FLOAT(out.x, m, 0);
-		_MM_EXTRACT_FLOAT(out.y, m, 1);
-		_MM_EXTRACT_FLOAT(out.z, m, 2);
-		return out;
+		float out[4];
+		_mm_storeu_ps(out, m);
+		return { out[0], out[1], out[2] };
 	}
 
 	explicit operator vec4f() const
 	{
 		vec4f out;
-		_MM_EXTRACT_FLOAT(out.x, m, 0);
-		_MM_EXTRACT_FLOAT(out.y, m, 1);
-		_MM_EXTRACT_FLOAT(out.z, m, 2);
-		_MM_EXTRACT_FLOAT(out.w, m, 2);
+		_mm_storeu_ps(out.xyzw, m);
 		return out;
 	}
 };
@@ -229,29 +220,31 @@ struct matm
 
 	matm(const mat4f& mat)
 	{
-		m0 = _mm_load_ps(&mat.m[0][0]); // Row 1
-		m1 = _mm_load_ps(&mat.m[1][0]); // Row 2
-		m2 = _mm_load_ps(&mat.m[2][0]); // Row 3
-		m3 = _mm_load_ps(&mat.m[3][0]); // Row 4
+		// mat4_t isn't aligned, so its rows can't be loaded with aligned loads
+		m0 = _mm_loadu_ps(&mat.m[0][0]); // Row 1
+		m1 = _mm_loadu_ps(&mat.m[1][0]); // Row 2
+		m2 = _mm_loadu_ps(&mat.m[2][0]); // Row 3
+		m3 = _mm_loadu_ps(&mat.m[3][0]); // Row 4
 	}
 
 	vecm operator*(const vecm& v) const
 	{
-		__m128 vResult = _mm_shuffle_ps(v.m, v.m, _MM_SHUFFLE(3, 3, 3, 3)); // W
-		vResult        = _mm_mul_ps(vResult, m3);
-		__m128 vTemp   = _mm_shuffle_ps(v.m, v.m, _MM_SHUFFLE(2, 2, 2, 2)); // Z
-		vResult        = _mm_add_ps(_mm_mul_ps(vTemp, m2), vResult);
-		vTemp          = _mm_shuffle_ps(v.m, v.m, _MM_SHUFFLE(1, 1, 1, 1)); // Y
-		vResult        = _mm_add_ps(_mm_mul_ps(vTemp, m1), vResult);
-		vTemp          = _mm_shuffle_ps(v.m, v.m, _MM_SHUFFLE(0, 0, 0, 0)); // X
-		vResult        = _mm_add_ps(_mm_mul_ps(vTemp, m0), vResult);
+		// Summed from X to W, matching the order of mat4_t::operator*
+		__m128 vResult = _mm_shuffle_ps(v.m, v.m, _MM_SHUFFLE(0, 0, 0, 0)); // X
+		vResult        = _mm_mul_ps(vResult, m0);
+		__m128 vTemp   = _mm_shuffle_ps(v.m, v.m, _MM_SHUFFLE(1, 1, 1, 1)); // Y
+		vResult        = _mm_add_ps(vResult, _mm_mul_ps(vTemp, m1));
+		vTemp          = _mm_shuffle_ps(v.m, v.m, _MM_SHUFFLE(2, 2, 2, 2)); // Z
+		vResult        = _mm_add_ps(vResult, _mm_mul_ps(vTemp, m2));
+		vTemp          = _mm_shuffle_ps(v.m, v.m, _MM_SHUFFLE(3, 3, 3, 3)); // W
+		vResult        = _mm_add_ps(vResult, _mm_mul_ps(vTemp, m3));
 		return vResult;
 	}
 };
 
 inline void vecLoad(const vec4f& in, float* out)
 {
-	memcpy(out, &in, 32);
+	std::memcpy(out, &in, sizeof(vec4f));
 }
 
 inline void vecUnload(const float* in, vec4f* out)
@@ -264,34 +257,34 @@ inline void vecUnload(const float* in, vec4f* out)
 
 inline void vecAddVec(const vec4f& v0, const vec4f& v1, vec4f& out)
 {
-	const __m128 a = _mm_load_ps(v0.xyzw);
-	const __m128 b = _mm_load_ps(v1.xyzw);
+	const __m128 a = _mm_loadu_ps(v0.xyzw);
+	const __m128 b = _mm_loadu_ps(v1.xyzw);
 	const __m128 c = _mm_add_ps(a, b);
-	_mm_store_ps(out.xyzw, c);
+	_mm_storeu_ps(out.xyzw, c);
 }
 
 inline void vecSubVec(const vec4f& v0, const vec4f& v1, vec4f& out)
 {
-	const __m128 a = _mm_load_ps(v0.xyzw);
-	const __m128 b = _mm_load_ps(v1.xyzw);
+	const __m128 a = _mm_loadu_ps(v0.xyzw);
+	const __m128 b = _mm_loadu_ps(v1.xyzw);
 	const __m128 c = _mm_sub_ps(a, b);
-	_mm_store_ps(out.xyzw, c);
+	_mm_storeu_ps(out.xyzw, c);
 }
 
 inline void vecMulVec(const vec4f& v0, const vec4f& v1, vec4f& out)
 {
-	const __m128 a = _mm_load_ps(v0.xyzw);
-	const __m128 b = _mm_load_ps(v1.xyzw);
+	const __m128 a = _mm_loadu_ps(v0.xyzw);
+	const __m128 b = _mm_loadu_ps(v1.xyzw);
 	const __m128 c = _mm_mul_ps(a, b);
-	_mm_store_ps(out.xyzw, c);
+	_mm_storeu_ps(out.xyzw, c);
 }
 
 inline void vecDivVec(const vec4f& v0, const vec4f& v1, vec4f& out)
 {
-	const __m128 a = _mm_load_ps(v0.xyzw);
-	const __m128 b = _mm_load_ps(v1.xyzw);
+	const __m128 a = _mm_loadu_ps(v0.xyzw);
+	const __m128 b = _mm_loadu_ps(v1.xyzw);
 	const __m128 c = _mm_div_ps(a, b);
-	_mm_store_ps(out.xyzw, c);
+	_mm_storeu_ps(out.xyzw, c);
 }
 
 inline void vecDotVec(const vec4f& v0, const vec4f& v1, float* out)
@@ -304,8 +297,8 @@ inline void vecDotVec(const vec4f& v0, const vec4f& v1, float* out)
 // https://geometrian.com/programming/tutorials/cross-product/index.php
 inline void vecCrossVec(const vec4f& v0, const vec4f& v1, vec4f& out)
 {
-	const __m128 a = _mm_load_ps(v0.xyzw);
-	const __m128 b = _mm_load_ps(v1.xyzw);
+	const __m128 a = _mm_loadu_ps(v0.xyzw);
+	const __m128 b = _mm_loadu_ps(v1.xyzw);
 
 	__m128 tmp0 = _mm_shuffle_ps(a, a, _MM_SHUFFLE(3, 0, 2, 1));
 	__m128 tmp1 = _mm_shuffle_ps(b, b, _MM_SHUFFLE(3, 1, 0, 2));
@@ -315,5 +308,7 @@ inline void vecCrossVec(const vec4f& v0, const vec4f& v1, vec4f& out)
 	__m128 result = _mm_sub_ps(
 		_mm_mul_ps(tmp0, tmp1),
 		_mm_mul_ps(tmp2, tmp3));
-	_mm_store_ps(out.xyzw, result);
+	_mm_storeu_ps(out.xyzw, result);
 }
+
+#endif
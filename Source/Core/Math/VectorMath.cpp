@@ -0,0 +1,453 @@
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <limits>
+#include <random>
+#include <vector>
+
+#include "VectorMath.h"
+
+#include "Matrix.h"
+#include "Core/Logging.h"
+#include "Core/Macros.h"
+
+#ifdef PENG_X86
+	#include <immintrin.h>
+#endif
+#include "Engine/Timer.h"
+#include "Platforms/Generic/CpuFeatures.h"
+
+namespace
+{
+	/** Scalar **/
+
+	void multiplyScalar(const mat4f& m0, const mat4f& m1, mat4f& out)
+	{
+		float result[4][4];
+		for (int32 row = 0; row < 4; row++)
+		{
+			const float x = m0.m[row][0];
+			const float y = m0.m[row][1];
+			const float z = m0.m[row][2];
+			const float w = m0.m[row][3];
+			for (int32 column = 0; column < 4; column++)
+			{
+				result[row][column] = (m1.m[0][column] * x) + (m1.m[1][column] * y) + (m1.m[2][column] * z) + (m1.m[3][column] * w);
+			}
+		}
+		std::memcpy(out.m, result, sizeof(result));
+	}
+
+	void multiplyBatchScalar(const mat4f* m0, const mat4f* m1, const int32 count, mat4f* out)
+	{
+		for (int32 i = 0; i < count; i++)
+		{
+			multiplyScalar(m0[i], m1[i], out[i]);
+		}
+	}
+
+	/** Transforms points [first, count). The SIMD backends use this for the points left over after their last full register. **/
+	void transformPointsScalar(const mat4f& m, const float* x, const float* y, const float* z, const int32 first, const int32 count,
+		float* outX, float* outY, float* outZ, float* outW)
+	{
+		const auto& mat = m.m;
+		for (int32 i = first; i < count; i++)
+		{
+			outX[i] = mat[0][0] * x[i] + mat[1][0] * y[i] + mat[2][0] * z[i] + mat[3][0];
+			outY[i] = mat[0][1] * x[i] + mat[1][1] * y[i] + mat[2][1] * z[i] + mat[3][1];
+			outZ[i] = mat[0][2] * x[i] + mat[1][2] * y[i] + mat[2][2] * z[i] + mat[3][2];
+			outW[i] = mat[0][3] * x[i] + mat[1][3] * y[i] + mat[2][3] * z[i] + mat[3][3];
+		}
+	}
+
+	void transformDirectionsScalar(const mat4f& m, const float* x, const float* y, const float* z, const int32 first, const int32 count,
+		float* outX, float* outY, float* outZ)
+	{
+		const auto& mat = m.m;
+		for (int32 i = first; i < count; i++)
+		{
+			outX[i] = mat[0][0] * x[i] + mat[1][0] * y[i] + mat[2][0] * z[i];
+			outY[i] = mat[0][1] * x[i] + mat[1][1] * y[i] + mat[2][1] * z[i];
+			outZ[i] = mat[0][2] * x[i] + mat[1][2] * y[i] + mat[2][2] * z[i];
+		}
+	}
+
+	void transformPointsScalar(const mat4f& m, const float* x, const float* y, const float* z, const int32 count, float* outX,
+		float* outY, float* outZ, float* outW)
+	{
+		transformPointsScalar(m, x, y, z, 0, count, outX, outY, outZ, outW);
+	}
+
+	void transformDirectionsScalar(const mat4f& m, const float* x, const float* y, const float* z, const int32 count, float* outX,
+		float* outY, float* outZ)
+	{
+		transformDirectionsScalar(m, x, y, z, 0, count, outX, outY, outZ);
+	}
+
+#ifdef PENG_X86
+	/** SSE4.1 **/
+
+	TARGET_SSE41 void multiplySSE41(const mat4f& m0, const mat4f& m1, mat4f& out)
+	{
+		// Every row of the output is the rows of m1 weighted by the matching row of m0. All of m1 is loaded before
+		// anything is stored, and each row of m0 before its own row of the output, so `out` may alias either.
+		const __m128 row0 = _mm_loadu_ps(m1.m[0]);
+		const __m128 row1 = _mm_loadu_ps(m1.m[1]);
+		const __m128 row2 = _mm_loadu_ps(m1.m[2]);
+		const __m128 row3 = _mm_loadu_ps(m1.m[3]);
+		for (int32 row = 0; row < 4; row++)
+		{
+			const float* weights = m0.m[row];
+			__m128		 result = _mm_mul_ps(row0, _mm_set1_ps(weights[0]));
+			result = _mm_add_ps(result, _mm_mul_ps(row1, _mm_set1_ps(weights[1])));
+			result = _mm_add_ps(result, _mm_mul_ps(row2, _mm_set1_ps(weights[2])));
+			result = _mm_add_ps(result, _mm_mul_ps(row3, _mm_set1_ps(weights[3])));
+			_mm_storeu_ps(out.m[row], result);
+		}
+	}
+
+	TARGET_SSE41 void multiplyBatchSSE41(const mat4f* m0, const mat4f* m1, const int32 count, mat4f* out)
+	{
+		for (int32 i = 0; i < count; i++)
+		{
+			multiplySSE41(m0[i], m1[i], out[i]);
+		}
+	}
+
+	TARGET_SSE41 void transformPointsSSE41(const mat4f& m, const float* x, const float* y, const float* z, const int32 count,
+		float* outX, float* outY, float* outZ, float* outW)
+	{
+		// Broadcast every element of the matrix once, then transform four points per iteration
+		__m128 mat[4][4];
+		for (int32 row = 0; row < 4; row++)
+		{
+			for (int32 column = 0; column < 4; column++)
+			{
+				mat[row][column] = _mm_set1_ps(m.m[row][column]);
+			}
+		}
+
+		float* outputs[4] = { outX, outY, outZ, outW };
+		int32  i = 0;
+		for (; i + 4 <= count; i += 4)
+		{
+			const __m128 vx = _mm_loadu_ps(x + i);
+			const __m128 vy = _mm_loadu_ps(y + i);
+			const __m128 vz = _mm_loadu_ps(z + i);
+			for (int32 column = 0; column < 4; column++)
+			{
+				__m128 result = _mm_mul_ps(mat[0][column], vx);
+				result = _mm_add_ps(result, _mm_mul_ps(mat[1][column], vy));
+				result = _mm_add_ps(result, _mm_mul_ps(mat[2][column], vz));
+				result = _mm_add_ps(result, mat[3][column]);
+				_mm_storeu_ps(outputs[column] + i, result);
+			}
+		}
+		transformPointsScalar(m, x, y, z, i, count, outX, outY, outZ, outW);
+	}
+
+	TARGET_SSE41 void transformDirectionsSSE41(const mat4f& m, const float* x, const float* y, const float* z, const int32 count,
+		float* outX, float* outY, float* outZ)
+	{
+		__m128 mat[3][3];
+		for (int32 row = 0; row < 3; row++)
+		{
+			for (int32 column = 0; column < 3; column++)
+			{
+				mat[row][column] = _mm_set1_ps(m.m[row][column]);
+			}
+		}
+
+		float* outputs[3] = { outX, outY, outZ };
+		int32  i = 0;
+		for (; i + 4 <= count; i += 4)
+		{
+			const __m128 vx = _mm_loadu_ps(x + i);
+			const __m128 vy = _mm_loadu_ps(y + i);
+			const __m128 vz = _mm_loadu_ps(z + i);
+			for (int32 column = 0; column < 3; column++)
+			{
+				__m128 result = _mm_mul_ps(mat[0][column], vx);
+				result = _mm_add_ps(result, _mm_mul_ps(mat[1][column], vy));
+				result = _mm_add_ps(result, _mm_mul_ps(mat[2][column], vz));
+				_mm_storeu_ps(outputs[column] + i, result);
+			}
+		}
+		transformDirectionsScalar(m, x, y, z, i, count, outX, outY, outZ);
+	}
+
+	/** AVX2 **/
+
+	/** Returns a register holding `low` in its lower four lanes and `high` in its upper four. **/
+	TARGET_AVX2 __m256 broadcastPair(const float low, const float high)
+	{
+		return _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_set1_ps(low)), _mm_set1_ps(high), 1);
+	}
+
+	TARGET_AVX2 void multiplyAVX2(const mat4f& m0, const mat4f& m1, mat4f& out)
+	{
+		// Compute two rows of the output per register, with every row of m1 in both halves
+		const __m256 row0 = _mm256_broadcast_ps((const __m128*)m1.m[0]);
+		const __m256 row1 = _mm256_broadcast_ps((const __m128*)m1.m[1]);
+		const __m256 row2 = _mm256_broadcast_ps((const __m128*)m1.m[2]);
+		const __m256 row3 = _mm256_broadcast_ps((const __m128*)m1.m[3]);
+		for (int32 row = 0; row < 4; row += 2)
+		{
+			const float* low = m0.m[row];
+			const float* high = m0.m[row + 1];
+			__m256		 result = _mm256_mul_ps(row0, broadcastPair(low[0], high[0]));
+			result = _mm256_add_ps(result, _mm256_mul_ps(row1, broadcastPair(low[1], high[1])));
+			result = _mm256_add_ps(result, _mm256_mul_ps(row2, broadcastPair(low[2], high[2])));
+			result = _mm256_add_ps(result, _mm256_mul_ps(row3, broadcastPair(low[3], high[3])));
+			_mm256_storeu_ps(out.m[row], result);
+		}
+	}
+
+	TARGET_AVX2 void multiplyBatchAVX2(const mat4f* m0, const mat4f* m1, const int32 count, mat4f* out)
+	{
+		for (int32 i = 0; i < count; i++)
+		{
+			multiplyAVX2(m0[i], m1[i], out[i]);
+		}
+	}
+
+	TARGET_AVX2 void transformPointsAVX2(const mat4f& m, const float* x, const float* y, const float* z, const int32 count,
+		float* outX, float* outY, float* outZ, float* outW)
+	{
+		__m256 mat[4][4];
+		for (int32 row = 0; row < 4; row++)
+		{
+			for (int32 column = 0; column < 4; column++)
+			{
+				mat[row][column] = _mm256_set1_ps(m.m[row][column]);
+			}
+		}
+
+		float* outputs[4] = { outX, outY, outZ, outW };
+		int32  i = 0;
+		for (; i + 8 <= count; i += 8)
+		{
+			const __m256 vx = _mm256_loadu_ps(x + i);
+			const __m256 vy = _mm256_loadu_ps(y + i);
+			const __m256 vz = _mm256_loadu_ps(z + i);
+			for (int32 column = 0; column < 4; column++)
+			{
+				__m256 result = _mm256_mul_ps(mat[0][column], vx);
+				result = _mm256_add_ps(result, _mm256_mul_ps(mat[1][column], vy));
+				result = _mm256_add_ps(result, _mm256_mul_ps(mat[2][column], vz));
+				result = _mm256_add_ps(result, mat[3][column]);
+				_mm256_storeu_ps(outputs[column] + i, result);
+			}
+		}
+		transformPointsScalar(m, x, y, z, i, count, outX, outY, outZ, outW);
+	}
+
+	TARGET_AVX2 void transformDirectionsAVX2(const mat4f& m, const float* x, const float* y, const float* z, const int32 count,
+		float* outX, float* outY, float* outZ)
+	{
+		__m256 mat[3][3];
+		for (int32 row = 0; row < 3; row++)
+		{
+			for (int32 column = 0; column < 3; column++)
+			{
+				mat[row][column] = _mm256_set1_ps(m.m[row][column]);
+			}
+		}
+
+		float* outputs[3] = { outX, outY, outZ };
+		int32  i = 0;
+		for (; i + 8 <= count; i += 8)
+		{
+			const __m256 vx = _mm256_loadu_ps(x + i);
+			const __m256 vy = _mm256_loadu_ps(y + i);
+			const __m256 vz = _mm256_loadu_ps(z + i);
+			for (int32 column = 0; column < 3; column++)
+			{
+				__m256 result = _mm256_mul_ps(mat[0][column], vx);
+				result = _mm256_add_ps(result, _mm256_mul_ps(mat[1][column], vy));
+				result = _mm256_add_ps(result, _mm256_mul_ps(mat[2][column], vz));
+				_mm256_storeu_ps(outputs[column] + i, result);
+			}
+		}
+		transformDirectionsScalar(m, x, y, z, i, count, outX, outY, outZ);
+	}
+
+#endif
+
+	/** Dispatch **/
+
+	struct VectorBackendFunctions
+	{
+		void (*multiply)(const mat4f&, const mat4f&, mat4f&);
+		void (*multiplyBatch)(const mat4f*, const mat4f*, int32, mat4f*);
+		void (*transformPoints)(const mat4f&, const float*, const float*, const float*, int32, float*, float*, float*, float*);
+		void (*transformDirections)(const mat4f&, const float*, const float*, const float*, int32, float*, float*, float*);
+	};
+
+	// Other architectures have no SIMD backends. Their CPUs never report SSE4.1 or AVX2, so those entries are never
+	// selected, and only fall back to the scalar functions to keep the table indexed by backend.
+	constexpr VectorBackendFunctions g_vectorBackends[] = {
+		{ multiplyScalar, multiplyBatchScalar, transformPointsScalar, transformDirectionsScalar },
+#ifdef PENG_X86
+		{ multiplySSE41, multiplyBatchSSE41, transformPointsSSE41, transformDirectionsSSE41 },
+		{ multiplyAVX2, multiplyBatchAVX2, transformPointsAVX2, transformDirectionsAVX2 },
+#else
+		{ multiplyScalar, multiplyBatchScalar, transformPointsScalar, transformDirectionsScalar },
+		{ multiplyScalar, multiplyBatchScalar, transformPointsScalar, transformDirectionsScalar },
+#endif
+	};
+	static_assert(std::size(g_vectorBackends) == (size_t)EVectorBackend::Count);
+
+	constexpr const char* g_vectorBackendNames[] = { "Scalar", "SSE4.1", "AVX2" };
+
+	// Matrices may be multiplied while other globals are constructed, before the best backend has been chosen. The
+	// scalar backend is constant initialized so those multiplications still work, just without SIMD.
+	// Both are atomic as the render and worker threads dispatch through them while another thread may switch backends.
+	// Every backend produces the same results, so relaxed ordering is enough: a thread which still calls the previous
+	// backend for a moment draws exactly the same frame.
+	std::atomic<EVectorBackend>				   g_currentVectorBackend = EVectorBackend::Scalar;
+	std::atomic<const VectorBackendFunctions*> g_currentVectorFunctions = &g_vectorBackends[0];
+
+	const bool g_vectorBackendSelected = []
+	{
+		VectorMath::setBackend(VectorMath::getBestBackend());
+		return true;
+	}();
+} // namespace
+
+bool VectorMath::isBackendSupported(const EVectorBackend backend)
+{
+	switch (backend)
+	{
+		case EVectorBackend::Scalar:
+			return true;
+		case EVectorBackend::SSE41:
+			return Platform::getCpuFeatures().sse41;
+		case EVectorBackend::AVX2:
+			return Platform::getCpuFeatures().avx2;
+		default:
+			return false;
+	}
+}
+
+EVectorBackend VectorMath::getBestBackend()
+{
+	if (isBackendSupported(EVectorBackend::AVX2))
+	{
+		return EVectorBackend::AVX2;
+	}
+	return isBackendSupported(EVectorBackend::SSE41) ? EVectorBackend::SSE41 : EVectorBackend::Scalar;
+}
+
+EVectorBackend VectorMath::getBackend()
+{
+	return g_currentVectorBackend.load(std::memory_order_relaxed);
+}
+
+void VectorMath::setBackend(const EVectorBackend backend)
+{
+	if (!isBackendSupported(backend))
+	{
+		LOG_WARNING("Vector backend {} is not supported by this CPU.", getBackendName(backend))
+		return;
+	}
+	g_currentVectorBackend.store(backend, std::memory_order_relaxed);
+	g_currentVectorFunctions.store(&g_vectorBackends[(int32)backend], std::memory_order_relaxed);
+}
+
+const char* VectorMath::getBackendName(const EVectorBackend backend)
+{
+	return backend < EVectorBackend::Count ? g_vectorBackendNames[(int32)backend] : "Unknown";
+}
+
+void VectorMath::multiply(const mat4f& m0, const mat4f& m1, mat4f& out)
+{
+	g_currentVectorFunctions.load(std::memory_order_relaxed)->multiply(m0, m1, out);
+}
+
+void VectorMath::multiply(const mat4f* m0, const mat4f* m1, const int32 count, mat4f* out)
+{
+	g_currentVectorFunctions.load(std::memory_order_relaxed)->multiplyBatch(m0, m1, count, out);
+}
+
+void VectorMath::transformPoints(const mat4f& m, const float* x, const float* y, const float* z, const int32 count, float* outX,
+	float* outY, float* outZ, float* outW)
+{
+	g_currentVectorFunctions.load(std::memory_order_relaxed)->transformPoints(m, x, y, z, count, outX, outY, outZ, outW);
+}
+
+void VectorMath::transformDirections(const mat4f& m, const float* x, const float* y, const float* z, const int32 count,
+	float* outX, float* outY, float* outZ)
+{
+	g_currentVectorFunctions.load(std::memory_order_relaxed)->transformDirections(m, x, y, z, count, outX, outY, outZ);
+}
+
+void VectorMath::benchmark(const int32 pointCount)
+{
+	std::mt19937						  generator(1337);
+	std::uniform_real_distribution<float> coordinate(-100.0f, 100.0f);
+
+	std::vector<float> inputs[3];
+	for (std::vector<float>& input : inputs)
+	{
+		input.resize(pointCount);
+		std::generate(input.begin(), input.end(), [&] { return coordinate(generator); });
+	}
+
+	mat4f matrix;
+	for (int32 row = 0; row < 4; row++)
+	{
+		for (int32 column = 0; column < 4; column++)
+		{
+			matrix.m[row][column] = coordinate(generator);
+		}
+	}
+
+	std::vector<float> reference;
+	std::vector<float> outputs[4];
+	for (std::vector<float>& output : outputs)
+	{
+		output.resize(pointCount);
+	}
+
+	for (int32 backendIndex = 0; backendIndex < (int32)EVectorBackend::Count; backendIndex++)
+	{
+		const auto backend = (EVectorBackend)backendIndex;
+		if (!isBackendSupported(backend))
+		{
+			LOG_INFO("{}: not supported by this CPU.", getBackendName(backend))
+			continue;
+		}
+		const VectorBackendFunctions& functions = g_vectorBackends[backendIndex];
+
+		// Take the best of a few runs to reduce noise
+		float bestTime = std::numeric_limits<float>::max();
+		for (int32 run = 0; run < 3; run++)
+		{
+			const TimePoint start = PTimer::now();
+			functions.transformPoints(matrix, inputs[0].data(), inputs[1].data(), inputs[2].data(), pointCount, outputs[0].data(),
+				outputs[1].data(), outputs[2].data(), outputs[3].data());
+			bestTime = std::min(bestTime, DurationMs(PTimer::now() - start).count());
+		}
+
+		// Every backend rounds identically, so the outputs must match bit for bit
+		std::vector<float> result;
+		for (const std::vector<float>& output : outputs)
+		{
+			result.insert(result.end(), output.begin(), output.end());
+		}
+		if (reference.empty())
+		{
+			reference = std::move(result);
+		}
+		else if (std::memcmp(reference.data(), result.data(), reference.size() * sizeof(float)) != 0)
+		{
+			LOG_WARNING("{}: transformed points differ from the {} backend.", getBackendName(backend),
+				getBackendName(EVectorBackend::Scalar))
+		}
+
+		const double pointsPerSecond = (double)pointCount / (bestTime / 1000.0);
+		LOG_INFO("{}: {:.2f} Mpoints/s ({} points in {:.3f} ms)", getBackendName(backend), pointsPerSecond / 1000000.0, pointCount,
+			bestTime)
+	}
+}
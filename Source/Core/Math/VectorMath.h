@@ -0,0 +1,85 @@
+#pragma once
+
+#include "Core/Types.h"
+#include "MathFwd.h"
+
+/** Instruction sets the batch operations of VectorMath can run with. **/
+enum class EVectorBackend : uint8
+{
+	/** Plain C++, one value at a time. Runs on any CPU. **/
+	Scalar,
+	/** SSE4.1, four values at a time. x86 and x64 only. **/
+	SSE41,
+	/** AVX2, eight values at a time. x86 and x64 only. **/
+	AVX2,
+	Count
+};
+
+/**
+ * Matrix and vector operations which run with the fastest instruction set the CPU supports, chosen when the engine
+ * starts rather than when it is compiled. Every backend multiplies and adds in the same order and never fuses the two,
+ * so they all produce exactly the same results, and switching backends never changes a frame.
+ *
+ * Operations on a single vector are cheaper than a call through the dispatch table, so those are inlined into
+ * `mat4_t` and `quat_t` instead.
+ */
+namespace VectorMath
+{
+	/**
+	 * @brief Returns whether the specified backend can run on this CPU.
+	 */
+	bool isBackendSupported(EVectorBackend backend);
+
+	/**
+	 * @brief Returns the fastest backend which can run on this CPU.
+	 */
+	EVectorBackend getBestBackend();
+
+	/**
+	 * @brief Returns the backend the batch operations run with. Defaults to the best backend for this CPU.
+	 */
+	EVectorBackend getBackend();
+
+	/**
+	 * @brief Overrides the backend the batch operations run with. Unsupported backends are ignored. Safe to call while
+	 * other threads are running batch operations, which each finish on the backend they started with.
+	 */
+	void setBackend(EVectorBackend backend);
+
+	/**
+	 * @brief Returns the display name of the specified backend.
+	 */
+	const char* getBackendName(EVectorBackend backend);
+
+	/**
+	 * @brief Sets `out` to `m0 * m1`, the transform which applies `m0` and then `m1`. `out` may alias either input.
+	 */
+	void multiply(const mat4f& m0, const mat4f& m1, mat4f& out);
+
+	/**
+	 * @brief Sets each of the `count` matrices of `out` to the product of the matching matrices of `m0` and `m1`,
+	 * with a single dispatch for the whole batch. `out` may alias either input.
+	 */
+	void multiply(const mat4f* m0, const mat4f* m1, int32 count, mat4f* out);
+
+	/**
+	 * @brief Transforms `count` points by `m`, treating their w as 1. Points are in structure of arrays form, and the
+	 * outputs must not alias the inputs.
+	 */
+	void transformPoints(const mat4f& m, const float* x, const float* y, const float* z, int32 count, float* outX,
+		float* outY, float* outZ, float* outW);
+
+	/**
+	 * @brief Transforms `count` directions by `m`, treating their w as 0 so they are not translated. Directions are in
+	 * structure of arrays form, and the outputs must not alias the inputs.
+	 */
+	void transformDirections(const mat4f& m, const float* x, const float* y, const float* z, int32 count, float* outX,
+		float* outY, float* outZ);
+
+	/**
+	 * @brief Transforms a fixed set of random points with every supported backend, checks they all agree, and logs the
+	 * number of points per second each of them transforms.
+	 * @param pointCount The number of points to transform.
+	 */
+	void benchmark(int32 pointCount = 1 << 20);
+} // namespace VectorMath
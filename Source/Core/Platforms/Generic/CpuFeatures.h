@@ -0,0 +1,65 @@
+#pragma once
+
+#include "Core/Macros.h"
+#include "Core/Types.h"
+
+#if defined(_MSC_VER) && defined(PENG_X86)
+	#include <intrin.h>
+#endif
+
+/**
+ * @brief Instruction set extensions supported by the CPU the engine is currently running on.
+ */
+struct CpuFeatures
+{
+	bool sse41 = false;
+	bool avx = false;
+	bool avx2 = false;
+};
+
+namespace Platform
+{
+	/**
+	 * @brief Queries the CPU for the instruction set extensions it supports.
+	 * @note Prefer `getCpuFeatures` which caches the result.
+	 */
+	inline CpuFeatures queryCpuFeatures()
+	{
+		// Every feature is left unsupported on other architectures, so only the scalar paths run there
+		CpuFeatures features;
+#if defined(_MSC_VER) && defined(PENG_X86)
+		int32 info[4];
+		__cpuid(info, 0);
+		const int32 maxLeaf = info[0];
+
+		__cpuid(info, 1);
+		features.sse41 = (info[2] & (1 << 19)) != 0;
+
+		// AVX also requires the OS to save the YMM registers on context switches
+		const bool osxsave = (info[2] & (1 << 27)) != 0;
+		const bool osAvx = osxsave && (_xgetbv(0) & 0x6) == 0x6;
+		features.avx = osAvx && (info[2] & (1 << 28)) != 0;
+
+		if (maxLeaf >= 7)
+		{
+			__cpuidex(info, 7, 0);
+			features.avx2 = features.avx && (info[1] & (1 << 5)) != 0;
+		}
+#elif defined(__GNUC__) && defined(PENG_X86)
+		__builtin_cpu_init();
+		features.sse41 = __builtin_cpu_supports("sse4.1");
+		features.avx = __builtin_cpu_supports("avx");
+		features.avx2 = __builtin_cpu_supports("avx2");
+#endif
+		return features;
+	}
+
+	/**
+	 * @brief Returns the instruction set extensions supported by this CPU.
+	 */
+	inline const CpuFeatures& getCpuFeatures()
+	{
+		static const CpuFeatures features = queryCpuFeatures();
+		return features;
+	}
+} // namespace Platform
@@ -6,6 +6,8 @@
 #include "Math/Color.h"
 #include "Renderer/UI/Widget.h"
 
+class Viewport;
+
 enum EWindowType
 {
 	Normal,
@@ -30,6 +32,8 @@ class GenericWindow
 protected:
 	WindowDescription		m_description;
 	Canvas* m_canvas;
+	/** Viewport whose frames are presented beneath the widgets of this window, or nullptr. **/
+	Viewport* m_viewport = nullptr;
 
 public:
 	GenericWindow() { m_canvas = new Canvas(); }
@@ -40,6 +44,8 @@ public:
 	virtual void clear() = 0;
 
 	Canvas* getCanvas() const { return m_canvas; }
+	Viewport* getViewport() const { return m_viewport; }
+	void setViewport(Viewport* viewport) { m_viewport = viewport; }
 	void					setCanvas(Canvas* newCanvas) { m_canvas = newCanvas; }
 
 	int32 getWidth() const { return m_description.width; }
@@ -0,0 +1,121 @@
+#include "MappedFile.h"
+
+#if defined(_WIN32)
+	#include <windows.h>
+#else
+	#include <fcntl.h>
+	#include <sys/mman.h>
+	#include <sys/stat.h>
+	#include <unistd.h>
+#endif
+
+#include "Core/Logging.h"
+
+MappedFile::~MappedFile()
+{
+	close();
+}
+
+bool MappedFile::open(const std::string& fileName)
+{
+	close();
+
+#if defined(_WIN32)
+	HANDLE file = CreateFileA(fileName.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+		FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+	if (file == INVALID_HANDLE_VALUE)
+	{
+		LOG_ERROR("Unable to open file {}.", fileName)
+		return false;
+	}
+
+	LARGE_INTEGER size;
+	if (!GetFileSizeEx(file, &size))
+	{
+		LOG_ERROR("Unable to read the size of file {}.", fileName)
+		CloseHandle(file);
+		return false;
+	}
+
+	// Empty files can't be mapped, but are still valid
+	m_file = file;
+	m_size = (size_t)size.QuadPart;
+	m_isOpen = true;
+	if (m_size == 0)
+	{
+		return true;
+	}
+
+	m_mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	m_data = m_mapping != nullptr ? (const char*)MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0) : nullptr;
+#else
+	const int file = ::open(fileName.c_str(), O_RDONLY);
+	if (file == -1)
+	{
+		LOG_ERROR("Unable to open file {}.", fileName)
+		return false;
+	}
+
+	struct stat status;
+	if (fstat(file, &status) != 0)
+	{
+		LOG_ERROR("Unable to read the size of file {}.", fileName)
+		::close(file);
+		return false;
+	}
+
+	// Empty files can't be mapped, but are still valid. The mapping keeps the file open on its own.
+	m_size = (size_t)status.st_size;
+	m_isOpen = true;
+	if (m_size == 0)
+	{
+		::close(file);
+		return true;
+	}
+
+	void* data = mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, file, 0);
+	::close(file);
+	if (data != MAP_FAILED)
+	{
+		// Start reading the whole file in the background, as it is about to be parsed from several places at once
+		m_data = (const char*)data;
+		madvise(data, m_size, MADV_WILLNEED);
+	}
+#endif
+
+	if (m_data == nullptr)
+	{
+		LOG_ERROR("Unable to map file {} into memory.", fileName)
+		close();
+		return false;
+	}
+	return true;
+}
+
+void MappedFile::close()
+{
+#if defined(_WIN32)
+	if (m_data != nullptr)
+	{
+		UnmapViewOfFile(m_data);
+	}
+	if (m_mapping != nullptr)
+	{
+		CloseHandle(m_mapping);
+	}
+	if (m_file != nullptr)
+	{
+		CloseHandle(m_file);
+	}
+	m_mapping = nullptr;
+	m_file = nullptr;
+#else
+	if (m_data != nullptr)
+	{
+		munmap((void*)m_data, m_size);
+	}
+#endif
+	m_data = nullptr;
+	m_size = 0;
+	m_isOpen = false;
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+
+#include "Core/Types.h"
+
+/**
+ * @brief Read-only view of a whole file, mapped into memory rather than copied into a buffer. Pages are read from
+ * disk as they are first touched, so a file can be parsed while it is still being read.
+ */
+class MappedFile
+{
+	const char* m_data = nullptr;
+	size_t		m_size = 0;
+	bool		m_isOpen = false;
+
+#if defined(_WIN32)
+	/** Handles of the file and its mapping. Kept as void* so windows.h isn't included everywhere this is. **/
+	void* m_file = nullptr;
+	void* m_mapping = nullptr;
+#endif
+
+public:
+	MappedFile() = default;
+	~MappedFile();
+
+	MappedFile(const MappedFile& other) = delete;
+	MappedFile& operator=(const MappedFile& other) = delete;
+
+	/**
+	 * @brief Maps `fileName` into memory, closing any file already mapped. Empty files open with no data.
+	 * @return Whether the file could be opened and mapped.
+	 */
+	bool open(const std::string& fileName);
+
+	/**
+	 * @brief Unmaps the file. Pointers into its data are invalid afterwards.
+	 */
+	void close();
+
+	[[nodiscard]] bool isOpen() const { return m_isOpen; }
+
+	[[nodiscard]] const char* getData() const { return m_data; }
+
+	[[nodiscard]] size_t getSize() const { return m_size; }
+
+	[[nodiscard]] std::string_view getView() const { return { m_data, m_size }; }
+};
@@ -42,6 +42,32 @@ void Win32Application::initialize(Engine* engine)
 	g_engine = engine;
 	g_engine->initialize(this);
 	setupInput();
+	createViewport();
+}
+
+void Win32Application::createViewport()
+{
+	if (m_mainWindow == nullptr)
+	{
+		return;
+	}
+
+	RECT clientRect;
+	GetClientRect(m_mainWindow->getHwnd(), &clientRect);
+	const int32 width = clientRect.right - clientRect.left;
+	const int32 height = clientRect.bottom - clientRect.top;
+
+	m_viewport = std::make_unique<Viewport>(width, height);
+	if (!m_viewport->initRHI(m_mainWindow->getHwnd()))
+	{
+		LOG_ERROR("Failed to initialize the viewport's RHI.")
+		m_viewport.reset();
+		return;
+	}
+	m_viewport->resize(width, height);
+	m_mainWindow->setViewport(m_viewport.get());
+
+	g_engine->onViewportCreated(m_viewport.get());
 }
 
 void Win32Application::tick(float deltaTime)
@@ -69,9 +95,26 @@ int32 Win32Application::exec()
 		startTime = PTimer::now();
 		float deltaTime = std::chrono::duration_cast<DurationMs>(endTime - startTime).count();
 		tick(deltaTime);
+
+		// Submit the next frame, which draws on the render thread while the following tick runs. Painting the main
+		// window presents the latest completed frame.
+		if (m_viewport != nullptr)
+		{
+			m_viewport->draw();
+		}
 		endTime = PTimer::now();
 	}
 
+	// Finish the frame in flight before the windows go away
+	if (m_mainWindow != nullptr)
+	{
+		m_mainWindow->setViewport(nullptr);
+	}
+	m_viewport.reset();
+
+	// Release the scene now that nothing draws it
+	g_engine->shutdown();
+
 	return 0;
 }
 
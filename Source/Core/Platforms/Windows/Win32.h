@@ -5,6 +5,7 @@
 
 #include "Engine/Timer.h"
 #include "Platforms/Generic/GenericApplication.h"
+#include "Renderer/Viewport.h"
 #include "Win32Window.h"
 
 #ifdef WITH_EDITOR
@@ -82,6 +83,13 @@ class Win32Application : public IApplication, public IInputHandler
 	std ::shared_ptr<Win32Window>			  m_mainWindow;
 	HINSTANCE								  m_hInstance;
 	MouseData								  m_mouse;
+	/** Draws the scene on its render thread, and is presented in the main window. **/
+	std::unique_ptr<Viewport> m_viewport;
+
+	/**
+	 * @brief Creates the viewport at the size of the main window's client area and presents it there.
+	 */
+	void createViewport();
 
 protected:
 	/**
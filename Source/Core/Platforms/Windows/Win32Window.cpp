@@ -1,5 +1,6 @@
 #include "Win32Window.h"
 #include "Win32.h"
+#include "Renderer/Viewport.h"
 
 const TCHAR Win32Window::m_windowClass[] = TEXT("PenguinWindow");
 
@@ -20,6 +21,12 @@ void Win32Window::resize(int32 width, int32 height)
 	// Set the painter texture to the new texture we just remade.
 	m_painter->setTexture(m_displayTexture.get());
 	m_painter->setViewport(recti(0, 0, width, height));
+
+	// Draw frames at the size of the client area. Minimized windows have no area, so keep the last size.
+	if (m_viewport != nullptr && width > 0 && height > 0)
+	{
+		m_viewport->resize(width, height);
+	}
 }
 
 void Win32Window::show()
@@ -39,6 +46,15 @@ void Win32Window::paint()
 	// Clear to background color first
 	clear();
 
+	// Present the latest frame of the scene beneath the widgets
+	if (m_viewport != nullptr)
+	{
+		if (Texture* frame = m_viewport->getFrame(); frame != nullptr)
+		{
+			m_painter->drawTexture(frame, { 0, 0 });
+		}
+	}
+
 	if (m_canvas != nullptr)
 	{
 		// Layout all widgets
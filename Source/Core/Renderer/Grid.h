@@ -19,7 +19,7 @@ public:
 		}
 	}
 
-	[[nodiscard]] std::vector<line3d> getLines() const
+	[[nodiscard]] const std::vector<line3d>& getLines() const
 	{
 		return m_lines;
 	}
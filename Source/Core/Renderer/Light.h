@@ -0,0 +1,34 @@
+#pragma once
+
+#include "Core/Types.h"
+#include "Math/Color.h"
+#include "Math/Vector.h"
+
+enum class ELightType : uint8
+{
+	/** Lights every direction equally. **/
+	Point,
+	/** Lights a cone around its direction. **/
+	Spot
+};
+
+/**
+ * A local light in the scene, drawn when the Lights render flag is set. Every light has a range past which it has no
+ * effect, so each part of the screen only has to be shaded by the few lights which can reach it.
+ */
+struct Light
+{
+	ELightType type = ELightType::Point;
+	/** World-space position. **/
+	vec3f position;
+	/** World-space direction spot lights point in. Doesn't need to be normalized. Unused by point lights. **/
+	vec3f direction = vec3f(0.0f, 0.0f, 1.0f);
+	Color color = Color::white();
+	float intensity = 1.0f;
+	/** Distance at which the light fades out completely. **/
+	float range = 10.0f;
+	/** Angle, in degrees, from the direction of a spot light within which it is at full strength. **/
+	float innerConeAngle = 20.0f;
+	/** Angle, in degrees, from the direction of a spot light past which it has no effect. **/
+	float outerConeAngle = 30.0f;
+};
@@ -7,6 +7,7 @@
 #include <filesystem>
 
 #include "D3D11Core.h"
+#include "Math/Frustum.h"
 
 using namespace DirectX;
 
@@ -289,6 +290,13 @@ void D3D11RHI::draw()
 {
 	for (auto& buffer : m_meshBuffers)
 	{
+		// Skip meshes whose bounds are outside the view frustum
+		const MeshDescription* desc = buffer.getMeshDescription();
+		const frustumf		   frustum(desc->renderable->getWorldMatrix() * m_viewData->viewProjectionMatrix);
+		if (!frustum.intersects(desc->mesh->getBoundingSphere()) || !frustum.intersects(desc->mesh->getBounds()))
+		{
+			continue;
+		}
 		drawMesh(&buffer);
 	}
 
@@ -304,10 +312,11 @@ void D3D11RHI::drawMesh(Buffer11* buffer)
 {
 	// Buffers
 	ID3D11Buffer* vertexBufferData = buffer->getVertexBuffer();
+	ID3D11Buffer* indexBufferData = buffer->getIndexBuffer();
 	ID3D11Buffer* constantBufferData = buffer->getConstantBuffer();
 
 	// Update model constant buffer
-	mat4f	model = buffer->getMeshDescription()->transform->toMatrix();
+	mat4f	model = buffer->getMeshDescription()->renderable->getWorldMatrix();
 	CBModel data{};
 	data.model = XMMATRIX(&model.m[0][0]);
 	m_deviceContext->UpdateSubresource(constantBufferData, 0, nullptr, &data, 0, 0);
@@ -319,6 +328,7 @@ void D3D11RHI::drawMesh(Buffer11* buffer)
 
 	// Set the current vertex buffer to this mesh's buffer
 	m_deviceContext->IASetVertexBuffers(0, 1, &vertexBufferData, &vertexBufferStride, &vertexBufferOffset);
+	m_deviceContext->IASetIndexBuffer(indexBufferData, DXGI_FORMAT_R32_UINT, 0);
 
 	// Set the constant buffer for this mesh
 	m_deviceContext->VSSetConstantBuffers(0 /* Camera */, 1, &m_constantBuffers[ConstantBufferId::Camera]);
@@ -334,7 +344,7 @@ void D3D11RHI::drawMesh(Buffer11* buffer)
 	}
 
 	// Draw the mesh to the screen
-	m_deviceContext->Draw(desc->byteSize, 0);
+	m_deviceContext->DrawIndexed(desc->indexCount, 0, 0);
 }
 
 void D3D11RHI::endDraw()
@@ -511,7 +521,7 @@ HRESULT D3D11RHI::compileShader(const LPCWSTR fileName, const LPCSTR entryPoint,
 	return result;
 }
 
-inline void Buffer11::createVertexBuffer(std::vector<float>& vertexData)
+inline void Buffer11::createVertexBuffer(std::span<const float> vertexData)
 {
 	auto msg = "Buffer11::createVertexBuffer(): ID3D11Device is not instantiated.";
 	ASSERT(g_device != nullptr, msg);
@@ -530,6 +540,25 @@ inline void Buffer11::createVertexBuffer(std::vector<float>& vertexData)
 	}
 }
 
+inline void Buffer11::createIndexBuffer(std::span<const uint32> indexData)
+{
+	auto msg = "Buffer11::createIndexBuffer(): ID3D11Device is not instantiated.";
+	ASSERT(g_device != nullptr, msg);
+
+	D3D11_BUFFER_DESC	   bufferDesc{};
+	D3D11_SUBRESOURCE_DATA subResourceData{};
+	bufferDesc.ByteWidth = indexData.size() * sizeof(uint32);
+	bufferDesc.Usage = D3D11_USAGE_DEFAULT;
+	bufferDesc.BindFlags = D3D11_BIND_INDEX_BUFFER;
+	subResourceData.pSysMem = indexData.data();
+
+	HRESULT result = g_device->CreateBuffer(&bufferDesc, &subResourceData, m_indexBuffer.GetAddressOf());
+	if (FAILED(result))
+	{
+		LOG_ERROR("D3D11Buffer::createIndexBuffer(): Failed to create index buffer ({}).", formatHResult(result));
+	}
+}
+
 void Buffer11::createConstantBuffer(int32 byteSize)
 {
 	auto msg = "Buffer11::createVertexBuffer(): ID3D11Device is not instantiated.";
@@ -550,14 +579,21 @@ void D3D11RHI::addRenderable(IRenderable* renderable)
 {
 	Buffer11 buffer;
 	auto	 vertexData = renderable->getMesh()->getVertexData();
-	buffer.createVertexBuffer(*vertexData);
-	buffer.createConstantBuffer(vertexData->size());
+	auto	 indexData = renderable->getMesh()->getIndexData();
+	buffer.createVertexBuffer(vertexData);
+	buffer.createIndexBuffer(indexData);
+	buffer.createConstantBuffer(vertexData.size());
 
 	MeshDescription meshDesc;
+	meshDesc.mesh = renderable->getMesh();
+	meshDesc.version = meshDesc.mesh->getVersion();
 	meshDesc.stride = sizeof(Vertex3);
-	meshDesc.data = vertexData->data();
-	meshDesc.byteSize = vertexData->size();
-	meshDesc.transform = renderable->getTransform();
+	meshDesc.data = vertexData.data();
+	meshDesc.byteSize = vertexData.size_bytes();
+	meshDesc.vertexCount = meshDesc.byteSize / sizeof(Vertex3);
+	meshDesc.indexes = indexData.data();
+	meshDesc.indexCount = indexData.size();
+	meshDesc.renderable = renderable;
 	buffer.setMeshDescription(meshDesc);
 
 	m_meshBuffers.emplace_back(buffer);
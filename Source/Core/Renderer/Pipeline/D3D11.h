@@ -160,15 +160,18 @@ class Buffer11 : public GenericBuffer
 {
 	MeshDescription		 m_meshDescription;
 	ComPtr<ID3D11Buffer> m_vertexBuffer = nullptr;
+	ComPtr<ID3D11Buffer> m_indexBuffer = nullptr;
 	ComPtr<ID3D11Buffer> m_constantBuffer = nullptr;
 
 public:
-	void createVertexBuffer(std::vector<float>& data) override;
+	void createVertexBuffer(std::span<const float> data) override;
+	void createIndexBuffer(std::span<const uint32> data) override;
 	void createConstantBuffer(int32 byteSize) override;
 	void setMeshDescription(const MeshDescription& meshDescription) { m_meshDescription = meshDescription; }
 
 	MeshDescription* getMeshDescription() { return &m_meshDescription; }
 	ID3D11Buffer*	 getVertexBuffer() const { return m_vertexBuffer.Get(); }
+	ID3D11Buffer*	 getIndexBuffer() const { return m_indexBuffer.Get(); }
 	ID3D11Buffer*	 getConstantBuffer() const { return m_constantBuffer.Get(); }
 };
 
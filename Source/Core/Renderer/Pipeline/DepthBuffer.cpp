@@ -0,0 +1,302 @@
+#include <limits>
+
+#include "DepthBuffer.h"
+#include "Core/Macros.h"
+
+#ifdef PENG_X86
+	#include <xmmintrin.h>
+#endif
+
+namespace
+{
+	/** Number of bits in the codes of each format. Float32 has none. **/
+	constexpr int32 g_depthFormatBits[] = { 0, 24, 16 };
+	constexpr int32 g_depthFormatSizes[] = { sizeof(float), sizeof(uint32), sizeof(uint16) };
+} // namespace
+
+DepthBuffer::DepthBuffer(const int32 width, const int32 height, const float clearDepth) : m_clearDepth(clearDepth)
+{
+	m_encoding.clearDepth = clearDepth;
+	resize(width, height);
+}
+
+void DepthBuffer::resize(const int32 width, const int32 height)
+{
+	m_width = width;
+	m_height = height;
+	m_pitch = (width + g_depthBlockSize - 1) & ~(g_depthBlockSize - 1);
+	m_blockCountX = (width + g_depthBlockSize - 1) / g_depthBlockSize;
+	m_blockCountY = (height + g_depthBlockSize - 1) / g_depthBlockSize;
+	m_coarseBlockCountX = (width + g_depthCoarseBlockSize - 1) / g_depthCoarseBlockSize;
+	m_coarseBlockCountY = (height + g_depthCoarseBlockSize - 1) / g_depthCoarseBlockSize;
+
+	// Sized for the widest format, so changing format never reallocates
+	m_data.resize((size_t)m_pitch * m_height);
+	m_blockMins.resize((size_t)m_blockCountX * m_blockCountY);
+	m_blockMaxs.resize((size_t)m_blockCountX * m_blockCountY);
+	m_coarseBlockMaxs.resize((size_t)m_coarseBlockCountX * m_coarseBlockCountY);
+}
+
+void DepthBuffer::setFormat(const EDepthFormat format)
+{
+	m_format = format;
+	m_encoding = format == EDepthFormat::Float32 ? DepthEncoding() : DepthEncoding(g_depthFormatBits[(int32)format], m_clearDepth);
+	m_encoding.clearDepth = m_clearDepth;
+}
+
+int32 DepthBuffer::getPixelSize() const
+{
+	return g_depthFormatSizes[(int32)m_format];
+}
+
+template <EDepthFormat Format>
+void DepthBuffer::clearPixels(const recti& rect)
+{
+	using Storage = DepthStorage<Format>;
+
+	Storage clearValue;
+	if constexpr (Format == EDepthFormat::Float32)
+	{
+		clearValue = m_clearDepth;
+	}
+	else
+	{
+		clearValue = (Storage)m_encoding.clearCode;
+	}
+
+	Storage* pixels = (Storage*)m_data.data();
+	for (int32 row = rect.y; row < rect.y + rect.height; row++)
+	{
+		Storage* line = pixels + (size_t)row * m_pitch;
+		std::fill(line + rect.x, line + rect.x + rect.width, clearValue);
+	}
+}
+
+void DepthBuffer::clear(const recti& rect)
+{
+	switch (m_format)
+	{
+		case EDepthFormat::Fixed24:
+			clearPixels<EDepthFormat::Fixed24>(rect);
+			break;
+		case EDepthFormat::Fixed16:
+			clearPixels<EDepthFormat::Fixed16>(rect);
+			break;
+		default:
+			clearPixels<EDepthFormat::Float32>(rect);
+			break;
+	}
+}
+
+void DepthBuffer::clearBlocks()
+{
+	std::fill(m_blockMins.begin(), m_blockMins.end(), m_clearDepth);
+	std::fill(m_blockMaxs.begin(), m_blockMaxs.end(), m_clearDepth);
+	std::fill(m_coarseBlockMaxs.begin(), m_coarseBlockMaxs.end(), m_clearDepth);
+}
+
+template <EDepthFormat Format>
+void DepthBuffer::updateBlock(const int32 blockX, const int32 blockY)
+{
+	using Storage = DepthStorage<Format>;
+
+	const int32	   x0 = blockX * g_depthBlockSize;
+	const int32	   y0 = blockY * g_depthBlockSize;
+	const int32	   x1 = std::min(x0 + g_depthBlockSize, m_width);
+	const int32	   y1 = std::min(y0 + g_depthBlockSize, m_height);
+	const Storage* pixels = (const Storage*)m_data.data();
+
+	Storage nearest = pixels[(size_t)y0 * m_pitch + x0];
+	Storage farthest = nearest;
+#ifdef PENG_X86
+	if constexpr (Format == EDepthFormat::Float32)
+	{
+		if (x1 - x0 == g_depthBlockSize)
+		{
+			__m128 nearest4 = _mm_set1_ps(nearest);
+			__m128 farthest4 = nearest4;
+			for (int32 y = y0; y < y1; y++)
+			{
+				const float* row = pixels + (size_t)y * m_pitch + x0;
+				const __m128 left = _mm_loadu_ps(row);
+				const __m128 right = _mm_loadu_ps(row + 4);
+				nearest4 = _mm_min_ps(nearest4, _mm_min_ps(left, right));
+				farthest4 = _mm_max_ps(farthest4, _mm_max_ps(left, right));
+			}
+			nearest4 = _mm_min_ps(nearest4, _mm_shuffle_ps(nearest4, nearest4, _MM_SHUFFLE(1, 0, 3, 2)));
+			nearest4 = _mm_min_ps(nearest4, _mm_shuffle_ps(nearest4, nearest4, _MM_SHUFFLE(2, 3, 0, 1)));
+			farthest4 = _mm_max_ps(farthest4, _mm_shuffle_ps(farthest4, farthest4, _MM_SHUFFLE(1, 0, 3, 2)));
+			farthest4 = _mm_max_ps(farthest4, _mm_shuffle_ps(farthest4, farthest4, _MM_SHUFFLE(2, 3, 0, 1)));
+			m_blockMins[(size_t)blockY * m_blockCountX + blockX] = _mm_cvtss_f32(nearest4);
+			m_blockMaxs[(size_t)blockY * m_blockCountX + blockX] = _mm_cvtss_f32(farthest4);
+			return;
+		}
+	}
+#endif
+
+	// Codes, partial blocks at the right edge of the buffer, and any block without SSE. The loops are simple enough
+	// to be vectorized.
+	for (int32 y = y0; y < y1; y++)
+	{
+		const Storage* row = pixels + (size_t)y * m_pitch;
+		for (int32 x = x0; x < x1; x++)
+		{
+			nearest = std::min(nearest, row[x]);
+			farthest = std::max(farthest, row[x]);
+		}
+	}
+
+	if constexpr (Format == EDepthFormat::Float32)
+	{
+		m_blockMins[(size_t)blockY * m_blockCountX + blockX] = nearest;
+		m_blockMaxs[(size_t)blockY * m_blockCountX + blockX] = farthest;
+	}
+	else
+	{
+		m_blockMins[(size_t)blockY * m_blockCountX + blockX] = m_encoding.decodeNearest(nearest);
+		m_blockMaxs[(size_t)blockY * m_blockCountX + blockX] = m_encoding.decodeFarthest(farthest);
+	}
+}
+
+void DepthBuffer::updateBlocks(const recti& bounds)
+{
+	const int32 minX = std::max(bounds.x, 0);
+	const int32 minY = std::max(bounds.y, 0);
+	const int32 maxX = std::min(bounds.x + bounds.width, m_width) - 1;
+	const int32 maxY = std::min(bounds.y + bounds.height, m_height) - 1;
+	if (minX > maxX || minY > maxY)
+	{
+		return;
+	}
+
+	// Recompute every fine block overlapping the bounds from the pixels
+	const int32 minBlockX = minX / g_depthBlockSize;
+	const int32 minBlockY = minY / g_depthBlockSize;
+	const int32 maxBlockX = maxX / g_depthBlockSize;
+	const int32 maxBlockY = maxY / g_depthBlockSize;
+	for (int32 blockY = minBlockY; blockY <= maxBlockY; blockY++)
+	{
+		for (int32 blockX = minBlockX; blockX <= maxBlockX; blockX++)
+		{
+			switch (m_format)
+			{
+				case EDepthFormat::Fixed24:
+					updateBlock<EDepthFormat::Fixed24>(blockX, blockY);
+					break;
+				case EDepthFormat::Fixed16:
+					updateBlock<EDepthFormat::Fixed16>(blockX, blockY);
+					break;
+				default:
+					updateBlock<EDepthFormat::Float32>(blockX, blockY);
+					break;
+			}
+		}
+	}
+
+	// Recompute every coarse block containing one of the fine blocks above
+	constexpr int32 blocksPerCoarseBlock = g_depthCoarseBlockSize / g_depthBlockSize;
+	for (int32 coarseY = minBlockY / blocksPerCoarseBlock; coarseY <= maxBlockY / blocksPerCoarseBlock; coarseY++)
+	{
+		const int32 blockY0 = coarseY * blocksPerCoarseBlock;
+		const int32 blockY1 = std::min(blockY0 + blocksPerCoarseBlock, m_blockCountY);
+		for (int32 coarseX = minBlockX / blocksPerCoarseBlock; coarseX <= maxBlockX / blocksPerCoarseBlock; coarseX++)
+		{
+			const int32 blockX0 = coarseX * blocksPerCoarseBlock;
+			const int32 blockX1 = std::min(blockX0 + blocksPerCoarseBlock, m_blockCountX);
+
+			float farthest = m_blockMaxs[(size_t)blockY0 * m_blockCountX + blockX0];
+			for (int32 blockY = blockY0; blockY < blockY1; blockY++)
+			{
+				const float* row = m_blockMaxs.data() + (size_t)blockY * m_blockCountX;
+				farthest = std::max(farthest, *std::max_element(row + blockX0, row + blockX1));
+			}
+			m_coarseBlockMaxs[(size_t)coarseY * m_coarseBlockCountX + coarseX] = farthest;
+		}
+	}
+}
+
+bool DepthBuffer::isOccluded(const recti& bounds, const float nearestDepth) const
+{
+	const int32 minX = std::max(bounds.x, 0);
+	const int32 minY = std::max(bounds.y, 0);
+	const int32 maxX = std::min(bounds.x + bounds.width, m_width) - 1;
+	const int32 maxY = std::min(bounds.y + bounds.height, m_height) - 1;
+	if (minX > maxX || minY > maxY)
+	{
+		return true;
+	}
+
+	for (int32 coarseY = minY / g_depthCoarseBlockSize; coarseY <= maxY / g_depthCoarseBlockSize; coarseY++)
+	{
+		for (int32 coarseX = minX / g_depthCoarseBlockSize; coarseX <= maxX / g_depthCoarseBlockSize; coarseX++)
+		{
+			// The whole coarse block is in front of the nearest depth
+			if (m_coarseBlockMaxs[(size_t)coarseY * m_coarseBlockCountX + coarseX] < nearestDepth)
+			{
+				continue;
+			}
+
+			// Otherwise check each fine block within both the bounds and this coarse block
+			const int32 blockX0 = std::max(minX, coarseX * g_depthCoarseBlockSize) / g_depthBlockSize;
+			const int32 blockY0 = std::max(minY, coarseY * g_depthCoarseBlockSize) / g_depthBlockSize;
+			const int32 blockX1 = std::min(maxX, (coarseX + 1) * g_depthCoarseBlockSize - 1) / g_depthBlockSize;
+			const int32 blockY1 = std::min(maxY, (coarseY + 1) * g_depthCoarseBlockSize - 1) / g_depthBlockSize;
+			for (int32 blockY = blockY0; blockY <= blockY1; blockY++)
+			{
+				const float* row = m_blockMaxs.data() + (size_t)blockY * m_blockCountX;
+				for (int32 blockX = blockX0; blockX <= blockX1; blockX++)
+				{
+					if (!(row[blockX] < nearestDepth))
+					{
+						return false;
+					}
+				}
+			}
+		}
+	}
+	return true;
+}
+
+vec2f DepthBuffer::getBounds(const recti& bounds) const
+{
+	vec2f		result(std::numeric_limits<float>::max(), std::numeric_limits<float>::lowest());
+	const int32 minX = std::max(bounds.x, 0);
+	const int32 minY = std::max(bounds.y, 0);
+	const int32 maxX = std::min(bounds.x + bounds.width, m_width) - 1;
+	const int32 maxY = std::min(bounds.y + bounds.height, m_height) - 1;
+	if (minX > maxX || minY > maxY)
+	{
+		return result;
+	}
+
+	for (int32 blockY = minY / g_depthBlockSize; blockY <= maxY / g_depthBlockSize; blockY++)
+	{
+		for (int32 blockX = minX / g_depthBlockSize; blockX <= maxX / g_depthBlockSize; blockX++)
+		{
+			// Every pixel drawn is nearer than the clear depth, so only blocks which are still entirely clear have it as
+			// their nearest depth
+			const size_t index = (size_t)blockY * m_blockCountX + blockX;
+			if (m_blockMins[index] >= m_clearDepth)
+			{
+				continue;
+			}
+			result.x = std::min(result.x, m_blockMins[index]);
+			result.y = std::max(result.y, m_blockMaxs[index]);
+		}
+	}
+	return result;
+}
+
+float DepthBuffer::getDepth(const int32 x, const int32 y) const
+{
+	const size_t index = (size_t)y * m_pitch + x;
+	switch (m_format)
+	{
+		case EDepthFormat::Fixed24:
+			return m_encoding.decode(((const uint32*)m_data.data())[index]);
+		case EDepthFormat::Fixed16:
+			return m_encoding.decode(((const uint16*)m_data.data())[index]);
+		default:
+			return ((const float*)m_data.data())[index];
+	}
+}
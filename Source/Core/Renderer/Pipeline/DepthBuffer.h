@@ -0,0 +1,210 @@
+#pragma once
+
+#include <algorithm>
+#include <type_traits>
+#include <vector>
+
+#include "Core/Types.h"
+#include "Math/Rect.h"
+#include "Math/Vector.h"
+
+/** Width and height, in pixels, of a single block in the fine level of the depth bounds. **/
+constexpr int32 g_depthBlockSize = 8;
+/** Width and height, in pixels, of a single block in the coarse level of the depth bounds. **/
+constexpr int32 g_depthCoarseBlockSize = 64;
+
+/**
+ * Nearest and farthest depth `Clipping::clipVertex` produces for points between the near and far planes. The fixed
+ * point formats spread their codes evenly across this range.
+ **/
+constexpr float g_minEncodedDepth = 0.25f;
+constexpr float g_maxEncodedDepth = 0.75f;
+
+/** How each pixel of a depth buffer is stored. **/
+enum class EDepthFormat : uint8
+{
+	/** 32-bit float. Exact, and the default. **/
+	Float32,
+	/** 24-bit unsigned fixed point in the low bits of 32. Depth tests become integer compares. **/
+	Fixed24,
+	/** 16-bit unsigned fixed point. Halves the memory traffic of the depth test, at the cost of precision. **/
+	Fixed16,
+	Count
+};
+
+/** The type a single pixel of the specified format is stored as. **/
+template <EDepthFormat Format>
+using DepthStorage = std::conditional_t<Format == EDepthFormat::Float32, float,
+	std::conditional_t<Format == EDepthFormat::Fixed24, uint32, uint16>>;
+
+/**
+ * @brief Maps depths to the codes of a fixed point format.
+ *
+ * Depths are truncated to a code, so a code stands for every depth from its own value up to the next code. The
+ * largest code is reserved for cleared pixels, and every depth encodes to a smaller one, so anything drawn passes the
+ * depth test against a cleared pixel.
+ */
+struct DepthEncoding
+{
+	float  offset = g_minEncodedDepth;
+	float  scale = 1.0f;
+	/** The code cleared pixels hold. **/
+	uint32 clearCode = 0;
+	/** The depth cleared pixels decode to. **/
+	float  clearDepth = 0.0f;
+
+	DepthEncoding() = default;
+	DepthEncoding(const int32 bits, const float inClearDepth)
+		: scale((float)((1u << bits) - 1) / (g_maxEncodedDepth - g_minEncodedDepth)), clearCode((1u << bits) - 1),
+		  clearDepth(inClearDepth)
+	{}
+
+	/**
+	 * @brief Returns the largest code a depth can encode to.
+	 */
+	[[nodiscard]] float getMaxCode() const { return (float)(clearCode - 1); }
+
+	[[nodiscard]] uint32 encode(const float depth) const
+	{
+		return (uint32)std::min(std::max((depth - offset) * scale, 0.0f), getMaxCode());
+	}
+
+	[[nodiscard]] float decode(const uint32 code) const { return code >= clearCode ? clearDepth : offset + (float)code / scale; }
+
+	/**
+	 * @brief Returns a depth no farther than any depth which encodes to `code`. Allows a code either side for rounding
+	 * in the encoding.
+	 */
+	[[nodiscard]] float decodeNearest(const uint32 code) const
+	{
+		return code >= clearCode ? clearDepth : offset + ((float)code - 1.0f) / scale;
+	}
+
+	/**
+	 * @brief Returns a depth no nearer than any depth which encodes to `code`.
+	 */
+	[[nodiscard]] float decodeFarthest(const uint32 code) const
+	{
+		return code >= clearCode ? clearDepth : offset + ((float)code + 2.0f) / scale;
+	}
+};
+
+/**
+ * @brief Depth buffer in one of several formats, with conservative bounds of its contents.
+ *
+ * Stores the nearest and farthest depth of every 8x8 block of pixels, and the farthest depth of every 64x64 block
+ * above that. Anything whose nearest depth is farther than the farthest depth of a block is hidden within that block,
+ * and anything whose farthest depth is nearer than the nearest depth of a block passes the depth test everywhere in
+ * it. Bounds are always decoded to float depths, whatever the format of the pixels.
+ *
+ * Rows are padded to a multiple of g_depthBlockSize pixels, so a whole block of a row can always be loaded at once.
+ */
+class DepthBuffer
+{
+	/** Pixels of every format, in rows of `m_pitch` pixels. **/
+	std::vector<uint32> m_data;
+	EDepthFormat		m_format = EDepthFormat::Float32;
+	DepthEncoding		m_encoding;
+	float				m_clearDepth = 0.0f;
+
+	int32 m_width = 0;
+	int32 m_height = 0;
+	int32 m_pitch = 0;
+
+	/** Nearest and farthest depth of each 8x8 block. **/
+	std::vector<float> m_blockMins;
+	std::vector<float> m_blockMaxs;
+	/** Farthest depth of each 64x64 block. **/
+	std::vector<float> m_coarseBlockMaxs;
+
+	int32 m_blockCountX = 0;
+	int32 m_blockCountY = 0;
+	int32 m_coarseBlockCountX = 0;
+	int32 m_coarseBlockCountY = 0;
+
+	template <EDepthFormat Format>
+	void updateBlock(int32 blockX, int32 blockY);
+
+	template <EDepthFormat Format>
+	void clearPixels(const recti& rect);
+
+public:
+	/**
+	 * @param clearDepth The depth pixels are cleared to. The fixed point formats decode cleared pixels to it.
+	 */
+	DepthBuffer(int32 width, int32 height, float clearDepth);
+
+	/**
+	 * @brief Resizes the buffer. Its contents are undefined until they are cleared.
+	 */
+	void resize(int32 width, int32 height);
+
+	[[nodiscard]] EDepthFormat getFormat() const { return m_format; }
+
+	/**
+	 * @brief Changes the format of the buffer. Its contents are undefined until they are cleared.
+	 */
+	void setFormat(EDepthFormat format);
+
+	/**
+	 * @brief Clears every pixel within `rect`. Doesn't touch the block bounds.
+	 */
+	void clear(const recti& rect);
+
+	/**
+	 * @brief Sets the bounds of every block to the clear depth. Should be called when the pixels are cleared, or
+	 * when every pixel is about to be cleared before it is next tested.
+	 */
+	void clearBlocks();
+
+	/**
+	 * @brief Recomputes the bounds of every block overlapping `bounds` from the pixels.
+	 */
+	void updateBlocks(const recti& bounds);
+
+	/**
+	 * @brief Returns whether anything within `bounds` with a nearest depth of `nearestDepth` is hidden.
+	 */
+	[[nodiscard]] bool isOccluded(const recti& bounds, float nearestDepth) const;
+
+	/**
+	 * @brief Returns the nearest and farthest depth of the blocks overlapping `bounds` as x and y, ignoring blocks
+	 * nothing has been drawn into. If nothing has been drawn into any of them, x is greater than y.
+	 */
+	[[nodiscard]] vec2f getBounds(const recti& bounds) const;
+
+	/**
+	 * @brief Returns the depth of pixel (x, y), decoded from its code in the fixed point formats.
+	 */
+	[[nodiscard]] float getDepth(int32 x, int32 y) const;
+
+	[[nodiscard]] void* getData() { return m_data.data(); }
+	[[nodiscard]] const void* getData() const { return m_data.data(); }
+
+	/**
+	 * @brief Returns the number of pixels in a single row of the buffer.
+	 */
+	[[nodiscard]] int32 getPitch() const { return m_pitch; }
+	[[nodiscard]] int32 getWidth() const { return m_width; }
+	[[nodiscard]] int32 getHeight() const { return m_height; }
+
+	[[nodiscard]] const DepthEncoding& getEncoding() const { return m_encoding; }
+
+	/**
+	 * @brief Returns the number of bytes a single pixel of the current format occupies.
+	 */
+	[[nodiscard]] int32 getPixelSize() const;
+
+	/**
+	 * @brief Returns the nearest depth of each 8x8 block, in rows of `getBlockCountX()` blocks.
+	 */
+	[[nodiscard]] const float* getBlockMins() const { return m_blockMins.data(); }
+
+	/**
+	 * @brief Returns the farthest depth of each 8x8 block, in rows of `getBlockCountX()` blocks.
+	 */
+	[[nodiscard]] const float* getBlockMaxs() const { return m_blockMaxs.data(); }
+
+	[[nodiscard]] int32 getBlockCountX() const { return m_blockCountX; }
+	[[nodiscard]] int32 getBlockCountY() const { return m_blockCountY; }
+};
@@ -0,0 +1,253 @@
+#include <algorithm>
+#include <cmath>
+
+#include "LineBatch.h"
+
+#include "Math/Clipping.h"
+
+namespace
+{
+	/**
+	 * @brief Returns the signed distance of `position` from each plane of the view frustum. Positions on the inside
+	 * have a positive distance.
+	 */
+	void getFrustumDistances(const vec4f& position, float (&distances)[5])
+	{
+		distances[0] = position.z;
+		distances[1] = position.w + position.x;
+		distances[2] = position.w - position.x;
+		distances[3] = position.w + position.y;
+		distances[4] = position.w - position.y;
+	}
+
+	vec4f lerp(const vec4f& a, const vec4f& b, const float t)
+	{
+		return { a.x + (b.x - a.x) * t, a.y + (b.y - a.y) * t, a.z + (b.z - a.z) * t, a.w + (b.w - a.w) * t };
+	}
+
+	/**
+	 * @brief Blends `source` over `target` by `coverage`, where 256 is fully covered. Every channel is blended,
+	 * alpha included, so a fully covered pixel is exactly the pixel a solid line writes. Red and blue, and alpha and
+	 * green, are each blended together in a single multiply.
+	 */
+	uint32 blendPixel(const uint32 target, const uint32 source, const uint32 coverage)
+	{
+		const uint32 inverse = 256 - coverage;
+		const uint32 redBlue = (((source & 0xFF00FF) * coverage + (target & 0xFF00FF) * inverse) >> 8) & 0xFF00FF;
+		const uint32 alphaGreen = (((source >> 8) & 0xFF00FF) * coverage + ((target >> 8) & 0xFF00FF) * inverse) & 0xFF00FF00;
+		return alphaGreen | redBlue;
+	}
+
+	/**
+	 * @brief Draws a solid line with Bresenham's algorithm. Runs of pixels on the same row are written as a single
+	 * span.
+	 */
+	void drawSolidLine(uint32* pixels, const int32 pitch, int32 x0, int32 y0, int32 x1, int32 y1, const uint32 color)
+	{
+		const int32 deltaX = std::abs(x1 - x0);
+		const int32 deltaY = std::abs(y1 - y0);
+
+		if (deltaX >= deltaY)
+		{
+			if (x0 > x1)
+			{
+				std::swap(x0, x1);
+				std::swap(y0, y1);
+			}
+			const int32 stepY = y1 > y0 ? 1 : -1;
+			int32		error = deltaX / 2;
+			int32		y = y0;
+			int32		spanStart = x0;
+			for (int32 x = x0; x < x1; x++)
+			{
+				error -= deltaY;
+				if (error < 0)
+				{
+					// The line steps to the next row after this pixel, so finish the current span
+					uint32* row = pixels + (size_t)y * pitch;
+					std::fill(row + spanStart, row + x + 1, color);
+					spanStart = x + 1;
+					y += stepY;
+					error += deltaX;
+				}
+			}
+			uint32* row = pixels + (size_t)y * pitch;
+			std::fill(row + spanStart, row + x1 + 1, color);
+			return;
+		}
+
+		// Steep lines cover a single pixel per row
+		if (y0 > y1)
+		{
+			std::swap(x0, x1);
+			std::swap(y0, y1);
+		}
+		const int32 stepX = x1 > x0 ? 1 : -1;
+		int32		error = deltaY / 2;
+		int32		x = x0;
+		for (int32 y = y0; y <= y1; y++)
+		{
+			pixels[(size_t)y * pitch + x] = color;
+			error -= deltaX;
+			if (error < 0)
+			{
+				x += stepX;
+				error += deltaY;
+			}
+		}
+	}
+
+	/**
+	 * @brief Draws an anti-aliased line with Xiaolin Wu's algorithm, splitting each step of the line between the two
+	 * pixels nearest to it.
+	 */
+	void drawSmoothLine(uint32* pixels, const int32 width, const int32 height, vec2f a, vec2f b, const uint32 color)
+	{
+		// Step along the major axis, plotting transposed pixels for steep lines
+		const bool steep = std::abs(b.y - a.y) > std::abs(b.x - a.x);
+		if (steep)
+		{
+			std::swap(a.x, a.y);
+			std::swap(b.x, b.y);
+		}
+		if (a.x > b.x)
+		{
+			std::swap(a, b);
+		}
+
+		const int32 pitch = width;
+		const int32 minorSize = steep ? width : height;
+		const auto	plot = [&](const int32 major, const int32 minor, const float coverage)
+		{
+			// Each step touches the row after the line, which may be past the edge of the target
+			if ((uint32)minor >= (uint32)minorSize)
+			{
+				return;
+			}
+			uint32& pixel = steep ? pixels[(size_t)major * pitch + minor] : pixels[(size_t)minor * pitch + major];
+			pixel = blendPixel(pixel, color, (uint32)(coverage * 256.0f));
+		};
+
+		const float deltaX = b.x - a.x;
+		const float gradient = deltaX > 0.0f ? (b.y - a.y) / deltaX : 0.0f;
+		const int32 first = (int32)std::round(a.x);
+		const int32 last = (int32)std::round(b.x);
+		float		minor = a.y + gradient * ((float)first - a.x);
+		for (int32 major = first; major <= last; major++, minor += gradient)
+		{
+			const float floorMinor = std::floor(minor);
+			const float fraction = minor - floorMinor;
+			plot(major, (int32)floorMinor, 1.0f - fraction);
+			plot(major, (int32)floorMinor + 1, fraction);
+		}
+	}
+} // namespace
+
+void LineBatch::begin(const int32 width, const int32 height)
+{
+	m_lines.clear();
+	m_width = width;
+	m_height = height;
+}
+
+void LineBatch::addClipLine(const vec4f& a, const vec4f& b, const Color& color)
+{
+	// Liang-Barsky: trim the parametric range of the line by each plane it crosses
+	float distancesA[5];
+	float distancesB[5];
+	getFrustumDistances(a, distancesA);
+	getFrustumDistances(b, distancesB);
+
+	float start = 0.0f;
+	float end = 1.0f;
+	for (int32 plane = 0; plane < 5; plane++)
+	{
+		const float distanceA = distancesA[plane];
+		const float distanceB = distancesB[plane];
+		if (distanceA < 0.0f && distanceB < 0.0f)
+		{
+			return;
+		}
+		if (distanceA < 0.0f)
+		{
+			start = std::max(start, distanceA / (distanceA - distanceB));
+		}
+		else if (distanceB < 0.0f)
+		{
+			end = std::min(end, distanceA / (distanceA - distanceB));
+		}
+	}
+	if (start > end)
+	{
+		return;
+	}
+
+	const vec3f screenA = Clipping::clipVertex(lerp(a, b, start), m_width, m_height);
+	const vec3f screenB = Clipping::clipVertex(lerp(a, b, end), m_width, m_height);
+	addScreenLine(vec2f(screenA.x, screenA.y), vec2f(screenB.x, screenB.y), color);
+}
+
+void LineBatch::addScreenLine(const vec2f& a, const vec2f& b, const Color& color)
+{
+	if (!std::isfinite(a.x) || !std::isfinite(a.y) || !std::isfinite(b.x) || !std::isfinite(b.y))
+	{
+		return;
+	}
+
+	// Liang-Barsky against the pixel centers of the target, so every point on the clipped line rounds to a pixel
+	// within it
+	const float deltaX = b.x - a.x;
+	const float deltaY = b.y - a.y;
+	const float directions[4] = { -deltaX, deltaX, -deltaY, deltaY };
+	const float distances[4] = { a.x, (float)(m_width - 1) - a.x, a.y, (float)(m_height - 1) - a.y };
+
+	float start = 0.0f;
+	float end = 1.0f;
+	for (int32 edge = 0; edge < 4; edge++)
+	{
+		if (directions[edge] == 0.0f)
+		{
+			if (distances[edge] < 0.0f)
+			{
+				return;
+			}
+			continue;
+		}
+
+		const float t = distances[edge] / directions[edge];
+		if (directions[edge] < 0.0f)
+		{
+			start = std::max(start, t);
+		}
+		else
+		{
+			end = std::min(end, t);
+		}
+	}
+	if (start > end)
+	{
+		return;
+	}
+
+	m_lines.push_back({ vec2f(a.x + deltaX * start, a.y + deltaY * start), vec2f(a.x + deltaX * end, a.y + deltaY * end),
+		(uint32)color.toInt32() });
+}
+
+void LineBatch::draw(Texture* target, const bool antiAliased) const
+{
+	uint32*		pixels = target->getData<uint32>();
+	const int32 pitch = target->getWidth();
+
+	for (const ScreenLine& line : m_lines)
+	{
+		if (antiAliased)
+		{
+			drawSmoothLine(pixels, pitch, target->getHeight(), line.a, line.b, line.color);
+		}
+		else
+		{
+			drawSolidLine(pixels, pitch, (int32)std::lround(line.a.x), (int32)std::lround(line.a.y), (int32)std::lround(line.b.x),
+				(int32)std::lround(line.b.y), line.color);
+		}
+	}
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <vector>
+
+#include "Core/Types.h"
+#include "Math/Color.h"
+#include "Math/Vector.h"
+#include "Renderer/Texture.h"
+
+/** A line segment on the screen, already clipped to the render target. **/
+struct ScreenLine
+{
+	vec2f  a;
+	vec2f  b;
+	uint32 color;
+};
+
+/**
+ * Collects line segments and draws them straight into a render target. Segments are clipped as they are added, so
+ * drawing never tests pixels against the bounds of the target. The batch keeps its memory when it is cleared, so
+ * drawing lines every frame doesn't allocate once it has grown to its working size.
+ */
+class LineBatch
+{
+	std::vector<ScreenLine> m_lines;
+	int32					m_width = 0;
+	int32					m_height = 0;
+
+public:
+	LineBatch() = default;
+
+	/**
+	 * @brief Removes every line and sets the size of the render target subsequent lines are clipped to.
+	 */
+	void begin(int32 width, int32 height);
+
+	/**
+	 * @brief Adds a line between two positions in homogeneous clip space. The line is clipped against the near plane
+	 * and the edges of the view frustum before it is projected, so lines passing behind the camera are drawn correctly.
+	 */
+	void addClipLine(const vec4f& a, const vec4f& b, const Color& color);
+
+	/**
+	 * @brief Adds a line between two screen positions, clipped to the render target.
+	 */
+	void addScreenLine(const vec2f& a, const vec2f& b, const Color& color);
+
+	/**
+	 * @brief Draws every line in the batch into `target`, which must be the size passed to `begin`.
+	 * @param antiAliased Whether to blend the lines into the target with Xiaolin Wu's algorithm, rather than writing
+	 * solid pixels.
+	 */
+	void draw(Texture* target, bool antiAliased) const;
+
+	[[nodiscard]] const std::vector<ScreenLine>& getLines() const
+	{
+		return m_lines;
+	}
+
+	[[nodiscard]] int32 getLineCount() const
+	{
+		return (int32)m_lines.size();
+	}
+};
@@ -1,11 +1,54 @@
 #pragma once
 
+#include <span>
+#include <vector>
+
 #include "Core/Types.h"
 #include "Engine/Object.h"
+#include "Engine/Actors/Camera.h"
 #include "Renderer/Grid.h"
+#include "Renderer/Light.h"
 #include "Renderer/Settings.h"
 #include <Renderer/Texture.h>
 
+/**
+ * Everything a frame reads from one renderable and its mesh, captured so the frame never touches the mesh itself.
+ */
+struct MeshSnapshot
+{
+	/** World matrix of the renderable. **/
+	mat4f worldMatrix;
+	/**
+	 * Vertex and index data of the level of detail chosen for the frame. The data itself is referenced rather than
+	 * copied, so a mesh must not be rebuilt while a frame captured from it is drawing.
+	 **/
+	std::span<const float>	vertices;
+	std::span<const uint32> indexes;
+	/** Object-space bounds of the mesh. **/
+	boxf	bounds;
+	spheref boundingSphere;
+	/** Version of the mesh's buffers the data was taken from. **/
+	uint32 version = 0;
+};
+
+/**
+ * Copy of the scene state an RHI reads while drawing a frame. Snapshots are captured on the thread which updates the
+ * scene, so a frame can be drawn on another thread while the next one is being simulated.
+ */
+struct FrameSnapshot
+{
+	ViewData viewData;
+	RenderSettings settings;
+	/** Each renderable added to the RHI and its mesh, in the order they were added. **/
+	std::vector<MeshSnapshot> meshes;
+	/** Renderables in the scene which intersect the view frustum, queried while the scene could not change. **/
+	std::vector<IRenderable*> visibleRenderables;
+	/** Copy of every light added to the RHI. **/
+	std::vector<Light> lights;
+	/** Incremented for each snapshot captured. **/
+	uint64 frameIndex = 0;
+};
+
 class IRHI
 {
 public:
@@ -36,6 +79,26 @@ public:
 
 	virtual void addRenderable(IRenderable* renderable) = 0;
 	virtual void addTexture(Texture* texture) = 0;
+	/**
+	 * @brief Adds a light to the scene. It is read every frame until the RHI is destroyed, so it can be moved
+	 * freely. RHIs which don't support local lights ignore it.
+	 */
+	virtual void addLight(Light*) {}
+
+	/** Frame snapshots **/
+
+	/**
+	 * @brief Copies the meshes, visible renderables and lights of the scene into `snapshot`. `snapshot`'s view data and
+	 * settings must already be set. Called on the thread which updates the scene, and may run while another frame is
+	 * drawing.
+	 */
+	virtual void captureFrame([[maybe_unused]] FrameSnapshot& snapshot) const {}
+
+	/**
+	 * @brief Draws subsequent frames from `snapshot` rather than from the live scene. Passing nullptr reads the live
+	 * scene again. The snapshot must outlive every frame drawn from it.
+	 */
+	virtual void setFrameSnapshot([[maybe_unused]] const FrameSnapshot* snapshot) {}
 };
 
 class ScanlineRHI;
@@ -0,0 +1,1284 @@
+#include <atomic>
+#include <bit>
+#include <cmath>
+#include <limits>
+#include <random>
+
+#include "Rasterizer.h"
+
+#include "Core/Logging.h"
+#include "Core/Macros.h"
+#include "Engine/Timer.h"
+#include "Platforms/Generic/CpuFeatures.h"
+
+#ifdef PENG_X86
+	#include <immintrin.h>
+#endif
+
+RasterTriangle::RasterTriangle(const vec3f& s0, const vec3f& s1, const vec3f& s2, const recti& bounds, const float padding)
+{
+	// Edge N is opposite vertex N, matching the order the edge functions were previously evaluated in
+	const vec3f* origins[3] = { &s1, &s2, &s0 };
+	const vec3f* targets[3] = { &s2, &s0, &s1 };
+	for (int32 i = 0; i < 3; i++)
+	{
+		edgeDx[i] = targets[i]->x - origins[i]->x;
+		edgeDy[i] = targets[i]->y - origins[i]->y;
+		originX[i] = origins[i]->x;
+		originY[i] = origins[i]->y;
+	}
+
+	depth[0] = -s0.z;
+	depth[1] = -s1.z;
+	depth[2] = -s2.z;
+
+	// Pre-compute the area of the screen triangle so we're not computing it every pixel
+	const float area = Math::area2D(s0, s1, s2) * 2.0f;
+	oneOverArea = 1.0f / area;
+
+	// Compute the bounds of just this triangle on the screen, clipped to the region being drawn
+	const rectf triangleBounds = rectf::makeBoundingBox(s0, s1, s2);
+	const vec2f boundsMin = triangleBounds.min();
+	const vec2f boundsMax = triangleBounds.max();
+	minX = std::max(static_cast<int32>(boundsMin.x - padding), bounds.x);
+	maxX = std::min(static_cast<int32>(boundsMax.x + padding), bounds.x + bounds.width - 1);
+	minY = std::max(static_cast<int32>(boundsMin.y - padding), bounds.y);
+	maxY = std::min(static_cast<int32>(boundsMax.y + padding), bounds.y + bounds.height - 1);
+
+	// The interpolated depth of a pixel is a weighted sum of the vertex depths. The weights only sum to one up to the
+	// rounding error of the edge functions, which grows with the distance from each edge's origin, and of the area,
+	// which is computed from absolute screen positions. Bound both over the triangle's bounds and lower the nearest
+	// depth by the result so block rejection never discards a pixel the depth test would have kept, and raise the
+	// farthest depth by the same amount so the depth test is only skipped where every pixel would have passed it.
+	constexpr float rounding = 4.0f * std::numeric_limits<float>::epsilon();
+	float			edgeError = 0.0f;
+	for (int32 i = 0; i < 3; i++)
+	{
+		const float rowDistance = std::max(std::abs((float)minY - originY[i]), std::abs((float)maxY - originY[i]));
+		const float columnDistance = std::max(std::abs((float)minX - originX[i]), std::abs((float)maxX - originX[i]));
+		edgeError += rounding * (std::abs(edgeDx[i]) * rowDistance + std::abs(edgeDy[i]) * columnDistance);
+	}
+	const float areaError = rounding
+		* (std::abs(s0.x * (s1.y - s2.y)) + std::abs(s1.x * (s2.y - s0.y)) + std::abs(s2.x * (s0.y - s1.y)));
+	const float weightError = (edgeError + areaError) * std::abs(oneOverArea) + rounding;
+	const float nearest = std::min({ s0.z, s1.z, s2.z });
+	const float farthest = std::max({ std::abs(s0.z), std::abs(s1.z), std::abs(s2.z) });
+	nearestDepth = nearest - std::abs(nearest) * weightError - farthest * rounding * (1.0f + weightError);
+	const float farthestVertex = std::max({ s0.z, s1.z, s2.z });
+	farthestDepth = farthestVertex + std::abs(farthestVertex) * weightError + farthest * rounding * (1.0f + weightError);
+}
+
+namespace
+{
+	/** Appends every pixel which passes to a fragment buffer. **/
+	struct FragmentOutput
+	{
+		std::vector<RasterFragment>& fragments;
+
+		void emit(const int32 x, const int32 y, const vec3f& bary, const float z, const uint8 coverage = g_fullCoverage) const
+		{
+			fragments.push_back({ x, y, bary, z, coverage });
+		}
+	};
+
+	/** Writes the triangle ID of every pixel which passes to a visibility buffer. **/
+	struct VisibilityOutput
+	{
+		uint32* visibilityBuffer;
+		int32	pitch;
+		uint32	id;
+
+		uint32* getRow(const int32 y) const { return visibilityBuffer + (size_t)y * pitch; }
+
+		void emit(const int32 x, const int32 y, const vec3f&, float) const { getRow(y)[x] = id; }
+	};
+
+	template <typename Output> using RasterKernelFunction = int32 (*)(const RasterTriangle&, const RasterDepth&, const Output&);
+
+	/**
+	 * @brief Returns the farthest depth of each 8x8 block in row `y`, or nullptr if block rejection is disabled.
+	 */
+	inline const float* getBlockRow(const RasterDepth& target, const int32 y)
+	{
+		return target.blockMaxs ? target.blockMaxs + (size_t)(y / g_depthBlockSize) * target.blockPitch : nullptr;
+	}
+
+	/**
+	 * @brief Returns the nearest depth of each 8x8 block in row `y`, or nullptr if block bounds are disabled.
+	 */
+	inline const float* getBlockMinRow(const RasterDepth& target, const int32 y)
+	{
+		return target.blockMins ? target.blockMins + (size_t)(y / g_depthBlockSize) * target.blockPitch : nullptr;
+	}
+
+	/**
+	 * @brief Returns whether the triangle is hidden behind everything already drawn in the block containing pixel `x`.
+	 */
+	inline bool isBlockHidden(const RasterTriangle& triangle, const float* blockRow, const int32 x)
+	{
+		return blockRow && blockRow[x / g_depthBlockSize] < triangle.nearestDepth;
+	}
+
+	/**
+	 * @brief Returns whether the triangle is in front of everything already drawn in the block containing pixel `x`,
+	 * so every pixel it covers there passes the depth test.
+	 */
+	inline bool isBlockVisible(const RasterTriangle& triangle, const float* blockMinRow, const int32 x)
+	{
+		return blockMinRow && triangle.farthestDepth < blockMinRow[x / g_depthBlockSize];
+	}
+
+	/**
+	 * @brief Converts a depth to the format it is stored in.
+	 */
+	template <EDepthFormat Format>
+	DepthStorage<Format> encodeDepth(const float z, const DepthEncoding& encoding)
+	{
+		if constexpr (Format == EDepthFormat::Float32)
+		{
+			return z;
+		}
+		else
+		{
+			return (DepthStorage<Format>)encoding.encode(z);
+		}
+	}
+
+	/**
+	 * @brief Tests a depth against a single pixel of the depth buffer, storing it if it passes.
+	 */
+	template <EDepthFormat Format>
+	bool testDepth(DepthStorage<Format>& stored, const float z, const DepthEncoding& encoding)
+	{
+		const DepthStorage<Format> value = encodeDepth<Format>(z, encoding);
+		if (value > stored)
+		{
+			return false;
+		}
+		stored = value;
+		return true;
+	}
+
+#ifdef PENG_X86
+	/**
+	 * The constants of a depth encoding, broadcast to every lane. Depths are encoded with the same operations as
+	 * `DepthEncoding::encode`, so every kernel produces the same codes.
+	 **/
+	struct DepthEncodingSSE
+	{
+		__m128 offset;
+		__m128 scale;
+		__m128 maxCode;
+
+		explicit DepthEncodingSSE(const DepthEncoding& encoding)
+			: offset(_mm_set1_ps(encoding.offset)), scale(_mm_set1_ps(encoding.scale)), maxCode(_mm_set1_ps(encoding.getMaxCode()))
+		{}
+	};
+
+	/**
+	 * @brief Converts four depths to the format they are stored in. Codes are returned in the bits of each lane.
+	 */
+	template <EDepthFormat Format>
+	__m128 encodeDepthSSE(const __m128 z, const DepthEncodingSSE& encoding)
+	{
+		if constexpr (Format == EDepthFormat::Float32)
+		{
+			return z;
+		}
+		else
+		{
+			const __m128 code = _mm_min_ps(_mm_max_ps(_mm_mul_ps(_mm_sub_ps(z, encoding.offset), encoding.scale), _mm_setzero_ps()),
+				encoding.maxCode);
+			return _mm_castsi128_ps(_mm_cvttps_epi32(code));
+		}
+	}
+
+	/**
+	 * @brief Loads four pixels of the depth buffer, widening 16-bit codes to a lane each.
+	 */
+	template <EDepthFormat Format>
+	__m128 loadDepthSSE(const DepthStorage<Format>* stored)
+	{
+		if constexpr (Format == EDepthFormat::Fixed16)
+		{
+			return _mm_castsi128_ps(_mm_unpacklo_epi16(_mm_loadl_epi64((const __m128i*)stored), _mm_setzero_si128()));
+		}
+		else
+		{
+			return _mm_loadu_ps((const float*)stored);
+		}
+	}
+
+	/**
+	 * @brief Returns the lanes of `value` which are farther than `old`, both in the format of the depth buffer.
+	 */
+	template <EDepthFormat Format>
+	__m128 compareDepthSSE(const __m128 value, const __m128 old)
+	{
+		if constexpr (Format == EDepthFormat::Float32)
+		{
+			return _mm_cmpgt_ps(value, old);
+		}
+		else
+		{
+			// Codes are never larger than 24 bits, so a signed compare is exact
+			return _mm_castsi128_ps(_mm_cmpgt_epi32(_mm_castps_si128(value), _mm_castps_si128(old)));
+		}
+	}
+
+	/**
+	 * @brief Stores four pixels of the depth buffer, narrowing 16-bit codes back to their own width.
+	 */
+	template <EDepthFormat Format>
+	void storeDepthSSE(DepthStorage<Format>* stored, const __m128 value)
+	{
+		if constexpr (Format == EDepthFormat::Fixed16)
+		{
+			// SSE2 can only pack with signed saturation, so shift the codes into the signed range and back again
+			const __m128i biased = _mm_sub_epi32(_mm_castps_si128(value), _mm_set1_epi32(0x8000));
+			const __m128i packed = _mm_xor_si128(_mm_packs_epi32(biased, biased), _mm_set1_epi16((int16)0x8000));
+			_mm_storel_epi64((__m128i*)stored, packed);
+		}
+		else
+		{
+			_mm_storeu_ps((float*)stored, value);
+		}
+	}
+
+	/** The AVX2 counterpart of DepthEncodingSSE. **/
+	struct DepthEncodingAVX2
+	{
+		__m256 offset;
+		__m256 scale;
+		__m256 maxCode;
+
+		TARGET_AVX2 explicit DepthEncodingAVX2(const DepthEncoding& encoding)
+			: offset(_mm256_set1_ps(encoding.offset)), scale(_mm256_set1_ps(encoding.scale)),
+			  maxCode(_mm256_set1_ps(encoding.getMaxCode()))
+		{}
+	};
+
+	template <EDepthFormat Format>
+	TARGET_AVX2 __m256 encodeDepthAVX2(const __m256 z, const DepthEncodingAVX2& encoding)
+	{
+		if constexpr (Format == EDepthFormat::Float32)
+		{
+			return z;
+		}
+		else
+		{
+			const __m256 code = _mm256_min_ps(
+				_mm256_max_ps(_mm256_mul_ps(_mm256_sub_ps(z, encoding.offset), encoding.scale), _mm256_setzero_ps()), encoding.maxCode);
+			return _mm256_castsi256_ps(_mm256_cvttps_epi32(code));
+		}
+	}
+
+	/**
+	 * @brief Loads eight pixels of the depth buffer. Lanes outside `mask` aren't read, except by 16-bit formats,
+	 * which always read the whole block of the row.
+	 */
+	template <EDepthFormat Format>
+	TARGET_AVX2 __m256 loadDepthAVX2(const DepthStorage<Format>* stored, const __m256 mask)
+	{
+		if constexpr (Format == EDepthFormat::Fixed16)
+		{
+			return _mm256_castsi256_ps(_mm256_cvtepu16_epi32(_mm_loadu_si128((const __m128i*)stored)));
+		}
+		else
+		{
+			return _mm256_maskload_ps((const float*)stored, _mm256_castps_si256(mask));
+		}
+	}
+
+	template <EDepthFormat Format>
+	TARGET_AVX2 __m256 compareDepthAVX2(const __m256 value, const __m256 old)
+	{
+		if constexpr (Format == EDepthFormat::Float32)
+		{
+			return _mm256_cmp_ps(value, old, _CMP_GT_OQ);
+		}
+		else
+		{
+			return _mm256_castsi256_ps(_mm256_cmpgt_epi32(_mm256_castps_si256(value), _mm256_castps_si256(old)));
+		}
+	}
+
+	/**
+	 * @brief Stores the lanes of `value` within `mask` to the depth buffer. There is no masked 16-bit store, so
+	 * 16-bit formats rewrite the whole block of the row, which is safe as each block belongs to a single tile.
+	 */
+	template <EDepthFormat Format>
+	TARGET_AVX2 void storeDepthAVX2(DepthStorage<Format>* stored, const __m256 value, const __m256 mask)
+	{
+		if constexpr (Format == EDepthFormat::Fixed16)
+		{
+			const __m256  blended = _mm256_blendv_ps(loadDepthAVX2<Format>(stored, mask), value, mask);
+			const __m256i packed = _mm256_packus_epi32(_mm256_castps_si256(blended), _mm256_castps_si256(blended));
+			_mm_storeu_si128((__m128i*)stored, _mm256_castsi256_si128(_mm256_permute4x64_epi64(packed, _MM_SHUFFLE(3, 1, 2, 0))));
+		}
+		else
+		{
+			_mm256_maskstore_ps((float*)stored, _mm256_castps_si256(mask), value);
+		}
+	}
+#endif
+
+	/**
+	 * @brief Tests a single pixel against the triangle, emitting it if it is covered and passes the depth test.
+	 * @param rowTerms The part of each edge function which only depends on the current row.
+	 * @param depthRow The current row of the depth buffer. Unused if DepthTest is false.
+	 * @return Whether the pixel was emitted.
+	 */
+	template <typename Output, bool DepthTest, EDepthFormat Format>
+	bool rasterizePixel(const RasterTriangle& triangle, const int32 x, const int32 y, const float* rowTerms,
+		DepthStorage<Format>* depthRow, const DepthEncoding& encoding, const Output& output)
+	{
+		const float w0 = triangle.getEdge(0, x, rowTerms[0]);
+		const float w1 = triangle.getEdge(1, x, rowTerms[1]);
+		const float w2 = triangle.getEdge(2, x, rowTerms[2]);
+		if (w0 > 0.0f || w1 > 0.0f || w2 > 0.0f)
+		{
+			return false;
+		}
+
+		// From the edge vectors, extrapolate the barycentric coordinates for this pixel.
+		const vec3f bary(w0 * triangle.oneOverArea, w1 * triangle.oneOverArea, w2 * triangle.oneOverArea);
+
+		float z = 0.0f;
+		if constexpr (DepthTest)
+		{
+			z = triangle.getDepth(bary);
+			if (!testDepth<Format>(depthRow[x], z, encoding))
+			{
+				return false;
+			}
+		}
+
+		output.emit(x, y, bary, z);
+		return true;
+	}
+
+	/**
+	 * @brief Computes the part of each edge function which only depends on the row `y`.
+	 */
+	inline void computeRowTerms(const RasterTriangle& triangle, const int32 y, float* rowTerms)
+	{
+		for (int32 i = 0; i < 3; i++)
+		{
+			rowTerms[i] = triangle.getRowTerm(i, y);
+		}
+	}
+
+	/**
+	 * @brief Returns row `y` of the depth buffer, or nullptr if depth testing is disabled.
+	 */
+	template <bool DepthTest, EDepthFormat Format>
+	DepthStorage<Format>* getDepthRow(const RasterDepth& target, const int32 y)
+	{
+		if constexpr (DepthTest)
+		{
+			return (DepthStorage<Format>*)target.buffer + (size_t)y * target.pitch;
+		}
+		return nullptr;
+	}
+
+	template <typename Output, bool DepthTest, EDepthFormat Format>
+	int32 rasterizeScalar(const RasterTriangle& triangle, const RasterDepth& target, const Output& output)
+	{
+		int32 pixelCount = 0;
+		float rowTerms[3];
+		for (int32 y = triangle.minY; y <= triangle.maxY; y++)
+		{
+			computeRowTerms(triangle, y, rowTerms);
+			DepthStorage<Format>* depthRow = getDepthRow<DepthTest, Format>(target, y);
+			const float*		  blockRow = DepthTest ? getBlockRow(target, y) : nullptr;
+			for (int32 x = triangle.minX; x <= triangle.maxX; x++)
+			{
+				if (isBlockHidden(triangle, blockRow, x))
+				{
+					// Skip to the last pixel of this block
+					x |= g_depthBlockSize - 1;
+					continue;
+				}
+				pixelCount += rasterizePixel<Output, DepthTest, Format>(triangle, x, y, rowTerms, depthRow, target.encoding, output);
+			}
+		}
+		return pixelCount;
+	}
+
+#ifdef PENG_X86
+	/**
+	 * @brief Rasterizes four pixels per instruction. SSE2 is part of x86 and x64, so this kernel is always available
+	 * on them.
+	 */
+	template <typename Output, bool DepthTest, EDepthFormat Format>
+	int32 rasterizeSSE(const RasterTriangle& triangle, const RasterDepth& target, const Output& output)
+	{
+		constexpr int32 laneCount = 4;
+
+		const __m128 zero = _mm_setzero_ps();
+		const __m128 laneStep = _mm_set1_ps((float)laneCount);
+		const __m128 laneOffsets = _mm_setr_ps(0.0f, 1.0f, 2.0f, 3.0f);
+		const __m128 firstX = _mm_set1_ps((float)triangle.minX);
+		const __m128 oneOverArea = _mm_set1_ps(triangle.oneOverArea);
+		const DepthEncodingSSE encoding(target.encoding);
+
+		__m128 edgeDy[3];
+		__m128 originX[3];
+		__m128 depth[3];
+		for (int32 i = 0; i < 3; i++)
+		{
+			edgeDy[i] = _mm_set1_ps(triangle.edgeDy[i]);
+			originX[i] = _mm_set1_ps(triangle.originX[i]);
+			depth[i] = _mm_set1_ps(triangle.depth[i]);
+		}
+
+		// Start each row on a multiple of the lane count so that each block of lanes lies within a single 8x8 depth
+		// block. Lanes before the first pixel are masked off below.
+		const int32 startX = triangle.minX & ~(laneCount - 1);
+
+		alignas(16) float baryLanes[3][laneCount];
+		alignas(16) float depthLanes[laneCount];
+		float			  rowTerms[3];
+		int32			  pixelCount = 0;
+
+		for (int32 y = triangle.minY; y <= triangle.maxY; y++)
+		{
+			computeRowTerms(triangle, y, rowTerms);
+			const __m128 row0 = _mm_set1_ps(rowTerms[0]);
+			const __m128 row1 = _mm_set1_ps(rowTerms[1]);
+			const __m128		  row2 = _mm_set1_ps(rowTerms[2]);
+			DepthStorage<Format>* depthRow = getDepthRow<DepthTest, Format>(target, y);
+			const float*		  blockRow = DepthTest ? getBlockRow(target, y) : nullptr;
+
+			// Step across the row a block of pixels at a time. Pixel coordinates are whole numbers, so stepping
+			// them incrementally is exact.
+			int32  x = startX;
+			__m128 px = _mm_add_ps(_mm_set1_ps((float)x), laneOffsets);
+			for (; x + laneCount - 1 <= triangle.maxX; x += laneCount, px = _mm_add_ps(px, laneStep))
+			{
+				if (isBlockHidden(triangle, blockRow, x))
+				{
+					continue;
+				}
+
+				const __m128 w0 = _mm_sub_ps(row0, _mm_mul_ps(edgeDy[0], _mm_sub_ps(px, originX[0])));
+				const __m128 w1 = _mm_sub_ps(row1, _mm_mul_ps(edgeDy[1], _mm_sub_ps(px, originX[1])));
+				const __m128 w2 = _mm_sub_ps(row2, _mm_mul_ps(edgeDy[2], _mm_sub_ps(px, originX[2])));
+
+				__m128 rejected = _mm_or_ps(_mm_or_ps(_mm_cmpgt_ps(w0, zero), _mm_cmpgt_ps(w1, zero)),
+					_mm_or_ps(_mm_cmpgt_ps(w2, zero), _mm_cmplt_ps(px, firstX)));
+				if (_mm_movemask_ps(rejected) == 0xF)
+				{
+					continue;
+				}
+
+				const __m128 bary0 = _mm_mul_ps(w0, oneOverArea);
+				const __m128 bary1 = _mm_mul_ps(w1, oneOverArea);
+				const __m128 bary2 = _mm_mul_ps(w2, oneOverArea);
+
+				__m128 z = zero;
+				if constexpr (DepthTest)
+				{
+					z = _mm_add_ps(_mm_add_ps(_mm_mul_ps(bary0, depth[0]), _mm_mul_ps(bary1, depth[1])), _mm_mul_ps(bary2, depth[2]));
+
+					// Only write depth for the pixels which are covered and closer than the current depth
+					const __m128 newZ = encodeDepthSSE<Format>(z, encoding);
+					const __m128 oldZ = loadDepthSSE<Format>(depthRow + x);
+					rejected = _mm_or_ps(rejected, compareDepthSSE<Format>(newZ, oldZ));
+					storeDepthSSE<Format>(depthRow + x, _mm_or_ps(_mm_and_ps(rejected, oldZ), _mm_andnot_ps(rejected, newZ)));
+				}
+
+				uint32 mask = ~(uint32)_mm_movemask_ps(rejected) & 0xF;
+				if (mask == 0)
+				{
+					continue;
+				}
+				pixelCount += std::popcount(mask);
+
+				if constexpr (std::is_same_v<Output, VisibilityOutput>)
+				{
+					// Write the triangle ID to every passing pixel in one go
+					float*		 idRow = (float*)(output.getRow(y) + x);
+					const __m128 ids = _mm_castsi128_ps(_mm_set1_epi32((int32)output.id));
+					const __m128 oldIds = _mm_loadu_ps(idRow);
+					_mm_storeu_ps(idRow, _mm_or_ps(_mm_and_ps(rejected, oldIds), _mm_andnot_ps(rejected, ids)));
+				}
+				else
+				{
+					_mm_store_ps(baryLanes[0], bary0);
+					_mm_store_ps(baryLanes[1], bary1);
+					_mm_store_ps(baryLanes[2], bary2);
+					_mm_store_ps(depthLanes, z);
+					while (mask)
+					{
+						const int32 lane = std::countr_zero(mask);
+						mask &= mask - 1;
+						output.emit(x + lane, y, vec3f(baryLanes[0][lane], baryLanes[1][lane], baryLanes[2][lane]), depthLanes[lane]);
+					}
+				}
+			}
+
+			// Finish the remainder of the row one pixel at a time
+			for (x = std::max(x, triangle.minX); x <= triangle.maxX; x++)
+			{
+				if (!isBlockHidden(triangle, blockRow, x))
+				{
+					pixelCount += rasterizePixel<Output, DepthTest, Format>(triangle, x, y, rowTerms, depthRow, target.encoding, output);
+				}
+			}
+		}
+		return pixelCount;
+	}
+
+	/**
+	 * @brief Rasterizes eight pixels per instruction. Only called when the CPU supports AVX2.
+	 *
+	 * Each block of eight lanes lines up with a single 8x8 depth block. The ends of each row are handled with masked
+	 * loads and stores rather than falling back to the scalar path, which would mix SSE and AVX instructions inside
+	 * the loop. Blocks the triangle is entirely in front of are written without loading their depth first.
+	 */
+	template <typename Output, bool DepthTest, EDepthFormat Format>
+	TARGET_AVX2 int32 rasterizeAVX2(const RasterTriangle& triangle, const RasterDepth& target, const Output& output)
+	{
+		constexpr int32 laneCount = 8;
+		static_assert(laneCount == g_depthBlockSize);
+
+		const __m256 zero = _mm256_setzero_ps();
+		const __m256 allLanes = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+		const __m256 laneStep = _mm256_set1_ps((float)laneCount);
+		const __m256 laneOffsets = _mm256_setr_ps(0.0f, 1.0f, 2.0f, 3.0f, 4.0f, 5.0f, 6.0f, 7.0f);
+		const __m256 firstX = _mm256_set1_ps((float)triangle.minX);
+		const __m256 lastX = _mm256_set1_ps((float)triangle.maxX);
+		const __m256 oneOverArea = _mm256_set1_ps(triangle.oneOverArea);
+		const DepthEncodingAVX2 encoding(target.encoding);
+
+		__m256 edgeDy[3];
+		__m256 originX[3];
+		__m256 depth[3];
+		for (int32 i = 0; i < 3; i++)
+		{
+			edgeDy[i] = _mm256_set1_ps(triangle.edgeDy[i]);
+			originX[i] = _mm256_set1_ps(triangle.originX[i]);
+			depth[i] = _mm256_set1_ps(triangle.depth[i]);
+		}
+
+		const int32 startX = triangle.minX & ~(laneCount - 1);
+
+		alignas(32) float baryLanes[3][laneCount];
+		alignas(32) float depthLanes[laneCount];
+		float			  rowTerms[3];
+		int32			  pixelCount = 0;
+
+		for (int32 y = triangle.minY; y <= triangle.maxY; y++)
+		{
+			computeRowTerms(triangle, y, rowTerms);
+			const __m256 row0 = _mm256_set1_ps(rowTerms[0]);
+			const __m256 row1 = _mm256_set1_ps(rowTerms[1]);
+			const __m256		  row2 = _mm256_set1_ps(rowTerms[2]);
+			DepthStorage<Format>* depthRow = getDepthRow<DepthTest, Format>(target, y);
+			const float*		  blockRow = DepthTest ? getBlockRow(target, y) : nullptr;
+			const float*		  blockMinRow = DepthTest ? getBlockMinRow(target, y) : nullptr;
+
+			__m256 px = _mm256_add_ps(_mm256_set1_ps((float)startX), laneOffsets);
+			for (int32 x = startX; x <= triangle.maxX; x += laneCount, px = _mm256_add_ps(px, laneStep))
+			{
+				if (isBlockHidden(triangle, blockRow, x))
+				{
+					continue;
+				}
+
+				const __m256 w0 = _mm256_sub_ps(row0, _mm256_mul_ps(edgeDy[0], _mm256_sub_ps(px, originX[0])));
+				const __m256 w1 = _mm256_sub_ps(row1, _mm256_mul_ps(edgeDy[1], _mm256_sub_ps(px, originX[1])));
+				const __m256 w2 = _mm256_sub_ps(row2, _mm256_mul_ps(edgeDy[2], _mm256_sub_ps(px, originX[2])));
+
+				// Lanes outside the triangle's bounds are never covered
+				const __m256 outside = _mm256_or_ps(_mm256_cmp_ps(px, firstX, _CMP_LT_OQ), _mm256_cmp_ps(px, lastX, _CMP_GT_OQ));
+				__m256		 rejected = _mm256_or_ps(_mm256_or_ps(_mm256_cmp_ps(w0, zero, _CMP_GT_OQ), _mm256_cmp_ps(w1, zero, _CMP_GT_OQ)),
+					 _mm256_or_ps(_mm256_cmp_ps(w2, zero, _CMP_GT_OQ), outside));
+				if (_mm256_movemask_ps(rejected) == 0xFF)
+				{
+					continue;
+				}
+
+				const __m256 bary0 = _mm256_mul_ps(w0, oneOverArea);
+				const __m256 bary1 = _mm256_mul_ps(w1, oneOverArea);
+				const __m256 bary2 = _mm256_mul_ps(w2, oneOverArea);
+
+				__m256 z = zero;
+				__m256 newZ = zero;
+				if constexpr (DepthTest)
+				{
+					z = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(bary0, depth[0]), _mm256_mul_ps(bary1, depth[1])),
+						_mm256_mul_ps(bary2, depth[2]));
+					newZ = encodeDepthAVX2<Format>(z, encoding);
+
+					if (!isBlockVisible(triangle, blockMinRow, x))
+					{
+						const __m256 oldZ = loadDepthAVX2<Format>(depthRow + x, _mm256_xor_ps(outside, allLanes));
+						rejected = _mm256_or_ps(rejected, compareDepthAVX2<Format>(newZ, oldZ));
+					}
+				}
+
+				const __m256 accepted = _mm256_xor_ps(rejected, allLanes);
+				uint32		 mask = (uint32)_mm256_movemask_ps(accepted);
+				if (mask == 0)
+				{
+					continue;
+				}
+				pixelCount += std::popcount(mask);
+
+				// Only write the pixels which are covered and closer than the current depth
+				if constexpr (DepthTest)
+				{
+					storeDepthAVX2<Format>(depthRow + x, newZ, accepted);
+				}
+
+				if constexpr (std::is_same_v<Output, VisibilityOutput>)
+				{
+					_mm256_maskstore_epi32((int*)(output.getRow(y) + x), _mm256_castps_si256(accepted), _mm256_set1_epi32((int32)output.id));
+				}
+				else
+				{
+					_mm256_store_ps(baryLanes[0], bary0);
+					_mm256_store_ps(baryLanes[1], bary1);
+					_mm256_store_ps(baryLanes[2], bary2);
+					_mm256_store_ps(depthLanes, z);
+					while (mask)
+					{
+						const int32 lane = std::countr_zero(mask);
+						mask &= mask - 1;
+						output.emit(x + lane, y, vec3f(baryLanes[0][lane], baryLanes[1][lane], baryLanes[2][lane]), depthLanes[lane]);
+					}
+				}
+			}
+		}
+		return pixelCount;
+	}
+
+#endif
+
+	/**
+	 * @brief Computes the offset each sample adds to each edge function, relative to the edge function at the center
+	 * of its pixel.
+	 */
+	inline void computeSampleTerms(const RasterTriangle& triangle, float (&sampleTerms)[3][g_sampleCount])
+	{
+		for (int32 i = 0; i < 3; i++)
+		{
+			for (int32 sample = 0; sample < g_sampleCount; sample++)
+			{
+				sampleTerms[i][sample] = triangle.edgeDx[i] * g_sampleOffsetsY[sample] - triangle.edgeDy[i] * g_sampleOffsetsX[sample];
+			}
+		}
+	}
+
+	/**
+	 * @brief Returns row `y` of the sample depth buffer, or nullptr if depth testing is disabled.
+	 */
+	template <bool DepthTest>
+	float* getSampleRow(const RasterDepth& target, const int32 y)
+	{
+		if constexpr (DepthTest)
+		{
+			return target.samples + (size_t)y * target.pitch * g_sampleCount;
+		}
+		return nullptr;
+	}
+
+	/**
+	 * @brief Emits pixel (x, y) with the barycentric coordinates and depth of its center, which the pixel shader is
+	 * run at regardless of which samples are covered.
+	 */
+	template <bool DepthTest>
+	void emitMultisamplePixel(const RasterTriangle& triangle, const int32 x, const int32 y, const float* rowTerms, const uint8 coverage,
+		const FragmentOutput& output)
+	{
+		const vec3f bary(triangle.getEdge(0, x, rowTerms[0]) * triangle.oneOverArea, triangle.getEdge(1, x, rowTerms[1]) * triangle.oneOverArea,
+			triangle.getEdge(2, x, rowTerms[2]) * triangle.oneOverArea);
+		output.emit(x, y, bary, DepthTest ? triangle.getDepth(bary) : 0.0f, coverage);
+	}
+
+	/**
+	 * @brief Tests every sample of a single pixel against the triangle, emitting the pixel if any sample is covered
+	 * and passes the depth test.
+	 * @return The number of samples written.
+	 */
+	template <bool DepthTest, EDepthFormat Format>
+	int32 rasterizeMultisamplePixel(const RasterTriangle& triangle, const int32 x, const int32 y, const float* rowTerms,
+		const float (&sampleTerms)[3][g_sampleCount], DepthStorage<Format>* depthRow, float* sampleRow, const DepthEncoding& encoding,
+		const FragmentOutput& output)
+	{
+		const float centers[3] = { triangle.getEdge(0, x, rowTerms[0]), triangle.getEdge(1, x, rowTerms[1]),
+			triangle.getEdge(2, x, rowTerms[2]) };
+
+		uint8 coverage = 0;
+		for (int32 sample = 0; sample < g_sampleCount; sample++)
+		{
+			const float w0 = centers[0] + sampleTerms[0][sample];
+			const float w1 = centers[1] + sampleTerms[1][sample];
+			const float w2 = centers[2] + sampleTerms[2][sample];
+			if (w0 > 0.0f || w1 > 0.0f || w2 > 0.0f)
+			{
+				continue;
+			}
+
+			if constexpr (DepthTest)
+			{
+				const float z = w0 * triangle.oneOverArea * triangle.depth[0] + w1 * triangle.oneOverArea * triangle.depth[1]
+					+ w2 * triangle.oneOverArea * triangle.depth[2];
+				float& sampleDepth = sampleRow[x * g_sampleCount + sample];
+				if (z > sampleDepth)
+				{
+					continue;
+				}
+				sampleDepth = z;
+			}
+			coverage |= 1 << sample;
+		}
+		if (coverage == 0)
+		{
+			return 0;
+		}
+
+		if constexpr (DepthTest)
+		{
+			const float* samples = sampleRow + x * g_sampleCount;
+			depthRow[x] = encodeDepth<Format>(std::max({ samples[0], samples[1], samples[2], samples[3] }), encoding);
+		}
+		emitMultisamplePixel<DepthTest>(triangle, x, y, rowTerms, coverage, output);
+		return std::popcount((uint32)coverage);
+	}
+
+	template <bool DepthTest, EDepthFormat Format>
+	int32 rasterizeMultisampleScalar(const RasterTriangle& triangle, const RasterDepth& target, const FragmentOutput& output)
+	{
+		float sampleTerms[3][g_sampleCount];
+		computeSampleTerms(triangle, sampleTerms);
+
+		int32 sampleCount = 0;
+		float rowTerms[3];
+		for (int32 y = triangle.minY; y <= triangle.maxY; y++)
+		{
+			computeRowTerms(triangle, y, rowTerms);
+			DepthStorage<Format>* depthRow = getDepthRow<DepthTest, Format>(target, y);
+			float*				  sampleRow = getSampleRow<DepthTest>(target, y);
+			const float*		  blockRow = DepthTest ? getBlockRow(target, y) : nullptr;
+			for (int32 x = triangle.minX; x <= triangle.maxX; x++)
+			{
+				if (isBlockHidden(triangle, blockRow, x))
+				{
+					x |= g_depthBlockSize - 1;
+					continue;
+				}
+				sampleCount += rasterizeMultisamplePixel<DepthTest, Format>(triangle, x, y, rowTerms, sampleTerms, depthRow, sampleRow,
+					target.encoding, output);
+			}
+		}
+		return sampleCount;
+	}
+
+#ifdef PENG_X86
+	/**
+	 * @brief Rasterizes a pixel per iteration, testing all four of its samples in a single instruction.
+	 */
+	template <bool DepthTest, EDepthFormat Format>
+	int32 rasterizeMultisampleSSE(const RasterTriangle& triangle, const RasterDepth& target, const FragmentOutput& output)
+	{
+		static_assert(g_sampleCount == 4);
+
+		const __m128 zero = _mm_setzero_ps();
+		const __m128 oneOverArea = _mm_set1_ps(triangle.oneOverArea);
+		const __m128 offsetsX = _mm_loadu_ps(g_sampleOffsetsX);
+		const __m128 offsetsY = _mm_loadu_ps(g_sampleOffsetsY);
+
+		__m128 sampleTerms[3];
+		__m128 depth[3];
+		for (int32 i = 0; i < 3; i++)
+		{
+			sampleTerms[i] = _mm_sub_ps(_mm_mul_ps(_mm_set1_ps(triangle.edgeDx[i]), offsetsY), _mm_mul_ps(_mm_set1_ps(triangle.edgeDy[i]), offsetsX));
+			depth[i] = _mm_set1_ps(triangle.depth[i]);
+		}
+
+		float rowTerms[3];
+		int32 sampleCount = 0;
+		for (int32 y = triangle.minY; y <= triangle.maxY; y++)
+		{
+			computeRowTerms(triangle, y, rowTerms);
+			DepthStorage<Format>* depthRow = getDepthRow<DepthTest, Format>(target, y);
+			float*				  sampleRow = getSampleRow<DepthTest>(target, y);
+			const float*		  blockRow = DepthTest ? getBlockRow(target, y) : nullptr;
+			for (int32 x = triangle.minX; x <= triangle.maxX; x++)
+			{
+				if (isBlockHidden(triangle, blockRow, x))
+				{
+					x |= g_depthBlockSize - 1;
+					continue;
+				}
+
+				const __m128 w0 = _mm_add_ps(_mm_set1_ps(triangle.getEdge(0, x, rowTerms[0])), sampleTerms[0]);
+				const __m128 w1 = _mm_add_ps(_mm_set1_ps(triangle.getEdge(1, x, rowTerms[1])), sampleTerms[1]);
+				const __m128 w2 = _mm_add_ps(_mm_set1_ps(triangle.getEdge(2, x, rowTerms[2])), sampleTerms[2]);
+
+				__m128 rejected = _mm_or_ps(_mm_or_ps(_mm_cmpgt_ps(w0, zero), _mm_cmpgt_ps(w1, zero)), _mm_cmpgt_ps(w2, zero));
+				if (_mm_movemask_ps(rejected) == 0xF)
+				{
+					continue;
+				}
+
+				__m128 farthest = zero;
+				if constexpr (DepthTest)
+				{
+					const __m128 z = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_mul_ps(w0, oneOverArea), depth[0]),
+													_mm_mul_ps(_mm_mul_ps(w1, oneOverArea), depth[1])),
+						_mm_mul_ps(_mm_mul_ps(w2, oneOverArea), depth[2]));
+
+					// Only write depth for the samples which are covered and closer than the current depth
+					float*		 samples = sampleRow + x * g_sampleCount;
+					const __m128 oldZ = _mm_loadu_ps(samples);
+					rejected = _mm_or_ps(rejected, _mm_cmpgt_ps(z, oldZ));
+					const __m128 newZ = _mm_or_ps(_mm_and_ps(rejected, oldZ), _mm_andnot_ps(rejected, z));
+					_mm_storeu_ps(samples, newZ);
+
+					farthest = _mm_max_ps(newZ, _mm_shuffle_ps(newZ, newZ, _MM_SHUFFLE(1, 0, 3, 2)));
+					farthest = _mm_max_ps(farthest, _mm_shuffle_ps(farthest, farthest, _MM_SHUFFLE(2, 3, 0, 1)));
+				}
+
+				const uint8 coverage = (uint8)(~_mm_movemask_ps(rejected) & g_fullCoverage);
+				if (coverage == 0)
+				{
+					continue;
+				}
+				if constexpr (DepthTest)
+				{
+					depthRow[x] = encodeDepth<Format>(_mm_cvtss_f32(farthest), target.encoding);
+				}
+				emitMultisamplePixel<DepthTest>(triangle, x, y, rowTerms, coverage, output);
+				sampleCount += std::popcount((uint32)coverage);
+			}
+		}
+		return sampleCount;
+	}
+
+	/**
+	 * @brief Rasterizes two pixels per iteration, testing all eight of their samples in a single instruction. Only
+	 * called when the CPU supports AVX2.
+	 */
+	template <bool DepthTest, EDepthFormat Format>
+	TARGET_AVX2 int32 rasterizeMultisampleAVX2(const RasterTriangle& triangle, const RasterDepth& target, const FragmentOutput& output)
+	{
+		static_assert(g_sampleCount == 4);
+		constexpr int32 pixelCount = 2;
+
+		const __m256 zero = _mm256_setzero_ps();
+		const __m256 allLanes = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+		const __m256 pixelStep = _mm256_set1_ps((float)pixelCount);
+		const __m256 pixelOffsets = _mm256_setr_ps(0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 1.0f, 1.0f, 1.0f);
+		const __m256 firstX = _mm256_set1_ps((float)triangle.minX);
+		const __m256 lastX = _mm256_set1_ps((float)triangle.maxX);
+		const __m256 oneOverArea = _mm256_set1_ps(triangle.oneOverArea);
+		const __m128 offsetsX = _mm_loadu_ps(g_sampleOffsetsX);
+		const __m128 offsetsY = _mm_loadu_ps(g_sampleOffsetsY);
+
+		__m256 edgeDy[3];
+		__m256 originX[3];
+		__m256 sampleTerms[3];
+		__m256 depth[3];
+		for (int32 i = 0; i < 3; i++)
+		{
+			edgeDy[i] = _mm256_set1_ps(triangle.edgeDy[i]);
+			originX[i] = _mm256_set1_ps(triangle.originX[i]);
+			depth[i] = _mm256_set1_ps(triangle.depth[i]);
+
+			// Both pixels share the same sample pattern
+			const __m128 terms = _mm_sub_ps(_mm_mul_ps(_mm_set1_ps(triangle.edgeDx[i]), offsetsY), _mm_mul_ps(_mm_set1_ps(triangle.edgeDy[i]), offsetsX));
+			sampleTerms[i] = _mm256_insertf128_ps(_mm256_castps128_ps256(terms), terms, 1);
+		}
+
+		// Start each row on an even pixel so both pixels of an iteration lie within a single 8x8 depth block
+		const int32 startX = triangle.minX & ~(pixelCount - 1);
+
+		float rowTerms[3];
+		int32 sampleCount = 0;
+		for (int32 y = triangle.minY; y <= triangle.maxY; y++)
+		{
+			computeRowTerms(triangle, y, rowTerms);
+			const __m256 row0 = _mm256_set1_ps(rowTerms[0]);
+			const __m256 row1 = _mm256_set1_ps(rowTerms[1]);
+			const __m256 row2 = _mm256_set1_ps(rowTerms[2]);
+			DepthStorage<Format>* depthRow = getDepthRow<DepthTest, Format>(target, y);
+			float*				  sampleRow = getSampleRow<DepthTest>(target, y);
+			const float*		  blockRow = DepthTest ? getBlockRow(target, y) : nullptr;
+
+			__m256 px = _mm256_add_ps(_mm256_set1_ps((float)startX), pixelOffsets);
+			for (int32 x = startX; x <= triangle.maxX; x += pixelCount, px = _mm256_add_ps(px, pixelStep))
+			{
+				if (isBlockHidden(triangle, blockRow, x))
+				{
+					continue;
+				}
+
+				// Evaluate each edge at the pixel centers exactly as the other kernels do, then offset it to each sample
+				const __m256 w0 = _mm256_add_ps(_mm256_sub_ps(row0, _mm256_mul_ps(edgeDy[0], _mm256_sub_ps(px, originX[0]))), sampleTerms[0]);
+				const __m256 w1 = _mm256_add_ps(_mm256_sub_ps(row1, _mm256_mul_ps(edgeDy[1], _mm256_sub_ps(px, originX[1]))), sampleTerms[1]);
+				const __m256 w2 = _mm256_add_ps(_mm256_sub_ps(row2, _mm256_mul_ps(edgeDy[2], _mm256_sub_ps(px, originX[2]))), sampleTerms[2]);
+
+				const __m256 outside = _mm256_or_ps(_mm256_cmp_ps(px, firstX, _CMP_LT_OQ), _mm256_cmp_ps(px, lastX, _CMP_GT_OQ));
+				__m256		 rejected = _mm256_or_ps(_mm256_or_ps(_mm256_cmp_ps(w0, zero, _CMP_GT_OQ), _mm256_cmp_ps(w1, zero, _CMP_GT_OQ)),
+					 _mm256_or_ps(_mm256_cmp_ps(w2, zero, _CMP_GT_OQ), outside));
+				if (_mm256_movemask_ps(rejected) == 0xFF)
+				{
+					continue;
+				}
+
+				__m256 z = zero;
+				__m256 oldZ = zero;
+				float* samples = nullptr;
+				if constexpr (DepthTest)
+				{
+					z = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(_mm256_mul_ps(w0, oneOverArea), depth[0]),
+										  _mm256_mul_ps(_mm256_mul_ps(w1, oneOverArea), depth[1])),
+						_mm256_mul_ps(_mm256_mul_ps(w2, oneOverArea), depth[2]));
+
+					samples = sampleRow + x * g_sampleCount;
+					oldZ = _mm256_maskload_ps(samples, _mm256_castps_si256(_mm256_xor_ps(outside, allLanes)));
+					rejected = _mm256_or_ps(rejected, _mm256_cmp_ps(z, oldZ, _CMP_GT_OQ));
+				}
+
+				const __m256 accepted = _mm256_xor_ps(rejected, allLanes);
+				const uint32 mask = (uint32)_mm256_movemask_ps(accepted);
+				if (mask == 0)
+				{
+					continue;
+				}
+				sampleCount += std::popcount(mask);
+
+				alignas(32) float farthest[8];
+				if constexpr (DepthTest)
+				{
+					_mm256_maskstore_ps(samples, _mm256_castps_si256(accepted), z);
+
+					// Find the farthest sample of each pixel, which ends up in the first lane of each half
+					const __m256 newZ = _mm256_blendv_ps(oldZ, z, accepted);
+					__m256		 maxZ = _mm256_max_ps(newZ, _mm256_permute_ps(newZ, _MM_SHUFFLE(1, 0, 3, 2)));
+					maxZ = _mm256_max_ps(maxZ, _mm256_permute_ps(maxZ, _MM_SHUFFLE(2, 3, 0, 1)));
+					_mm256_store_ps(farthest, maxZ);
+				}
+
+				for (int32 pixel = 0; pixel < pixelCount; pixel++)
+				{
+					const uint8 coverage = (uint8)((mask >> (pixel * g_sampleCount)) & g_fullCoverage);
+					if (coverage == 0)
+					{
+						continue;
+					}
+					if constexpr (DepthTest)
+					{
+						depthRow[x + pixel] = encodeDepth<Format>(farthest[pixel * g_sampleCount], target.encoding);
+					}
+					emitMultisamplePixel<DepthTest>(triangle, x + pixel, y, rowTerms, coverage, output);
+				}
+			}
+		}
+		return sampleCount;
+	}
+#endif
+
+	/** Every multisample kernel, compiled without the depth test and with it for each depth format. **/
+	template <bool DepthTest, EDepthFormat Format>
+	constexpr RasterKernelFunction<FragmentOutput> g_multisampleKernels[] = {
+		rasterizeMultisampleScalar<DepthTest, Format>,
+#ifdef PENG_X86
+		rasterizeMultisampleSSE<DepthTest, Format>,
+		rasterizeMultisampleAVX2<DepthTest, Format>,
+#else
+		rasterizeMultisampleScalar<DepthTest, Format>,
+		rasterizeMultisampleScalar<DepthTest, Format>,
+#endif
+	};
+
+	/**
+	 * Every kernel is compiled without the depth test, and with it for each depth format. The variant is picked once
+	 * per triangle from the target's depth buffer, so the per-pixel loops never check for one or its format.
+	 *
+	 * Other architectures only have the scalar kernel. The SIMD entries are never supported there, and only point at
+	 * it to keep the table indexed by kernel.
+	 */
+	template <typename Output, bool DepthTest, EDepthFormat Format>
+	constexpr RasterKernelFunction<Output> g_rasterKernels[] = {
+		rasterizeScalar<Output, DepthTest, Format>,
+#ifdef PENG_X86
+		rasterizeSSE<Output, DepthTest, Format>,
+		rasterizeAVX2<Output, DepthTest, Format>,
+#else
+		rasterizeScalar<Output, DepthTest, Format>,
+		rasterizeScalar<Output, DepthTest, Format>,
+#endif
+	};
+
+	/**
+	 * @brief Returns the variant of `kernel` which matches the depth buffer of `depth`.
+	 */
+	template <typename Output>
+	RasterKernelFunction<Output> getKernelFunction(const ERasterKernel kernel, const RasterDepth& depth)
+	{
+		if (!depth.buffer)
+		{
+			return g_rasterKernels<Output, false, EDepthFormat::Float32>[(int32)kernel];
+		}
+		switch (depth.format)
+		{
+			case EDepthFormat::Fixed24:
+				return g_rasterKernels<Output, true, EDepthFormat::Fixed24>[(int32)kernel];
+			case EDepthFormat::Fixed16:
+				return g_rasterKernels<Output, true, EDepthFormat::Fixed16>[(int32)kernel];
+			default:
+				return g_rasterKernels<Output, true, EDepthFormat::Float32>[(int32)kernel];
+		}
+	}
+
+	/**
+	 * @brief Returns the multisample variant of `kernel` which matches the depth buffer of `depth`.
+	 */
+	inline RasterKernelFunction<FragmentOutput> getMultisampleKernelFunction(const ERasterKernel kernel, const RasterDepth& depth)
+	{
+		if (!depth.buffer)
+		{
+			return g_multisampleKernels<false, EDepthFormat::Float32>[(int32)kernel];
+		}
+		switch (depth.format)
+		{
+			case EDepthFormat::Fixed24:
+				return g_multisampleKernels<true, EDepthFormat::Fixed24>[(int32)kernel];
+			case EDepthFormat::Fixed16:
+				return g_multisampleKernels<true, EDepthFormat::Fixed16>[(int32)kernel];
+			default:
+				return g_multisampleKernels<true, EDepthFormat::Float32>[(int32)kernel];
+		}
+	}
+
+	constexpr const char* g_rasterKernelNames[] = { "Scalar", "SSE", "AVX2" };
+	constexpr const char* g_depthFormatNames[] = { "Float32", "Fixed24", "Fixed16" };
+
+	// Read by every tile worker while the kernel may be switched from another thread. Every kernel rasterizes the
+	// same pixels, so no ordering is needed beyond the switch itself being atomic.
+	std::atomic<ERasterKernel> g_currentRasterKernel = Rasterizer::getBestKernel();
+} // namespace
+
+bool Rasterizer::isKernelSupported(const ERasterKernel kernel)
+{
+	switch (kernel)
+	{
+		case ERasterKernel::Scalar:
+			return true;
+		case ERasterKernel::SSE:
+#ifdef PENG_X86
+			return true;
+#else
+			return false;
+#endif
+		case ERasterKernel::AVX2:
+			return Platform::getCpuFeatures().avx2;
+		default:
+			return false;
+	}
+}
+
+ERasterKernel Rasterizer::getBestKernel()
+{
+	if (isKernelSupported(ERasterKernel::AVX2))
+	{
+		return ERasterKernel::AVX2;
+	}
+	return isKernelSupported(ERasterKernel::SSE) ? ERasterKernel::SSE : ERasterKernel::Scalar;
+}
+
+ERasterKernel Rasterizer::getKernel()
+{
+	return g_currentRasterKernel.load(std::memory_order_relaxed);
+}
+
+void Rasterizer::setKernel(const ERasterKernel kernel)
+{
+	if (!isKernelSupported(kernel))
+	{
+		LOG_WARNING("Raster kernel {} is not supported by this CPU.", getKernelName(kernel))
+		return;
+	}
+	g_currentRasterKernel.store(kernel, std::memory_order_relaxed);
+}
+
+const char* Rasterizer::getKernelName(const ERasterKernel kernel)
+{
+	return kernel < ERasterKernel::Count ? g_rasterKernelNames[(int32)kernel] : "Unknown";
+}
+
+int32 Rasterizer::rasterize(const RasterTriangle& triangle, const RasterDepth& depth, std::vector<RasterFragment>& fragments)
+{
+	return rasterize(g_currentRasterKernel.load(std::memory_order_relaxed), triangle, depth, fragments);
+}
+
+int32 Rasterizer::rasterize(const ERasterKernel kernel, const RasterTriangle& triangle, const RasterDepth& depth,
+	std::vector<RasterFragment>& fragments)
+{
+	if (triangle.isEmpty())
+	{
+		return 0;
+	}
+	return getKernelFunction<FragmentOutput>(kernel, depth)(triangle, depth, FragmentOutput{ fragments });
+}
+
+int32 Rasterizer::rasterizeMultisample(const RasterTriangle& triangle, const RasterDepth& depth, std::vector<RasterFragment>& fragments)
+{
+	return rasterizeMultisample(g_currentRasterKernel.load(std::memory_order_relaxed), triangle, depth, fragments);
+}
+
+int32 Rasterizer::rasterizeMultisample(const ERasterKernel kernel, const RasterTriangle& triangle, const RasterDepth& depth,
+	std::vector<RasterFragment>& fragments)
+{
+	if (triangle.isEmpty())
+	{
+		return 0;
+	}
+	return getMultisampleKernelFunction(kernel, depth)(triangle, depth, FragmentOutput{ fragments });
+}
+
+int32 Rasterizer::rasterizeVisibility(const RasterTriangle& triangle, const RasterDepth& depth, uint32* visibilityBuffer,
+	const int32 visibilityPitch, const uint32 id)
+{
+	if (triangle.isEmpty())
+	{
+		return 0;
+	}
+	const ERasterKernel kernel = g_currentRasterKernel.load(std::memory_order_relaxed);
+	return getKernelFunction<VisibilityOutput>(kernel, depth)(triangle, depth, VisibilityOutput{ visibilityBuffer, visibilityPitch, id });
+}
+
+void Rasterizer::benchmark(const int32 width, const int32 height, const int32 triangleCount)
+{
+	// Build a fixed set of triangles of varying sizes so every kernel rasterizes exactly the same work
+	std::mt19937						  generator(1337);
+	std::uniform_real_distribution<float> centerX(0.0f, (float)width);
+	std::uniform_real_distribution<float> centerY(0.0f, (float)height);
+	std::uniform_real_distribution<float> offset(-48.0f, 48.0f);
+	std::uniform_real_distribution<float> randomDepth(g_minEncodedDepth, g_maxEncodedDepth);
+
+	const recti					screen(0, 0, width, height);
+	std::vector<RasterTriangle> triangles;
+	std::vector<RasterTriangle> multisampleTriangles;
+	triangles.reserve(triangleCount);
+	multisampleTriangles.reserve(triangleCount);
+	for (int32 index = 0; index < triangleCount; index++)
+	{
+		const float cx = centerX(generator);
+		const float cy = centerY(generator);
+		vec3f		s0(cx + offset(generator), cy + offset(generator), randomDepth(generator));
+		vec3f		s1(cx + offset(generator), cy + offset(generator), randomDepth(generator));
+		vec3f		s2(cx + offset(generator), cy + offset(generator), randomDepth(generator));
+
+		// Only triangles with negative edge functions are covered, so flip any with the opposite winding
+		if (Math::edgeFunction(s0, s1, s2) > 0.0f)
+		{
+			std::swap(s1, s2);
+		}
+		triangles.emplace_back(s0, s1, s2, screen);
+		multisampleTriangles.emplace_back(s0, s1, s2, screen, g_maxSampleOffset);
+	}
+
+	constexpr float				clearDepth = 10000.0f;
+	DepthBuffer					depthBuffer(width, height, clearDepth);
+	std::vector<float>			sampleDepthBuffer((size_t)depthBuffer.getPitch() * height * g_sampleCount);
+	std::vector<RasterFragment> fragments;
+
+	// Every kernel must agree within a format, but the fixed point formats round depth and so resolve some pixels
+	// differently to floats
+	for (int32 formatIndex = 0; formatIndex < (int32)EDepthFormat::Count; formatIndex++)
+	{
+		const auto format = (EDepthFormat)formatIndex;
+		depthBuffer.setFormat(format);
+
+		RasterDepth depth;
+		depth.buffer = depthBuffer.getData();
+		depth.format = format;
+		depth.encoding = depthBuffer.getEncoding();
+		depth.pitch = depthBuffer.getPitch();
+		depth.samples = sampleDepthBuffer.data();
+
+		int64 referencePixelCount = -1;
+		int64 referenceSampleCount = -1;
+		LOG_INFO("{} depth, {} bytes per pixel:", g_depthFormatNames[formatIndex], depthBuffer.getPixelSize())
+
+		for (int32 kernelIndex = 0; kernelIndex < (int32)ERasterKernel::Count; kernelIndex++)
+		{
+			const auto kernel = (ERasterKernel)kernelIndex;
+			if (!isKernelSupported(kernel))
+			{
+				LOG_INFO("{}: not supported by this CPU.", getKernelName(kernel))
+				continue;
+			}
+
+			// Take the best of a few runs to reduce noise
+			float bestTime = std::numeric_limits<float>::max();
+			int64 pixelCount = 0;
+			for (int32 run = 0; run < 3; run++)
+			{
+				depthBuffer.clear(screen);
+				pixelCount = 0;
+
+				const TimePoint start = PTimer::now();
+				for (const RasterTriangle& triangle : triangles)
+				{
+					fragments.clear();
+					pixelCount += rasterize(kernel, triangle, depth, fragments);
+				}
+				const float time = DurationMs(PTimer::now() - start).count();
+				bestTime = std::min(bestTime, time);
+			}
+
+			if (referencePixelCount < 0)
+			{
+				referencePixelCount = pixelCount;
+			}
+			else if (pixelCount != referencePixelCount)
+			{
+				LOG_WARNING("{}: rasterized {} pixels, expected {}.", getKernelName(kernel), pixelCount, referencePixelCount)
+			}
+
+			const double pixelsPerSecond = (double)pixelCount / (bestTime / 1000.0);
+			LOG_INFO("{}: {:.2f} Mpixels/s ({} pixels in {:.3f} ms)", getKernelName(kernel), pixelsPerSecond / 1000000.0,
+				pixelCount, bestTime)
+
+			// Rasterize the same triangles again at every sample, to compare the cost of multisampling with it
+			float bestMultisampleTime = std::numeric_limits<float>::max();
+			int64 sampleCount = 0;
+			for (int32 run = 0; run < 3; run++)
+			{
+				depthBuffer.clear(screen);
+				std::fill(sampleDepthBuffer.begin(), sampleDepthBuffer.end(), clearDepth);
+				sampleCount = 0;
+
+				const TimePoint start = PTimer::now();
+				for (const RasterTriangle& triangle : multisampleTriangles)
+				{
+					fragments.clear();
+					sampleCount += rasterizeMultisample(kernel, triangle, depth, fragments);
+				}
+				const float time = DurationMs(PTimer::now() - start).count();
+				bestMultisampleTime = std::min(bestMultisampleTime, time);
+			}
+
+			if (referenceSampleCount < 0)
+			{
+				referenceSampleCount = sampleCount;
+			}
+			else if (sampleCount != referenceSampleCount)
+			{
+				LOG_WARNING("{} multisample: rasterized {} samples, expected {}.", getKernelName(kernel), sampleCount, referenceSampleCount)
+			}
+
+			const double samplesPerSecond = (double)sampleCount / (bestMultisampleTime / 1000.0);
+			LOG_INFO("{} multisample: {:.2f} Msamples/s ({} samples in {:.3f} ms, {:.2f}x the time of a single sample)",
+				getKernelName(kernel), samplesPerSecond / 1000000.0, sampleCount, bestMultisampleTime, bestMultisampleTime / bestTime)
+		}
+	}
+}
@@ -0,0 +1,253 @@
+#pragma once
+
+#include <algorithm>
+#include <vector>
+
+#include "Core/Types.h"
+#include "Math/Rect.h"
+#include "Math/Vector.h"
+#include "Renderer/Pipeline/DepthBuffer.h"
+
+/** The implementations available to rasterize triangles. **/
+enum class ERasterKernel : uint8
+{
+	Scalar,
+	SSE,
+	AVX2,
+	Count
+};
+
+/** The number of coverage and depth samples per pixel when multisampling. **/
+constexpr int32 g_sampleCount = 4;
+/** Coverage mask of a pixel with every sample covered. **/
+constexpr uint8 g_fullCoverage = (1 << g_sampleCount) - 1;
+
+/**
+ * Offset of each sample from the center of its pixel when multisampling. A rotated grid, so near-horizontal and
+ * near-vertical edges both cross four distinct rows and columns of samples.
+ **/
+constexpr float g_sampleOffsetsX[g_sampleCount] = { -0.125f, 0.375f, -0.375f, 0.125f };
+constexpr float g_sampleOffsetsY[g_sampleCount] = { -0.375f, -0.125f, 0.125f, 0.375f };
+/** Farthest any sample lies from the center of its pixel along either axis. **/
+constexpr float g_maxSampleOffset = 0.375f;
+
+/**
+ * @brief A single pixel covered by a triangle, output by the rasterizer.
+ */
+struct RasterFragment
+{
+	int32 x;
+	int32 y;
+	/** Barycentric coordinates of the center of this pixel within the triangle. **/
+	vec3f bary;
+	/** Interpolated depth of the center of this pixel, or zero if depth testing is disabled. **/
+	float depth;
+	/**
+	 * Samples of this pixel which are covered and pass the depth test, one bit per sample. Pixels rasterized with a
+	 * single sample are always fully covered.
+	 **/
+	uint8 coverage;
+};
+
+/**
+ * @brief A screen-space triangle with its edge functions set up for rasterization.
+ *
+ * Each edge function is evaluated as `dx * (y - originY) - dy * (x - originX)`, which matches
+ * `Math::edgeFunction` exactly, so every kernel produces the same coverage as the reference path.
+ */
+struct RasterTriangle
+{
+	float edgeDx[3];
+	float edgeDy[3];
+	float originX[3];
+	float originY[3];
+	/** Negated screen-space depth of each vertex. **/
+	float depth[3];
+	/**
+	 * Nearest depth of any pixel in the triangle, lowered slightly so that rounding in the interpolated depth can never
+	 * produce a pixel nearer than it.
+	 **/
+	float nearestDepth;
+	/** Farthest depth of any pixel in the triangle, raised by the same margin as `nearestDepth`. **/
+	float farthestDepth;
+	float oneOverArea;
+
+	/** Pixel bounds of the triangle, clipped to the region being drawn. **/
+	int32 minX;
+	int32 minY;
+	int32 maxX;
+	int32 maxY;
+
+	/**
+	 * @brief Sets up the edge functions of the triangle (s0, s1, s2).
+	 * @param s0, s1, s2 Screen-space vertexes of the triangle.
+	 * @param bounds The region of the screen to rasterize within.
+	 * @param padding Distance to grow the triangle's bounds by before they are rounded to pixels. Multisampled
+	 * triangles pass g_maxSampleOffset, as they may cover samples of pixels whose centers lie outside them.
+	 */
+	RasterTriangle(const vec3f& s0, const vec3f& s1, const vec3f& s2, const recti& bounds, float padding = 0.0f);
+
+	/**
+	 * @brief Returns whether this triangle covers no pixels of the region being drawn.
+	 */
+	[[nodiscard]] bool isEmpty() const { return minX > maxX || minY > maxY; }
+
+	/**
+	 * @brief Returns the pixel bounds of this triangle.
+	 */
+	[[nodiscard]] recti getBounds() const { return recti(minX, minY, maxX - minX + 1, maxY - minY + 1); }
+
+	/**
+	 * @brief Clips the pixel bounds of this triangle to the specified region.
+	 */
+	void clip(const recti& bounds)
+	{
+		minX = std::max(minX, bounds.x);
+		maxX = std::min(maxX, bounds.x + bounds.width - 1);
+		minY = std::max(minY, bounds.y);
+		maxY = std::min(maxY, bounds.y + bounds.height - 1);
+	}
+
+	/**
+	 * @brief Returns the part of edge function `edge` which only depends on the row `y`.
+	 */
+	[[nodiscard]] float getRowTerm(const int32 edge, const int32 y) const { return edgeDx[edge] * ((float)y - originY[edge]); }
+
+	/**
+	 * @brief Evaluates edge function `edge` at pixel (x, y), given its row term.
+	 */
+	[[nodiscard]] float getEdge(const int32 edge, const int32 x, const float rowTerm) const
+	{
+		return rowTerm - edgeDy[edge] * ((float)x - originX[edge]);
+	}
+
+	/**
+	 * @brief Returns the barycentric coordinates of pixel (x, y). These are identical to the coordinates the
+	 * rasterizer computed for the same pixel.
+	 */
+	[[nodiscard]] vec3f getBarycentrics(const int32 x, const int32 y) const
+	{
+		return vec3f(getEdge(0, x, getRowTerm(0, y)) * oneOverArea, getEdge(1, x, getRowTerm(1, y)) * oneOverArea,
+			getEdge(2, x, getRowTerm(2, y)) * oneOverArea);
+	}
+
+	/**
+	 * @brief Interpolates the depth of the triangle at the specified barycentric coordinates.
+	 */
+	[[nodiscard]] float getDepth(const vec3f& bary) const { return bary.x * depth[0] + bary.y * depth[1] + bary.z * depth[2]; }
+};
+
+/**
+ * @brief The depth buffer triangles are tested against.
+ */
+struct RasterDepth
+{
+	/** Per-pixel depth in `format`, or nullptr to disable depth testing. **/
+	void*		 buffer = nullptr;
+	EDepthFormat format = EDepthFormat::Float32;
+	/** Maps depths to the codes stored in `buffer` by the fixed point formats. **/
+	DepthEncoding encoding;
+	/**
+	 * The number of pixels in a single row of `buffer`. Must be a multiple of g_depthBlockSize when depth testing,
+	 * so the kernels can load a whole block of a row at once.
+	 **/
+	int32 pitch = 0;
+	/**
+	 * Nearest and farthest depth of each 8x8 block of `buffer`, used to skip the depth test in blocks the triangle is
+	 * entirely in front of, and to skip blocks it is hidden behind. May be nullptr.
+	 **/
+	const float* blockMins = nullptr;
+	const float* blockMaxs = nullptr;
+	/** The number of blocks in a single row of `blockMins` and `blockMaxs`. **/
+	int32 blockPitch = 0;
+	/**
+	 * Depth of each sample when multisampling, g_sampleCount floats per pixel and `pitch * g_sampleCount` floats per
+	 * row. Samples are always stored as floats. `buffer` then holds the farthest depth of each pixel's samples.
+	 **/
+	float* samples = nullptr;
+};
+
+namespace Rasterizer
+{
+	/**
+	 * @brief Returns whether the specified kernel can run on this CPU.
+	 */
+	bool isKernelSupported(ERasterKernel kernel);
+
+	/**
+	 * @brief Returns the fastest kernel which can run on this CPU.
+	 */
+	ERasterKernel getBestKernel();
+
+	/**
+	 * @brief Returns the kernel used by `rasterize`. Defaults to the best kernel for this CPU.
+	 */
+	ERasterKernel getKernel();
+
+	/**
+	 * @brief Overrides the kernel used by `rasterize`. Unsupported kernels are ignored. Safe to call while other
+	 * threads are rasterizing.
+	 */
+	void setKernel(ERasterKernel kernel);
+
+	/**
+	 * @brief Returns the display name of the specified kernel.
+	 */
+	const char* getKernelName(ERasterKernel kernel);
+
+	/**
+	 * @brief Rasterizes a triangle, appending every covered pixel which passes the depth test to `fragments`.
+	 * @param triangle The triangle to rasterize.
+	 * @param depth The depth buffer to test against and write to.
+	 * @param fragments The fragment buffer to append to.
+	 * @return The number of pixels written.
+	 */
+	int32 rasterize(const RasterTriangle& triangle, const RasterDepth& depth, std::vector<RasterFragment>& fragments);
+
+	/**
+	 * @brief Rasterizes a triangle with the specified kernel rather than the current kernel.
+	 */
+	int32 rasterize(ERasterKernel kernel, const RasterTriangle& triangle, const RasterDepth& depth,
+		std::vector<RasterFragment>& fragments);
+
+	/**
+	 * @brief Rasterizes a triangle at g_sampleCount samples per pixel, appending every pixel with at least one sample
+	 * which is covered and passes the depth test to `fragments`. Each pixel is output once, with the barycentric
+	 * coordinates of its center and a mask of the samples which passed.
+	 * @param triangle The triangle to rasterize. Should be set up with a padding of g_maxSampleOffset.
+	 * @param depth The depth buffer to test against and write to. `depth.samples` must be set if depth testing is
+	 * enabled.
+	 * @param fragments The fragment buffer to append to.
+	 * @return The number of samples written.
+	 */
+	int32 rasterizeMultisample(const RasterTriangle& triangle, const RasterDepth& depth, std::vector<RasterFragment>& fragments);
+
+	/**
+	 * @brief Rasterizes a triangle at g_sampleCount samples per pixel with the specified kernel rather than the
+	 * current kernel.
+	 */
+	int32 rasterizeMultisample(ERasterKernel kernel, const RasterTriangle& triangle, const RasterDepth& depth,
+		std::vector<RasterFragment>& fragments);
+
+	/**
+	 * @brief Rasterizes a triangle into a visibility buffer, writing `id` to every covered pixel which passes the
+	 * depth test. No fragments are produced.
+	 * @param triangle The triangle to rasterize.
+	 * @param depth The depth buffer to test against and write to.
+	 * @param visibilityBuffer The visibility buffer to write to.
+	 * @param visibilityPitch The number of IDs in a single row of the visibility buffer.
+	 * @param id The ID to write for this triangle.
+	 * @return The number of pixels written.
+	 */
+	int32 rasterizeVisibility(const RasterTriangle& triangle, const RasterDepth& depth, uint32* visibilityBuffer, int32 visibilityPitch,
+		uint32 id);
+
+	/**
+	 * @brief Rasterizes a fixed set of random triangles with every supported kernel and depth format, and logs the
+	 * number of pixels per second each of them rasterizes.
+	 * @param width The width of the render target.
+	 * @param height The height of the render target.
+	 * @param triangleCount The number of triangles to rasterize.
+	 */
+	void benchmark(int32 width = 1280, int32 height = 720, int32 triangleCount = 10000);
+} // namespace Rasterizer
@@ -1,44 +1,66 @@
+﻿#include <array>
+#include <bit>
+#include <cmath>
+#include <limits>
+#include <utility>
+
 #include "Scanline.h"
 
 #include "Math/Clipping.h"
+#include "Math/Frustum.h"
 #include "Renderer/UI/Widget.h"
 
-/** Vertex3 Shader **/
+/** Pipeline **/
 
-VertexOutput ScanlineVertexShader::process(const VertexInput& input)
+namespace
 {
-	VertexOutput out;
-	// Project world position to screen
-	out.position = Math::vectorTransform(vec4f(input.position, 1.0f), input.viewProjection);
-	// Transform object normal to world normal
-	out.normal = Math::vectorTransform(input.normal, input.model);
-	return out;
-}
-
-/** Pixel Shader **/
+	using RasterStageFunction = void (ScanlineRHI::*)(const ScanlineTriangle&, const recti&, ScanlineThreadContext&) const;
+	using ResolveStageFunction = void (ScanlineRHI::*)(const recti&) const;
 
-Color ScanlinePixelShader::process(const PixelData& input)
-{
-	Color out = Color::white();
-	if (input.texture)
+	template <size_t... Features>
+	constexpr std::array<RasterStageFunction, sizeof...(Features)> makeRasterStages(std::index_sequence<Features...>)
 	{
-		// Compute the relative UV coordinates on the texture
-		int32 x = input.uv.x * (input.texture->getWidth() - 1);
-		int32 y = input.uv.y * (input.texture->getHeight() - 1);
-		x = std::abs(x);
-		y = std::abs(y);
+		return { &ScanlineRHI::rasterStage<(uint8)Features>... };
+	}
 
-		// Set the outColor to the pixel at [x,y] in the texture
-		out = input.texture->getPixelAsColor(x, y);
+	template <size_t... Features>
+	constexpr std::array<ResolveStageFunction, sizeof...(Features)> makeResolveStages(std::index_sequence<Features...>)
+	{
+		return { &ScanlineRHI::resolveStage<(uint8)Features>... };
 	}
-	float facingRatio = (-input.cameraNormal).dot(input.worldNormal);
-	facingRatio = std::clamp(facingRatio, 0.0f, 1.0f);
-	out *= facingRatio;
 
-	return out;
-}
+	/** Every variant of the raster and resolve stages, indexed by their EShadingFeature combination. **/
+	constexpr auto g_rasterStages = makeRasterStages(std::make_index_sequence<g_shadingVariantCount>());
+	constexpr auto g_resolveStages = makeResolveStages(std::make_index_sequence<g_shadingVariantCount>());
 
-/** Pipeline **/
+	/**
+	 * @brief Returns the average color of a pixel's samples. Two channels are summed in each add, as the sum of four
+	 * 8-bit values can't carry into the next channel.
+	 */
+	uint32 averageSamples(const uint32* samples)
+	{
+		static_assert(g_sampleCount == 4);
+		uint32 redBlue = 0;
+		uint32 alphaGreen = 0;
+		for (int32 sample = 0; sample < g_sampleCount; sample++)
+		{
+			redBlue += samples[sample] & 0x00FF00FF;
+			alphaGreen += (samples[sample] >> 8) & 0x00FF00FF;
+		}
+		return ((redBlue >> 2) & 0x00FF00FF) | (((alphaGreen >> 2) & 0x00FF00FF) << 8);
+	}
+
+	/**
+	 * @brief Returns the screen-space depth `Clipping::clipVertex` produces for a point `viewDepth` in front of the
+	 * camera.
+	 */
+	float getScreenDepth(const ViewData& viewData, const float viewDepth)
+	{
+		const float range = viewData.maxZ / (viewData.maxZ - viewData.minZ);
+		const float clipDepth = range - range * viewData.minZ / viewDepth;
+		return (clipDepth + 0.5f) * 0.5f;
+	}
+} // namespace
 
 bool ScanlineRHI::init(void* windowHandle)
 {
@@ -46,7 +68,8 @@ bool ScanlineRHI::init(void* windowHandle)
 	int32 height = g_defaultViewportHeight;
 
 	m_frameBuffer = std::make_shared<Texture>(vec2i{ width, height });
-	m_depthBuffer = std::make_shared<Texture>(vec2i{ width, height });
+	m_depthBuffer = std::make_shared<DepthBuffer>(width, height, g_clearDepth);
+	m_visibilityBuffer = std::make_shared<Texture>(vec2i{ width, height });
 
 	m_vertexShader = std::make_shared<ScanlineVertexShader>();
 	m_pixelShader = std::make_shared<ScanlinePixelShader>();
@@ -57,21 +80,22 @@ bool ScanlineRHI::init(void* windowHandle)
 
 	m_painter = std::make_shared<Painter>(m_frameBuffer.get(), recti{ 0, 0, width, height });
 
+	m_threadPool = std::make_shared<ThreadPool>();
+	m_threadContexts.resize(m_threadPool->getThreadCount());
+
 	return true;
 }
 
 void ScanlineRHI::beginDraw()
 {
-	// Reset all buffers to their default values (namely z to Inf)
-	m_frameBuffer->fill(Color::black());
-	Color bgColor = Color::fromRgba(80, 128, 200);
-	for (int i = m_viewData->height - 1; i >= 0; i--)
-	{
-		float perc = (float)i / (float)m_viewData->height;
-		Color color = bgColor * Math::remap(perc, 0.0f, 1.0f, 0.1f, 1.0f);
-		m_frameBuffer->fillRow(i, color);
-	}
-	m_depthBuffer->fill(10000.0f);
+	// Every pixel of the depth buffer is cleared before it is next tested, so its format can change between frames
+	m_depthBuffer->setFormat(m_renderSettings->getDepthFormat());
+
+	// Reset all buffers to their default values (namely z to Inf). The frame and depth buffers are cleared a tile at
+	// a time as they are drawn into, so tiles nothing covers are only ever written once.
+	updateSampleBuffers();
+	clearTiles();
+	m_depthBuffer->clearBlocks();
 
 	if (TextureManager::count() > 0)
 	{
@@ -82,6 +106,7 @@ void ScanlineRHI::beginDraw()
 void ScanlineRHI::draw()
 {
 	drawRenderables();
+	resolveTiles();
 	// TODO: Figure out why drawing is vertically flipped
 	m_frameBuffer->flipVertical();
 	//drawUI(WidgetManager::g_rootWidget);
@@ -89,416 +114,1161 @@ void ScanlineRHI::draw()
 
 void ScanlineRHI::drawRenderables()
 {
-	// Draw all renderables
-	for (const MeshDescription& desc : m_meshDescriptions)
+	// Run the vertex stage on every unique vertex of every renderable, then assemble each triangle
+	// from the transformed vertexes, collecting the clipped triangles which are on screen and front-facing.
+	m_triangles.clear();
+
+	// Cull renderables in the scene using its bounding volume hierarchy, rather than visiting each one. The
+	// visible meshes are still drawn in the order they were added, so the output doesn't depend on the tree.
+	m_drawList.assign(m_untrackedDescriptions.begin(), m_untrackedDescriptions.end());
+	if (!m_sceneDescriptions.empty())
 	{
-		m_vertexBuffer.clear();
-		size_t dataSize = desc.byteSize;
-		m_vertexBuffer.resize(dataSize);
-		std::memcpy(m_vertexBuffer.data(), desc.data, dataSize);
-		m_viewData->modelMatrix = desc.transform->toMatrix();
+		// A snapshot already holds the visible renderables, as the tree may be changing while the frame draws
+		if (m_snapshot == nullptr)
+		{
+			m_visibleRenderables.clear();
+			g_objectManager.getRenderableTree()->queryFrustum(frustumf(m_viewData->viewProjectionMatrix), m_visibleRenderables);
+		}
+		const std::vector<IRenderable*>& visibleRenderables = m_snapshot != nullptr ? m_snapshot->visibleRenderables : m_visibleRenderables;
+		for (IRenderable* renderable : visibleRenderables)
+		{
+			if (auto it = m_sceneDescriptions.find(renderable); it != m_sceneDescriptions.end())
+			{
+				m_drawList.push_back(it->second);
+			}
+		}
+	}
+	std::sort(m_drawList.begin(), m_drawList.end());
+
+	for (const int32 descriptionIndex : m_drawList)
+	{
+		// Renderables added after the snapshot was captured are drawn from the next one
+		if (m_snapshot != nullptr && descriptionIndex >= (int32)m_snapshot->meshes.size())
+		{
+			continue;
+		}
+
+		// Frames drawn from a snapshot never read the mesh, as the scene may be changing it
+		MeshSnapshot liveMesh;
+		if (m_snapshot == nullptr)
+		{
+			liveMesh = captureMesh(m_meshDescriptions[descriptionIndex], *m_viewData, *m_renderSettings);
+		}
+		const MeshSnapshot& mesh = m_snapshot != nullptr ? m_snapshot->meshes[descriptionIndex] : liveMesh;
+
+		m_viewData->modelMatrix = mesh.worldMatrix;
 		m_viewData->modelViewProjectionMatrix = m_viewData->modelMatrix * m_viewData->viewProjectionMatrix;
+		m_uniforms.model = m_viewData->modelMatrix;
+		m_uniforms.modelViewProjection = m_viewData->modelViewProjectionMatrix;
+
+		// Skip the whole mesh if its bounds are outside the view frustum. The planes are extracted from the
+		// model view projection matrix, so they can be tested against the object-space bounds directly.
+		const frustumf frustum(m_viewData->modelViewProjectionMatrix);
+		if (!frustum.intersects(mesh.boundingSphere) || !frustum.intersects(mesh.bounds))
+		{
+			continue;
+		}
 
-		// Draw each triangle in the vertex buffer
-		for (int32 index = 0; index < desc.vertexCount; index += 3)
+		// Distant meshes were captured with a simplified level of detail
+		const Vertex3* vertices = (const Vertex3*)mesh.vertices.data();
+		const uint32   vertexCount = (uint32)(mesh.vertices.size_bytes() / sizeof(Vertex3));
+		const uint32*  indexes = mesh.indexes.data();
+		const uint32   indexCount = (uint32)mesh.indexes.size();
+
+		// Transform each vertex in the vertex buffer once
+		m_vertexShader->bind(m_uniforms);
+		vertexStage(vertices, vertexCount);
+
+		// Cull whole batches of triangles in the index buffer at once, and only assemble those which may be visible
+		const int32 triangleCount = (int32)(indexCount / 3);
+		m_visibleTriangles.resize(triangleCount);
+		const int32 visibleCount = VertexPipeline::cullTriangles(m_vertexCache, indexes, triangleCount,
+			m_viewData->cameraDirection, m_visibleTriangles.data());
+		for (int32 i = 0; i < visibleCount; i++)
 		{
-			Vertex3* vertex = (Vertex3*)m_vertexBuffer.data() + index;
-			drawTriangle(vertex);
+			primitiveStage(vertices, indexes + m_visibleTriangles[i] * 3, m_triangles);
 		}
 	}
+
+	if (m_renderSettings->getRenderFlag(Shaded))
+	{
+		prepareLights();
+		selectShadingVariant();
+		if (m_renderSettings->getDeferredShading())
+		{
+			// Set up the edge functions of every triangle once, so they can be shared by the visibility
+			// and resolve stages
+			const recti screen(0, 0, m_viewData->width, m_viewData->height);
+			m_rasterTriangles.clear();
+			m_rasterTriangles.reserve(m_triangles.size());
+			for (const ScanlineTriangle& triangle : m_triangles)
+			{
+				m_rasterTriangles.emplace_back(triangle.screenPoints[0], triangle.screenPoints[1], triangle.screenPoints[2], screen);
+			}
+		}
+
+		// Without a depth buffer filled before shading, the lights of each tile are culled against the triangles
+		// overlapping it
+		if (!m_shaderLights.empty() && !isCullingLightsByDepthBuffer())
+		{
+			cullLights();
+		}
+
+		if (m_renderSettings->getTileRendering())
+		{
+			drawTiles();
+		}
+		else
+		{
+			drawTriangles();
+		}
+
+		// Resolve before the lines are drawn, so they aren't averaged with the samples
+		if (isMultisampling())
+		{
+			resolveSamples();
+		}
+	}
+
+	// Draw wireframe and normals on top of the shaded triangles
+	const bool wireframe = m_renderSettings->getRenderFlag(Wireframe);
+	const bool normals = m_renderSettings->getRenderFlag(Normals);
+	if (wireframe || normals)
+	{
+		m_lineBatch.begin(m_viewData->width, m_viewData->height);
+		for (const ScanlineTriangle& triangle : m_triangles)
+		{
+			if (wireframe)
+			{
+				addWireframe(triangle);
+			}
+			if (normals)
+			{
+				addNormal(triangle);
+			}
+		}
+		flushLines();
+	}
 }
 
-void ScanlineRHI::drawUI(Widget* w)
+bool ScanlineRHI::isMultisampling() const
 {
-	//// Draw all UI elements
-	//if (w)
-	//{
-	//	w->paint(m_painter.get());
-	//	for (Widget* w : w->getChildren())
-	//	{
-	//		drawUI(w);
-	//	}
-	//}
+	// The visibility buffer holds a single triangle per pixel, so deferred shading always draws a single sample
+	return m_renderSettings->getMultisampling() && !m_renderSettings->getDeferredShading();
 }
 
-void ScanlineRHI::addRenderable(IRenderable* renderable)
+void ScanlineRHI::updateSampleBuffers()
 {
-	// Convert the current renderable's geometry into a vertex buffer
-	Mesh* mesh = renderable->getMesh();
-	auto  vertexData = mesh->getVertexData();
+	if (!isMultisampling())
+	{
+		return;
+	}
 
-	MeshDescription desc{};
-	desc.data = vertexData->data();
-	desc.byteSize = vertexData->size();
-	desc.stride = sizeof(Vertex3);
-	desc.vertexCount = vertexData->size() / sizeof(Vertex3);
-	desc.transform = renderable->getTransform();
+	const vec2i size(m_depthBuffer->getPitch() * g_sampleCount, m_depthBuffer->getHeight());
+	if (m_sampleBuffer == nullptr)
+	{
+		m_sampleBuffer = std::make_shared<Texture>(size);
+		m_sampleDepthBuffer = std::make_shared<Texture>(size);
+	}
+	else if (m_sampleBuffer->getWidth() != size.x || m_sampleBuffer->getHeight() != size.y)
+	{
+		m_sampleBuffer->resize(size);
+		m_sampleDepthBuffer->resize(size);
+	}
+}
 
-	// Add to mesh descriptions
-	m_meshDescriptions.emplace_back(desc);
+uint8 ScanlineRHI::getShadingFeatures() const
+{
+	uint8 features = ShadeNone;
+	if (m_renderSettings->getRenderFlag(Depth))
+	{
+		features |= ShadeDepthTest;
+	}
+	if (m_renderSettings->getRenderFlag(Textures) && m_texturePtr)
+	{
+		features |= ShadeTextured;
+	}
+	if (m_renderSettings->getRenderFlag(Lights))
+	{
+		features |= ShadeLit;
+	}
+	if (isMultisampling())
+	{
+		features |= ShadeMultisample;
+	}
+	return features;
 }
 
-void ScanlineRHI::endDraw() {}
+void ScanlineRHI::selectShadingVariant()
+{
+	const uint8 features = getShadingFeatures();
+	m_uniforms.cameraDirection = m_viewData->cameraDirection;
+	m_uniforms.texture = m_texturePtr;
+	m_uniforms.features = features;
+	m_pixelShader->bind(m_uniforms);
+
+	m_rasterStage = g_rasterStages[features];
+	m_resolveStage = g_resolveStages[features];
+}
 
-bool ScanlineRHI::vertexStage()
+void ScanlineRHI::prepareLights()
 {
-	// Run the vertex shader for each vertex. This is assuming the output is a vec4f which is the
-	// final projected vertex position on the screen. The W component of that vector needs to be
-	// above 0 to be in the view frustum. Otherwise, it's off the screen.
-	bool triangleOnScreen = false;
+	m_shaderLights.clear();
+	m_lightBounds.clear();
+	m_uniforms.lights = TileLightLists();
+	if (!m_renderSettings->getRenderFlag(Lights))
+	{
+		return;
+	}
 
-	VertexInput input;
-	input.viewProjection = m_viewData->modelViewProjectionMatrix;
-	input.model = m_viewData->modelMatrix;
-	for (int32 i = 0; i < 3; i++)
+	const frustumf frustum(m_viewData->viewProjectionMatrix);
+	const auto&	   viewProjection = m_viewData->viewProjectionMatrix.m;
+	// The distance in front of the camera is the clip-space W of a point, which changes by the length of this
+	// gradient for every unit moved in world space
+	const vec3f viewDepthGradient(viewProjection[0][3], viewProjection[1][3], viewProjection[2][3]);
+	const float viewDepthScale = viewDepthGradient.length();
+	const int32 width = m_viewData->width;
+	const int32 height = m_viewData->height;
+
+	const auto prepareLight = [&](const Light& light)
 	{
-		input.position = m_vertexBufferPtr[i].position;
-		input.normal = m_vertexBufferPtr[i].normal;
+		if (light.range <= 0.0f || light.intensity <= 0.0f)
+		{
+			return;
+		}
+		const spheref sphere(light.position, light.range);
+		if (!frustum.intersects(sphere))
+		{
+			return;
+		}
+
+		const float viewDepth = viewDepthGradient.dot(light.position) + viewProjection[3][3];
+		const float nearestViewDepth = viewDepth - light.range * viewDepthScale;
+		const float farthestViewDepth = viewDepth + light.range * viewDepthScale;
 
-		auto output = ScanlineVertexShader::process(input);
-		if (output.position.w > 0.0f)
+		ScanlineLightBounds bounds{ 0, 0, width - 1, height - 1, std::numeric_limits<float>::lowest(),
+			getScreenDepth(*m_viewData, std::max(farthestViewDepth, m_viewData->minZ)) };
+		if (nearestViewDepth > m_viewData->minZ)
+		{
+			bounds.nearestDepth = getScreenDepth(*m_viewData, nearestViewDepth);
+		}
+
+		// Project the corners of the box around the light's range, unless some of them are behind the near plane. The
+		// farthest corner from the center is sqrt(3) times the range away.
+		if (viewDepth - 1.7321f * light.range * viewDepthScale > m_viewData->minZ)
+		{
+			vec2f minCorner(std::numeric_limits<float>::max());
+			vec2f maxCorner(std::numeric_limits<float>::lowest());
+			for (int32 corner = 0; corner < 8; corner++)
+			{
+				const vec3f offset((corner & 1) ? light.range : -light.range, (corner & 2) ? light.range : -light.range,
+					(corner & 4) ? light.range : -light.range);
+				const vec3f screenPoint = Clipping::clipVertex(m_viewData->viewProjectionMatrix * vec4f(light.position + offset, 1.0f), width, height);
+				minCorner = vec2f(std::min(minCorner.x, screenPoint.x), std::min(minCorner.y, screenPoint.y));
+				maxCorner = vec2f(std::max(maxCorner.x, screenPoint.x), std::max(maxCorner.y, screenPoint.y));
+			}
+			bounds.minX = std::max((int32)std::floor(minCorner.x), 0);
+			bounds.minY = std::max((int32)std::floor(minCorner.y), 0);
+			bounds.maxX = std::min((int32)std::floor(maxCorner.x), width - 1);
+			bounds.maxY = std::min((int32)std::floor(maxCorner.y), height - 1);
+			if (bounds.minX > bounds.maxX || bounds.minY > bounds.maxY)
+			{
+				return;
+			}
+		}
+
+		ShaderLight& shaderLight = m_shaderLights.emplace_back();
+		shaderLight.type = light.type;
+		shaderLight.position = light.position;
+		const float directionLength = light.direction.length();
+		shaderLight.direction = directionLength > 0.0f ? light.direction / directionLength : vec3f(0.0f, 0.0f, 1.0f);
+		shaderLight.color = vec3f((float)light.color.r, (float)light.color.g, (float)light.color.b) * (light.intensity / 255.0f);
+		shaderLight.invRangeSquared = 1.0f / (light.range * light.range);
+		const float outerConeAngle = std::max(light.outerConeAngle, 0.0f);
+		const float innerConeAngle = std::clamp(light.innerConeAngle, 0.0f, outerConeAngle);
+		shaderLight.outerConeCos = std::cos(outerConeAngle * DEG_TO_RAD);
+		shaderLight.coneScale = 1.0f / std::max(std::cos(innerConeAngle * DEG_TO_RAD) - shaderLight.outerConeCos, 0.0001f);
+		m_lightBounds.push_back(bounds);
+	};
+
+	if (m_snapshot != nullptr)
+	{
+		for (const Light& light : m_snapshot->lights)
+		{
+			prepareLight(light);
+		}
+	}
+	else
+	{
+		for (const Light* light : m_lights)
 		{
-			m_screenPoints[i] = Clipping::clipVertex(output.position, m_viewData->width, m_viewData->height);
-			m_screenNormals[i] = output.normal;
-			triangleOnScreen = true;
+			prepareLight(*light);
 		}
 	}
+	if (m_shaderLights.empty())
+	{
+		return;
+	}
 
-	// If none of the vertexes are on the screen, the triangle is off-screen and the vertex stage
-	// has failed.
-	if (!triangleOnScreen)
+	// Pixels are lit in world space, from their screen position and depth. Screen positions are mapped back to
+	// normalized device coordinates, with depth reversing `Clipping::clipVertex`, then unprojected.
+	mat4f screenToClip;
+	screenToClip.setZero();
+	screenToClip.m[0][0] = 2.0f / (float)width;
+	screenToClip.m[1][1] = 2.0f / (float)height;
+	screenToClip.m[2][2] = 2.0f;
+	screenToClip.m[3][0] = -1.0f;
+	screenToClip.m[3][1] = -1.0f;
+	screenToClip.m[3][2] = -0.5f;
+	screenToClip.m[3][3] = 1.0f;
+	mat4f viewProjectionMatrix = m_viewData->viewProjectionMatrix;
+	m_uniforms.screenToWorld = screenToClip * viewProjectionMatrix.getInverse();
+
+	m_lightTileCountX = (width + g_lightTileSize - 1) / g_lightTileSize;
+	m_lightTileCountY = (height + g_lightTileSize - 1) / g_lightTileSize;
+	m_tileLights.resize((size_t)m_lightTileCountX * m_lightTileCountY);
+	m_uniforms.lights.lights = m_shaderLights.data();
+	m_uniforms.lights.tiles = m_tileLights.data();
+	m_uniforms.lights.tileCountX = m_lightTileCountX;
+	m_uniforms.lights.tileSize = g_lightTileSize;
+}
+
+bool ScanlineRHI::isCullingLightsByDepthBuffer() const
+{
+	return !m_shaderLights.empty() && m_renderSettings->getDeferredShading() && m_renderSettings->getRenderFlag(Depth);
+}
+
+void ScanlineRHI::cullLights()
+{
+	// Nothing has been drawn yet, so each light tile is bounded by the depth of every triangle overlapping it. The edge
+	// setup bounds the depth of every pixel the rasterizer can produce, including its rounding.
+	m_tileDepthBounds.assign((size_t)m_lightTileCountX * m_lightTileCountY,
+		vec2f(std::numeric_limits<float>::max(), std::numeric_limits<float>::lowest()));
+	const recti screen(0, 0, m_viewData->width, m_viewData->height);
+	const float padding = isMultisampling() ? g_maxSampleOffset : 0.0f;
+	for (const ScanlineTriangle& triangle : m_triangles)
 	{
-		return false;
+		const RasterTriangle rasterTriangle(triangle.screenPoints[0], triangle.screenPoints[1], triangle.screenPoints[2], screen, padding);
+		if (rasterTriangle.isEmpty())
+		{
+			continue;
+		}
+
+		for (int32 tileY = rasterTriangle.minY / g_lightTileSize; tileY <= rasterTriangle.maxY / g_lightTileSize; tileY++)
+		{
+			for (int32 tileX = rasterTriangle.minX / g_lightTileSize; tileX <= rasterTriangle.maxX / g_lightTileSize; tileX++)
+			{
+				vec2f& depthBounds = m_tileDepthBounds[tileY * m_lightTileCountX + tileX];
+				depthBounds.x = std::min(depthBounds.x, rasterTriangle.nearestDepth);
+				depthBounds.y = std::max(depthBounds.y, rasterTriangle.farthestDepth);
+			}
+		}
 	}
 
-	// Check back-facing
-	auto  normal = (m_screenNormals[0] + m_screenNormals[1] + m_screenNormals[2]) / 3.0f;
-	float dotNormal = (-m_viewData->cameraDirection).dot(normal);
-	if (dotNormal > 0.0f)
+	m_threadPool->parallelFor(m_lightTileCountX * m_lightTileCountY, [this](const int32 tileIndex, int32)
 	{
-		return false;
+		cullTileLights(tileIndex, m_tileDepthBounds[tileIndex]);
+	});
+}
+
+void ScanlineRHI::cullLights(const recti& bounds)
+{
+	for (int32 y = bounds.y; y < bounds.y + bounds.height; y += g_lightTileSize)
+	{
+		for (int32 x = bounds.x; x < bounds.x + bounds.width; x += g_lightTileSize)
+		{
+			const int32 tileIndex = (y / g_lightTileSize) * m_lightTileCountX + x / g_lightTileSize;
+			cullTileLights(tileIndex, m_depthBuffer->getBounds(recti(x, y, g_lightTileSize, g_lightTileSize)));
+		}
 	}
+}
 
-	// Check the order of the vertexes on the screen. If they are
-	EWindingOrder order = Math::getWindingOrder(m_screenPoints[0], m_screenPoints[1], m_screenPoints[2]);
-	switch (order)
+void ScanlineRHI::cullTileLights(const int32 tileIndex, const vec2f& depthBounds)
+{
+	std::vector<int32>& tileLights = m_tileLights[tileIndex];
+	tileLights.clear();
+	if (depthBounds.x > depthBounds.y)
 	{
-		case EWindingOrder::Clockwise: // Triangle is back-facing, exit
-		case EWindingOrder::CoLinear:  // Triangle has zero area, exit
-			return false;
-		case EWindingOrder::CounterClockwise: // Triangle is front-facing, continue
-			break;
+		return;
 	}
 
-	return true;
+	const int32 minX = (tileIndex % m_lightTileCountX) * g_lightTileSize;
+	const int32 minY = (tileIndex / m_lightTileCountX) * g_lightTileSize;
+	const int32 maxX = minX + g_lightTileSize - 1;
+	const int32 maxY = minY + g_lightTileSize - 1;
+	for (int32 index = 0; index < (int32)m_lightBounds.size(); index++)
+	{
+		const ScanlineLightBounds& bounds = m_lightBounds[index];
+		if (bounds.maxX < minX || bounds.minX > maxX || bounds.maxY < minY || bounds.minY > maxY
+			|| bounds.nearestDepth > depthBounds.y || bounds.farthestDepth < depthBounds.x)
+		{
+			continue;
+		}
+		tileLights.push_back(index);
+	}
 }
 
-void ScanlineRHI::rasterStage()
+void ScanlineRHI::drawTriangles()
 {
-	// Clear pixel buffer prior to rasterization
-	m_pixelBuffer.clear();
+	const recti			   screen(0, 0, m_viewData->width, m_viewData->height);
+	if (m_renderSettings->getDeferredShading())
+	{
+		// Find the visible triangle at each pixel, then shade each pixel exactly once
+		m_visibilityBuffer->clear();
+		for (int32 index = 0; index < (int32)m_triangles.size(); index++)
+		{
+			visibilityStage(index, screen);
+		}
+		if (isCullingLightsByDepthBuffer())
+		{
+			cullLights(screen);
+		}
+		(this->*m_resolveStage)(screen);
+		return;
+	}
+
+	// Rasterize and shade each triangle
+	ScanlineThreadContext& context = m_threadContexts[0];
+	for (const ScanlineTriangle& triangle : m_triangles)
+	{
+		(this->*m_rasterStage)(triangle, screen, context);
+	}
+}
 
-	Vertex3 v0 = m_vertexBufferPtr[0];
-	Vertex3 v1 = m_vertexBufferPtr[1];
-	Vertex3 v2 = m_vertexBufferPtr[2];
+void ScanlineRHI::binTriangles()
+{
+	m_tileCountX = (m_viewData->width + g_tileSize - 1) / g_tileSize;
+	m_tileCountY = (m_viewData->height + g_tileSize - 1) / g_tileSize;
 
-	vec3f s0 = m_screenPoints[0];
-	vec3f s1 = m_screenPoints[1];
-	vec3f s2 = m_screenPoints[2];
+	// Clear the bins, keeping their memory around for the next frame
+	m_tileBins.resize(m_tileCountX * m_tileCountY);
+	for (std::vector<int32>& bin : m_tileBins)
+	{
+		bin.clear();
+	}
 
-	// Compute the bounds of just this triangle on the screen
-	int32 width = m_viewData->width;
-	int32 height = m_viewData->height;
+	const int32 maxX = m_viewData->width - 1;
+	const int32 maxY = m_viewData->height - 1;
+	// Multisampled triangles may cover samples of pixels just outside their bounds, matching RasterTriangle
+	const float padding = isMultisampling() ? g_maxSampleOffset : 0.0f;
+	for (int32 index = 0; index < (int32)m_triangles.size(); index++)
+	{
+		const ScanlineTriangle& triangle = m_triangles[index];
+		rectf					bounds = rectf::makeBoundingBox(triangle.screenPoints[0], triangle.screenPoints[1], triangle.screenPoints[2]);
+
+		int32 minX = std::max(static_cast<int32>(bounds.min().x - padding), 0);
+		int32 minY = std::max(static_cast<int32>(bounds.min().y - padding), 0);
+		int32 boundsMaxX = std::min(static_cast<int32>(bounds.max().x + padding), maxX);
+		int32 boundsMaxY = std::min(static_cast<int32>(bounds.max().y + padding), maxY);
+		if (minX > boundsMaxX || minY > boundsMaxY)
+		{
+			continue;
+		}
 
-	rectf bounds = rectf::makeBoundingBox(s0, s1, s2);
+		// Add this triangle to every tile its bounding box overlaps
+		for (int32 tileY = minY / g_tileSize; tileY <= boundsMaxY / g_tileSize; tileY++)
+		{
+			for (int32 tileX = minX / g_tileSize; tileX <= boundsMaxX / g_tileSize; tileX++)
+			{
+				m_tileBins[tileY * m_tileCountX + tileX].emplace_back(index);
+			}
+		}
+	}
+}
 
-	vec2f boundsMin = bounds.min();
-	vec2f boundsMax = bounds.max();
-	int32 minX = std::max(static_cast<int32>(boundsMin.x), 0);
-	int32 maxX = std::min(static_cast<int32>(boundsMax.x), width - 1);
-	int32 minY = std::max(static_cast<int32>(boundsMin.y), 0);
-	int32 maxY = std::min(static_cast<int32>(boundsMax.y), height - 1);
+void ScanlineRHI::clearTiles()
+{
+	m_tileCountX = (m_viewData->width + g_tileSize - 1) / g_tileSize;
+	m_tileCountY = (m_viewData->height + g_tileSize - 1) / g_tileSize;
+	const uint8 clears = TileClearColor | TileClearDepth | (isMultisampling() ? TileClearSamples : TileClearNone);
+	m_tileClears.assign((size_t)m_tileCountX * m_tileCountY, clears);
+
+	// Compute the background gradient once per frame, rather than for every tile
+	const Color bgColor = Color::fromRgba(80, 128, 200);
+	m_backgroundRows.resize(m_viewData->height);
+	for (int32 i = 0; i < m_viewData->height; i++)
+	{
+		const float perc = (float)i / (float)m_viewData->height;
+		m_backgroundRows[i] = (uint32)(bgColor * Math::remap(perc, 0.0f, 1.0f, 0.1f, 1.0f)).toInt32();
+	}
+}
 
-	// Pre-compute the area of the screen triangle so we're not computing it every pixel
-	float area = Math::area2D(s0, s1, s2) * 2.0f;
-	float oneOverArea = 1.0f / area;
+void ScanlineRHI::prepareTiles(const recti& bounds, const uint8 clears) const
+{
+	const int32 minTileX = std::max(bounds.x, 0) / g_tileSize;
+	const int32 minTileY = std::max(bounds.y, 0) / g_tileSize;
+	const int32 maxTileX = std::min((bounds.x + bounds.width - 1) / g_tileSize, m_tileCountX - 1);
+	const int32 maxTileY = std::min((bounds.y + bounds.height - 1) / g_tileSize, m_tileCountY - 1);
+	for (int32 tileY = minTileY; tileY <= maxTileY; tileY++)
+	{
+		for (int32 tileX = minTileX; tileX <= maxTileX; tileX++)
+		{
+			const int32 tileIndex = tileY * m_tileCountX + tileX;
+			const uint8 owed = m_tileClears[tileIndex] & clears;
+			if (owed != TileClearNone)
+			{
+				clearTile(tileIndex, owed);
+				m_tileClears[tileIndex] &= ~owed;
+			}
+		}
+	}
+}
 
-	// Loop through all pixels in the screen bounding box.
-	for (int32 y = minY; y <= maxY; y++)
+void ScanlineRHI::resolveTiles()
+{
+	// Nothing reads the depth of untouched tiles after this, so only their color is cleared
+	for (int32 tileIndex = 0; tileIndex < (int32)m_tileClears.size(); tileIndex++)
 	{
-		for (int32 x = minX; x <= maxX; x++)
+		if (m_tileClears[tileIndex] & TileClearColor)
 		{
-			vec3f point((float)x, (float)y, 0);
+			clearTile(tileIndex, TileClearColor);
+			m_tileClears[tileIndex] &= ~TileClearColor;
+		}
+	}
+}
 
-			// Use Pineda's edge function to determine if the current pixel is within the triangle.
-			float w0 = Math::edgeFunction(s1, s2, point);
-			float w1 = Math::edgeFunction(s2, s0, point);
-			float w2 = Math::edgeFunction(s0, s1, point);
+void ScanlineRHI::resolveSamples()
+{
+	const uint32* samples = m_sampleBuffer->getData<uint32>();
+	const int32	  samplePitch = m_sampleBuffer->getWidth();
+	uint32*		  pixels = m_frameBuffer->getData<uint32>();
+	const int32	  pitch = m_frameBuffer->getWidth();
 
-			if (w0 > 0.0f || w1 > 0.0f || w2 > 0.0f)
+	m_threadPool->parallelFor(m_tileCountX * m_tileCountY, [&](const int32 tileIndex, int32)
+	{
+		// Tiles no triangle reached never filled their samples, and the frame buffer already holds their color
+		if (m_tileClears[tileIndex] & TileClearSamples)
+		{
+			return;
+		}
+
+		const int32 x = (tileIndex % m_tileCountX) * g_tileSize;
+		const int32 y = (tileIndex / m_tileCountX) * g_tileSize;
+		const int32 width = std::min(g_tileSize, m_viewData->width - x);
+		const int32 height = std::min(g_tileSize, m_viewData->height - y);
+		for (int32 row = y; row < y + height; row++)
+		{
+			const uint32* sampleLine = samples + (size_t)row * samplePitch;
+			uint32*		  line = pixels + (size_t)row * pitch;
+			for (int32 column = x; column < x + width; column++)
 			{
-				continue;
+				line[column] = averageSamples(sampleLine + column * g_sampleCount);
 			}
+		}
+	});
+}
 
-			// From the edge vectors, extrapolate the barycentric coordinates for this pixel.
-			w0 *= oneOverArea;
-			w1 *= oneOverArea;
-			w2 *= oneOverArea;
-
-			vec3f bary;
-			bary.x = w0;
-			bary.y = w1;
-			bary.z = w2;
+void ScanlineRHI::clearTile(const int32 tileIndex, const uint8 clears) const
+{
+	const int32 x = (tileIndex % m_tileCountX) * g_tileSize;
+	const int32 y = (tileIndex / m_tileCountX) * g_tileSize;
+	const int32 width = std::min(g_tileSize, m_viewData->width - x);
+	const int32 height = std::min(g_tileSize, m_viewData->height - y);
 
-			float z = 0;
-			if (m_renderSettings->getRenderFlag(Depth))
+	if (clears & TileClearColor)
+	{
+		uint32*		pixels = m_frameBuffer->getData<uint32>();
+		const int32 pitch = m_frameBuffer->getWidth();
+		for (int32 row = y; row < y + height; row++)
+		{
+			uint32* line = pixels + (size_t)row * pitch;
+			std::fill(line + x, line + x + width, m_backgroundRows[row]);
+		}
+	}
+	if (clears & TileClearDepth)
+	{
+		m_depthBuffer->clear(recti(x, y, width, height));
+	}
+	if (clears & TileClearSamples)
+	{
+		// Every sample starts as the color already in the frame buffer, so the grid and anything else drawn before
+		// the triangles survives the resolve
+		const uint32* pixels = m_frameBuffer->getData<uint32>();
+		const int32	  pitch = m_frameBuffer->getWidth();
+		uint32*		  samples = m_sampleBuffer->getData<uint32>();
+		float*		  sampleDepths = m_sampleDepthBuffer->getData<float>();
+		const int32	  samplePitch = m_sampleBuffer->getWidth();
+		for (int32 row = y; row < y + height; row++)
+		{
+			const uint32* line = pixels + (size_t)row * pitch;
+			uint32*		  sampleLine = samples + (size_t)row * samplePitch;
+			for (int32 column = x; column < x + width; column++)
 			{
-				// Interpolate depth given the barycentric coordinates
-				z = bary.x * -s0.z + bary.y * -s1.z + bary.z * -s2.z;
-
-				// Compare the new depth to the current depth at this pixel. If the new depth is further than
-				// the current depth, continue.
-				float oldZ = m_depthBuffer->getPixelAsFloat(x, y);
-				if (z > oldZ)
-				{
-					continue;
-				}
-				// If the new depth is closer than the current depth, set the current depth
-				// at this pixel to the new depth we just got.
-				m_depthBuffer->setPixelFromFloat(x, y, z);
+				std::fill_n(sampleLine + column * g_sampleCount, g_sampleCount, line[column]);
 			}
 
-			PixelData pixel;
-			pixel.width = m_viewData->width;
-			pixel.height = m_viewData->height;
-			pixel.depth = z;
-			pixel.distance = bary;
+			float* depthLine = sampleDepths + (size_t)row * samplePitch;
+			std::fill(depthLine + x * g_sampleCount, depthLine + (x + width) * g_sampleCount, g_clearDepth);
+		}
+	}
+}
 
-			// Compute World Position of the current pixel
-			pixel.position = point; // local
-			pixel.worldPosition = v0.position * bary.x + v1.position * bary.y + v2.position * bary.z;
+void ScanlineRHI::drawTiles()
+{
+	binTriangles();
 
-			// Compute the UV coordinates of the current pixel
-			pixel.uv = v0.texCoord * bary.x + v1.texCoord * bary.y + v2.texCoord * bary.z;
+	// Each tile owns its own region of the frame and depth buffers, so tiles can be rasterized and
+	// shaded on any thread without locking. Triangles within a tile are drawn in submission order,
+	// so the result is identical to drawing serially.
+	m_threadPool->parallelFor(m_tileCountX * m_tileCountY, [this](const int32 tileIndex, const int32 threadIndex)
+	{
+		const std::vector<int32>& bin = m_tileBins[tileIndex];
+		if (bin.empty())
+		{
+			return;
+		}
 
-			// Compute the Normal direction of the current pixel
-			pixel.worldNormal = m_screenNormals[0] * bary.x + m_screenNormals[1] * bary.y + m_screenNormals[2] * bary.z;
-			pixel.cameraNormal = m_viewData->cameraDirection;
+		const int32 x = (tileIndex % m_tileCountX) * g_tileSize;
+		const int32 y = (tileIndex / m_tileCountX) * g_tileSize;
+		const recti tile(x, y, std::min(g_tileSize, m_viewData->width - x), std::min(g_tileSize, m_viewData->height - y));
 
-			// Set the texture
-			pixel.texture = m_texturePtr;
+		if (m_renderSettings->getDeferredShading())
+		{
+			uint32* visibility = m_visibilityBuffer->getData<uint32>();
+			for (int32 row = tile.y; row < tile.y + tile.height; row++)
+			{
+				uint32* line = visibility + (size_t)row * m_visibilityBuffer->getWidth();
+				std::fill(line + tile.x, line + tile.x + tile.width, 0);
+			}
+			for (const int32 triangleIndex : bin)
+			{
+				visibilityStage(triangleIndex, tile);
+			}
+			if (isCullingLightsByDepthBuffer())
+			{
+				cullLights(tile);
+			}
+			(this->*m_resolveStage)(tile);
+			return;
+		}
 
-			// Add to the fragment buffer
-			m_pixelBuffer.emplace_back(pixel);
+		ScanlineThreadContext& context = m_threadContexts[threadIndex];
+		for (const int32 triangleIndex : bin)
+		{
+			(this->*m_rasterStage)(m_triangles[triangleIndex], tile, context);
 		}
+	});
+}
+
+void ScanlineRHI::drawUI(Widget* w)
+{
+	//// Draw all UI elements
+	//if (w)
+	//{
+	//	w->paint(m_painter.get());
+	//	for (Widget* w : w->getChildren())
+	//	{
+	//		drawUI(w);
+	//	}
+	//}
+}
+
+void ScanlineRHI::addRenderable(IRenderable* renderable)
+{
+	// Reference the current renderable's geometry, rather than copying it
+	MeshDescription desc{};
+	desc.mesh = renderable->getMesh();
+	desc.stride = sizeof(Vertex3);
+	desc.renderable = renderable;
+	updateMeshDescription(desc);
+
+	// Renderables in the scene are culled through its bounding volume hierarchy
+	const int32 index = (int32)m_meshDescriptions.size();
+	if (g_objectManager.getRenderableTree()->contains(renderable))
+	{
+		m_sceneDescriptions[renderable] = index;
+	}
+	else
+	{
+		m_untrackedDescriptions.push_back(index);
 	}
+
+	// Add to mesh descriptions
+	m_meshDescriptions.emplace_back(desc);
+}
+
+void ScanlineRHI::addLight(Light* light)
+{
+	m_lights.push_back(light);
 }
 
-void ScanlineRHI::fragmentStage() const
+void ScanlineRHI::captureFrame(FrameSnapshot& snapshot) const
 {
-	// Render each pixel
-	for (const auto& pixel : m_pixelBuffer)
+	// Actors cache their world matrices, so this is just a copy for any which haven't moved
+	snapshot.meshes.resize(m_meshDescriptions.size());
+	for (size_t i = 0; i < m_meshDescriptions.size(); i++)
+	{
+		snapshot.meshes[i] = captureMesh(m_meshDescriptions[i], snapshot.viewData, snapshot.settings);
+	}
+
+	snapshot.visibleRenderables.clear();
+	if (!m_sceneDescriptions.empty())
+	{
+		g_objectManager.getRenderableTree()->queryFrustum(frustumf(snapshot.viewData.viewProjectionMatrix), snapshot.visibleRenderables);
+	}
+
+	snapshot.lights.resize(m_lights.size());
+	for (size_t i = 0; i < m_lights.size(); i++)
 	{
-		Color color = ScanlinePixelShader::process(pixel);
-		m_frameBuffer->setPixelFromColor(pixel.position.x, pixel.position.y, color);
+		snapshot.lights[i] = *m_lights[i];
 	}
 }
 
-void ScanlineRHI::drawTriangle(Vertex3* vertex)
+void ScanlineRHI::setFrameSnapshot(const FrameSnapshot* snapshot)
+{
+	m_snapshot = snapshot;
+}
+
+void ScanlineRHI::updateMeshDescription(MeshDescription& desc)
+{
+	auto vertexData = desc.mesh->getVertexData();
+	auto indexData = desc.mesh->getIndexData();
+
+	desc.data = vertexData.data();
+	desc.byteSize = vertexData.size_bytes();
+	desc.vertexCount = desc.byteSize / sizeof(Vertex3);
+	desc.indexes = indexData.data();
+	desc.indexCount = indexData.size();
+	desc.version = desc.mesh->getVersion();
+}
+
+MeshSnapshot ScanlineRHI::captureMesh(const MeshDescription& desc, const ViewData& viewData, const RenderSettings& settings)
 {
-	// Set the vertex buffer pointer to the current vertex.
-	m_vertexBufferPtr = vertex;
+	const Mesh& mesh = *desc.mesh;
 
-	// Run the vertex shader
-	if (!vertexStage())
+	MeshSnapshot snapshot;
+	snapshot.worldMatrix = desc.renderable->getWorldMatrix();
+	snapshot.bounds = mesh.getBounds();
+	snapshot.boundingSphere = mesh.getBoundingSphere();
+	snapshot.version = mesh.getVersion();
+
+	// Distant meshes are drawn from a simplified level of detail
+	if (const int32 level = selectLod(mesh, snapshot.worldMatrix, viewData, settings.getLodThreshold()); level > 0)
 	{
-		return;
+		snapshot.vertices = mesh.getLod(level).getVertexData();
+		snapshot.indexes = mesh.getLod(level).getIndexData();
 	}
+	else
+	{
+		snapshot.vertices = mesh.getVertexData();
+		snapshot.indexes = mesh.getIndexData();
+	}
+	return snapshot;
+}
 
-	if (m_renderSettings->getRenderFlag(Shaded))
+int32 ScanlineRHI::selectLod(const Mesh& mesh, const mat4f& model, const ViewData& viewData, const float threshold)
+{
+	const int32 lodCount = mesh.getLodCount();
+	if (threshold <= 0.0f || lodCount == 1)
 	{
-		// Rasterize the triangle
-		rasterStage();
+		return 0;
+	}
 
-		// Run the pixel shader
-		fragmentStage();
+	// The model matrix includes the scale of every parent, so measure the scale from the length of its basis rows
+	float maxScale = 0.0f;
+	for (int32 row = 0; row < 3; row++)
+	{
+		maxScale = std::max(maxScale, vec3f(model.m[row][0], model.m[row][1], model.m[row][2]).length());
 	}
 
-	// Draw wireframe
-	if (m_renderSettings->getRenderFlag(Wireframe))
+	// Find the distance from the camera to the nearest point of the mesh's world-space bounding sphere
+	const spheref& sphere = mesh.getBoundingSphere();
+	const vec4f center = model * vec4f(sphere.center, 1.0f);
+	const float distance = (vec3f(center.x, center.y, center.z) - viewData.cameraTranslation).length() - sphere.radius * maxScale;
+	if (distance <= viewData.minZ)
 	{
-		drawWireframe();
+		return 0;
 	}
 
-	if (m_renderSettings->getRenderFlag(Normals))
+	// An object-space error of `error` covers roughly this many pixels at that distance
+	const float pixelsPerUnit = (float)viewData.height / (2.0f * std::tan(viewData.fov * DEG_TO_RAD * 0.5f));
+	const float errorScale = maxScale * pixelsPerUnit / distance;
+
+	for (int32 level = lodCount - 1; level > 0; level--)
 	{
-		drawNormal();
+		if (mesh.getLod(level).error * errorScale <= threshold)
+		{
+			return level;
+		}
 	}
+	return 0;
 }
 
-void ScanlineRHI::drawWireframe() const
+void ScanlineRHI::endDraw() {}
+
+void ScanlineRHI::vertexStage(const Vertex3* vertices, const int32 vertexCount)
 {
-	auto s0 = m_screenPoints[0];
-	auto s1 = m_screenPoints[1];
-	auto s2 = m_screenPoints[2];
+	// Run the vertex shader on batches of vertexes. This is assuming the output is the final projected
+	// vertex position in homogeneous clip space.
+	m_vertexCache.resize(vertexCount);
 
-	std::vector<vec2f> pixels{};
-	computeLinePixels(s0, s1, pixels);
-	computeLinePixels(s1, s2, pixels);
-	computeLinePixels(s2, s0, pixels);
-	for (const auto& p : pixels)
+	VertexBatch		  input;
+	VertexBatchOutput output;
+	for (int32 first = 0; first < vertexCount; first += g_shaderBatchSize)
 	{
-		m_frameBuffer->setPixelFromColor(p.x, p.y, m_renderSettings->getWireColor());
+		// Gather the batch into structure of arrays form, zeroing any lanes past the end of the mesh
+		VertexPipeline::loadBatch(vertices + first, std::min(g_shaderBatchSize, vertexCount - first), input);
+
+		m_vertexShader->process(input, output);
+
+		// Project the batch to the screen and compute its clip codes while it is still in cache. The cache is
+		// padded to whole batches, so lanes past the end of the mesh are stored too.
+		VertexPipeline::storeBatch(output, m_viewData->width, m_viewData->height, first, m_vertexCache);
 	}
 }
 
-void ScanlineRHI::drawNormal()
+void ScanlineRHI::primitiveStage(const Vertex3* vertices, const uint32* indexes, std::vector<ScanlineTriangle>& triangles) const
 {
-	auto v0 = m_vertexBufferPtr[0];
-	auto v1 = m_vertexBufferPtr[1];
-	auto v2 = m_vertexBufferPtr[2];
+	// Read the transformed vertexes of this triangle from the vertex cache. Back-facing triangles and those
+	// outside the view frustum have already been culled.
+	const Vertex3 vertex[3] = { vertices[indexes[0]], vertices[indexes[1]], vertices[indexes[2]] };
+	vec3f		  normals[3];
+	for (int32 i = 0; i < 3; i++)
+	{
+		normals[i] = m_vertexCache.getNormal((int32)indexes[i]);
+	}
 
-	// Render normal direction
-	if (m_renderSettings->getRenderFlag(Normals))
+	const auto emitTriangle = [&](const ScanlineTriangle& triangle)
+	{
+		// Texture coordinates are interpolated linearly in screen space, so their derivatives are the same for
+		// every pixel of the triangle
+		ScanlineTriangle& emitted = triangles.emplace_back(triangle);
+		const vec3f		  edge1 = triangle.screenPoints[1] - triangle.screenPoints[0];
+		const vec3f		  edge2 = triangle.screenPoints[2] - triangle.screenPoints[0];
+		const vec2f		  uv1 = triangle.vertices[1].texCoord - triangle.vertices[0].texCoord;
+		const vec2f		  uv2 = triangle.vertices[2].texCoord - triangle.vertices[0].texCoord;
+		const float		  oneOverDet = 1.0f / (edge1.x * edge2.y - edge2.x * edge1.y);
+		emitted.uvDx = (uv1 * edge2.y - uv2 * edge1.y) * oneOverDet;
+		emitted.uvDy = (uv2 * edge1.x - uv1 * edge2.x) * oneOverDet;
+	};
+
+	// Triangles within the near plane and the guard band were projected by the vertex stage, and their winding
+	// already tested. Anything past the guard band on screen is left for the rasterizer to clamp to the bounds
+	// being drawn.
+	const int32 planes = m_vertexCache.getGuardBandCode((int32)indexes[0]) | m_vertexCache.getGuardBandCode((int32)indexes[1])
+		| m_vertexCache.getGuardBandCode((int32)indexes[2]);
+	if (planes == 0)
 	{
-		// Get the center of the triangle
-		vec3f triangleCenter = (v0.position + v1.position + v2.position) / 3.0f;
+		ScanlineTriangle triangle;
+		for (int32 i = 0; i < 3; i++)
+		{
+			triangle.vertices[i] = vertex[i];
+			triangle.screenPoints[i] = m_vertexCache.getScreenPoint((int32)indexes[i]);
+			triangle.normals[i] = normals[i];
+		}
+		emitTriangle(triangle);
+		return;
+	}
 
-		// Get the computed triangle normal (average of the three normals)
-		vec3f triangleNormal = (v0.normal + v1.normal + v2.normal) / 3.0f;
+	// Otherwise clip the triangle in clip space, before the divide by W, and split the resulting polygon
+	// into a fan of triangles. Attributes are interpolated from the original vertexes.
+	const vec4f positions[3] = { m_vertexCache.getPosition((int32)indexes[0]), m_vertexCache.getPosition((int32)indexes[1]),
+		m_vertexCache.getPosition((int32)indexes[2]) };
+	Clipping::ClipVertex polygon[Clipping::g_maxClipVertices];
+	const int32			 count = Clipping::clipTriangle(positions, planes, polygon);
+	for (int32 i = 1; i + 1 < count; i++)
+	{
+		ScanlineTriangle triangle;
+		const int32		 indices[3] = { 0, i, i + 1 };
+		for (int32 j = 0; j < 3; j++)
+		{
+			const Clipping::ClipVertex& clipVertex = polygon[indices[j]];
+			const vec3f&				w = clipVertex.weights;
 
-		vec3f normalStartScreen;
-		vec3f normalEndScreen;
+			Vertex3& clipped = triangle.vertices[j];
+			clipped.position = vertex[0].position * w.x + vertex[1].position * w.y + vertex[2].position * w.z;
+			clipped.normal = vertex[0].normal * w.x + vertex[1].normal * w.y + vertex[2].normal * w.z;
+			clipped.texCoord = vertex[0].texCoord * w.x + vertex[1].texCoord * w.y + vertex[2].texCoord * w.z;
 
-		// Compute two screen-space points:
-		// 1. The center of the triangle
-		// 2. 1 unit out from the center of the triangle, in the direction the triangle is facing
-		Math::projectWorldToScreen(triangleCenter, normalStartScreen, *m_viewData);
-		Math::projectWorldToScreen(triangleCenter + triangleNormal, normalEndScreen, *m_viewData);
+			triangle.screenPoints[j] = Clipping::clipVertex(clipVertex.position, m_viewData->width, m_viewData->height);
+			triangle.normals[j] = normals[0] * w.x + normals[1] * w.y + normals[2] * w.z;
+		}
 
-		// Draw the line between the two points
-		auto normalColor = Color::yellow();
-		drawLine(
-			normalStartScreen, // Start
-			normalEndScreen,   // End
-			normalColor);	   // Color
+		// Only front-facing triangles with some area on screen are drawn
+		if (Math::getWindingOrder(triangle.screenPoints[0], triangle.screenPoints[1], triangle.screenPoints[2])
+			== EWindingOrder::CounterClockwise)
+		{
+			emitTriangle(triangle);
+		}
 	}
 }
 
-void ScanlineRHI::drawGrid(Grid* grid)
+template <uint8 Features>
+void ScanlineRHI::rasterStage(const ScanlineTriangle& triangle, const recti& bounds, ScanlineThreadContext& context) const
 {
-	if (grid == nullptr)
+	// Clear fragment buffers prior to rasterization
+	context.fragments.clear();
+
+	// Skip the triangle entirely if it is hidden behind everything already drawn
+	constexpr bool		 multisample = (Features & ShadeMultisample) != 0;
+	const RasterTriangle rasterTriangle(triangle.screenPoints[0], triangle.screenPoints[1], triangle.screenPoints[2], bounds,
+		multisample ? g_maxSampleOffset : 0.0f);
+	if (rasterTriangle.isEmpty() || isOccluded(rasterTriangle))
 	{
 		return;
 	}
+	prepareTiles(rasterTriangle.getBounds(), TileClearColor | TileClearDepth | (multisample ? TileClearSamples : TileClearNone));
 
-	Color color = m_renderSettings->getGridColor();
-	for (const line3d& line : grid->getLines())
+	// Find every pixel covered by the triangle which passes the depth test. When multisampling, this is every pixel
+	// with a sample which passes, and each is still shaded once.
+	const int32 written = multisample ? Rasterizer::rasterizeMultisample(rasterTriangle, getRasterDepth(), context.fragments)
+									  : Rasterizer::rasterize(rasterTriangle, getRasterDepth(), context.fragments);
+	if (written > 0)
 	{
-		// Project the world-space points to screen-space
-		vec3f s0, s1;
-		bool  lineOnScreen = false;
-		lineOnScreen |= Math::projectWorldToScreen(line.a, s0, *m_viewData);
-		lineOnScreen |= Math::projectWorldToScreen(line.b, s1, *m_viewData);
+		updateDepthBlocks(rasterTriangle);
+	}
 
-		// If neither of the points are on the screen, return
-		if (!lineOnScreen)
+	// Run the pixel shader on batches of fragments
+	PixelBatch batch;
+	for (const RasterFragment& fragment : context.fragments)
+	{
+		interpolatePixel<Features>(triangle, fragment.x, fragment.y, fragment.bary, fragment.depth, fragment.coverage, batch);
+		if (batch.count == g_shaderBatchSize)
 		{
-			return;
+			shadeBatch<Features>(batch);
 		}
-
-		drawLine(s0, s1, color);
 	}
+	shadeBatch<Features>(batch);
 }
 
-void ScanlineRHI::drawLine(const vec3f& inA, const vec3f& inB, const Color& color)
+void ScanlineRHI::visibilityStage(const int32 triangleIndex, const recti& bounds) const
 {
-	std::vector<vec2f> pixels;
-	computeLinePixels(inA, inB, pixels);
-	for (const auto& p : pixels)
+	RasterTriangle rasterTriangle = m_rasterTriangles[triangleIndex];
+	rasterTriangle.clip(bounds);
+	if (rasterTriangle.isEmpty() || isOccluded(rasterTriangle))
 	{
-		m_frameBuffer->setPixelFromColor(p.x, p.y, color);
+		return;
 	}
-}
+	prepareTiles(rasterTriangle.getBounds());
 
-void ScanlineRHI::computeLinePixels(const vec3f& inA, const vec3f& inB, std::vector<vec2f>& points) const
-{
-	vec2i a((int32)inA.x, (int32)inA.y);
-	vec2i b((int32)inB.x, (int32)inB.y);
-
-	// Clip the screen points within the viewport. If the line points are outside the viewport entirely
-	// then just return.
-	if (!Clipping::clipLine(&a, &b, vec2i{ m_viewData->width, m_viewData->height }))
+	const int32 written = Rasterizer::rasterizeVisibility(rasterTriangle, getRasterDepth(), m_visibilityBuffer->getData<uint32>(),
+		m_visibilityBuffer->getWidth(), triangleIndex + 1);
+	if (written > 0)
 	{
-		return;
+		updateDepthBlocks(rasterTriangle);
 	}
-	/* TODO: This is a temporary fix to prevent m_lines getting clipped and setting one of the points to [0,0]. */
-	if (a == 0.0f || b == 0.0f)
+}
+
+RasterDepth ScanlineRHI::getRasterDepth() const
+{
+	RasterDepth depth;
+	depth.pitch = m_depthBuffer->getPitch();
+	if (m_renderSettings->getRenderFlag(Depth))
 	{
-		return;
+		depth.buffer = m_depthBuffer->getData();
+		depth.format = m_depthBuffer->getFormat();
+		depth.encoding = m_depthBuffer->getEncoding();
+		depth.blockMins = m_depthBuffer->getBlockMins();
+		depth.blockMaxs = m_depthBuffer->getBlockMaxs();
+		depth.blockPitch = m_depthBuffer->getBlockCountX();
+		if (isMultisampling())
+		{
+			depth.samples = m_sampleDepthBuffer->getData<float>();
+		}
 	}
+	return depth;
+}
 
-	bool isSteep = false;
-	if (std::abs(a.x - b.x) < std::abs(a.y - b.y))
+bool ScanlineRHI::isOccluded(const RasterTriangle& triangle) const
+{
+	if (!m_renderSettings->getRenderFlag(Depth))
 	{
-		a = vec2i(a.y, a.x);
-		b = vec2i(b.y, b.x);
-		isSteep = true;
+		return false;
 	}
+	return m_depthBuffer->isOccluded(triangle.getBounds(), triangle.nearestDepth);
+}
 
-	if (a.x > b.x)
+void ScanlineRHI::updateDepthBlocks(const RasterTriangle& triangle) const
+{
+	if (m_renderSettings->getRenderFlag(Depth))
 	{
-		std::swap(a, b);
+		m_depthBuffer->updateBlocks(triangle.getBounds());
 	}
+}
 
-	const int32 deltaX = b.x - a.x;
-	const int32 deltaY = b.y - a.y;
-	const int32 deltaError = std::abs(deltaY) * 2;
-	int32		errorCount = 0;
+template <uint8 Features>
+void ScanlineRHI::resolveStage(const recti& bounds) const
+{
+	const uint32* visibility = m_visibilityBuffer->getData<uint32>();
+	const int32	  pitch = m_visibilityBuffer->getWidth();
 
-	// https://github.com/ssloy/tinyrenderer/issues/28
-	int32 y = a.y;
+	// Batches may span several triangles, as each pixel is interpolated from its own triangle
+	PixelBatch batch;
 
-	if (isSteep)
+	for (int32 y = bounds.y; y < bounds.y + bounds.height; y++)
 	{
-		for (int32 x = a.x; x < b.x; ++x)
+		const uint32* line = visibility + (size_t)y * pitch;
+		for (int32 x = bounds.x; x < bounds.x + bounds.width; x++)
 		{
-			if (y < 0)
+			const uint32 id = line[x];
+			if (id == 0)
 			{
 				continue;
 			}
-			points.push_back(vec2f(y, x));
-			errorCount += deltaError;
-			if (errorCount > deltaX)
+
+			// Rebuild the barycentric coordinates the rasterizer computed for this pixel
+			const RasterTriangle& rasterTriangle = m_rasterTriangles[id - 1];
+			const vec3f			  bary = rasterTriangle.getBarycentrics(x, y);
+			const float			  z = (Features & ShadeDepthTest) != 0 ? rasterTriangle.getDepth(bary) : 0.0f;
+
+			interpolatePixel<Features>(m_triangles[id - 1], x, y, bary, z, g_fullCoverage, batch);
+			if (batch.count == g_shaderBatchSize)
 			{
-				y += (b.y > a.y ? 1 : -1);
-				errorCount -= deltaX * 2;
+				shadeBatch<Features>(batch);
 			}
 		}
 	}
-	else
+	shadeBatch<Features>(batch);
+}
+
+template <uint8 Features>
+void ScanlineRHI::interpolatePixel(const ScanlineTriangle& triangle, const int32 x, const int32 y, const vec3f& bary, const float depth,
+	const uint8 coverage, PixelBatch& batch)
+{
+	const int32 lane = batch.count++;
+	batch.x[lane] = x;
+	batch.y[lane] = y;
+	batch.depth[lane] = depth;
+	if constexpr ((Features & ShadeMultisample) != 0)
+	{
+		batch.coverage[lane] = coverage;
+	}
+
+	if constexpr ((Features & ShadeTextured) != 0)
+	{
+		// Compute the UV coordinates of the current pixel
+		const vec2f uv = triangle.vertices[0].texCoord * bary.x + triangle.vertices[1].texCoord * bary.y
+			+ triangle.vertices[2].texCoord * bary.z;
+		batch.u[lane] = uv.x;
+		batch.v[lane] = uv.y;
+		batch.uvDx[lane] = triangle.uvDx;
+		batch.uvDy[lane] = triangle.uvDy;
+	}
+
+	if constexpr ((Features & ShadeLit) != 0)
+	{
+		// Lights need the depth of every pixel to find its position, even when it wasn't depth tested. The weights sum
+		// to -1, matching the rasterizer's negated vertex depths.
+		batch.depth[lane] = -(triangle.screenPoints[0].z * bary.x + triangle.screenPoints[1].z * bary.y + triangle.screenPoints[2].z * bary.z);
+
+		// Compute the Normal direction of the current pixel
+		const vec3f normal = triangle.normals[0] * bary.x + triangle.normals[1] * bary.y + triangle.normals[2] * bary.z;
+		batch.normalX[lane] = normal.x;
+		batch.normalY[lane] = normal.y;
+		batch.normalZ[lane] = normal.z;
+	}
+}
+
+template <uint8 Features>
+void ScanlineRHI::shadeBatch(PixelBatch& batch) const
+{
+	if (batch.count == 0)
 	{
-		for (int32 x = a.x; x < b.x; ++x)
+		return;
+	}
+
+	Color colors[g_shaderBatchSize];
+	m_pixelShader->process(batch, colors);
+	if constexpr ((Features & ShadeMultisample) != 0)
+	{
+		// Each pixel is shaded once, and its color is written to every sample the triangle covers
+		uint32*		samples = m_sampleBuffer->getData<uint32>();
+		const int32 pitch = m_sampleBuffer->getWidth();
+		for (int32 i = 0; i < batch.count; i++)
 		{
-			if (y < 0)
+			const uint32 color = (uint32)colors[i].toInt32();
+			uint32*		 pixelSamples = samples + (size_t)batch.y[i] * pitch + batch.x[i] * g_sampleCount;
+			for (uint32 mask = batch.coverage[i]; mask != 0; mask &= mask - 1)
 			{
-				continue;
-			}
-			points.push_back(vec2f(x, y));
-			errorCount += deltaError;
-			if (errorCount > deltaX)
-			{
-				y += (b.y > a.y ? 1 : -1);
-				errorCount -= deltaX * 2;
+				pixelSamples[std::countr_zero(mask)] = color;
 			}
 		}
 	}
+	else
+	{
+		for (int32 i = 0; i < batch.count; i++)
+		{
+			m_frameBuffer->setPixelFromColor(batch.x[i], batch.y[i], colors[i]);
+		}
+	}
+	batch.count = 0;
+}
+
+void ScanlineRHI::addWireframe(const ScanlineTriangle& triangle)
+{
+	const Color color = m_renderSettings->getWireColor();
+	const vec2f s0(triangle.screenPoints[0].x, triangle.screenPoints[0].y);
+	const vec2f s1(triangle.screenPoints[1].x, triangle.screenPoints[1].y);
+	const vec2f s2(triangle.screenPoints[2].x, triangle.screenPoints[2].y);
+	m_lineBatch.addScreenLine(s0, s1, color);
+	m_lineBatch.addScreenLine(s1, s2, color);
+	m_lineBatch.addScreenLine(s2, s0, color);
+}
+
+void ScanlineRHI::addNormal(const ScanlineTriangle& triangle)
+{
+	const Vertex3& v0 = triangle.vertices[0];
+	const Vertex3& v1 = triangle.vertices[1];
+	const Vertex3& v2 = triangle.vertices[2];
+
+	// Get the center of the triangle
+	const vec3f triangleCenter = (v0.position + v1.position + v2.position) / 3.0f;
+
+	// Get the computed triangle normal (average of the three normals)
+	const vec3f triangleNormal = (v0.normal + v1.normal + v2.normal) / 3.0f;
+
+	// Draw a line from the center of the triangle to 1 unit out from it, in the direction the triangle is facing.
+	// The line is clipped in clip space, so normals passing behind the camera are still drawn correctly.
+	const vec4f start = m_viewData->viewProjectionMatrix * vec4f(triangleCenter, 1.0f);
+	const vec4f end = m_viewData->viewProjectionMatrix * vec4f(triangleCenter + triangleNormal, 1.0f);
+	m_lineBatch.addClipLine(start, end, Color::yellow());
+}
+
+void ScanlineRHI::flushLines()
+{
+	// Anti-aliased lines also touch the pixel after each step, so pad the bounds of each line by one pixel
+	for (const ScreenLine& line : m_lineBatch.getLines())
+	{
+		const int32 minX = (int32)std::min(line.a.x, line.b.x);
+		const int32 minY = (int32)std::min(line.a.y, line.b.y);
+		const int32 maxX = (int32)std::max(line.a.x, line.b.x) + 2;
+		const int32 maxY = (int32)std::max(line.a.y, line.b.y) + 2;
+		prepareTiles(recti(minX, minY, maxX - minX + 1, maxY - minY + 1));
+	}
+	m_lineBatch.draw(m_frameBuffer.get(), m_renderSettings->getAntiAliasedLines());
+}
+
+void ScanlineRHI::drawGrid(Grid* grid)
+{
+	if (grid == nullptr)
+	{
+		return;
+	}
+
+	// The grid is drawn before any geometry, so draw it straight away rather than with the wireframe
+	m_lineBatch.begin(m_viewData->width, m_viewData->height);
+	const Color color = m_renderSettings->getGridColor();
+	for (const line3d& line : grid->getLines())
+	{
+		const vec4f a = m_viewData->viewProjectionMatrix * vec4f(line.a, 1.0f);
+		const vec4f b = m_viewData->viewProjectionMatrix * vec4f(line.b, 1.0f);
+		m_lineBatch.addClipLine(a, b, color);
+	}
+	flushLines();
+}
+
+void ScanlineRHI::drawLine(const vec3f& inA, const vec3f& inB, const Color& color)
+{
+	m_lineBatch.begin(m_viewData->width, m_viewData->height);
+	m_lineBatch.addScreenLine(vec2f(inA.x, inA.y), vec2f(inB.x, inB.y), color);
+	flushLines();
 }
 
 void ScanlineRHI::resize(int32 width, int32 height)
 {
 	m_frameBuffer->resize({ width, height }, g_maxWindowBufferSize);
-	m_depthBuffer->resize({ width, height }, g_maxWindowBufferSize);
+	m_depthBuffer->resize(width, height);
+	m_visibilityBuffer->resize({ width, height }, g_maxWindowBufferSize);
 	m_painter->setViewport({ 0, 0, width, height });
 }
 
@@ -517,6 +1287,16 @@ void ScanlineRHI::setRenderSettings(RenderSettings* newRenderSettings)
 	m_renderSettings = std::make_shared<RenderSettings>(*newRenderSettings);
 }
 
+void ScanlineRHI::setVertexShader(const std::shared_ptr<ScanlineVertexShader>& shader)
+{
+	m_vertexShader = shader ? shader : std::make_shared<ScanlineVertexShader>();
+}
+
+void ScanlineRHI::setPixelShader(const std::shared_ptr<ScanlinePixelShader>& shader)
+{
+	m_pixelShader = shader ? shader : std::make_shared<ScanlinePixelShader>();
+}
+
 void ScanlineRHI::drawTexture(Texture* texture, const vec2f& position)
 {
 	if (texture == nullptr)
@@ -552,6 +1332,7 @@ void ScanlineRHI::drawTexture(Texture* texture, const vec2f& position)
 	uint32 maxY = bounds.y + bounds.height;
 #endif
 
+	prepareTiles(recti((int32)minX, (int32)minY, (int32)(maxX - minX), (int32)(maxY - minY)));
 	for (auto x = minX; x < maxX; x++)
 	{
 		for (auto y = minY; y < maxY; y++)
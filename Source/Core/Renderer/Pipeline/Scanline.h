@@ -1,9 +1,16 @@
-#pragma once
+﻿#pragma once
 
 #include <memory>
+#include <unordered_map>
 
+#include "DepthBuffer.h"
+#include "LineBatch.h"
+#include "Rasterizer.h"
 #include "RHI.h"
+#include "ScanlineShader.h"
+#include "VertexPipeline.h"
 
+#include "Core/ThreadPool.h"
 #include "Engine/Actors/Camera.h"
 #include "Engine/Mesh.h"
 #include "Renderer/Grid.h"
@@ -13,49 +20,60 @@
 #include "Renderer/UI/Painter.h"
 #include "Renderer/UI/Widget.h"
 
-struct VertexInput
-{
-	vec3f position;
-	vec3f normal;
-	mat4f viewProjection;
-	mat4f model;
-};
+/** Value the depth buffer is cleared to at the start of each frame. **/
+constexpr float g_clearDepth = 10000.0f;
+
+/** Width and height, in pixels, of a single screen tile. Tiles are the unit of tile rendering and of clearing. **/
+constexpr int32 g_tileSize = 64;
 
-struct VertexOutput
+/**
+ * Width and height, in pixels, of the screen tiles lights are culled for. Smaller than the tiles drawn, so each pixel
+ * visits fewer lights, and divides their size evenly.
+ **/
+constexpr int32 g_lightTileSize = 16;
+static_assert(g_tileSize % g_lightTileSize == 0);
+
+/** Clears which are still owed to a single tile of the frame and depth buffers. **/
+enum ETileClear : uint8
 {
-	vec4f position;
-	vec3f normal;
+	TileClearNone    = 0,
+	TileClearColor   = 1 << 0,
+	TileClearDepth   = 1 << 1,
+	/** The sample buffers are filled from the frame buffer and the sample depths are cleared. **/
+	TileClearSamples = 1 << 2
 };
 
-struct PixelData
+/** A single triangle which has passed the vertex stage and is ready to be rasterized. **/
+struct ScanlineTriangle
 {
-	int32 width;
-	int32 height;
-	vec2f position;
-	vec3f normal;
-	vec2f uv;
-	float depth;
-	vec3f worldPosition;
-	vec3f worldNormal;
-	vec3f cameraNormal;
-	vec3f distance;
-	Texture* texture;
+	/** Object-space vertexes of the triangle. **/
+	Vertex3 vertices[3];
+	/** Screen-space position of each vertex. **/
+	vec3f screenPoints[3];
+	/** World-space normal of each vertex. **/
+	vec3f normals[3];
+	/** Change in texture coordinates per pixel along the screen's X and Y axes. These are constant across the triangle. **/
+	vec2f uvDx;
+	vec2f uvDy;
 };
 
-class ScanlineVertexShader : public VertexShader
+/** Screen-space bounds of a light's range, which every tile it may reach overlaps. **/
+struct ScanlineLightBounds
 {
-public:
-	ScanlineVertexShader() = default;
-
-	static VertexOutput process(const VertexInput& input);
+	/** Pixel bounds, inclusive. **/
+	int32 minX;
+	int32 minY;
+	int32 maxX;
+	int32 maxY;
+	/** Nearest and farthest screen-space depth. **/
+	float nearestDepth;
+	float farthestDepth;
 };
 
-class ScanlinePixelShader : public PixelShader
+/** Scratch buffers owned by a single thread, reused between triangles. **/
+struct ScanlineThreadContext
 {
-public:
-	ScanlinePixelShader() = default;
-
-	static Color process(const PixelData& input);
+	std::vector<RasterFragment> fragments;
 };
 
 class ScanlineRHI : public IRHI
@@ -64,31 +82,84 @@ class ScanlineRHI : public IRHI
 	std::shared_ptr<ScanlinePixelShader> m_pixelShader   = nullptr;
 
 	std::shared_ptr<Texture> m_frameBuffer = nullptr;
-	std::shared_ptr<Texture> m_depthBuffer = nullptr;
+	/** Depth of each pixel, in the format chosen by the render settings, and bounds of each block of it. **/
+	std::shared_ptr<DepthBuffer> m_depthBuffer = nullptr;
+	/** ID (index into m_triangles, plus one) of the visible triangle at each pixel when deferred shading is enabled. **/
+	std::shared_ptr<Texture> m_visibilityBuffer = nullptr;
+	/**
+	 * Color and depth of each sample when multisampling, with g_sampleCount consecutive samples per pixel and rows as
+	 * long as the depth buffer's pitch. The depth buffer then holds the farthest depth of each pixel's samples. Only
+	 * allocated once multisampling is enabled.
+	 **/
+	std::shared_ptr<Texture> m_sampleBuffer = nullptr;
+	std::shared_ptr<Texture> m_sampleDepthBuffer = nullptr;
 
 	std::shared_ptr<ViewData> m_viewData = nullptr;
 
 	/** Current model matrix **/
 	mat4f m_modelMatrix;
-	/** Vector of all vertexes in all meshes. **/
-	std::vector<float> m_vertexBuffer;
+	/** Output of the vertex shader for each unique vertex of the mesh currently being drawn. **/
+	VertexCache m_vertexCache;
+	/** Indexes of the triangles of the mesh currently being drawn which survived culling. **/
+	std::vector<uint32> m_visibleTriangles;
 	/** Vector of mesh descriptions of meshes which are currently bound. **/
 	std::vector<MeshDescription> m_meshDescriptions;
-	/** Pointer to the first Vertex3 in the current triangle. **/
-	Vertex3* m_vertexBufferPtr;
+	/** Index into m_meshDescriptions of each renderable tracked by the scene's bounding volume hierarchy. **/
+	std::unordered_map<IRenderable*, int32> m_sceneDescriptions;
+	/** Indexes into m_meshDescriptions of renderables outside the scene, which are always drawn. **/
+	std::vector<int32> m_untrackedDescriptions;
+	/** Renderables in the scene which intersect the view frustum this frame. **/
+	std::vector<IRenderable*> m_visibleRenderables;
+	/** Indexes into m_meshDescriptions to draw this frame, in the order they were added. **/
+	std::vector<int32> m_drawList;
+	/** Snapshot of the scene frames are drawn from, or nullptr to read the live scene. **/
+	const FrameSnapshot* m_snapshot = nullptr;
+	/** Lights added to the scene. **/
+	std::vector<Light*> m_lights;
+	/** Lights within the view frustum this frame, prepared for the pixel shader, and the screen bounds of each. **/
+	std::vector<ShaderLight>		 m_shaderLights;
+	std::vector<ScanlineLightBounds> m_lightBounds;
+	/** Per-light tile list of indexes into m_shaderLights of the lights which may reach the tile. **/
+	std::vector<std::vector<int32>> m_tileLights;
+	int32							m_lightTileCountX = 0;
+	int32							m_lightTileCountY = 0;
+	/** Nearest and farthest depth of anything drawn into each light tile, used to cull lights before drawing. **/
+	std::vector<vec2f> m_tileDepthBounds;
 	/** Pointer to the current texture. */
-	Texture* m_texturePtr;
-	/** 3-element array of the current screen points. */
-	vec3f m_screenPoints[3];
-	vec3f m_screenNormals[3];
-	/** Vector of all pixel fragments in the current triangle. **/
-	std::vector<PixelData> m_pixelBuffer;
+	Texture* m_texturePtr = nullptr;
+	/** Vector of all triangles in the current frame which passed the vertex stage. **/
+	std::vector<ScanlineTriangle> m_triangles;
+	/** Edge setup of each triangle in m_triangles, used by deferred shading. **/
+	std::vector<RasterTriangle> m_rasterTriangles;
+	/** Uniforms bound to the shaders for the current draw. **/
+	ShaderUniforms m_uniforms;
+	/** Raster and resolve stages compiled for the shading features of the current draw. **/
+	void (ScanlineRHI::*m_rasterStage)(const ScanlineTriangle&, const recti&, ScanlineThreadContext&) const = nullptr;
+	void (ScanlineRHI::*m_resolveStage)(const recti&) const = nullptr;
+	/** Scratch buffers for each thread in the thread pool. **/
+	std::vector<ScanlineThreadContext> m_threadContexts;
+	/** Per-tile list of indexes into m_triangles, in submission order. **/
+	std::vector<std::vector<int32>> m_tileBins;
+	int32							m_tileCountX = 0;
+	int32							m_tileCountY = 0;
+	/**
+	 * Clears still owed to each tile, as a combination of ETileClear. Clearing the buffers only marks their tiles, and
+	 * each tile is cleared the first time anything draws into it. Mutable as the raster stages clear tiles as they
+	 * reach them.
+	 **/
+	mutable std::vector<uint8> m_tileClears;
+	/** Background color of each row of the frame buffer. **/
+	std::vector<uint32> m_backgroundRows;
+	/** Worker threads used to rasterize tiles. **/
+	std::shared_ptr<ThreadPool> m_threadPool = nullptr;
 	/** Pointer to the current mesh. **/
 	Mesh* m_currentMesh                              = nullptr;
 	Triangle3* m_currentTriangle                      = nullptr;
 	std::shared_ptr<RenderSettings> m_renderSettings = nullptr;
 
 	std::shared_ptr<Painter> m_painter = nullptr;
+	/** Lines waiting to be drawn into the frame buffer, reused between frames. **/
+	LineBatch m_lineBatch;
 
 public:
 	ScanlineRHI() = default;
@@ -102,22 +173,156 @@ public:
 	void shutdown() override {}
 	void resize(int32 width, int32 height) override;
 	void addRenderable(IRenderable* renderable) override;
+	/**
+	 * @brief Points `desc` at the current vertex and index data of its mesh.
+	 */
+	static void updateMeshDescription(MeshDescription& desc);
+	/**
+	 * @brief Returns the coarsest level of detail of `mesh` whose error projects to no more than `threshold` pixels
+	 * on screen when drawn with `model` from `viewData`.
+	 */
+	static int32 selectLod(const Mesh& mesh, const mat4f& model, const ViewData& viewData, float threshold);
+	/**
+	 * @brief Captures the world matrix of `desc`'s renderable along with the bounds of its mesh and the data of the
+	 * level of detail it is drawn with from `viewData`.
+	 */
+	static MeshSnapshot captureMesh(const MeshDescription& desc, const ViewData& viewData, const RenderSettings& settings);
 	void addTexture(Texture* texture) override {}
+	void addLight(Light* light) override;
+	void captureFrame(FrameSnapshot& snapshot) const override;
+	void setFrameSnapshot(const FrameSnapshot* snapshot) override;
+	/**
+	 * @brief Replaces the vertex shader used for every mesh. Passing nullptr restores the default shader.
+	 */
+	void setVertexShader(const std::shared_ptr<ScanlineVertexShader>& shader);
+	/**
+	 * @brief Replaces the pixel shader used for every mesh. Passing nullptr restores the default shader.
+	 */
+	void setPixelShader(const std::shared_ptr<ScanlinePixelShader>& shader);
 
 	/** Geometry drawing **/
 
-	bool vertexStage();
-	void rasterStage();
-	void fragmentStage() const;
+	/**
+	 * @brief Runs the vertex shader once for each unique vertex, storing the results in the vertex cache along with
+	 * the screen position and clip codes of each vertex.
+	 */
+	void vertexStage(const Vertex3* vertices, int32 vertexCount);
+	/**
+	 * @brief Assembles the triangle at `indexes` from the vertex cache, clips it against the near plane and guard band,
+	 * and appends every resulting front-facing triangle to `triangles`. The triangle must have survived
+	 * `VertexPipeline::cullTriangles`.
+	 */
+	void primitiveStage(const Vertex3* vertices, const uint32* indexes, std::vector<ScanlineTriangle>& triangles) const;
+	/**
+	 * @brief Returns whether triangles are rasterized at several samples per pixel this frame.
+	 */
+	bool isMultisampling() const;
+	/**
+	 * @brief Allocates the sample buffers at the size of the frame buffer if multisampling is enabled.
+	 */
+	void updateSampleBuffers();
+	/**
+	 * @brief Returns the EShadingFeature combination the current render settings and texture call for.
+	 */
+	uint8 getShadingFeatures() const;
+	/**
+	 * @brief Picks the raster and resolve stages compiled for the current shading features. Called once per draw.
+	 */
+	void selectShadingVariant();
+	/**
+	 * @brief Rasterizes `triangle` within `bounds` and shades every pixel which passes the depth test.
+	 */
+	template <uint8 Features>
+	void rasterStage(const ScanlineTriangle& triangle, const recti& bounds, ScanlineThreadContext& context) const;
+	void visibilityStage(int32 triangleIndex, const recti& bounds) const;
+	RasterDepth getRasterDepth() const;
+	bool isOccluded(const RasterTriangle& triangle) const;
+	void updateDepthBlocks(const RasterTriangle& triangle) const;
+	/**
+	 * @brief Shades every pixel within `bounds` which has a visible triangle in the visibility buffer.
+	 */
+	template <uint8 Features>
+	void resolveStage(const recti& bounds) const;
+	/**
+	 * @brief Interpolates the attributes of `triangle` at a single pixel into the next lane of `batch`. Only the
+	 * attributes `Features` uses are set.
+	 * @param coverage The samples of the pixel the triangle covers. Only used when multisampling.
+	 */
+	template <uint8 Features>
+	static void interpolatePixel(const ScanlineTriangle& triangle, int32 x, int32 y, const vec3f& bary, float depth, uint8 coverage,
+		PixelBatch& batch);
+	/**
+	 * @brief Runs the pixel shader on every pixel in `batch`, writes the results to the frame buffer, or to the covered
+	 * samples when multisampling, and empties it.
+	 */
+	template <uint8 Features>
+	void shadeBatch(PixelBatch& batch) const;
+
+	/** Lighting **/
+
+	/**
+	 * @brief Prepares the lights within the view frustum for shading and finds their screen bounds. Called once per
+	 * frame, before the shading variant is selected.
+	 */
+	void prepareLights();
+	/**
+	 * @brief Returns whether the lights of each light tile are culled against its depth in the depth buffer once its
+	 * visibility has been found, rather than against the triangles overlapping it before anything is drawn.
+	 */
+	bool isCullingLightsByDepthBuffer() const;
+	/**
+	 * @brief Bounds each light tile by the depth of the triangles overlapping it and culls its lights.
+	 */
+	void cullLights();
+	/**
+	 * @brief Culls the lights of every light tile within `bounds` against the depth buffer. `bounds` must start on
+	 * a light tile.
+	 */
+	void cullLights(const recti& bounds);
+	/**
+	 * @brief Fills the list of a single light tile with the lights whose bounds overlap it, and overlap `depthBounds`
+	 * (nearest and farthest depth) in depth. Safe to call from several threads at once for different tiles.
+	 */
+	void cullTileLights(int32 tileIndex, const vec2f& depthBounds);
 
-	void drawTriangle(Vertex3* vertex);
-	void drawWireframe() const;
-	void drawNormal();
+	void drawTriangles();
+	void drawTiles();
+	void binTriangles();
+	/**
+	 * @brief Marks every tile of the frame and depth buffers as needing to be cleared, without writing to either.
+	 */
+	void clearTiles();
+	/**
+	 * @brief Performs the clears in `clears` still owed to every tile overlapping `bounds`. Must be called before
+	 * drawing into `bounds`. Safe to call from several threads at once, as long as no two threads prepare the same
+	 * tile.
+	 */
+	void prepareTiles(const recti& bounds, uint8 clears = TileClearColor | TileClearDepth) const;
+	/**
+	 * @brief Fills the color of every tile which was never drawn into with the background.
+	 */
+	void resolveTiles();
+	/**
+	 * @brief Averages the samples of every pixel drawn while multisampling into the frame buffer.
+	 */
+	void resolveSamples();
+	void clearTile(int32 tileIndex, uint8 clears) const;
+	/**
+	 * @brief Adds the edges of `triangle` to the line batch.
+	 */
+	void addWireframe(const ScanlineTriangle& triangle);
+	/**
+	 * @brief Adds a line from the center of `triangle` along its average normal to the line batch.
+	 */
+	void addNormal(const ScanlineTriangle& triangle);
+	/**
+	 * @brief Draws every line in the line batch into the frame buffer.
+	 */
+	void flushLines();
 	void drawGrid(Grid* grid) override;
 
 	/** General drawing **/
 	void drawLine(const vec3f& inA, const vec3f& inB, const Color& color) override;
-	void computeLinePixels(const vec3f& inA, const vec3f& inB, std::vector<vec2f>& points) const;
 
 	Texture* getFrameData() override;
 	void setViewData(ViewData* newViewData) override;
@@ -0,0 +1,137 @@
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <utility>
+
+#include "ScanlineShader.h"
+
+#include "Math/VectorMath.h"
+#include "Renderer/Sampler.h"
+
+/** Vertex Shader **/
+
+void ScanlineVertexShader::process(const VertexBatch& input, VertexBatchOutput& output) const
+{
+	// Every lane is transformed, including those past the batch's count, so the SIMD backends never need a scalar tail
+
+	// Project object position to clip space
+	VectorMath::transformPoints(m_uniforms.modelViewProjection, input.positionX, input.positionY, input.positionZ, g_shaderBatchSize,
+		output.positionX, output.positionY, output.positionZ, output.positionW);
+
+	// Transform object normal to world normal
+	VectorMath::transformDirections(m_uniforms.model, input.normalX, input.normalY, input.normalZ, g_shaderBatchSize, output.normalX,
+		output.normalY, output.normalZ);
+}
+
+/** Pixel Shader **/
+
+namespace
+{
+	/**
+	 * @brief Returns the summed light of `lights` reaching a surface at pixel (x, y) with the specified depth and
+	 * normal. Each light fades out smoothly towards its range, and spot lights towards their outer cone.
+	 */
+	vec3f computeLighting(const ShaderUniforms& uniforms, const std::vector<int32>& lights, const int32 x, const int32 y,
+		const float depth, const vec3f& normal)
+	{
+		// Reconstruct the world-space position of the pixel from its depth
+		const auto& m = uniforms.screenToWorld.m;
+		const float sx = (float)x;
+		const float sy = (float)y;
+		const float w = m[0][3] * sx + m[1][3] * sy + m[2][3] * depth + m[3][3];
+		const vec3f position = vec3f(m[0][0] * sx + m[1][0] * sy + m[2][0] * depth + m[3][0],
+								   m[0][1] * sx + m[1][1] * sy + m[2][1] * depth + m[3][1],
+								   m[0][2] * sx + m[1][2] * sy + m[2][2] * depth + m[3][2])
+			/ w;
+
+		const float normalLength = std::sqrt(normal.dot(normal));
+		if (normalLength <= 0.0f)
+		{
+			return vec3f::zeroVector();
+		}
+		const vec3f surfaceNormal = normal / normalLength;
+
+		vec3f lighting = vec3f::zeroVector();
+		for (const int32 index : lights)
+		{
+			const ShaderLight& light = uniforms.lights.lights[index];
+			const vec3f		   toLight = light.position - position;
+			const float		   distanceSquared = toLight.dot(toLight);
+			float			   attenuation = 1.0f - distanceSquared * light.invRangeSquared;
+			if (attenuation <= 0.0f || distanceSquared <= 0.0f)
+			{
+				continue;
+			}
+			attenuation *= attenuation;
+
+			const vec3f direction = toLight / std::sqrt(distanceSquared);
+			const float lambert = surfaceNormal.dot(direction);
+			if (lambert <= 0.0f)
+			{
+				continue;
+			}
+
+			if (light.type == ELightType::Spot)
+			{
+				const float cone = std::clamp((-direction.dot(light.direction) - light.outerConeCos) * light.coneScale, 0.0f, 1.0f);
+				attenuation *= cone * cone;
+			}
+			lighting += light.color * (lambert * attenuation);
+		}
+		return lighting;
+	}
+} // namespace
+
+template <uint8 Features>
+void ScanlinePixelShader::shade(const ShaderUniforms& uniforms, const PixelBatch& input, Color* output)
+{
+	const vec3f toCamera = -uniforms.cameraDirection;
+	for (int32 i = 0; i < input.count; i++)
+	{
+		Color out = Color::white();
+		if constexpr ((Features & ShadeTextured) != 0)
+		{
+			// Filter the mip levels closest to the pixel's footprint on the texture, so minified textures don't alias
+			out = Sampler::sampleTrilinear(uniforms.texture, vec2f(input.u[i], input.v[i]), input.uvDx[i], input.uvDy[i]);
+		}
+		if constexpr ((Features & ShadeLit) != 0)
+		{
+			const vec3f normal(input.normalX[i], input.normalY[i], input.normalZ[i]);
+			float		facingRatio = toCamera.dot(normal);
+			facingRatio = std::clamp(facingRatio, 0.0f, 1.0f);
+
+			// Only the lights which may reach this pixel's tile are visited, however many are in the scene
+			const std::vector<int32>* lights = uniforms.lights.tiles != nullptr ? &uniforms.lights.getLights(input.x[i], input.y[i]) : nullptr;
+			if (lights == nullptr || lights->empty())
+			{
+				out *= facingRatio;
+			}
+			else
+			{
+				const vec3f lighting = computeLighting(uniforms, *lights, input.x[i], input.y[i], input.depth[i], normal)
+					+ vec3f(facingRatio, facingRatio, facingRatio);
+				out.r = (uint8)std::min((float)out.r * lighting.x, 255.0f);
+				out.g = (uint8)std::min((float)out.g * lighting.y, 255.0f);
+				out.b = (uint8)std::min((float)out.b * lighting.z, 255.0f);
+			}
+		}
+		output[i] = out;
+	}
+}
+
+void ScanlinePixelShader::bind(const ShaderUniforms& uniforms)
+{
+	// Variants are chosen here, once per draw, rather than for each batch
+	static constexpr auto shadeFunctions = []<size_t... Features>(std::index_sequence<Features...>)
+	{
+		return std::array<ShadeFunction, sizeof...(Features)>{ &shade<(uint8)Features>... };
+	}(std::make_index_sequence<g_shadingVariantCount>());
+
+	m_uniforms = uniforms;
+	m_shadeFunction = shadeFunctions[uniforms.features];
+}
+
+void ScanlinePixelShader::process(const PixelBatch& input, Color* output) const
+{
+	m_shadeFunction(m_uniforms, input, output);
+}
@@ -0,0 +1,193 @@
+#pragma once
+
+#include <vector>
+
+#include "Core/Types.h"
+#include "Math/Color.h"
+#include "Math/Matrix.h"
+#include "Math/Vector.h"
+#include "Renderer/Light.h"
+#include "Renderer/Shader.h"
+#include "Renderer/Texture.h"
+
+/** The number of vertexes or pixels passed to a single call of a shader. **/
+constexpr int32 g_shaderBatchSize = 8;
+
+/**
+ * Features which change the work done for each pixel. The raster and shade loops are compiled once for every
+ * combination of these, and the combination is chosen once per draw, so no per-pixel code branches on the render
+ * settings.
+ **/
+enum EShadingFeature : uint8
+{
+	ShadeNone        = 0,
+	ShadeDepthTest   = 1 << 0,
+	ShadeTextured    = 1 << 1,
+	ShadeLit         = 1 << 2,
+	/** Coverage and depth are tested at several samples per pixel, which is still shaded once. **/
+	ShadeMultisample = 1 << 3
+};
+
+/** The number of combinations of EShadingFeature. **/
+constexpr int32 g_shadingVariantCount = 1 << 4;
+
+/** A light in the view, with everything which is the same for every pixel it lights computed once per frame. **/
+struct ShaderLight
+{
+	ELightType type = ELightType::Point;
+	vec3f	   position;
+	/** Normalized direction of a spot light. **/
+	vec3f direction;
+	/** Color scaled by intensity, where 1 is full brightness. **/
+	vec3f color;
+	float invRangeSquared = 0.0f;
+	/** Cosine of a spot light's outer cone angle, and one over its difference to the inner cone's. **/
+	float outerConeCos = 0.0f;
+	float coneScale = 0.0f;
+};
+
+/** The lights of a frame, and the indexes of those which may reach each screen tile. **/
+struct TileLightLists
+{
+	const ShaderLight* lights = nullptr;
+	/** Indexes into `lights` for each tile, in rows of `tileCountX` tiles. nullptr if there are no lights. **/
+	const std::vector<int32>* tiles = nullptr;
+	int32					  tileCountX = 0;
+	int32					  tileSize = 0;
+
+	/**
+	 * @brief Returns the indexes of the lights which may reach pixel (x, y).
+	 */
+	[[nodiscard]] const std::vector<int32>& getLights(const int32 x, const int32 y) const
+	{
+		return tiles[(y / tileSize) * tileCountX + x / tileSize];
+	}
+};
+
+/** Values which are the same for every vertex or pixel of a draw, bound to each shader once per draw. **/
+struct ShaderUniforms
+{
+	mat4f model;
+	mat4f modelViewProjection;
+	vec3f cameraDirection;
+	const Texture* texture = nullptr;
+	/** Transforms a screen-space position and depth back to world space. **/
+	mat4f screenToWorld;
+	/** Lights which may reach each pixel. Only read when ShadeLit is enabled. **/
+	TileLightLists lights;
+	/** Combination of EShadingFeature enabled for this draw. **/
+	uint8 features = ShadeNone;
+};
+
+/**
+ * Object-space vertexes in structure of arrays form. Lanes past `count` are zero, so shaders may process every lane
+ * without checking `count`.
+ **/
+struct VertexBatch
+{
+	int32 count = 0;
+	alignas(32) float positionX[g_shaderBatchSize];
+	alignas(32) float positionY[g_shaderBatchSize];
+	alignas(32) float positionZ[g_shaderBatchSize];
+	alignas(32) float normalX[g_shaderBatchSize];
+	alignas(32) float normalY[g_shaderBatchSize];
+	alignas(32) float normalZ[g_shaderBatchSize];
+};
+
+/** Output of the vertex shader for each lane of a VertexBatch. Lanes past the batch's count are ignored. **/
+struct VertexBatchOutput
+{
+	/** Position in homogeneous clip space. **/
+	alignas(32) float positionX[g_shaderBatchSize];
+	alignas(32) float positionY[g_shaderBatchSize];
+	alignas(32) float positionZ[g_shaderBatchSize];
+	alignas(32) float positionW[g_shaderBatchSize];
+	/** World-space normal. **/
+	alignas(32) float normalX[g_shaderBatchSize];
+	alignas(32) float normalY[g_shaderBatchSize];
+	alignas(32) float normalZ[g_shaderBatchSize];
+};
+
+/**
+ * Interpolated attributes of up to g_shaderBatchSize pixels, in structure of arrays form. Pixels in a batch may come
+ * from different triangles. Only the attributes used by the draw's shading features are set.
+ **/
+struct PixelBatch
+{
+	int32 count = 0;
+	int32 x[g_shaderBatchSize];
+	int32 y[g_shaderBatchSize];
+	/** Screen-space depth. Always set when ShadeLit is enabled, otherwise only when depth testing. **/
+	alignas(32) float depth[g_shaderBatchSize];
+	alignas(32) float u[g_shaderBatchSize];
+	alignas(32) float v[g_shaderBatchSize];
+	/** Screen-space derivatives of the texture coordinates, passed as they are to the sampler. **/
+	vec2f uvDx[g_shaderBatchSize];
+	vec2f uvDy[g_shaderBatchSize];
+	/** World-space normal. **/
+	alignas(32) float normalX[g_shaderBatchSize];
+	alignas(32) float normalY[g_shaderBatchSize];
+	alignas(32) float normalZ[g_shaderBatchSize];
+	/** Samples of each pixel the shaded color is written to when multisampling, one bit per sample. **/
+	uint8 coverage[g_shaderBatchSize];
+};
+
+/**
+ * Vertex shader of the software pipeline. Override `process` to implement a material; the default transforms each
+ * vertex by the bound model view projection matrix and its normal by the model matrix.
+ */
+class ScanlineVertexShader : public VertexShader
+{
+protected:
+	ShaderUniforms m_uniforms;
+
+public:
+	ScanlineVertexShader() = default;
+
+	/**
+	 * @brief Binds the uniforms of the next draw. Called once per draw, before any batch is processed.
+	 */
+	virtual void bind(const ShaderUniforms& uniforms)
+	{
+		m_uniforms = uniforms;
+	}
+
+	/**
+	 * @brief Transforms a batch of vertexes. May be called from several threads at once.
+	 */
+	virtual void process(const VertexBatch& input, VertexBatchOutput& output) const;
+};
+
+/**
+ * Pixel shader of the software pipeline. Override `process` to implement a material; the default modulates the bound
+ * texture by the facing ratio of each pixel, plus the light of every point and spot light which may reach its tile,
+ * depending on the bound shading features.
+ */
+class ScanlinePixelShader : public PixelShader
+{
+	using ShadeFunction = void (*)(const ShaderUniforms&, const PixelBatch&, Color*);
+
+protected:
+	ShaderUniforms m_uniforms;
+
+private:
+	/** Variant of `shade` compiled for the bound shading features. **/
+	ShadeFunction m_shadeFunction = nullptr;
+
+	template <uint8 Features>
+	static void shade(const ShaderUniforms& uniforms, const PixelBatch& input, Color* output);
+
+public:
+	ScanlinePixelShader() = default;
+
+	/**
+	 * @brief Binds the uniforms of the next draw. Called once per draw, before any batch is processed.
+	 */
+	virtual void bind(const ShaderUniforms& uniforms);
+
+	/**
+	 * @brief Shades a batch of pixels, writing one color per pixel to `output`. May be called from several threads
+	 * at once.
+	 */
+	virtual void process(const PixelBatch& input, Color* output) const;
+};
@@ -0,0 +1,503 @@
+#include <bit>
+
+#include "VertexPipeline.h"
+
+#include "Core/Macros.h"
+#include "Math/Clipping.h"
+#include "Math/VectorMath.h"
+
+#ifdef PENG_X86
+	#include <immintrin.h>
+#endif
+
+// Vertexes are converted to structure of arrays form by transposing rows of eight floats
+static_assert(sizeof(Vertex3) == 8 * sizeof(float));
+
+namespace
+{
+	/** Mask of the clip code bits of the planes of the view frustum itself. **/
+	constexpr int32 g_frustumCodeMask = (1 << g_guardBandCodeShift) - 1;
+	/** Mask of the clip code bits of the planes of the guard band. **/
+	constexpr int32 g_guardBandCodeMask = ~g_frustumCodeMask;
+
+	/** Scalar **/
+
+	int32 getClipCodes(const vec4f& position)
+	{
+		return Clipping::getFrustumOutCode(position) | Clipping::getOutCode(position) << g_guardBandCodeShift;
+	}
+
+	/**
+	 * @brief Returns whether the triangle with the specified corners may be visible. `viewVector` is the opposite of
+	 * the camera's direction, so the normals of front faces point along it.
+	 */
+	bool isTriangleVisible(const VertexCache& cache, const uint32* corners, const vec3f& viewVector)
+	{
+		const int32 i0 = (int32)corners[0];
+		const int32 i1 = (int32)corners[1];
+		const int32 i2 = (int32)corners[2];
+
+		// Facing away from the camera
+		const vec3f normal = (cache.getNormal(i0) + cache.getNormal(i1) + cache.getNormal(i2)) / 3.0f;
+		if (viewVector.dot(normal) > 0.0f)
+		{
+			return false;
+		}
+
+		// Every corner is outside the same plane of the view frustum
+		const int32 codes0 = cache.clipCodes[i0];
+		const int32 codes1 = cache.clipCodes[i1];
+		const int32 codes2 = cache.clipCodes[i2];
+		if (codes0 & codes1 & codes2 & g_frustumCodeMask)
+		{
+			return false;
+		}
+
+		// Triangles which will be clipped are only tested for area once they have been
+		if ((codes0 | codes1 | codes2) & g_guardBandCodeMask)
+		{
+			return true;
+		}
+		return Math::getWindingOrder(cache.getScreenPoint(i0), cache.getScreenPoint(i1), cache.getScreenPoint(i2))
+			== EWindingOrder::CounterClockwise;
+	}
+
+	void loadBatchScalar(const Vertex3* vertices, const int32 count, VertexBatch& batch)
+	{
+		for (int32 i = 0; i < g_shaderBatchSize; i++)
+		{
+			const Vertex3 vertex = i < count ? vertices[i] : Vertex3();
+			batch.positionX[i] = vertex.position.x;
+			batch.positionY[i] = vertex.position.y;
+			batch.positionZ[i] = vertex.position.z;
+			batch.normalX[i] = vertex.normal.x;
+			batch.normalY[i] = vertex.normal.y;
+			batch.normalZ[i] = vertex.normal.z;
+		}
+	}
+
+	void storeBatchScalar(const VertexBatchOutput& output, const int32 width, const int32 height, const int32 first, VertexCache& cache)
+	{
+		for (int32 i = 0; i < g_shaderBatchSize; i++)
+		{
+			const int32 index = first + i;
+			const vec4f position(output.positionX[i], output.positionY[i], output.positionZ[i], output.positionW[i]);
+			cache.positionX[index] = position.x;
+			cache.positionY[index] = position.y;
+			cache.positionZ[index] = position.z;
+			cache.positionW[index] = position.w;
+			cache.normalX[index] = output.normalX[i];
+			cache.normalY[index] = output.normalY[i];
+			cache.normalZ[index] = output.normalZ[i];
+
+			const vec3f screenPoint = Clipping::clipVertex(position, width, height);
+			cache.screenX[index] = screenPoint.x;
+			cache.screenY[index] = screenPoint.y;
+			cache.screenZ[index] = screenPoint.z;
+			cache.clipCodes[index] = getClipCodes(position);
+		}
+	}
+
+	int32 cullTrianglesScalar(const VertexCache& cache, const uint32* indexes, const int32 first, const int32 triangleCount,
+		const vec3f& viewVector, uint32* survivors)
+	{
+		int32 count = 0;
+		for (int32 triangle = first; triangle < triangleCount; triangle++)
+		{
+			if (isTriangleVisible(cache, indexes + triangle * 3, viewVector))
+			{
+				survivors[count++] = (uint32)triangle;
+			}
+		}
+		return count;
+	}
+
+#ifdef PENG_X86
+	/** Appends the triangles from `first` with a set bit in `visibleMask` to `survivors`. **/
+	int32 appendSurvivors(uint32 visibleMask, const int32 first, uint32* survivors)
+	{
+		int32 count = 0;
+		while (visibleMask != 0)
+		{
+			survivors[count++] = (uint32)(first + std::countr_zero(visibleMask));
+			visibleMask &= visibleMask - 1;
+		}
+		return count;
+	}
+
+	/** SSE4.1 **/
+
+	TARGET_SSE41 void loadBatchSSE41(const Vertex3* vertices, const int32 count, VertexBatch& batch)
+	{
+		const float* data = (const float*)vertices;
+		for (int32 block = 0; block < g_shaderBatchSize; block += 4)
+		{
+			// Each vertex is a row of eight floats. Transposing the first and last four columns of four rows
+			// separately leaves each attribute of the four vertexes in its own register.
+			__m128 low[4];
+			__m128 high[4];
+			for (int32 row = 0; row < 4; row++)
+			{
+				const bool valid = block + row < count;
+				low[row] = valid ? _mm_loadu_ps(data + (block + row) * 8) : _mm_setzero_ps();
+				high[row] = valid ? _mm_loadu_ps(data + (block + row) * 8 + 4) : _mm_setzero_ps();
+			}
+			_MM_TRANSPOSE4_PS(low[0], low[1], low[2], low[3]);
+			_MM_TRANSPOSE4_PS(high[0], high[1], high[2], high[3]);
+
+			_mm_storeu_ps(batch.positionX + block, low[0]);
+			_mm_storeu_ps(batch.positionY + block, low[1]);
+			_mm_storeu_ps(batch.positionZ + block, low[2]);
+			_mm_storeu_ps(batch.normalX + block, low[3]);
+			_mm_storeu_ps(batch.normalY + block, high[0]);
+			_mm_storeu_ps(batch.normalZ + block, high[1]);
+		}
+	}
+
+	/** Returns `bit` in every lane where `mask` is set. **/
+	TARGET_SSE41 __m128i maskToBit(const __m128 mask, const int32 bit)
+	{
+		return _mm_and_si128(_mm_castps_si128(mask), _mm_set1_epi32(bit));
+	}
+
+	TARGET_SSE41 void storeBatchSSE41(const VertexBatchOutput& output, const int32 width, const int32 height, const int32 first,
+		VertexCache& cache)
+	{
+		const __m128 zero = _mm_setzero_ps();
+		const __m128 half = _mm_set1_ps(0.5f);
+		const __m128 signBit = _mm_set1_ps(-0.0f);
+		const __m128 guardBandScale = _mm_set1_ps(Clipping::g_guardBandScale);
+		const __m128 screenWidth = _mm_set1_ps((float)width);
+		const __m128 screenHeight = _mm_set1_ps((float)height);
+
+		for (int32 lane = 0; lane < g_shaderBatchSize; lane += 4)
+		{
+			const int32	 index = first + lane;
+			const __m128 x = _mm_loadu_ps(output.positionX + lane);
+			const __m128 y = _mm_loadu_ps(output.positionY + lane);
+			const __m128 z = _mm_loadu_ps(output.positionZ + lane);
+			const __m128 w = _mm_loadu_ps(output.positionW + lane);
+			_mm_storeu_ps(cache.positionX.data() + index, x);
+			_mm_storeu_ps(cache.positionY.data() + index, y);
+			_mm_storeu_ps(cache.positionZ.data() + index, z);
+			_mm_storeu_ps(cache.positionW.data() + index, w);
+			_mm_storeu_ps(cache.normalX.data() + index, _mm_loadu_ps(output.normalX + lane));
+			_mm_storeu_ps(cache.normalY.data() + index, _mm_loadu_ps(output.normalY + lane));
+			_mm_storeu_ps(cache.normalZ.data() + index, _mm_loadu_ps(output.normalZ + lane));
+
+			// Divide by W and map to the screen, exactly as Clipping::clipVertex does
+			_mm_storeu_ps(cache.screenX.data() + index, _mm_mul_ps(_mm_add_ps(_mm_mul_ps(_mm_div_ps(x, w), half), half), screenWidth));
+			_mm_storeu_ps(cache.screenY.data() + index, _mm_mul_ps(_mm_add_ps(_mm_mul_ps(_mm_div_ps(y, w), half), half), screenHeight));
+			_mm_storeu_ps(cache.screenZ.data() + index, _mm_mul_ps(_mm_add_ps(_mm_div_ps(z, w), half), half));
+
+			// Planes of the view frustum
+			const __m128 negativeW = _mm_xor_ps(w, signBit);
+			const __m128 nearMask = _mm_cmplt_ps(z, zero);
+			__m128i		 codes = maskToBit(nearMask, Clipping::Near);
+			codes = _mm_or_si128(codes, maskToBit(_mm_cmplt_ps(x, negativeW), Clipping::Left));
+			codes = _mm_or_si128(codes, maskToBit(_mm_cmpgt_ps(x, w), Clipping::Right));
+			codes = _mm_or_si128(codes, maskToBit(_mm_cmplt_ps(y, negativeW), Clipping::Bottom));
+			codes = _mm_or_si128(codes, maskToBit(_mm_cmpgt_ps(y, w), Clipping::Top));
+
+			// Planes of the guard band, which share the near plane
+			const __m128 guardW = _mm_mul_ps(w, guardBandScale);
+			codes = _mm_or_si128(codes, maskToBit(nearMask, Clipping::Near << g_guardBandCodeShift));
+			codes = _mm_or_si128(codes, maskToBit(_mm_cmplt_ps(_mm_add_ps(x, guardW), zero), Clipping::Left << g_guardBandCodeShift));
+			codes = _mm_or_si128(codes, maskToBit(_mm_cmplt_ps(_mm_sub_ps(guardW, x), zero), Clipping::Right << g_guardBandCodeShift));
+			codes = _mm_or_si128(codes, maskToBit(_mm_cmplt_ps(_mm_add_ps(y, guardW), zero), Clipping::Bottom << g_guardBandCodeShift));
+			codes = _mm_or_si128(codes, maskToBit(_mm_cmplt_ps(_mm_sub_ps(guardW, y), zero), Clipping::Top << g_guardBandCodeShift));
+			_mm_storeu_si128((__m128i*)(cache.clipCodes.data() + index), codes);
+		}
+	}
+
+	TARGET_SSE41 int32 cullTrianglesSSE41(const VertexCache& cache, const uint32* indexes, const int32 triangleCount,
+		const vec3f& viewVector, uint32* survivors)
+	{
+		const __m128  zero = _mm_setzero_ps();
+		const __m128  three = _mm_set1_ps(3.0f);
+		const __m128  viewX = _mm_set1_ps(viewVector.x);
+		const __m128  viewY = _mm_set1_ps(viewVector.y);
+		const __m128  viewZ = _mm_set1_ps(viewVector.z);
+		const __m128i frustumMask = _mm_set1_epi32(g_frustumCodeMask);
+		const __m128i guardBandMask = _mm_set1_epi32(g_guardBandCodeMask);
+
+		int32 count = 0;
+		int32 triangle = 0;
+		for (; triangle + 4 <= triangleCount; triangle += 4)
+		{
+			// Gather the corners of four triangles into structure of arrays form
+			alignas(16) float normalX[3][4];
+			alignas(16) float normalY[3][4];
+			alignas(16) float normalZ[3][4];
+			alignas(16) float screenX[3][4];
+			alignas(16) float screenY[3][4];
+			alignas(16) int32 codes[3][4];
+			for (int32 lane = 0; lane < 4; lane++)
+			{
+				for (int32 corner = 0; corner < 3; corner++)
+				{
+					const uint32 index = indexes[(triangle + lane) * 3 + corner];
+					normalX[corner][lane] = cache.normalX[index];
+					normalY[corner][lane] = cache.normalY[index];
+					normalZ[corner][lane] = cache.normalZ[index];
+					screenX[corner][lane] = cache.screenX[index];
+					screenY[corner][lane] = cache.screenY[index];
+					codes[corner][lane] = cache.clipCodes[index];
+				}
+			}
+
+			// Facing away from the camera
+			const __m128 nx = _mm_div_ps(_mm_add_ps(_mm_add_ps(_mm_load_ps(normalX[0]), _mm_load_ps(normalX[1])), _mm_load_ps(normalX[2])), three);
+			const __m128 ny = _mm_div_ps(_mm_add_ps(_mm_add_ps(_mm_load_ps(normalY[0]), _mm_load_ps(normalY[1])), _mm_load_ps(normalY[2])), three);
+			const __m128 nz = _mm_div_ps(_mm_add_ps(_mm_add_ps(_mm_load_ps(normalZ[0]), _mm_load_ps(normalZ[1])), _mm_load_ps(normalZ[2])), three);
+			const __m128 facing = _mm_add_ps(_mm_add_ps(_mm_mul_ps(viewX, nx), _mm_mul_ps(viewY, ny)), _mm_mul_ps(viewZ, nz));
+			const __m128 backFacing = _mm_cmpgt_ps(facing, zero);
+
+			// Outside the view frustum, or crossing the guard band
+			const __m128i codes0 = _mm_load_si128((const __m128i*)codes[0]);
+			const __m128i codes1 = _mm_load_si128((const __m128i*)codes[1]);
+			const __m128i codes2 = _mm_load_si128((const __m128i*)codes[2]);
+			const __m128i outside = _mm_and_si128(_mm_and_si128(_mm_and_si128(codes0, codes1), codes2), frustumMask);
+			const __m128i clipped = _mm_and_si128(_mm_or_si128(_mm_or_si128(codes0, codes1), codes2), guardBandMask);
+			const __m128  inside = _mm_castsi128_ps(_mm_cmpeq_epi32(outside, _mm_setzero_si128()));
+			const __m128  unclipped = _mm_castsi128_ps(_mm_cmpeq_epi32(clipped, _mm_setzero_si128()));
+
+			// Clockwise or zero area on screen, only known before clipping for triangles which won't be clipped
+			const __m128 x0 = _mm_load_ps(screenX[0]);
+			const __m128 y0 = _mm_load_ps(screenY[0]);
+			const __m128 area = _mm_sub_ps(_mm_mul_ps(_mm_sub_ps(_mm_load_ps(screenX[1]), x0), _mm_sub_ps(_mm_load_ps(screenY[2]), y0)),
+				_mm_mul_ps(_mm_sub_ps(_mm_load_ps(screenY[1]), y0), _mm_sub_ps(_mm_load_ps(screenX[2]), x0)));
+			const __m128 wrongWinding = _mm_and_ps(unclipped, _mm_cmpge_ps(area, zero));
+
+			const __m128 visible = _mm_andnot_ps(_mm_or_ps(backFacing, wrongWinding), inside);
+			count += appendSurvivors((uint32)_mm_movemask_ps(visible), triangle, survivors + count);
+		}
+		return count + cullTrianglesScalar(cache, indexes, triangle, triangleCount, viewVector, survivors + count);
+	}
+
+	/** AVX2 **/
+
+	TARGET_AVX2 void loadBatchAVX2(const Vertex3* vertices, const int32 count, VertexBatch& batch)
+	{
+		// Each vertex is a row of eight floats, so transposing the rows of the batch leaves each attribute of every
+		// vertex in its own register
+		const float* data = (const float*)vertices;
+		__m256		 rows[8];
+		for (int32 row = 0; row < 8; row++)
+		{
+			rows[row] = row < count ? _mm256_loadu_ps(data + row * 8) : _mm256_setzero_ps();
+		}
+
+		const __m256 t0 = _mm256_unpacklo_ps(rows[0], rows[1]);
+		const __m256 t1 = _mm256_unpackhi_ps(rows[0], rows[1]);
+		const __m256 t2 = _mm256_unpacklo_ps(rows[2], rows[3]);
+		const __m256 t3 = _mm256_unpackhi_ps(rows[2], rows[3]);
+		const __m256 t4 = _mm256_unpacklo_ps(rows[4], rows[5]);
+		const __m256 t5 = _mm256_unpackhi_ps(rows[4], rows[5]);
+		const __m256 t6 = _mm256_unpacklo_ps(rows[6], rows[7]);
+		const __m256 t7 = _mm256_unpackhi_ps(rows[6], rows[7]);
+
+		const __m256 s0 = _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(1, 0, 1, 0));
+		const __m256 s1 = _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(3, 2, 3, 2));
+		const __m256 s2 = _mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(1, 0, 1, 0));
+		const __m256 s3 = _mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(3, 2, 3, 2));
+		const __m256 s4 = _mm256_shuffle_ps(t4, t6, _MM_SHUFFLE(1, 0, 1, 0));
+		const __m256 s5 = _mm256_shuffle_ps(t4, t6, _MM_SHUFFLE(3, 2, 3, 2));
+		const __m256 s6 = _mm256_shuffle_ps(t5, t7, _MM_SHUFFLE(1, 0, 1, 0));
+		const __m256 s7 = _mm256_shuffle_ps(t5, t7, _MM_SHUFFLE(3, 2, 3, 2));
+
+		// Columns 0-3 are in the lower halves and 4-7 in the upper halves. Texture coordinates aren't needed.
+		_mm256_storeu_ps(batch.positionX, _mm256_permute2f128_ps(s0, s4, 0x20));
+		_mm256_storeu_ps(batch.positionY, _mm256_permute2f128_ps(s1, s5, 0x20));
+		_mm256_storeu_ps(batch.positionZ, _mm256_permute2f128_ps(s2, s6, 0x20));
+		_mm256_storeu_ps(batch.normalX, _mm256_permute2f128_ps(s3, s7, 0x20));
+		_mm256_storeu_ps(batch.normalY, _mm256_permute2f128_ps(s0, s4, 0x31));
+		_mm256_storeu_ps(batch.normalZ, _mm256_permute2f128_ps(s1, s5, 0x31));
+	}
+
+	/** Returns `bit` in every lane where `mask` is set. **/
+	TARGET_AVX2 __m256i maskToBitAVX2(const __m256 mask, const int32 bit)
+	{
+		return _mm256_and_si256(_mm256_castps_si256(mask), _mm256_set1_epi32(bit));
+	}
+
+	TARGET_AVX2 void storeBatchAVX2(const VertexBatchOutput& output, const int32 width, const int32 height, const int32 first,
+		VertexCache& cache)
+	{
+		static_assert(g_shaderBatchSize == 8);
+		const __m256 zero = _mm256_setzero_ps();
+		const __m256 half = _mm256_set1_ps(0.5f);
+
+		const __m256 x = _mm256_loadu_ps(output.positionX);
+		const __m256 y = _mm256_loadu_ps(output.positionY);
+		const __m256 z = _mm256_loadu_ps(output.positionZ);
+		const __m256 w = _mm256_loadu_ps(output.positionW);
+		_mm256_storeu_ps(cache.positionX.data() + first, x);
+		_mm256_storeu_ps(cache.positionY.data() + first, y);
+		_mm256_storeu_ps(cache.positionZ.data() + first, z);
+		_mm256_storeu_ps(cache.positionW.data() + first, w);
+		_mm256_storeu_ps(cache.normalX.data() + first, _mm256_loadu_ps(output.normalX));
+		_mm256_storeu_ps(cache.normalY.data() + first, _mm256_loadu_ps(output.normalY));
+		_mm256_storeu_ps(cache.normalZ.data() + first, _mm256_loadu_ps(output.normalZ));
+
+		// Divide by W and map to the screen, exactly as Clipping::clipVertex does
+		_mm256_storeu_ps(cache.screenX.data() + first,
+			_mm256_mul_ps(_mm256_add_ps(_mm256_mul_ps(_mm256_div_ps(x, w), half), half), _mm256_set1_ps((float)width)));
+		_mm256_storeu_ps(cache.screenY.data() + first,
+			_mm256_mul_ps(_mm256_add_ps(_mm256_mul_ps(_mm256_div_ps(y, w), half), half), _mm256_set1_ps((float)height)));
+		_mm256_storeu_ps(cache.screenZ.data() + first, _mm256_mul_ps(_mm256_add_ps(_mm256_div_ps(z, w), half), half));
+
+		// Planes of the view frustum
+		const __m256 negativeW = _mm256_xor_ps(w, _mm256_set1_ps(-0.0f));
+		const __m256 nearMask = _mm256_cmp_ps(z, zero, _CMP_LT_OQ);
+		__m256i		 codes = maskToBitAVX2(nearMask, Clipping::Near);
+		codes = _mm256_or_si256(codes, maskToBitAVX2(_mm256_cmp_ps(x, negativeW, _CMP_LT_OQ), Clipping::Left));
+		codes = _mm256_or_si256(codes, maskToBitAVX2(_mm256_cmp_ps(x, w, _CMP_GT_OQ), Clipping::Right));
+		codes = _mm256_or_si256(codes, maskToBitAVX2(_mm256_cmp_ps(y, negativeW, _CMP_LT_OQ), Clipping::Bottom));
+		codes = _mm256_or_si256(codes, maskToBitAVX2(_mm256_cmp_ps(y, w, _CMP_GT_OQ), Clipping::Top));
+
+		// Planes of the guard band, which share the near plane
+		const __m256 guardW = _mm256_mul_ps(w, _mm256_set1_ps(Clipping::g_guardBandScale));
+		codes = _mm256_or_si256(codes, maskToBitAVX2(nearMask, Clipping::Near << g_guardBandCodeShift));
+		codes = _mm256_or_si256(codes,
+			maskToBitAVX2(_mm256_cmp_ps(_mm256_add_ps(x, guardW), zero, _CMP_LT_OQ), Clipping::Left << g_guardBandCodeShift));
+		codes = _mm256_or_si256(codes,
+			maskToBitAVX2(_mm256_cmp_ps(_mm256_sub_ps(guardW, x), zero, _CMP_LT_OQ), Clipping::Right << g_guardBandCodeShift));
+		codes = _mm256_or_si256(codes,
+			maskToBitAVX2(_mm256_cmp_ps(_mm256_add_ps(y, guardW), zero, _CMP_LT_OQ), Clipping::Bottom << g_guardBandCodeShift));
+		codes = _mm256_or_si256(codes,
+			maskToBitAVX2(_mm256_cmp_ps(_mm256_sub_ps(guardW, y), zero, _CMP_LT_OQ), Clipping::Top << g_guardBandCodeShift));
+		_mm256_storeu_si256((__m256i*)(cache.clipCodes.data() + first), codes);
+	}
+
+	TARGET_AVX2 int32 cullTrianglesAVX2(const VertexCache& cache, const uint32* indexes, const int32 triangleCount,
+		const vec3f& viewVector, uint32* survivors)
+	{
+		const __m256  zero = _mm256_setzero_ps();
+		const __m256  three = _mm256_set1_ps(3.0f);
+		const __m256  viewX = _mm256_set1_ps(viewVector.x);
+		const __m256  viewY = _mm256_set1_ps(viewVector.y);
+		const __m256  viewZ = _mm256_set1_ps(viewVector.z);
+		const __m256i frustumMask = _mm256_set1_epi32(g_frustumCodeMask);
+		const __m256i guardBandMask = _mm256_set1_epi32(g_guardBandCodeMask);
+		// Offset of the first corner of each of eight consecutive triangles in the index buffer
+		const __m256i cornerOffsets = _mm256_setr_epi32(0, 3, 6, 9, 12, 15, 18, 21);
+
+		int32 count = 0;
+		int32 triangle = 0;
+		for (; triangle + 8 <= triangleCount; triangle += 8)
+		{
+			const int* triangleIndexes = (const int*)(indexes + triangle * 3);
+			__m256	   nx = zero;
+			__m256	   ny = zero;
+			__m256	   nz = zero;
+			__m256	   screenX[3];
+			__m256	   screenY[3];
+			__m256i	   codes[3];
+			for (int32 corner = 0; corner < 3; corner++)
+			{
+				// Gather the attributes of each corner of eight triangles straight from the cache
+				const __m256i index = _mm256_i32gather_epi32(triangleIndexes, _mm256_add_epi32(cornerOffsets, _mm256_set1_epi32(corner)), 4);
+				const __m256  cornerX = _mm256_i32gather_ps(cache.normalX.data(), index, 4);
+				const __m256  cornerY = _mm256_i32gather_ps(cache.normalY.data(), index, 4);
+				const __m256  cornerZ = _mm256_i32gather_ps(cache.normalZ.data(), index, 4);
+				nx = corner == 0 ? cornerX : _mm256_add_ps(nx, cornerX);
+				ny = corner == 0 ? cornerY : _mm256_add_ps(ny, cornerY);
+				nz = corner == 0 ? cornerZ : _mm256_add_ps(nz, cornerZ);
+				screenX[corner] = _mm256_i32gather_ps(cache.screenX.data(), index, 4);
+				screenY[corner] = _mm256_i32gather_ps(cache.screenY.data(), index, 4);
+				codes[corner] = _mm256_i32gather_epi32(cache.clipCodes.data(), index, 4);
+			}
+
+			// Facing away from the camera
+			nx = _mm256_div_ps(nx, three);
+			ny = _mm256_div_ps(ny, three);
+			nz = _mm256_div_ps(nz, three);
+			const __m256 facing = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(viewX, nx), _mm256_mul_ps(viewY, ny)), _mm256_mul_ps(viewZ, nz));
+			const __m256 backFacing = _mm256_cmp_ps(facing, zero, _CMP_GT_OQ);
+
+			// Outside the view frustum, or crossing the guard band
+			const __m256i outside = _mm256_and_si256(_mm256_and_si256(_mm256_and_si256(codes[0], codes[1]), codes[2]), frustumMask);
+			const __m256i clipped = _mm256_and_si256(_mm256_or_si256(_mm256_or_si256(codes[0], codes[1]), codes[2]), guardBandMask);
+			const __m256  inside = _mm256_castsi256_ps(_mm256_cmpeq_epi32(outside, _mm256_setzero_si256()));
+			const __m256  unclipped = _mm256_castsi256_ps(_mm256_cmpeq_epi32(clipped, _mm256_setzero_si256()));
+
+			// Clockwise or zero area on screen, only known before clipping for triangles which won't be clipped
+			const __m256 area = _mm256_sub_ps(
+				_mm256_mul_ps(_mm256_sub_ps(screenX[1], screenX[0]), _mm256_sub_ps(screenY[2], screenY[0])),
+				_mm256_mul_ps(_mm256_sub_ps(screenY[1], screenY[0]), _mm256_sub_ps(screenX[2], screenX[0])));
+			const __m256 wrongWinding = _mm256_and_ps(unclipped, _mm256_cmp_ps(area, zero, _CMP_GE_OQ));
+
+			const __m256 visible = _mm256_andnot_ps(_mm256_or_ps(backFacing, wrongWinding), inside);
+			count += appendSurvivors((uint32)_mm256_movemask_ps(visible), triangle, survivors + count);
+		}
+		return count + cullTrianglesScalar(cache, indexes, triangle, triangleCount, viewVector, survivors + count);
+	}
+#endif
+} // namespace
+
+void VertexCache::resize(const int32 vertexCount)
+{
+	const size_t paddedCount = (size_t)(vertexCount + g_shaderBatchSize - 1) / g_shaderBatchSize * g_shaderBatchSize;
+	for (std::vector<float>* array : { &positionX, &positionY, &positionZ, &positionW, &normalX, &normalY, &normalZ, &screenX,
+			 &screenY, &screenZ })
+	{
+		array->resize(paddedCount);
+	}
+	clipCodes.resize(paddedCount);
+}
+
+void VertexPipeline::loadBatch(const Vertex3* vertices, const int32 count, VertexBatch& batch)
+{
+	batch.count = count;
+	switch (VectorMath::getBackend())
+	{
+#ifdef PENG_X86
+		case EVectorBackend::AVX2:
+			loadBatchAVX2(vertices, count, batch);
+			break;
+		case EVectorBackend::SSE41:
+			loadBatchSSE41(vertices, count, batch);
+			break;
+#endif
+		default:
+			loadBatchScalar(vertices, count, batch);
+			break;
+	}
+}
+
+void VertexPipeline::storeBatch(const VertexBatchOutput& output, const int32 width, const int32 height, const int32 first,
+	VertexCache& cache)
+{
+	switch (VectorMath::getBackend())
+	{
+#ifdef PENG_X86
+		case EVectorBackend::AVX2:
+			storeBatchAVX2(output, width, height, first, cache);
+			break;
+		case EVectorBackend::SSE41:
+			storeBatchSSE41(output, width, height, first, cache);
+			break;
+#endif
+		default:
+			storeBatchScalar(output, width, height, first, cache);
+			break;
+	}
+}
+
+int32 VertexPipeline::cullTriangles(const VertexCache& cache, const uint32* indexes, const int32 triangleCount,
+	const vec3f& cameraDirection, uint32* survivors)
+{
+	const vec3f viewVector = -cameraDirection;
+	switch (VectorMath::getBackend())
+	{
+#ifdef PENG_X86
+		case EVectorBackend::AVX2:
+			return cullTrianglesAVX2(cache, indexes, triangleCount, viewVector, survivors);
+		case EVectorBackend::SSE41:
+			return cullTrianglesSSE41(cache, indexes, triangleCount, viewVector, survivors);
+#endif
+		default:
+			return cullTrianglesScalar(cache, indexes, 0, triangleCount, viewVector, survivors);
+	}
+}
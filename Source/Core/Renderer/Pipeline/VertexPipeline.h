@@ -0,0 +1,92 @@
+#pragma once
+
+#include <vector>
+
+#include "ScanlineShader.h"
+
+#include "Core/Types.h"
+#include "Engine/Mesh.h"
+#include "Math/Vector.h"
+
+/**
+ * Shift of the guard band planes within the clip codes of the vertex cache. The planes of the view frustum itself are
+ * in the bits below it. Both use the bits of Clipping::EClipPlane.
+ **/
+constexpr int32 g_guardBandCodeShift = 8;
+
+/**
+ * Output of the vertex stage for every unique vertex of the mesh being drawn, in structure of arrays form so whole
+ * batches of triangles can be culled at once. Arrays are padded to a whole number of g_shaderBatchSize vertexes.
+ **/
+struct VertexCache
+{
+	/** Position in homogeneous clip space. **/
+	std::vector<float> positionX;
+	std::vector<float> positionY;
+	std::vector<float> positionZ;
+	std::vector<float> positionW;
+	/** World-space normal. **/
+	std::vector<float> normalX;
+	std::vector<float> normalY;
+	std::vector<float> normalZ;
+	/** Screen-space position, as `Clipping::clipVertex` projects it. Meaningless for vertexes behind the near plane. **/
+	std::vector<float> screenX;
+	std::vector<float> screenY;
+	std::vector<float> screenZ;
+	/**
+	 * Planes of the view frustum each vertex is outside of, and the planes of the guard band shifted up by
+	 * g_guardBandCodeShift.
+	 **/
+	std::vector<int32> clipCodes;
+
+	/**
+	 * @brief Resizes every array to hold at least `vertexCount` vertexes, rounded up to a whole number of batches.
+	 */
+	void resize(int32 vertexCount);
+
+	[[nodiscard]] vec4f getPosition(const int32 index) const
+	{
+		return { positionX[index], positionY[index], positionZ[index], positionW[index] };
+	}
+
+	[[nodiscard]] vec3f getNormal(const int32 index) const { return { normalX[index], normalY[index], normalZ[index] }; }
+
+	[[nodiscard]] vec3f getScreenPoint(const int32 index) const { return { screenX[index], screenY[index], screenZ[index] }; }
+
+	/**
+	 * @brief Returns the guard band planes vertex `index` is outside of, as `Clipping::getOutCode` would.
+	 */
+	[[nodiscard]] int32 getGuardBandCode(const int32 index) const { return clipCodes[index] >> g_guardBandCodeShift; }
+};
+
+/**
+ * The SIMD front end of the scanline renderer, run with the VectorMath backend. Every backend computes exactly what
+ * the scalar functions in Clipping and Math would, so they agree on every vertex and triangle.
+ */
+namespace VertexPipeline
+{
+	/**
+	 * @brief Converts `count` vertexes to structure of arrays form, zeroing the lanes of `batch` past `count`.
+	 */
+	void loadBatch(const Vertex3* vertices, int32 count, VertexBatch& batch);
+
+	/**
+	 * @brief Stores a batch output by the vertex shader in the cache, starting at vertex `first`, along with the
+	 * screen position and clip codes of each of its vertexes. Every lane of the batch is stored.
+	 */
+	void storeBatch(const VertexBatchOutput& output, int32 width, int32 height, int32 first, VertexCache& cache);
+
+	/**
+	 * @brief Culls the triangles of `indexes` which face away from the camera, lie entirely outside one plane of the
+	 * view frustum, or have zero or negative area on screen. Triangles which cross the near plane or guard band only
+	 * have their area tested once they are clipped, so may still be culled later.
+	 * @param cache The vertex cache of the mesh the triangles belong to.
+	 * @param indexes Three vertex indexes per triangle.
+	 * @param triangleCount The number of triangles in `indexes`.
+	 * @param cameraDirection The direction the camera is facing.
+	 * @param survivors Receives the index of each triangle which may be visible. Must have room for `triangleCount`.
+	 * @return The number of triangles written to `survivors`.
+	 */
+	int32 cullTriangles(const VertexCache& cache, const uint32* indexes, int32 triangleCount, const vec3f& cameraDirection,
+		uint32* survivors);
+} // namespace VertexPipeline
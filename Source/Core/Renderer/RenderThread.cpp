@@ -0,0 +1,109 @@
+#include "RenderThread.h"
+
+namespace
+{
+	/** Slots of the presentation chain. **/
+	constexpr int32 g_frontFrame = 0;
+	constexpr int32 g_readyFrame = 1;
+	constexpr int32 g_backFrame = 2;
+} // namespace
+
+RenderThread::RenderThread(const std::shared_ptr<IRHI>& rhi, Grid* grid) : m_rhi(rhi), m_grid(grid)
+{
+	for (std::shared_ptr<Texture>& frame : m_frames)
+	{
+		frame = std::make_shared<Texture>();
+	}
+	m_thread = std::thread(&RenderThread::threadLoop, this);
+}
+
+RenderThread::~RenderThread()
+{
+	{
+		std::unique_lock lock(m_mutex);
+		m_stopping = true;
+	}
+	m_submitCondition.notify_one();
+	m_thread.join();
+}
+
+void RenderThread::threadLoop()
+{
+	while (true)
+	{
+		int32 drawIndex;
+		{
+			std::unique_lock lock(m_mutex);
+			m_submitCondition.wait(lock, [&] { return m_stopping || m_drawing; });
+			if (m_stopping)
+			{
+				return;
+			}
+			drawIndex = m_captureIndex ^ 1;
+		}
+
+		drawFrame(m_snapshots[drawIndex]);
+
+		// Copy the completed frame out of the RHI, so the next frame can draw while this one is presented. RHIs
+		// which present frames themselves have no frame data.
+		if (const Texture* frameData = m_rhi->getFrameData(); frameData != nullptr)
+		{
+			*m_frames[g_backFrame] = *frameData;
+		}
+
+		{
+			std::unique_lock lock(m_mutex);
+			std::swap(m_frames[g_readyFrame], m_frames[g_backFrame]);
+			m_frameReady = true;
+			m_drawing = false;
+		}
+		m_doneCondition.notify_all();
+	}
+}
+
+void RenderThread::drawFrame(FrameSnapshot& snapshot)
+{
+	// The settings and view data are copied by the RHI, so the snapshot only has to outlive this frame
+	m_rhi->setRenderSettings(&snapshot.settings);
+	m_rhi->setViewData(&snapshot.viewData);
+	m_rhi->setFrameSnapshot(&snapshot);
+
+	m_rhi->beginDraw();
+	if (m_grid != nullptr)
+	{
+		m_rhi->drawGrid(m_grid);
+	}
+	m_rhi->draw();
+	m_rhi->endDraw();
+
+	m_rhi->setFrameSnapshot(nullptr);
+}
+
+void RenderThread::submit()
+{
+	{
+		std::unique_lock lock(m_mutex);
+		m_doneCondition.wait(lock, [&] { return !m_drawing; });
+		m_snapshots[m_captureIndex].frameIndex = m_frameIndex++;
+		m_captureIndex ^= 1;
+		m_drawing = true;
+	}
+	m_submitCondition.notify_one();
+}
+
+void RenderThread::wait()
+{
+	std::unique_lock lock(m_mutex);
+	m_doneCondition.wait(lock, [&] { return !m_drawing; });
+}
+
+Texture* RenderThread::acquireFrame()
+{
+	std::unique_lock lock(m_mutex);
+	if (m_frameReady)
+	{
+		std::swap(m_frames[g_frontFrame], m_frames[g_readyFrame]);
+		m_frameReady = false;
+	}
+	return m_frames[g_frontFrame].get();
+}
@@ -0,0 +1,108 @@
+#pragma once
+
+#include <array>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+#include "Core/Types.h"
+#include "Renderer/Grid.h"
+#include "Renderer/Texture.h"
+#include "Renderer/Pipeline/RHI.h"
+
+/** The number of frames in the presentation chain: one presented, one ready to present and one being written. **/
+constexpr int32 g_frameChainLength = 3;
+
+/**
+ * Draws frames with an RHI on a thread of its own, so the scene can be updated while the previous frame is drawn.
+ *
+ * The updating thread fills the snapshot returned by `getSnapshot` and hands it over with `submit`. Snapshots are
+ * double buffered: while one frame draws, the next is captured into the other snapshot, and `submit` only waits if
+ * that frame is still drawing. Completed frames are copied into a chain of textures, and `acquireFrame` returns the
+ * latest of them.
+ *
+ * Every other call into the RHI must go through `execute`, which waits for the frame being drawn to finish.
+ */
+class RenderThread
+{
+	std::shared_ptr<IRHI> m_rhi = nullptr;
+	/** Drawn before the renderables of every frame. **/
+	Grid* m_grid = nullptr;
+
+	std::thread				m_thread;
+	std::mutex				m_mutex;
+	std::condition_variable m_submitCondition;
+	std::condition_variable m_doneCondition;
+
+	/** The snapshot being captured by the updating thread, and the one the render thread draws from. **/
+	std::array<FrameSnapshot, 2> m_snapshots;
+	int32						 m_captureIndex = 0;
+	/** Whether the render thread has a snapshot it hasn't finished drawing. **/
+	bool m_drawing = false;
+	bool m_stopping = false;
+	/** Incremented for each snapshot submitted. **/
+	uint64 m_frameIndex = 0;
+
+	/**
+	 * Presentation chain. The front frame is read by the presenting thread, the back frame is written by the render
+	 * thread, and the ready frame is the latest completed one; each side swaps its frame with the ready one.
+	 **/
+	std::array<std::shared_ptr<Texture>, g_frameChainLength> m_frames;
+	bool													 m_frameReady = false;
+
+	void threadLoop();
+	void drawFrame(FrameSnapshot& snapshot);
+
+public:
+	RenderThread(const std::shared_ptr<IRHI>& rhi, Grid* grid);
+	~RenderThread();
+
+	RenderThread(const RenderThread&) = delete;
+	RenderThread& operator=(const RenderThread&) = delete;
+
+	/**
+	 * @brief Returns the snapshot the next frame will be drawn from. It isn't read by the render thread until it is
+	 * submitted.
+	 */
+	FrameSnapshot& getSnapshot()
+	{
+		return m_snapshots[m_captureIndex];
+	}
+
+	/**
+	 * @brief Hands the snapshot returned by `getSnapshot` to the render thread, first waiting for the previous frame
+	 * to finish drawing.
+	 */
+	void submit();
+
+	/**
+	 * @brief Blocks until the frame being drawn, if any, has finished.
+	 */
+	void wait();
+
+	/**
+	 * @brief Runs `function` on the calling thread while no frame is drawing, for changes to the RHI itself such as
+	 * resizing or adding renderables.
+	 */
+	template <typename Function>
+	void execute(Function&& function)
+	{
+		std::unique_lock lock(m_mutex);
+		m_doneCondition.wait(lock, [&] { return !m_drawing; });
+		function(m_rhi.get());
+	}
+
+	/**
+	 * @brief Returns the latest completed frame. The texture stays valid and unchanged until the next call.
+	 */
+	[[nodiscard]] Texture* acquireFrame();
+
+	/**
+	 * @brief Returns the number of snapshots submitted so far.
+	 */
+	[[nodiscard]] uint64 getFrameIndex() const
+	{
+		return m_frameIndex;
+	}
+};
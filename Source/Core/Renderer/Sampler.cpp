@@ -0,0 +1,249 @@
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <numbers>
+#include <random>
+
+#include "Sampler.h"
+#include "Core/Logging.h"
+#include "Core/Macros.h"
+#include "Engine/Timer.h"
+
+#ifdef PENG_X86
+	#include <immintrin.h>
+#endif
+
+namespace
+{
+	/** The four texels surrounding a sample point, with the blend weights between them. **/
+	struct BilinearFootprint
+	{
+		uint32 texels[4];
+		float  fracX;
+		float  fracY;
+	};
+
+	int32 wrap(const int32 value, const int32 size)
+	{
+		// Most coordinates are already within the texture, and don't need the division
+		if ((uint32)value < (uint32)size)
+		{
+			return value;
+		}
+		const int32 result = value % size;
+		return result < 0 ? result + size : result;
+	}
+
+	BilinearFootprint getFootprint(const Texture* mip, const vec2f& uv)
+	{
+		const int32 width = mip->getWidth();
+		const int32 height = mip->getHeight();
+
+		// Texel centers are at half-texel offsets
+		const float x = uv.x * (float)width - 0.5f;
+		const float y = uv.y * (float)height - 0.5f;
+		const float floorX = std::floor(x);
+		const float floorY = std::floor(y);
+
+		const int32 x0 = wrap((int32)floorX, width);
+		const int32 y0 = wrap((int32)floorY, height);
+		const int32 x1 = x0 + 1 == width ? 0 : x0 + 1;
+		const int32 y1 = y0 + 1 == height ? 0 : y0 + 1;
+
+		// Pixel indexes are separable into row and column offsets in every layout. Tiled textures usually keep all
+		// four texels in the same cache line.
+		const uint32* row0 = mip->getData<uint32>() + mip->getRowOffset(y0);
+		const uint32* row1 = mip->getData<uint32>() + mip->getRowOffset(y1);
+		const size_t  column0 = mip->getColumnOffset(x0);
+		const size_t  column1 = mip->getColumnOffset(x1);
+		return { { row0[column0], row0[column1], row1[column0], row1[column1] }, x - floorX, y - floorY };
+	}
+
+#ifdef PENG_SSE
+	/** Expands the four bytes of a texel into four floats. Only uses SSE2, which every x64 CPU supports. **/
+	__m128 unpackTexel(const uint32 texel)
+	{
+		const __m128i zero = _mm_setzero_si128();
+		const __m128i words = _mm_unpacklo_epi8(_mm_cvtsi32_si128((int32)texel), zero);
+		return _mm_cvtepi32_ps(_mm_unpacklo_epi16(words, zero));
+	}
+
+	__m128 lerp(const __m128 a, const __m128 b, const __m128 t)
+	{
+		return _mm_add_ps(a, _mm_mul_ps(_mm_sub_ps(b, a), t));
+	}
+
+	/** Blends all four channels of the footprint at once. **/
+	__m128 filterBilinear(const Texture* mip, const vec2f& uv)
+	{
+		const BilinearFootprint footprint = getFootprint(mip, uv);
+		const __m128 fracX = _mm_set1_ps(footprint.fracX);
+		const __m128 top = lerp(unpackTexel(footprint.texels[0]), unpackTexel(footprint.texels[1]), fracX);
+		const __m128 bottom = lerp(unpackTexel(footprint.texels[2]), unpackTexel(footprint.texels[3]), fracX);
+		return lerp(top, bottom, _mm_set1_ps(footprint.fracY));
+	}
+
+	/**
+	 * Rounds four float channels back into the bytes of a single texel. Blended channels stay within [0, 255], so
+	 * the signed saturation of the SSE2 pack to words never clamps them.
+	 */
+	uint32 packTexel(const __m128 channels)
+	{
+		const __m128i integers = _mm_cvtps_epi32(channels);
+		const __m128i words = _mm_packs_epi32(integers, integers);
+		return (uint32)_mm_cvtsi128_si32(_mm_packus_epi16(words, words));
+	}
+#else
+	struct TexelChannels
+	{
+		float values[4];
+	};
+
+	TexelChannels filterBilinear(const Texture* mip, const vec2f& uv)
+	{
+		const BilinearFootprint footprint = getFootprint(mip, uv);
+		TexelChannels out;
+		for (int32 channel = 0; channel < 4; channel++)
+		{
+			const int32 shift = channel * 8;
+			const float c00 = (float)((footprint.texels[0] >> shift) & 0xFF);
+			const float c10 = (float)((footprint.texels[1] >> shift) & 0xFF);
+			const float c01 = (float)((footprint.texels[2] >> shift) & 0xFF);
+			const float c11 = (float)((footprint.texels[3] >> shift) & 0xFF);
+			const float top = c00 + (c10 - c00) * footprint.fracX;
+			const float bottom = c01 + (c11 - c01) * footprint.fracX;
+			out.values[channel] = top + (bottom - top) * footprint.fracY;
+		}
+		return out;
+	}
+
+	uint32 packTexel(const TexelChannels& channels)
+	{
+		uint32 texel = 0;
+		for (int32 channel = 0; channel < 4; channel++)
+		{
+			const float value = std::clamp(std::nearbyint(channels.values[channel]), 0.0f, 255.0f);
+			texel |= (uint32)value << (channel * 8);
+		}
+		return texel;
+	}
+#endif
+} // namespace
+
+float Sampler::computeMipLevel(const Texture* texture, const vec2f& uvDx, const vec2f& uvDy)
+{
+	// Measure how many texels of the full resolution texture a single pixel covers along its longest axis
+	const float width = (float)texture->getWidth();
+	const float height = (float)texture->getHeight();
+	const float lengthX = (uvDx.x * width) * (uvDx.x * width) + (uvDx.y * height) * (uvDx.y * height);
+	const float lengthY = (uvDy.x * width) * (uvDy.x * width) + (uvDy.y * height) * (uvDy.y * height);
+	const float lengthSquared = std::max(lengthX, lengthY);
+	if (!(lengthSquared > 1.0f))
+	{
+		return 0.0f;
+	}
+
+	// log2(sqrt(x)) == 0.5 * log2(x)
+	const float level = 0.5f * std::log2(lengthSquared);
+	return std::min(level, (float)(texture->getMipCount() - 1));
+}
+
+Color Sampler::sampleBilinear(const Texture* texture, const vec2f& uv, const int32 level)
+{
+	const Texture* mip = texture->getMip(std::clamp(level, 0, texture->getMipCount() - 1));
+	return Color::fromUInt32((int32)packTexel(filterBilinear(mip, uv)));
+}
+
+Color Sampler::sampleTrilinear(const Texture* texture, const vec2f& uv, const vec2f& uvDx, const vec2f& uvDy)
+{
+	const float level = computeMipLevel(texture, uvDx, uvDy);
+	const int32 level0 = (int32)level;
+	const float blend = level - (float)level0;
+
+	// Magnified textures and exact levels only need one bilinear sample
+	if (blend <= 0.0f || level0 + 1 >= texture->getMipCount())
+	{
+		return sampleBilinear(texture, uv, level0);
+	}
+
+	const auto sample0 = filterBilinear(texture->getMip(level0), uv);
+	const auto sample1 = filterBilinear(texture->getMip(level0 + 1), uv);
+#ifdef PENG_SSE
+	return Color::fromUInt32((int32)packTexel(lerp(sample0, sample1, _mm_set1_ps(blend))));
+#else
+	TexelChannels blended;
+	for (int32 channel = 0; channel < 4; channel++)
+	{
+		blended.values[channel] = sample0.values[channel] + (sample1.values[channel] - sample0.values[channel]) * blend;
+	}
+	return Color::fromUInt32((int32)packTexel(blended));
+#endif
+}
+
+void Sampler::benchmark(const int32 textureSize, const int32 quadSize)
+{
+	// Fill the texture with noise, so neither layout gains anything from repeated texels
+	std::mt19937 generator(1337);
+	Texture		 linear(vec2i(textureSize, textureSize));
+	for (int32 y = 0; y < textureSize; y++)
+	{
+		for (int32 x = 0; x < textureSize; x++)
+		{
+			linear.setPixelFromUInt32(x, y, generator());
+		}
+	}
+	linear.generateMips();
+
+	Texture tiled(linear);
+	tiled.setLayout(ETextureLayout::Tiled);
+	const Texture* textures[] = { &linear, &tiled };
+
+	constexpr float angles[] = { 0.0f, 30.0f, 45.0f, 60.0f, 90.0f };
+	constexpr float texelsPerPixel[] = { 1.0f, 1.5f };
+	const int64		sampleCount = (int64)quadSize * quadSize;
+
+	for (const float density : texelsPerPixel)
+	{
+		for (const float angle : angles)
+		{
+			// Step across the texture along the rotated axes of the quad
+			const float radians = angle * std::numbers::pi_v<float> / 180.0f;
+			const float step = density / (float)textureSize;
+			const vec2f uvDx(std::cos(radians) * step, std::sin(radians) * step);
+			const vec2f uvDy(-std::sin(radians) * step, std::cos(radians) * step);
+
+			float  times[2];
+			uint32 checksums[2];
+			for (int32 layout = 0; layout < 2; layout++)
+			{
+				// Take the best of a few runs to reduce noise
+				times[layout] = std::numeric_limits<float>::max();
+				for (int32 run = 0; run < 3; run++)
+				{
+					uint32			checksum = 0;
+					const TimePoint start = PTimer::now();
+					for (int32 y = 0; y < quadSize; y++)
+					{
+						for (int32 x = 0; x < quadSize; x++)
+						{
+							const vec2f uv(uvDx.x * (float)x + uvDy.x * (float)y, uvDx.y * (float)x + uvDy.y * (float)y);
+							checksum += (uint32)sampleTrilinear(textures[layout], uv, uvDx, uvDy).toInt32();
+						}
+					}
+					times[layout] = std::min(times[layout], DurationMs(PTimer::now() - start).count());
+					checksums[layout] = checksum;
+				}
+			}
+
+			if (checksums[0] != checksums[1])
+			{
+				LOG_WARNING("Tiled texture sampled different colors than linear at {} degrees.", angle)
+			}
+
+			const double linearRate = (double)sampleCount / (times[0] / 1000.0) / 1000000.0;
+			const double tiledRate = (double)sampleCount / (times[1] / 1000.0) / 1000000.0;
+			LOG_INFO("{:.1f} texels/pixel at {:.0f} degrees: linear {:.2f} Msamples/s, tiled {:.2f} Msamples/s ({:.2f}x)", density, angle,
+				linearRate, tiledRate, tiledRate / linearRate)
+		}
+	}
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include "Math/Color.h"
+#include "Math/Vector.h"
+#include "Renderer/Texture.h"
+
+/**
+ * Filtered texture sampling. Texture coordinates wrap, so UVs outside of [0, 1] repeat the texture, and texel centers
+ * lie at half-texel offsets. Texels are filtered as four independent bytes, so the byte order of the texture is
+ * preserved.
+ */
+namespace Sampler
+{
+	/**
+	 * @brief Returns the mip level whose texels best match the size of a pixel, given the screen-space derivatives of
+	 * the texture coordinates.
+	 * @param texture The texture being sampled.
+	 * @param uvDx Change in UV for a one pixel step to the right.
+	 * @param uvDy Change in UV for a one pixel step down.
+	 * @return A fractional level, clamped to the mip chain of `texture`.
+	 */
+	float computeMipLevel(const Texture* texture, const vec2f& uvDx, const vec2f& uvDy);
+
+	/**
+	 * @brief Samples a single mip level of `texture`, blending the four texels nearest to `uv`.
+	 */
+	Color sampleBilinear(const Texture* texture, const vec2f& uv, int32 level = 0);
+
+	/**
+	 * @brief Samples `texture` at the mip level chosen from the UV derivatives, blending bilinear samples of the two
+	 * nearest levels.
+	 */
+	Color sampleTrilinear(const Texture* texture, const vec2f& uv, const vec2f& uvDx, const vec2f& uvDy);
+
+	/**
+	 * @brief Measures trilinear sampling throughput of a linear and a tiled texture, drawn onto quads rotated to several
+	 * angles, and logs the results.
+	 * @param textureSize Width and height of the sampled texture.
+	 * @param quadSize Width and height, in pixels, of the quad sampled at each angle.
+	 */
+	void benchmark(int32 textureSize = 1024, int32 quadSize = 512);
+} // namespace Sampler
@@ -1,5 +1,6 @@
 ﻿#pragma once
 #include "Core/Bitmask.h"
+#include "Renderer/Pipeline/DepthBuffer.h"
 
 enum ERenderFlag : uint8
 {
@@ -19,6 +20,18 @@ struct RenderSettings
 private:
 	ERenderFlag m_renderFlags = Wireframe;
 	bool m_tileRendering      = false;
+	bool m_deferredShading    = false;
+	/** Whether wireframes, normals and the grid are drawn with anti-aliased lines. **/
+	bool m_antiAliasedLines = false;
+	/**
+	 * Whether triangle edges are anti-aliased by testing coverage and depth at four samples per pixel. Each pixel is
+	 * still shaded once. Ignored by deferred shading.
+	 **/
+	bool m_multisampling = false;
+	/** How the depth buffer stores each pixel. The fixed point formats trade precision for cheaper depth tests. **/
+	EDepthFormat m_depthFormat = EDepthFormat::Float32;
+	/** Largest screen-space error, in pixels, allowed when choosing a mesh's level of detail. 0 always draws full detail. **/
+	float m_lodThreshold = 1.0f;
 
 	Color m_wireColor = Color::blue();
 	Color m_gridColor = Color::gray();
@@ -26,7 +39,7 @@ private:
 public:
 	RenderSettings()
 	{
-		m_renderFlags = Shaded | Depth;
+		m_renderFlags = Shaded | Depth | Textures | Lights;
 	}
 
 	[[nodiscard]] constexpr bool getRenderFlag(const ERenderFlag flag) const
@@ -64,6 +77,74 @@ public:
 		return m_tileRendering;
 	}
 
+	[[nodiscard]] bool getDeferredShading() const
+	{
+		return m_deferredShading;
+	}
+
+	void setDeferredShading(const bool newState)
+	{
+		m_deferredShading = newState;
+	}
+
+	bool toggleDeferredShading()
+	{
+		m_deferredShading = !m_deferredShading;
+		return m_deferredShading;
+	}
+
+	[[nodiscard]] bool getAntiAliasedLines() const
+	{
+		return m_antiAliasedLines;
+	}
+
+	void setAntiAliasedLines(const bool newState)
+	{
+		m_antiAliasedLines = newState;
+	}
+
+	bool toggleAntiAliasedLines()
+	{
+		m_antiAliasedLines = !m_antiAliasedLines;
+		return m_antiAliasedLines;
+	}
+
+	[[nodiscard]] bool getMultisampling() const
+	{
+		return m_multisampling;
+	}
+
+	void setMultisampling(const bool newState)
+	{
+		m_multisampling = newState;
+	}
+
+	bool toggleMultisampling()
+	{
+		m_multisampling = !m_multisampling;
+		return m_multisampling;
+	}
+
+	[[nodiscard]] EDepthFormat getDepthFormat() const
+	{
+		return m_depthFormat;
+	}
+
+	void setDepthFormat(const EDepthFormat newFormat)
+	{
+		m_depthFormat = newFormat;
+	}
+
+	[[nodiscard]] float getLodThreshold() const
+	{
+		return m_lodThreshold;
+	}
+
+	void setLodThreshold(const float newThreshold)
+	{
+		m_lodThreshold = newThreshold;
+	}
+
 	Color getWireColor() const
 	{
 		return m_wireColor;
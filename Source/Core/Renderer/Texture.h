@@ -1,6 +1,8 @@
 #pragma once
 
+#include <cassert>
 #include <cstdlib>
+#include <cstring>
 #include <vector>
 
 #include "Core/Array.h"
@@ -33,6 +35,23 @@ enum class ETextureByteOrder
 	BRGA
 };
 
+/**
+ * @brief The order pixels of a texture are stored in memory.
+ */
+enum class ETextureLayout : uint8
+{
+	/** Rows of pixels, one after the other. */
+	Linear,
+	/** Square tiles of g_textureTileSize pixels, stored row by row. Each tile fills a single 64-byte cache line, so
+	 * pixels which are close on screen are close in memory whichever direction the texture is sampled in. */
+	Tiled
+};
+
+/** Width and height, in pixels, of a single tile of a tiled texture. */
+constexpr int32 g_textureTileSize = 4;
+constexpr int32 g_textureTileShift = 2;
+constexpr int32 g_textureTileMask = g_textureTileSize - 1;
+
 /**
  * @brief Texture class for storing pixel data in a 2D format.
  */
@@ -48,6 +67,10 @@ class Texture
 	int32 m_channelCount = 4;
 	/** The order of RGB bytes in RGBA */
 	ETextureByteOrder m_byteOrder = ETextureByteOrder::RGBA;
+	/** The order pixels are stored in m_buffer. Row-based accessors are only valid for linear textures. */
+	ETextureLayout m_layout = ETextureLayout::Linear;
+	/** Successively halved copies of this texture, used when it is minified. Level 0 is this texture and is not stored here. */
+	std::vector<Texture> m_mips;
 
 	void _initFromApplicationType()
 	{
@@ -89,9 +112,15 @@ public:
 		memcpy(m_buffer.data(), inData->data(), inData->size());
 	}
 
-	Texture(const Texture& other) : m_buffer(other.m_buffer), m_size(other.m_size), m_pitch(other.m_pitch) {}
+	Texture(const Texture& other)
+		: m_buffer(other.m_buffer), m_size(other.m_size), m_pitch(other.m_pitch), m_layout(other.m_layout), m_mips(other.m_mips)
+	{
+	}
 
-	Texture(Texture&& other) noexcept : m_buffer(other.m_buffer), m_size(other.m_size), m_pitch(other.m_pitch) {}
+	Texture(Texture&& other) noexcept
+		: m_buffer(other.m_buffer), m_size(other.m_size), m_pitch(other.m_pitch), m_layout(other.m_layout), m_mips(std::move(other.m_mips))
+	{
+	}
 
 	Texture& operator=(const Texture& other)
 	{
@@ -102,6 +131,8 @@ public:
 		m_buffer = other.m_buffer;
 		m_size = other.m_size;
 		m_pitch = other.m_pitch;
+		m_layout = other.m_layout;
+		m_mips = other.m_mips;
 		return *this;
 	}
 
@@ -114,6 +145,8 @@ public:
 		m_buffer = other.m_buffer;
 		m_size = other.m_size;
 		m_pitch = other.m_pitch;
+		m_layout = other.m_layout;
+		m_mips = std::move(other.m_mips);
 		return *this;
 	}
 
@@ -124,6 +157,7 @@ public:
 		m_size = inSize;
 		m_pitch = inSize.x;
 		m_buffer.resize(getDataSize());
+		m_mips.clear();
 	}
 
 	void resize(const vec2i& inSize, size_t dataSize)
@@ -131,6 +165,7 @@ public:
 		m_size = inSize;
 		m_pitch = inSize.x;
 		m_buffer.resize(dataSize);
+		m_mips.clear();
 	}
 
 	/**
@@ -158,7 +193,87 @@ public:
 	 * @brief Returns the memory size of this texture in bytes.
 	 * @return The number of bytes this texture allocates.
 	 */
-	[[nodiscard]] size_t getDataSize() const { return m_size.x * m_size.y * g_bytesPerPixel; }
+	[[nodiscard]] size_t getDataSize() const { return getPixelCount() * g_bytesPerPixel; }
+
+	/**
+	 * @brief Returns the number of pixels this texture allocates, including the padding of partial tiles.
+	 */
+	[[nodiscard]] size_t getPixelCount() const
+	{
+		if (m_layout == ETextureLayout::Tiled)
+		{
+			return (size_t)getTileCountX() * ((m_size.y + g_textureTileMask) >> g_textureTileShift) * g_textureTileSize * g_textureTileSize;
+		}
+		return (size_t)m_size.x * m_size.y;
+	}
+
+	[[nodiscard]] int32 getTileCountX() const { return (m_size.x + g_textureTileMask) >> g_textureTileShift; }
+
+	[[nodiscard]] ETextureLayout getLayout() const { return m_layout; }
+
+	/**
+	 * @brief Returns the index of the pixel at [x,y] in this texture's memory, in pixels. This is always the sum of the
+	 * row offset of `y` and the column offset of `x`.
+	 */
+	[[nodiscard]] size_t getPixelIndex(const int32 x, const int32 y) const { return getRowOffset(y) + getColumnOffset(x); }
+
+	/**
+	 * @brief Returns the part of a pixel's index which only depends on its row.
+	 */
+	[[nodiscard]] size_t getRowOffset(const int32 y) const
+	{
+		if (m_layout == ETextureLayout::Linear)
+		{
+			return (size_t)y * m_pitch;
+		}
+		return ((size_t)(y >> g_textureTileShift) * getTileCountX() << (g_textureTileShift * 2)) + ((y & g_textureTileMask) << g_textureTileShift);
+	}
+
+	/**
+	 * @brief Returns the part of a pixel's index which only depends on its column.
+	 */
+	[[nodiscard]] size_t getColumnOffset(const int32 x) const
+	{
+		if (m_layout == ETextureLayout::Linear)
+		{
+			return x;
+		}
+		return ((size_t)(x >> g_textureTileShift) << (g_textureTileShift * 2)) + (x & g_textureTileMask);
+	}
+
+	/**
+	 * @brief Reorders the pixels of this texture, and each of its mips, into `newLayout`.
+	 */
+	void setLayout(const ETextureLayout newLayout)
+	{
+		if (newLayout != m_layout)
+		{
+			std::vector<uint32> pixels((size_t)m_size.x * m_size.y);
+			for (int32 y = 0; y < m_size.y; y++)
+			{
+				for (int32 x = 0; x < m_size.x; x++)
+				{
+					pixels[(size_t)y * m_size.x + x] = getPixelAsUInt32(x, y);
+				}
+			}
+
+			m_layout = newLayout;
+			m_buffer.resize(getDataSize());
+			clear();
+			for (int32 y = 0; y < m_size.y; y++)
+			{
+				for (int32 x = 0; x < m_size.x; x++)
+				{
+					setPixelFromUInt32(x, y, pixels[(size_t)y * m_size.x + x]);
+				}
+			}
+		}
+
+		for (Texture& mip : m_mips)
+		{
+			mip.setLayout(newLayout);
+		}
+	}
 
 	/**
 	 * @brief Returns the width of the texture.
@@ -182,7 +297,7 @@ public:
 	{
 		int32* ptr = (int32*)m_buffer.data();
 		int32  color = inColor.toInt32();
-		size_t size = m_size.x * m_size.y;
+		size_t size = getPixelCount();
 		std::fill(ptr, ptr + size, color);
 	}
 
@@ -193,13 +308,22 @@ public:
 	 */
 	void fill(const float value)
 	{
-		auto  ptr = (float*)m_buffer.data();
-		int32 size = m_size.x * m_size.y;
+		auto   ptr = (float*)m_buffer.data();
+		size_t size = getPixelCount();
 		std::fill(ptr, ptr + size, value);
 	}
 
+	/**
+	 * @brief Sets every byte of this texture to zero.
+	 */
+	void clear()
+	{
+		std::memset(m_buffer.data(), 0, getDataSize());
+	}
+
 	void fillRange(int32 row, int32 x0, int32 x1, const Color& inColor)
 	{
+		assert(m_layout == ETextureLayout::Linear);
 		int32* ptr = (int32*)m_buffer.data() + (row * m_pitch);
 		int32  color = inColor.toInt32();
 		std::fill(ptr + x0, ptr + x1, color);
@@ -207,6 +331,7 @@ public:
 
 	void fillRow(int32 row, const Color& inColor)
 	{
+		assert(m_layout == ETextureLayout::Linear);
 		int32* ptr = (int32*)m_buffer.data() + (row * m_pitch);
 		int32  color = inColor.toInt32();
 		std::fill(ptr, ptr + m_pitch, color);
@@ -217,28 +342,28 @@ public:
 	 * @param y The row to return.
 	 * @return A type T pointer to the row of pixels.
 	 */
-	[[nodiscard]] uint32* scanline(const int y) { return (uint32*)m_buffer.data() + (y * m_pitch); }
+	[[nodiscard]] uint32* scanline(const int y)
+	{
+		assert(m_layout == ETextureLayout::Linear);
+		return (uint32*)m_buffer.data() + (y * m_pitch);
+	}
 
-	template <typename T> [[nodiscard]] T getPixel(const int32 x, const int32 y)
+	template <typename T> [[nodiscard]] T getPixel(const int32 x, const int32 y) const
 	{
-		T* line = (T*)scanline(y);
-		return line[x];
+		return *(T*)(getData<uint32>() + getPixelIndex(x, y));
 	}
 
-	[[nodiscard]] Color getPixelAsColor(const int32 x, const int32 y)
+	[[nodiscard]] Color getPixelAsColor(const int32 x, const int32 y) const
 	{
-		uint32* line = scanline(y);
-		uint32	v = line[x];
-		return Color::fromUInt32(v);
+		return Color::fromUInt32(getPixelAsUInt32(x, y));
 	}
 
-	[[nodiscard]] uint32 getPixelAsUInt32(const int32 x, const int32 y)
+	[[nodiscard]] uint32 getPixelAsUInt32(const int32 x, const int32 y) const
 	{
-		uint32* line = scanline(y);
-		return line[x];
+		return getData<uint32>()[getPixelIndex(x, y)];
 	}
 
-	[[nodiscard]] float getPixelAsFloat(const int32 x, const int32 y)
+	[[nodiscard]] float getPixelAsFloat(const int32 x, const int32 y) const
 	{
 		uint32 pixel = getPixelAsUInt32(x, y);
 		return *(reinterpret_cast<float*>(&pixel));
@@ -246,27 +371,30 @@ public:
 
 	void setPixel(const int32 x, const int32 y, const uint8 color)
 	{
+		assert(m_layout == ETextureLayout::Linear);
 		uint8* line = m_buffer.data() + (y * m_pitch);
 		line[x] = color;
 	}
 
+	void setPixelFromUInt32(const int32 x, const int32 y, const uint32 value)
+	{
+		getData<uint32>()[getPixelIndex(x, y)] = value;
+	}
+
 	void setPixelFromColor(const int32 x, const int32 y, const Color& color)
 	{
-		auto line = (uint32*)m_buffer.data();
-		line += (y * m_pitch);
-		line[x] = color.toInt32();
+		setPixelFromUInt32(x, y, color.toInt32());
 	}
 
 	void setPixelFromFloat(const int32 x, const int32 y, float value)
 	{
-		uint32* line = (uint32*)m_buffer.data();
-		line += (y * m_pitch);
 		auto* castInt = reinterpret_cast<uint32*>(&value);
-		line[x] = *castInt;
+		setPixelFromUInt32(x, y, *castInt);
 	}
 
 	void setRow(const int32 row, const Color& color)
 	{
+		assert(m_layout == ETextureLayout::Linear);
 		auto line = (uint32*)m_buffer.data();
 		line += (row * m_pitch);
 		int32 value = color.toInt32();
@@ -313,7 +441,11 @@ public:
 		}
 	}
 
-	void flipVertical() { Texture::flipVertical(m_buffer.data(), m_size.x, m_size.y); }
+	void flipVertical()
+	{
+		assert(m_layout == ETextureLayout::Linear);
+		Texture::flipVertical(m_buffer.data(), m_size.x, m_size.y);
+	}
 
 	// Swap the RGBA bytes for BGRA
 	void setByteOrder(ETextureByteOrder newOrder)
@@ -373,4 +505,65 @@ public:
 	}
 
 	void addAlphaChannel() {}
+
+	/**
+	 * @brief Builds the mip chain of this texture, halving its size down to a single pixel. Each pixel of a level is
+	 * the average of the 2x2 pixels above it.
+	 */
+	void generateMips()
+	{
+		m_mips.clear();
+
+		int32 levelCount = 0;
+		for (vec2i size = m_size; size.x > 1 || size.y > 1; size = vec2i(std::max(size.x / 2, 1), std::max(size.y / 2, 1)))
+		{
+			levelCount++;
+		}
+		m_mips.reserve(levelCount);
+
+		for (int32 level = 0; level < levelCount; level++)
+		{
+			const Texture& source = level == 0 ? *this : m_mips[level - 1];
+			const int32	   sourceWidth = source.getWidth();
+			const int32	   sourceHeight = source.getHeight();
+
+			// Each level keeps the layout of the texture
+			Texture& mip = m_mips.emplace_back(vec2i(std::max(sourceWidth / 2, 1), std::max(sourceHeight / 2, 1)));
+			mip.m_layout = m_layout;
+			mip.m_buffer.resize(mip.getDataSize());
+			for (int32 y = 0; y < mip.getHeight(); y++)
+			{
+				// Odd sizes reuse the last row or column of the source
+				const int32 y0 = std::min(y * 2, sourceHeight - 1);
+				const int32 y1 = std::min(y * 2 + 1, sourceHeight - 1);
+				for (int32 x = 0; x < mip.getWidth(); x++)
+				{
+					const int32 x0 = std::min(x * 2, sourceWidth - 1);
+					const int32 x1 = std::min(x * 2 + 1, sourceWidth - 1);
+
+					const uint32 p00 = source.getPixelAsUInt32(x0, y0);
+					const uint32 p10 = source.getPixelAsUInt32(x1, y0);
+					const uint32 p01 = source.getPixelAsUInt32(x0, y1);
+					const uint32 p11 = source.getPixelAsUInt32(x1, y1);
+					uint32		 out = 0;
+					for (uint32 shift = 0; shift < 32; shift += 8)
+					{
+						const uint32 sum = ((p00 >> shift) & 0xFF) + ((p10 >> shift) & 0xFF) + ((p01 >> shift) & 0xFF) + ((p11 >> shift) & 0xFF);
+						out |= ((sum + 2) >> 2) << shift;
+					}
+					mip.setPixelFromUInt32(x, y, out);
+				}
+			}
+		}
+	}
+
+	/**
+	 * @brief Returns the number of mip levels of this texture, including the texture itself.
+	 */
+	[[nodiscard]] int32 getMipCount() const { return (int32)m_mips.size() + 1; }
+
+	/**
+	 * @brief Returns the mip level `level`, where level 0 is this texture.
+	 */
+	[[nodiscard]] const Texture* getMip(const int32 level) const { return level == 0 ? this : &m_mips[level - 1]; }
 };
@@ -154,6 +154,27 @@ void Painter::drawRect(recti r, const Color& color, int32 thickness)
 	}
 }
 
+void Painter::drawTexture(Texture* texture, const vec2i& position)
+{
+	assertValid();
+
+	// Clamp the texture to the current viewport size
+	const int32 minX = std::max(position.x, 0);
+	const int32 minY = std::max(position.y, 0);
+	const int32 maxX = std::min(position.x + texture->getWidth(), m_viewport.max().x);
+	const int32 maxY = std::min(position.y + texture->getHeight(), m_viewport.max().y);
+	if (minX >= maxX)
+	{
+		return;
+	}
+
+	for (int32 row = minY; row < maxY; row++)
+	{
+		const uint32* source = texture->scanline(row - position.y) + (minX - position.x);
+		std::copy(source, source + (maxX - minX), m_texture->scanline(row) + minX);
+	}
+}
+
 void Painter::drawRectFilled(recti r, const Color& color)
 {
 	assertValid();
@@ -108,5 +108,11 @@ public:
 
 	void drawGlyphTexture(const GlyphTexture* ft, const vec2i& pos);
 
+	/**
+	 * @brief Copies every pixel of `texture` to the target with its top left corner at `position`, clipped to the
+	 * current viewport.
+	 */
+	void drawTexture(Texture* texture, const vec2i& position);
+
 	void drawText(const vec2i& pos, const std::string& text);
 };
\ No newline at end of file
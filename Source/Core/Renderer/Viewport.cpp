@@ -22,6 +22,9 @@ Viewport::Viewport(const int32 inWidth, const int32 inHeight)
 
 Viewport::~Viewport()
 {
+	// Finish the frame in flight before the RHI is shut down
+	m_renderThread.reset();
+
 	if (m_rhi != nullptr)
 	{
 		m_rhi->shutdown();
@@ -36,7 +39,14 @@ void Viewport::resize(const int32 inWidth, const int32 inHeight) const
 {
 	m_camera->m_width  = inWidth;
 	m_camera->m_height = inHeight;
-	m_rhi->resize(inWidth, inHeight);
+	if (m_renderThread != nullptr)
+	{
+		m_renderThread->execute([&](IRHI* rhi) { rhi->resize(inWidth, inHeight); });
+	}
+	else
+	{
+		m_rhi->resize(inWidth, inHeight);
+	}
 }
 
 int32 Viewport::getWidth() const
@@ -71,29 +81,23 @@ void Viewport::resetView() const
 
 void Viewport::draw()
 {
-	if (m_rhi != nullptr)
+	if (m_renderThread != nullptr)
 	{
-		// Transfer render settings
-		m_rhi->setRenderSettings(&m_settings);
-
-		// Update camera data
-		m_rhi->setViewData(m_camera->getViewData());
-
-		// Draw all geometry
-		m_rhi->beginDraw();
-
-		// Called prior to drawing geometry, draws the world grid
-		m_rhi->drawGrid(m_grid.get());
+		// Bring the world matrices and bounds of every actor which moved since the last frame up to date
+		Actor::updateTransforms();
 
-		// Draw each renderable object
-		m_rhi->draw();
+		// Capture everything the frame reads, so the scene can change as soon as it is submitted
+		FrameSnapshot& snapshot = m_renderThread->getSnapshot();
+		snapshot.settings = m_settings;
+		snapshot.viewData = *m_camera->getViewData();
+		m_rhi->captureFrame(snapshot);
 
-		// Called after drawing geometry
-		m_rhi->endDraw();
+		// Draw the grid and each renderable object on the render thread
+		m_renderThread->submit();
 	}
 	else
 	{
-		LOG_ERROR("Render Pipeline is not set. (Renderer::beginDraw)")
+		LOG_ERROR("Render Pipeline is not initialized. (Viewport::draw)")
 	}
 }
 
@@ -109,7 +113,7 @@ bool Viewport::createRHI()
 	return true;
 }
 
-bool Viewport::initRHI(void* windowHandle) const
+bool Viewport::initRHI(void* windowHandle)
 {
 	if (!m_rhi->init(windowHandle))
 	{
@@ -117,6 +121,7 @@ bool Viewport::initRHI(void* windowHandle) const
 	}
 
 	m_rhi->setViewData(m_camera->getViewData());
+	m_renderThread = std::make_unique<RenderThread>(m_rhi, m_grid.get());
 
 	return true;
 }
@@ -126,6 +131,55 @@ IRHI* Viewport::getRHI() const
 	return m_rhi.get();
 }
 
+void Viewport::addRenderable(IRenderable* renderable) const
+{
+	if (m_renderThread != nullptr)
+	{
+		m_renderThread->execute([&](IRHI* rhi) { rhi->addRenderable(renderable); });
+	}
+	else
+	{
+		m_rhi->addRenderable(renderable);
+	}
+}
+
+void Viewport::addLight(Light* light) const
+{
+	if (m_renderThread != nullptr)
+	{
+		m_renderThread->execute([&](IRHI* rhi) { rhi->addLight(light); });
+	}
+	else
+	{
+		m_rhi->addLight(light);
+	}
+}
+
+Texture* Viewport::getFrame() const
+{
+	return m_renderThread != nullptr ? m_renderThread->acquireFrame() : nullptr;
+}
+
+IRenderable* Viewport::pickRenderable(const vec2i& position) const
+{
+	// Projected screen positions are measured from the bottom of the viewport
+	const vec2f screenPosition(static_cast<float>(position.x) + 0.5f, static_cast<float>(getHeight() - position.y) - 0.5f);
+
+	vec3f origin;
+	vec3f direction;
+	if (!Math::deprojectScreenToWorld(screenPosition, *m_camera->getViewData(), origin, direction))
+	{
+		return nullptr;
+	}
+
+	// The bounds of actors which moved since the last frame are only updated along with their world matrices
+	Actor::updateTransforms();
+
+	RaycastHit hit;
+	g_objectManager.getRenderableTree()->raycast(origin, direction, hit);
+	return hit.renderable;
+}
+
 void Viewport::formatDebugText()
 {
 	m_debugText          = std::format(
@@ -9,11 +9,14 @@
 #include "Core/Types.h"
 #include "Math/MathCommon.h"
 #include "Pipeline/RHI.h"
+#include "RenderThread.h"
 
 class Viewport
 {
 	std::unique_ptr<Grid> m_grid;
 	std::shared_ptr<IRHI> m_rhi;
+	/** Draws frames from snapshots of the scene once the RHI is initialized. **/
+	std::unique_ptr<RenderThread> m_renderThread;
 
 public:
 	/* Render settings. */
@@ -40,10 +43,39 @@ public:
 
 	/** Render pipeline **/
 
+	/**
+	 * @brief Captures a snapshot of the camera, render settings and scene, and submits it to the render thread. Only
+	 * waits if the previous frame is still drawing, so the scene can be updated while this frame draws.
+	 */
 	void draw();
 	bool createRHI();
-	bool initRHI(void* windowHandle) const;
+	bool initRHI(void* windowHandle);
+	/**
+	 * @brief Returns the RHI. Once it is initialized, it is only safe to call while no frame is drawing; see
+	 * `RenderThread::execute`.
+	 */
 	[[nodiscard]] IRHI* getRHI() const;
+	/**
+	 * @brief Adds `renderable` to the RHI, waiting for the frame being drawn to finish.
+	 */
+	void addRenderable(IRenderable* renderable) const;
+	/**
+	 * @brief Adds `light` to the RHI, waiting for the frame being drawn to finish.
+	 */
+	void addLight(Light* light) const;
+	/**
+	 * @brief Returns the latest completed frame, or nullptr if the RHI isn't initialized. The texture is unchanged
+	 * until the next call.
+	 */
+	[[nodiscard]] Texture* getFrame() const;
+
+	/** Picking **/
+
+	/**
+	 * @brief Returns the renderable under `position`, measured in pixels from the top left of the viewport, or
+	 * nullptr if there is none.
+	 */
+	[[nodiscard]] IRenderable* pickRenderable(const vec2i& position) const;
 
 	/** Debug **/
 
@@ -1,5 +1,8 @@
 
 #include "EditorEngine.h"
+#include "Importers/MeshImporter.h"
+#include "Importers/ResourceManager.h"
+#include "Renderer/Viewport.h"
 #include "Renderer/UI/Widget.h"
 #include "Editor.h"
 
@@ -19,11 +22,44 @@ bool EditorEngine::initialize(IApplication* app)
 
 bool EditorEngine::shutdown()
 {
+	m_viewport = nullptr;
+	m_selection = nullptr;
+	if (m_exampleActor != nullptr)
+	{
+		g_objectManager.destroyObject(m_exampleActor);
+		m_exampleActor = nullptr;
+	}
+	m_exampleMesh.reset();
 	return true;
 }
 
 void EditorEngine::tick(float deltaTime) {}
 
+void EditorEngine::onViewportCreated(Viewport* viewport)
+{
+	m_viewport = viewport;
+	loadExampleScene(viewport);
+
+	// Building the tree over the whole scene gives tighter bounds than the inserts made as it loaded
+	g_objectManager.rebuildRenderableTree();
+}
+
+void EditorEngine::onLeftMouseDown(MouseData& mouse)
+{
+	// Clicks handled by the UI don't select anything
+	if (m_viewport == nullptr || mouse.inputConsumed)
+	{
+		return;
+	}
+
+	const vec2i position((int32)mouse.clickPosition.x, (int32)mouse.clickPosition.y);
+	m_selection = m_viewport->pickRenderable(position);
+	if (m_selection != nullptr)
+	{
+		LOG_INFO("Selected the renderable under {}.", position.toString())
+	}
+}
+
 void EditorEngine::constructUI()
 {
 	createMainWindow();
@@ -84,3 +120,19 @@ void EditorEngine::createNewWindow()
 {
 	m_newWindow = m_application->createWindow(m_mainWindow, std::string("New Window"), vec2i(200,300), 0);
 }
+
+void EditorEngine::loadExampleScene(Viewport* viewport)
+{
+	const std::string fileName = ResourceManager::getResourceFileName("Examples\\Teapot.obj");
+	m_exampleMesh = std::make_unique<Mesh>();
+	if (fileName.empty() || !ObjImporter::importCached(fileName, m_exampleMesh.get()))
+	{
+		LOG_ERROR("Failed to load the example mesh.")
+		m_exampleMesh.reset();
+		return;
+	}
+
+	m_exampleActor = g_objectManager.createObject<StaticMeshActor>();
+	m_exampleActor->setMesh(m_exampleMesh.get());
+	viewport->addRenderable(m_exampleActor);
+}
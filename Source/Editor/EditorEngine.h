@@ -1,6 +1,7 @@
 #pragma once
 
 #include "Engine/Engine.h"
+#include "Engine/Actors/StaticMeshActor.h"
 #include "Platforms/Generic/GenericApplication.h"
 
 inline EditorEngine* g_editor = nullptr;
@@ -27,13 +28,28 @@ protected:
 
 	std::shared_ptr<GenericWindow> m_newWindow;
 
+	// Scene
+	Viewport*			  m_viewport = nullptr;
+	std::unique_ptr<Mesh> m_exampleMesh;
+	StaticMeshActor*	  m_exampleActor = nullptr;
+	/** The renderable last clicked in the viewport, or nullptr if the click missed. **/
+	IRenderable* m_selection = nullptr;
+
 public:
 	static Engine* create();
 	bool		   initialize(IApplication* app) override;
 	bool		   shutdown() override;
 	void		   tick(float deltaTime) override;
+	void		   onViewportCreated(Viewport* viewport) override;
+	void		   onLeftMouseDown(MouseData& mouse) override;
 
 	void constructUI();
 	void createMainWindow();
 	void createNewWindow();
+
+	/**
+	 * @brief Adds the example mesh to the scene drawn in `viewport`. It is loaded from its .pmesh cache when that is
+	 * up to date, so only the first launch after the OBJ file changes parses it.
+	 */
+	void loadExampleScene(Viewport* viewport);
 };